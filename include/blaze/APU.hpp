@@ -0,0 +1,200 @@
+#pragma once
+
+#include <blaze/BBus.hpp>
+#include <blaze/DSP.hpp>
+#include <blaze/MemTypes.hpp>
+#include <blaze/Scheduler.hpp>
+#include <blaze/SPC700.hpp>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Blaze {
+	struct Bus;
+	class StateWriter;
+	class StateReader;
+
+	//
+	// The audio processing unit: the SPC700 and the S-DSP, with their own 64 KiB of RAM, running on their own clock. The
+	// only connection to the rest of the machine is 4 bytes of ports in each direction, which the CPU sees on the B-bus at
+	// $40 through $43 (mirrored up to $7F).
+	//
+	// Since the ports are all there is, the APU doesn't have to run in lockstep with the CPU: it can run on its own
+	// thread, as long as it sees the CPU's port writes at the right times and is caught up whenever the CPU reads a port.
+	//
+	//   - every port write is queued with the master cycle it happened at (in a lock-free single-producer queue), and the
+	//     APU applies it when it gets to that point;
+	//   - the bus publishes how far the CPU has gotten (`publish`) after every batch. the APU's thread runs up to there
+	//     and no further, so it never gets ahead of a port write it hasn't seen yet;
+	//   - port reads bring the APU up to the current time (`sync`) before returning the port's value. if the APU's thread
+	//     is busy, this waits for it; otherwise, the reading thread runs the APU itself, which is quicker than waking the
+	//     thread up for the few cycles between two reads of a polling loop.
+	//
+	// The APU is only ever run by whoever holds `_runMutex`, so it runs exactly the same way no matter which thread ends
+	// up doing it (or whether it has a thread at all; without one, it only runs in `sync`).
+	//
+	// The CPU's time is only known at the start of each batch (see `Scheduler::now`), so a port access ends the batch it's
+	// in, which keeps the timestamps of polling loops close.
+	//
+	class APU: public BBusDevice {
+	public:
+		static constexpr size_t ARAM_SIZE = 0x10000;
+
+		// the SPC700's clock (a 24.576 MHz crystal divided by 24), and how many of its cycles an output sample takes
+		static constexpr uint64_t CLOCK_HZ = 1'024'000;
+		static constexpr unsigned CYCLES_PER_SAMPLE = 32;
+		static constexpr unsigned SAMPLE_RATE = CLOCK_HZ / CYCLES_PER_SAMPLE;
+
+		// the IPL ROM (the boot program that receives the rest from the CPU), mapped over the top of RAM
+		static constexpr Word IPL_ADDRESS = 0xffc0;
+		static constexpr size_t IPL_SIZE = 64;
+
+		// the APU's thread only gets woken up once it's at least this far behind
+		static constexpr MasterCycles WAKE_INTERVAL = MASTER_CYCLES_PER_SCANLINE * 16;
+
+		// output samples are handed to `sampleHook` this many at a time
+		static constexpr size_t SAMPLE_CHUNK_FRAMES = 256;
+
+		//=== Components ===
+		// (anything writing to this directly rather than through `write` has to tell the DSP, with `dsp.aramWritten`)
+		std::array<Byte, ARAM_SIZE> aram {};
+		SPC700 spc;
+		DSP dsp { aram.data() };
+
+		// receives the output (interleaved 16-bit stereo, `frames` pairs of samples at `SAMPLE_RATE`). it's called on
+		// whichever thread is running the APU, which is usually the APU's own thread.
+		std::function<void(const int16_t* samples, size_t frames)> sampleHook;
+
+		//=== Constructor & Destructor ===
+		APU();
+		~APU();
+
+		APU(const APU&) = delete;
+		APU& operator=(const APU&) = delete;
+
+		void reset(Bus* bus);
+
+		//=== Threading ===
+		// the APU can be moved onto its own thread at any time (and back off of it)
+		void startThread();
+		void stopThread();
+
+		bool threaded() const {
+			return _thread.joinable();
+		};
+
+		// lets the APU run up to the given point on the master clock (on its own thread; this doesn't wait for it)
+		void publish(MasterCycles time);
+
+		// brings the APU up to the given point on the master clock before returning
+		void sync(MasterCycles time);
+
+		// how far the APU has gotten
+		MasterCycles time() const {
+			return _time.load(std::memory_order_acquire);
+		};
+
+		//=== SPC700 address space ===
+		Byte read(Word address) {
+			if ((address & 0xfff0) == 0x00f0) {
+				return readIO(address);
+			}
+			if (address >= IPL_ADDRESS && _iplEnabled) {
+				return IPL_ROM[address - IPL_ADDRESS];
+			}
+			return aram[address];
+		};
+
+		void write(Word address, Byte value) {
+			if ((address & 0xfff0) == 0x00f0) {
+				writeIO(address, value);
+			}
+			// (writes always go to RAM, even where the registers or the IPL ROM are mapped)
+			aram[address] = value;
+			dsp.aramWritten(address);
+		};
+
+		//=== BBusDevice ===
+		Byte readB(Byte address) override;
+		void writeB(Byte address, Byte value) override;
+
+		// the state is always taken as of how far the APU has gotten (see `time`), with any port writes it hasn't seen
+		// yet included
+		void saveState(StateWriter& writer) const;
+		void loadState(StateReader& reader);
+
+	private:
+		static const std::array<Byte, IPL_SIZE> IPL_ROM;
+
+		Bus* _bus = nullptr;
+
+		//=== I/O registers ($F0 through $FF) ===
+		struct Timer {
+			bool enabled = false;
+			Byte target = 0; // (0 means 256)
+			Byte stage = 0; // counts up to the target
+			Byte counter = 0; // counts how many times it got there (4 bits; cleared when read)
+			unsigned cycles = 0; // towards the next step of `stage`
+		};
+
+		std::array<Timer, 3> _timers {};
+		bool _iplEnabled = true;
+		Byte _dspAddress = 0;
+		std::array<Byte, 4> _inputPorts {}; // written by the CPU
+		std::array<Byte, 4> _outputPorts {}; // written by the SPC700
+
+		Byte readIO(Word address);
+		void writeIO(Word address, Byte value);
+
+		//=== Running ===
+		// how far (on the master clock) the APU has gotten, and how far the CPU has said it can go
+		std::atomic<MasterCycles> _time { 0 };
+		std::atomic<MasterCycles> _horizon { 0 };
+
+		// the part of an SPC700 cycle that `_time` is past the last whole one (in units of 1 / MASTER_CLOCK_HZ)
+		uint64_t _clockRemainder = 0;
+		// SPC700 cycles that are due but haven't been run yet (instructions can overshoot, which makes this negative)
+		int64_t _cyclesDue = 0;
+		unsigned _sampleCycles = 0;
+
+		std::vector<int16_t> _samples;
+
+		// held by whoever is running the APU
+		mutable std::mutex _runMutex;
+
+		// runs the APU up to the given time, applying any queued port writes up to there on the way
+		void catchUp(MasterCycles time);
+		void runTo(MasterCycles time);
+		void runCycles(uint64_t cycles);
+		void runTimers(unsigned cycles);
+		void flushSamples();
+
+		//=== Port write queue ===
+		struct PortWrite {
+			MasterCycles time;
+			Byte port;
+			Byte value;
+		};
+
+		static constexpr size_t QUEUE_SIZE = 1024;
+		std::array<PortWrite, QUEUE_SIZE> _queue {};
+		std::atomic<size_t> _queueHead { 0 }; // only the CPU moves this
+		std::atomic<size_t> _queueTail { 0 }; // only whoever holds `_runMutex` moves this
+
+		//=== Thread ===
+		std::thread _thread;
+		std::mutex _wakeMutex;
+		std::condition_variable _wake;
+		std::atomic<bool> _sleeping { false };
+		std::atomic<bool> _stopRequested { false };
+
+		void threadMain();
+	};
+} // namespace Blaze
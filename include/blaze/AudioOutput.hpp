@@ -0,0 +1,85 @@
+#pragma once
+
+#include <blaze/SampleRing.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Blaze {
+	//
+	// Carries the APU's output over to an audio device running on its own clock.
+	//
+	// The emulation side pushes samples (at `APU::SAMPLE_RATE`) into a `SampleRing`, and the device's callback pulls
+	// them out resampled to the device's rate. The two clocks never quite agree (the emulation is paced by the system
+	// clock, the device by its own crystal), so the ratio is nudged by up to `MAX_RATE_ADJUSTMENT` either way depending
+	// on how full the ring is: fuller than the target latency and the output consumes slightly faster, emptier and
+	// slightly slower. that keeps the ring hovering around the target without ever blocking the emulation, at a pitch
+	// change nobody can hear.
+	//
+	// If the ring does run dry (e.g. while the emulation is stopped), the output goes silent and waits for the ring to
+	// fill back up to the target before starting again, rather than crackling along at the edge.
+	//
+	class AudioOutput {
+	public:
+		static constexpr size_t CHANNELS = SampleRing::CHANNELS;
+
+		// 0.5%, or about a twelfth of a semitone
+		static constexpr double MAX_RATE_ADJUSTMENT = 0.005;
+
+		// how quickly the fill level the rate is based on follows the actual one (per `pull`). the emulation produces
+		// samples in bursts of a frame or so, and following each burst would make the pitch wobble.
+		static constexpr double FILL_SMOOTHING = 1.0 / 32;
+
+		// how much audio (in input frames) to keep buffered by default; about 50 ms at 32 kHz
+		static constexpr size_t DEFAULT_LATENCY_FRAMES = 1600;
+
+		AudioOutput(unsigned inputRate, unsigned outputRate, size_t latencyFrames = DEFAULT_LATENCY_FRAMES);
+
+		//=== Producer (the emulation) ===
+		// never blocks; whatever doesn't fit is dropped
+		void push(const int16_t* samples, size_t frames);
+
+		//=== Consumer (the audio device) ===
+		// always fills in all the frames, with silence if there's nothing to play
+		void pull(int16_t* samples, size_t frames);
+
+		// the input frames per output frame used by the last `pull`
+		double ratio() const {
+			return _ratio.load(std::memory_order_relaxed);
+		};
+
+		size_t buffered() const {
+			return _ring.available();
+		};
+
+		// how many frames had to be dropped because the ring was full, and how many times it ran dry
+		uint64_t droppedFrames() const {
+			return _droppedFrames.load(std::memory_order_relaxed);
+		};
+		uint64_t underruns() const {
+			return _underruns.load(std::memory_order_relaxed);
+		};
+
+	private:
+		SampleRing _ring;
+		double _baseRatio;
+		size_t _targetFrames;
+
+		std::atomic<double> _ratio;
+		std::atomic<uint64_t> _droppedFrames { 0 };
+		std::atomic<uint64_t> _underruns { 0 };
+
+		//=== Consumer state ===
+		// the last 4 input frames (oldest first); the output is interpolated between the middle two
+		std::array<std::array<int32_t, CHANNELS>, 4> _history {};
+		double _position = 0; // between the middle two
+		double _fill = 0; // (smoothed; see `FILL_SMOOTHING`)
+		bool _playing = false; // (false until the ring has filled up to the target)
+
+		// the input frames read for the current `pull` (allocated up front, since the callback shouldn't allocate)
+		std::vector<int16_t> _input;
+	};
+} // namespace Blaze
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <blaze/MemTypes.hpp>
+#include <blaze/MMIO.hpp>
+
+#include <array>
+#include <cstddef>
+
+namespace Blaze {
+	// A device on the B-bus (see `BBus`). It's given the 8-bit B-bus address of the register being accessed.
+	class BBusDevice {
+	public:
+		virtual ~BBusDevice() = default;
+
+		virtual Byte readB(Byte address) = 0;
+		virtual void writeB(Byte address, Byte value) = 0;
+
+		// a fast path for DMA: writes `size` bytes from `data` to the register at `address`, or (when `alternating` is set)
+		// alternately to the registers at `address` and `address + 1`, starting with `address`.
+		//
+		// the result has to be the same as calling `writeB` for each byte. devices that can do that faster (e.g. by copying
+		// into their memory directly) override this; returning false makes the DMA write the bytes one at a time instead.
+		virtual bool writeBlockB(Byte address, bool alternating, const Byte* data, size_t size) {
+			return false;
+		};
+	};
+
+	//
+	// The SNES's second address bus, which the PPU, the APU's communication ports, and the WRAM ports are on.
+	//
+	// B-bus addresses are only 8 bits wide. The CPU sees them at $2100 through $21FF (in banks $00 through $3F and $80
+	// through $BF), and DMA channels access them directly (see `DMA`).
+	//
+	class BBus: public MMIODevice {
+	public:
+		// makes `device` handle the registers from `first` through `last` (inclusive)
+		void attach(Byte first, Byte last, BBusDevice* device);
+
+		// registers with nothing attached read open bus
+		Byte read(Byte address);
+		void write(Byte address, Byte value);
+
+		// see `BBusDevice::writeBlockB`. returns false if the device(s) at the given address(es) can't do it.
+		bool writeBlock(Byte address, bool alternating, const Byte* data, size_t size);
+
+		//=== MMIODevice ===
+		// the bus maps this to the page at $2000 through $2FFF, with the 16-bit address as the offset
+		Byte read8(Address offset) override;
+		Word read16(Address offset) override;
+		Address read24(Address offset) override;
+
+		void write8(Address offset, Byte value) override;
+		void write16(Address offset, Word value) override;
+		void write24(Address offset, Address value) override;
+
+		void reset(Bus* bus) override;
+
+	private:
+		Bus* _bus = nullptr;
+		std::array<BBusDevice*, 256> _devices {};
+	};
+} // namespace Blaze
@@ -1,9 +1,18 @@
 #pragma once
 
+#include <blaze/APU.hpp>
+#include <blaze/BBus.hpp>
 #include <blaze/CPU.hpp>
+#include <blaze/DMA.hpp>
 #include <blaze/MemRam.hpp>
 #include <blaze/ROM.hpp>
 #include <blaze/MMIO.hpp>
+#include <blaze/PPU.hpp>
+#include <blaze/Scheduler.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
 
 namespace Blaze
 {
@@ -13,11 +22,25 @@ namespace Blaze
 		CPU cpu;
 		MemRam ram;
 		ROM rom;
+		BBus bBus;
+
+		//=== Timing ===
+		Scheduler scheduler;
+
+		// these register their events with the scheduler, so they have to come after it
+		DMA dma { scheduler };
+		PPU ppu { scheduler };
+
+		// this one runs on its own clock (and maybe its own thread), and only hears about the time through `runFor`
+		APU apu;
 
 		//=== Constructor & Destructor ===
 		Bus();
 
 		//=== Bus Functionality ===
+		// accesses to addresses with nothing mapped behave like open bus on the real hardware: reads return the last value
+		// that was on the data bus (`openBus`), and writes are dropped. they're counted in `unmappedAccesses`, and reported
+		// to `faultHook` (if set), e.g. for debugging.
 		void write(Address addr, Byte data); 	// write8
 		void write(Address addr, Word data); 	// write16
 		void write(Address addr, Address data); // write 24
@@ -27,7 +50,143 @@ namespace Blaze
 
 		void reset();
 
+		//=== Open Bus ===
+		// the last byte that was read or written (see above)
+		Byte openBus = 0;
+
+		uint64_t unmappedAccesses = 0;
+		std::function<void(Address address, bool isWrite)> faultHook;
+
+		// devices call these for the registers they don't implement.
+		// they're kept out of line, since they're rare and shouldn't bloat the fast paths.
+		Byte unmappedRead(Address address);
+		void unmappedWrite(Address address);
+
+		//=== Running ===
+		enum class RunResult {
+			// the requested time has passed (for `runFrame`, the frame is over)
+			Finished,
+
+			// the CPU is about to execute an instruction at one of the `breakpoints`
+			Breakpoint,
+
+			// the CPU executed `STP` (or the custom halt opcode)
+			Stopped,
+		};
+
+		// the CPU never runs for longer than this without checking on the rest of the machine
+		static constexpr MasterCycles MAX_BATCH_CYCLES = MASTER_CYCLES_PER_FRAME;
+
+		// 24-bit addresses the CPU stops at (before executing the instruction there). while there are any, the CPU runs one
+		// instruction at a time, which is a lot slower than running batches.
+		std::vector<Address> breakpoints;
+
+		// the total number of instructions `runFor` and `runFrame` have executed
+		uint64_t instructionsExecuted = 0;
+
+		// runs the whole machine for (at least) the given number of master cycles.
+		//
+		// the CPU runs in batches that last until the next scheduled event, so this only returns early when the CPU hits a
+		// breakpoint or stops. the first instruction is always executed, even if it's at a breakpoint, so calling this again
+		// after hitting one continues past it.
+		//
+		// the APU is told how far the CPU has gotten after every batch, and is caught up before this returns.
+		RunResult runFor(MasterCycles cycles);
+
+		// runs until the next frame boundary (every `MASTER_CYCLES_PER_FRAME` on the master clock)
+		RunResult runFrame();
+
+		//=== Save States ===
+		// the number of bytes `saveState` needs for the current state
+		size_t saveStateSize() const;
+
+		// writes the state of the whole machine into the given buffer, returning the number of bytes written.
+		// throws if the buffer is too small.
+		size_t saveState(Byte* buffer, size_t size) const;
+
+		// restores a state written by `saveState`. the same ROM needs to be loaded already.
+		// throws if the state is invalid, from a different version, or for a different ROM; the machine is left
+		// untouched when that's detected up front (bad header or ROM), but truncated states can leave it partially loaded.
+		void loadState(const Byte* buffer, size_t size);
+
+		// copies `size` bytes between two ranges of directly accessible memory (e.g. for block moves), given by their lowest
+		// addresses. the result is the same as copying them one at a time in ascending (or descending) order would be.
+		//
+		// if either range isn't directly accessible or crosses a page, or if the ranges overlap in a way that copying them
+		// one at a time would read bytes that were already overwritten, nothing is copied and this returns false.
+		bool copyDirect(Address destination, Address source, Address size, bool descending);
+
+		// rebuilds the page table used to map addresses to devices.
+		// this needs to be called whenever the mapping changes (e.g. when a new ROM is loaded); `reset` does this automatically.
+		void updateMemoryMap();
+
+		// how many master cycles a CPU access to the given address takes
+		Byte accessCycles(Address address) const {
+			return pageForAddress(address).accessCycles;
+		};
+
+		// whether the ROM area of banks $80 through $FF is accessed at the fast speed (FastROM, bit 0 of MEMSEL at $420D).
+		// the DMA device forwards MEMSEL writes here; `reset` turns it off.
+		bool fastROM() const {
+			return _fastROM;
+		};
+		void setFastROM(bool enabled);
+
+		// lets the CPU's decode cache drop anything it decoded from RAM that was just written to. writes through the bus do
+		// this automatically; devices that write to RAM some other way (like the WRAM ports) have to call it themselves.
+		// (every line in the range is checked, not just the ends: block moves and DMA can cover a lot of them.)
+		void invalidateRAMCode(Address ramOffset, Address size) {
+			cpu.decodeCache.invalidateRAM(ramOffset, size);
+		};
+
+		//=== Memory Map ===
+		static constexpr Address PAGE_SHIFT = 12; // 4 KiB pages
+		static constexpr Address PAGE_SIZE = 1u << PAGE_SHIFT;
+		static constexpr Address PAGE_OFFSET_MASK = PAGE_SIZE - 1;
+		static constexpr Address PAGE_COUNT = 1u << (24 - PAGE_SHIFT);
+
+		// memory access speeds, in master cycles
+		static constexpr Byte FAST_ACCESS_CYCLES = 6;
+		static constexpr Byte SLOW_ACCESS_CYCLES = 8;
+		static constexpr Byte EXTRA_SLOW_ACCESS_CYCLES = 12;
+
+		struct MemoryPage {
+			// pointers to host memory backing the whole page, if the device allows direct access to it.
+			// when these are null, accesses go through `device` instead.
+			const Byte* directRead = nullptr;
+			Byte* directWrite = nullptr;
+
+			// null if nothing is mapped to this page
+			MMIODevice* device = nullptr;
+
+			// the device offset corresponding to the first address in the page
+			Address offset = 0;
+
+			// how long a CPU access to this page takes (in master cycles)
+			Byte accessCycles = SLOW_ACCESS_CYCLES;
+		};
+
+		// what's mapped at the given address. this is for looking at memory without going through the devices
+		// (e.g. for the decode cache); normal accesses should use `read8`/`write` and friends.
+		const MemoryPage& pageForAddress(Address address) const {
+			return _pages[(address >> PAGE_SHIFT) & (PAGE_COUNT - 1)];
+		};
+
 	private:
-		void findDeviceAndOffset(Address address, MMIODevice*& outDevice, Address& outOffset);
+		std::vector<MemoryPage> _pages;
+		bool _fastROM = false;
+
+		// when the CPU's current batch ends, if it's running one. events scheduled before this cut it short.
+		MasterCycles _batchEnd = Scheduler::NEVER;
+
+		bool isBreakpoint(Address address) const;
+
+		void invalidateCode(const MemoryPage& page, Address pageOffset, Address size) {
+			if (page.device == &ram) {
+				invalidateRAMCode(page.offset + pageOffset, size);
+			}
+		};
+
+		bool findDeviceAndOffset(Address address, MMIODevice*& outDevice, Address& outOffset);
 	};
 }
@@ -2,17 +2,21 @@
 
 #include <blaze/MemTypes.hpp>
 #include <blaze/MemRam.hpp>
+#include <blaze/DecodeCache.hpp>
 #include <limits>
 #include <array>
-#include <unordered_map>
 #include <functional>
 
 namespace Blaze {
-	using ClockTicks = uint32_t;
 	using Cycles = uint32_t;
 
 	// Avoid circular inclusions by declaring Bus
 	struct Bus;
+	class StateWriter;
+	class StateReader;
+	class TraceBuffer;
+	class JIT;
+	class CallProfiler;
 
 	struct CPU {
 		// TODO: Link to the system bus
@@ -291,6 +295,7 @@ namespace Blaze {
 
 			BRA,
 
+			Last = BRA,
 			INVALID = std::numeric_limits<Byte>::max(),
 		};
 
@@ -319,6 +324,10 @@ namespace Blaze {
 			enum IgnoreMe: Byte {
 				// Prints the character from the low 8 bits of the accumulator
 				PutChararacter = 0x80,
+
+				// Stops the processor, just like `STP`.
+				// Test ROMs use this to signal that they're done (e.g. for the headless runner).
+				Halt = 0x81,
 			};
 		};
 
@@ -370,7 +379,11 @@ namespace Blaze {
 			};
 		};
 
-		static const std::unordered_map<Byte, Instruction> INSTRUCTIONS_WITH_NO_PATTERN;
+		// pre-decoded information for every possible opcode, generated at compile time from the opcode patterns above.
+		//
+		// instructions with Immediate addressing have a size of 0 in this table, since their size depends on the CPU flags.
+		// use `decodeInstruction` to get the actual size.
+		static const std::array<Instruction, 256> OPCODE_TABLE;
 
 		struct flags {
 			enum IngoreMe: Byte {
@@ -409,8 +422,49 @@ namespace Blaze {
 			Word forceLoadFull() const;
 			void forceStoreFull(Word value);
 
+			// where the full 16-bit value lives, for code that accesses it directly (i.e. the JIT)
+			const Word* address() const {
+				return &_value;
+			};
+
 			bool mostSignificantBit() const;
 
+			// these are like `load`, `store`, and `mostSignificantBit`, except that the register width is chosen at compile time.
+			// they're used by the width-specialized instruction handlers so that they don't have to check the CPU flags on every access.
+
+			template<bool Is8Bit>
+			Word load() const {
+				if constexpr (Is8Bit) {
+					return _value & 0xff;
+				} else {
+					return _value;
+				}
+			};
+
+			template<bool Is8Bit>
+			void store(Word value) {
+				if constexpr (Is8Bit) {
+					if (_mask == flags::m) {
+						// the accumulator preserves the high byte
+						_value = (_value & 0xff00) | (value & 0xff);
+					} else {
+						// the index registers clear the high byte
+						_value = value & 0xff;
+					}
+				} else {
+					_value = value;
+				}
+			};
+
+			template<bool Is8Bit>
+			bool mostSignificantBit() const {
+				if constexpr (Is8Bit) {
+					return (_value & (1u << 7)) != 0;
+				} else {
+					return (_value & (1u << 15)) != 0;
+				}
+			};
+
 			Register& operator+=(Word rhs);
 			Register& operator-=(Word rhs);
 			Register& operator*=(Word rhs);
@@ -457,11 +511,30 @@ namespace Blaze {
 		// BEFORE the current instruction starts executing.
 		Address executingPC;
 
+		// the opcode and operand bytes (little-endian) of the instruction that is currently executing.
+		// these are fetched before the instruction starts executing, so handlers don't need to read them from the bus again.
+		Byte executingOpcode = 0;
+		Address operandBytes = 0;
+
+		// pre-decoded blocks of code, so that `execute` doesn't have to fetch instructions through the bus
+		DecodeCache decodeCache;
+
 		// System Bus
 		Bus *bus = nullptr;
 
 		std::function<void(char)> putCharacterHook = nullptr;
 
+		// when set, every executed instruction is recorded here (see `Trace.hpp`). the buffer isn't owned by the CPU.
+		TraceBuffer* trace = nullptr;
+
+		// when set, `clock` runs whole blocks at a time through the JIT (see `JIT.hpp`). the JIT isn't owned by the CPU.
+		JIT* jit = nullptr;
+
+		// when set, calls, returns and interrupts are tracked on a shadow call stack and every instruction's cycles are
+		// charged to it (see `CallProfiler.hpp`). this makes `run` and the JIT run one instruction at a time.
+		// the profiler isn't owned by the CPU.
+		CallProfiler* callProfiler = nullptr;
+
 		Byte load8(Address address) const;
 		Byte load8(Byte bank, Word addressLow) const;
 		Word load16(Address address) const;
@@ -480,19 +553,95 @@ namespace Blaze {
 		// of the operand with the given addressing mode.
 		Address decodeAddress(AddressingMode addressingMode) const;
 
+		// same as above, but with the width of the index registers chosen at compile time
+		template<bool IndexIs8Bit>
+		Address decodeAddress(AddressingMode addressingMode) const;
+
 		// this function is meant to be used by simple instructions that only need to load data from the
 		// memory operands (which is true for most instructions). if you need to both read from and write to
 		// a memory operand, you should use `decodeAddress` + `load16` instead.
 		Word loadOperand(AddressingMode addressingMode, bool use8BitImmediate) const;
 
+		// same as above, but with the operand width and the index register width chosen at compile time.
+		// unlike the runtime version, this only loads 8 bits from memory operands when `OperandIs8Bit` is true.
+		template<bool OperandIs8Bit, bool IndexIs8Bit>
+		Word loadOperand(AddressingMode addressingMode) const;
+
 		// decodes the current instruction based on the given opcode, returning the decoded instruction information
 		Instruction decodeInstruction(Byte inst0) const;
 
+		// decodes the given opcode by its bit patterns without using `OPCODE_TABLE`.
+		// this is much slower than `decodeInstruction`; it is only meant for verifying the table.
+		static Instruction decodeInstructionByPattern(Byte inst0, bool memoryAndAccumulatorAre8Bit, bool indexRegistersAre8Bit);
+
+		// the size of an instruction with a flag-dependent immediate operand (the ones with a size of 0 in `OPCODE_TABLE`).
+		// `LDX`, `LDY`, `CPX` and `CPY` take an operand as wide as the index registers; everything else (including `BIT #`)
+		// takes one as wide as the accumulator.
+		static constexpr Byte immediateInstructionSize(Opcode opcode, bool memoryIs8Bit, bool indexIs8Bit) {
+			bool usesIndexWidth = opcode == Opcode::LDX || opcode == Opcode::LDY || opcode == Opcode::CPX || opcode == Opcode::CPY;
+			return (usesIndexWidth ? indexIs8Bit : memoryIs8Bit) ? 2 : 3;
+		};
+
 		// executes the current (pre-decoded) instruction with the given information
 		Cycles executeInstruction(const Instruction& info);
 
+		// fetches the instruction at the PC into `executingPC`, `executingOpcode` and `operandBytes` (from the decode cache, if possible)
+		Instruction fetchInstruction();
+
+		// everything that happens before the handler of the fetched instruction runs: tracing, the fixed cycles and
+		// penalties (from `INSTRUCTION_TIMINGS[index]`), and moving the PC past the instruction. returns the CPU cycles so far.
+		Cycles beginInstruction(const Instruction& info, size_t index);
+
+		// the rest of `execute`, once the instruction has been fetched
+		Cycles executeFetched(const Instruction& info);
+
+		// instruction handlers return the number of CPU cycles the instruction took *on top of* its base cycles
+		// (e.g. 1 for a branch that was taken); everything that can be known from the opcode and the `m`/`x` flags
+		// alone is already accounted for by `execute`.
+		using InstructionHandler = Cycles (CPU::*)(const Instruction& info);
+
+		// executes the given opcode with the given accumulator/memory and index register widths.
+		// these are the entries of `DISPATCH_TABLE`.
+		template<Opcode Op, bool MemoryIs8Bit, bool IndexIs8Bit>
+		Cycles executeOpcode(const Instruction& info);
+
+		// width-specialized handlers for every opcode byte, indexed with `dispatchIndex`.
+		//
+		// this lets `execute` pick the right handler for the current `m` and `x` flags with a single table load,
+		// rather than having each handler check the flags on every register and memory access.
+		static const std::array<InstructionHandler, 1024> DISPATCH_TABLE;
+
+		struct InstructionTiming {
+			// the base cycles plus the extra cycles for 16-bit accumulator/memory and index registers
+			Byte cycles = 0;
+
+			// takes an extra cycle when the low byte of the direct page register is non-zero
+			bool directPagePenalty = false;
+
+			// takes an extra cycle when adding the (8-bit) index register crosses a page boundary.
+			// with 16-bit index registers, the extra cycle is always taken, so it's already part of `cycles`.
+			bool pageCrossPenalty = false;
+		};
+
+		// the timing of every opcode byte with the current `m` and `x` flags, indexed with `dispatchIndex` (just like `DISPATCH_TABLE`).
+		// these are CPU cycles; `execute` converts them into master cycles.
+		//
+		// that conversion is approximate: every cycle of an instruction is charged at the speed of the memory its opcode was
+		// fetched from (`Bus::accessCycles`), including its data accesses and internal cycles. e.g. code in slow ROM that
+		// only touches I/O registers runs a little slow, and code in FastROM that touches WRAM a little fast. charging each
+		// access separately would mean counting them in every handler (and in the JIT), for a difference of a few percent.
+		static const std::array<InstructionTiming, 1024> INSTRUCTION_TIMINGS;
+
+		// bit 9 = `m`, bit 8 = `x`, bits 0-7 = the opcode byte
+		size_t dispatchIndex(Byte inst0) const {
+			return (static_cast<size_t>(P & (flags::m | flags::x)) << 4) | inst0;
+		};
+
 		Cycles invalidInstruction();
 
+		// pushes the PBR (in native mode), the PC and P, and jumps through the given vector; for `BRK` and `COP`
+		Cycles softwareInterrupt(Address nativeVector, Address emulatedVector);
+
 		Cycles executeBRK();
 		Cycles executeBRL();
 		Cycles executeCLC();
@@ -500,30 +649,41 @@ namespace Blaze {
 		Cycles executeCLI();
 		Cycles executeCLV();
 		Cycles executeCOP();
+		template<bool IndexIs8Bit>
 		Cycles executeDEX();
+		template<bool IndexIs8Bit>
 		Cycles executeDEY();
+		template<bool IndexIs8Bit>
 		Cycles executeINX();
+		template<bool IndexIs8Bit>
 		Cycles executeINY();
 		Cycles executeJML();
 		Cycles executeJSL();
-		Cycles executeMVN();
-		Cycles executeMVP();
+		// `MVN` and `MVP`; the only difference is the direction
+		template<bool Descending, bool IndexIs8Bit>
+		Cycles executeBlockMove();
 		Cycles executeNOP();
 		Cycles executePEA();
 		Cycles executePEI();
 		Cycles executePER();
+		template<bool MemoryIs8Bit>
 		Cycles executePHA();
 		Cycles executePHB();
 		Cycles executePHD();
 		Cycles executePHK();
 		Cycles executePHP();
+		template<bool IndexIs8Bit>
 		Cycles executePHX();
+		template<bool IndexIs8Bit>
 		Cycles executePHY();
+		template<bool MemoryIs8Bit>
 		Cycles executePLA();
 		Cycles executePLB();
 		Cycles executePLD();
 		Cycles executePLP();
+		template<bool IndexIs8Bit>
 		Cycles executePLX();
+		template<bool IndexIs8Bit>
 		Cycles executePLY();
 		Cycles executeREP();
 		Cycles executeRTI();
@@ -534,48 +694,84 @@ namespace Blaze {
 		Cycles executeSEI();
 		Cycles executeSEP();
 		Cycles executeSTP();
+		template<bool IndexIs8Bit>
 		Cycles executeTAX();
+		template<bool IndexIs8Bit>
 		Cycles executeTAY();
 		Cycles executeTCD();
 		Cycles executeTCS();
+		template<bool MemoryIs8Bit>
 		Cycles executeTDC();
+		template<bool MemoryIs8Bit>
 		Cycles executeTSC();
+		template<bool IndexIs8Bit>
 		Cycles executeTSX();
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeTXA();
+		template<bool IndexIs8Bit>
 		Cycles executeTXS();
+		template<bool IndexIs8Bit>
 		Cycles executeTXY();
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeTYA();
+		template<bool IndexIs8Bit>
 		Cycles executeTYX();
 		Cycles executeWAI();
 		Cycles executeWDM();
 		Cycles executeXBA();
 		Cycles executeXCE();
 
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeADC(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeAND(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeASL(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeBIT(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeCMP(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeCPX(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeCPY(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeDEC(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeEOR(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeINC(AddressingMode mode);
+		template<bool IndexIs8Bit>
 		Cycles executeJMP(AddressingMode mode);
+		template<bool IndexIs8Bit>
 		Cycles executeJSR(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeLDA(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeLDX(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeLDY(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeLSR(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeORA(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeROL(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeROR(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeSBC(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeSTA(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeSTX(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeSTY(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeSTZ(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeTRB(AddressingMode mode);
+		template<bool MemoryIs8Bit, bool IndexIs8Bit>
 		Cycles executeTSB(AddressingMode mode);
 
 		Cycles executeBRA(ConditionCode condition, bool passConditionIfBitSet);
@@ -587,14 +783,56 @@ namespace Blaze {
 			{};
 
 		void reset(Bus* theBus);      		// Reset CPU internal state
-		void execute(); 		// Execute the current instruction
-		void clock();                    		// CPU driver
+		void saveState(StateWriter& writer) const;
+		void loadState(StateReader& reader);
+		Cycles execute(); 		// Execute the current instruction (returns the number of master cycles it took)
+		Cycles execute(const DecodeCache::DecodedInstruction& decoded); // Same, but for an instruction that's already been fetched from the decode cache (it has to be the one at the PC)
+		void recordTrace(const Instruction& info) const; // Append the current instruction and registers to `trace`
+		// runs instructions until at least `budget` master cycles have passed, or until the processor stops or starts waiting
+		// for an interrupt. unlike `clock`, this doesn't advance the scheduler; the caller has to do that afterwards (and
+		// should keep the budget short enough to not run past the next event). returns the number of instructions executed;
+		// `outCycles` receives the number of master cycles they took.
+		uint32_t run(Cycles budget, Cycles& outCycles);
+
+		// makes `run` return after the current instruction, regardless of how much of its budget is left
+		void endRun() {
+			runBudget = 0;
+			runEnded = true;
+		};
+		uint32_t clock();                		// CPU driver: executes an instruction (or a block, with the JIT) and advances the bus scheduler by the time it took. returns the number of instructions executed
 		Byte read(Address addr);				// Read from the Bus
 		void write(Address addr, Byte data);	// Write to the Bus
 
+		// set by `STP` (and the custom `WDM` halt opcode); the processor doesn't execute anything else until it's reset
+		bool stopped = false;
+
+		// set by `WAI`; the processor doesn't execute anything else until an interrupt comes in
+		bool waitingForInterrupt = false;
+
+		// the number of master cycles the current `run` goes on for (`endRun` cuts it short)
+		Cycles runBudget = 0;
+
+		// set by `endRun`; the JIT clears it before running a block, and ends the block as soon as it's set
+		bool runEnded = false;
+
+		// how many master cycles the next block move (`MVN`/`MVP`) may take before it has to give other devices a chance to
+		// run (`run` sets this to what's left of its budget). as long as there's time for more than one byte, the move copies
+		// as many bytes at once as it can; otherwise, it moves one byte at a time, like the real thing.
+		Cycles blockMoveBudget = 0;
+
+		// master cycles the CPU was halted for (e.g. by DMA) that haven't been charged yet; they're added to the time the
+		// current (or next) instruction takes
+		Cycles stalledCycles = 0;
+
+		// halts the CPU for the given number of master cycles. this also ends the current `run`, since the time might
+		// push it past the next event.
+		void stall(Cycles cycles) {
+			stalledCycles += cycles;
+			endRun();
+		};
+
 		// Interrupt Handling
-		Cycles cyclesCountDown = 0;					// Counts how many cycles the instruction has remaining
-		ClockTicks clockCount = 0;					// A global accumulation of the number of clocks
+		Cycles pendingCycles = 0;					// CPU cycles that haven't been charged yet (e.g. for entering an interrupt handler); they're added to the next instruction
 		void irq();
 		void nmi();
 		void abort();
@@ -610,6 +848,12 @@ namespace Blaze {
 		// this is only used for ADC and SBC
 		void setOverflowFlag(Word leftOperand, Word rightOperand, Word result);
 
+		// same as above, but with the value width chosen at compile time
+		template<bool Is8Bit>
+		void setZeroNegFlags(Word value);
+		template<bool Is8Bit>
+		void setOverflowFlag(Word leftOperand, Word rightOperand, Word result);
+
 		// just a convenience method to make it more clear what we're checking for
 		bool memoryAndAccumulatorAre8Bit() const {
 			return getFlag(flags::m);
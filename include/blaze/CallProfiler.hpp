@@ -0,0 +1,121 @@
+#pragma once
+
+#include <blaze/MemTypes.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace Blaze {
+	class SymbolTable;
+
+	//
+	// A profiler for the emulated code: which routines the 65C816 spends its cycles in, and how it got there.
+	//
+	// When `CPU::callProfiler` points at one, the CPU keeps a shadow copy of the call stack up to date (`JSR`/`JSL` and
+	// interrupts push a frame, `RTS`/`RTL`/`RTI` pop one) and charges the master cycles of every instruction to the
+	// stack it ran in. The results can be written out as folded stacks, which flame graph tools take as they are.
+	//
+	// Games don't always return the way they were called: they jump through the stack with `RTS`, drop return addresses
+	// with `PLA`, or just reset the stack pointer. So frames aren't matched by instruction, but by the stack pointer:
+	// each frame remembers what it was before the call, and a frame is gone as soon as the stack pointer is back up to
+	// (or past) that. a return that doesn't go back up past any frame (like an `RTS` jump) doesn't pop anything.
+	//
+	// The CPU only runs instructions one at a time while profiling (no JIT, no threaded dispatch), so it's a lot slower.
+	// Time spent stopped or waiting for an interrupt isn't charged to anything.
+	//
+	class CallProfiler {
+	public:
+		enum class FrameKind: Byte {
+			Root,
+			Subroutine,
+			IRQ,
+			NMI,
+			Abort,
+		};
+
+		// stacks deeper than this stop growing; anything called from there is charged to the deepest frame
+		static constexpr size_t MAX_DEPTH = 256;
+
+		CallProfiler();
+
+		//=== CPU hooks ===
+		// a subroutine call from the current instruction. `sp` is the stack pointer before the return address was pushed.
+		// (the stack only changes once the instruction has been charged, so calls and returns count towards the caller.)
+		void call(Address target, Word sp) {
+			_pending = Pending { true, target, sp };
+		};
+
+		// a return from the current instruction. `sp` is the stack pointer after the return address was pulled.
+		void returned(Word sp) {
+			_pending = Pending { false, 0, sp };
+		};
+
+		// an interrupt, between instructions. `sp` is the stack pointer before anything was pushed.
+		void interrupt(FrameKind kind, Address handler, Word sp);
+
+		// charges the master cycles of the instruction that just ran to the current stack
+		void charge(uint64_t cycles) {
+			_nodes[_stack.back().node].cycles += cycles;
+			if (_pending.sp != NO_PENDING) {
+				applyPending();
+			}
+		};
+
+		//=== Results ===
+		size_t depth() const {
+			return _stack.size() - 1;
+		};
+
+		uint64_t totalCycles() const;
+
+		// calls and returns that didn't line up with the shadow stack (frames that were dropped, and stacks that got too deep)
+		uint64_t mismatches() const {
+			return _mismatches;
+		};
+
+		// one line per distinct stack that ran anything, e.g. "(root);main;print_string 1234", outermost first.
+		// without symbols, routines are named by their addresses.
+		void writeFolded(std::ostream& stream, const SymbolTable* symbols = nullptr) const;
+
+		// forgets every stack and count (the current stack starts over as just the root)
+		void clear();
+
+	private:
+		static constexpr uint32_t NO_PENDING = 0xffffffff;
+
+		// one for every distinct stack: a tree, with the root at index 0
+		struct Node {
+			uint32_t parent;
+			FrameKind kind;
+			Address entry;
+			uint64_t cycles = 0; // (only what ran in this frame itself, not in what it called)
+		};
+
+		struct StackEntry {
+			uint32_t node;
+			uint32_t sp; // the stack pointer before the call (past anything the root could have)
+		};
+
+		struct Pending {
+			bool isCall = false;
+			Address target = 0;
+			uint32_t sp = NO_PENDING;
+		};
+
+		std::vector<Node> _nodes;
+		std::unordered_map<uint64_t, uint32_t> _children; // (parent, kind, entry) -> node
+		std::vector<StackEntry> _stack;
+		Pending _pending;
+		uint64_t _mismatches = 0;
+
+		void applyPending();
+
+		// pops every frame whose return address is no longer on the stack, returning how many that was
+		size_t unwind(Word sp);
+
+		void push(FrameKind kind, Address entry, Word sp);
+	};
+} // namespace Blaze
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <blaze/MemTypes.hpp>
+#include <blaze/MMIO.hpp>
+#include <blaze/Scheduler.hpp>
+
+#include <array>
+#include <cstddef>
+
+namespace Blaze {
+	using Cycles = uint32_t;
+
+	//
+	// The SNES's 8 DMA channels, which copy data between the A-bus (the CPU's address space) and the B-bus (see `BBus`).
+	//
+	// General purpose DMA runs as soon as it's started (by writing to MDMAEN, $420B), with the CPU halted until it's
+	// done; the time it took is charged to the CPU via `CPU::stall`. Whenever both sides allow it, transfers are done a
+	// whole page at a time (with `BBus::writeBlock`) instead of one byte at a time.
+	//
+	// HDMA transfers a few bytes per channel at the start of every H-blank, following a table in memory. It's driven by
+	// scheduler events, which are only pending while HDMA is enabled (via HDMAEN, $420C).
+	//
+	// For now, this also owns the rest of the CPU's I/O page ($4000 through $4FFF); the registers there that aren't
+	// implemented are open bus.
+	//
+	class DMA: public MMIODevice {
+	public:
+		static constexpr size_t CHANNEL_COUNT = 8;
+
+		// every byte takes 8 master cycles, no matter what it's read from or written to
+		static constexpr Cycles CYCLES_PER_BYTE = 8;
+
+		// general purpose DMA takes this long per transfer (for syncing up with the CPU clock), plus this long per channel
+		static constexpr Cycles DMA_OVERHEAD = 18;
+		static constexpr Cycles DMA_CHANNEL_OVERHEAD = 8;
+
+		// HDMA takes this long per line (or frame, for setting up the tables) if any channels are active, plus this long
+		// per active channel
+		static constexpr Cycles HDMA_OVERHEAD = 18;
+		static constexpr Cycles HDMA_CHANNEL_OVERHEAD = 8;
+
+		// when HDMA happens, relative to the start of the frame (for setting up the tables) or the scanline (for transfers)
+		static constexpr MasterCycles HDMA_INIT_TIME = 24;
+		static constexpr MasterCycles HDMA_LINE_TIME = 1112;
+
+		// HDMA runs on lines 0 through 224
+		static constexpr MasterCycles HDMA_LAST_LINE = 224;
+
+		struct Channel {
+			// power-on values are all $FF
+			Byte control = 0xff;         // DMAPx ($43x0)
+			Byte bAddress = 0xff;        // BBADx ($43x1)
+			Word aAddress = 0xffff;      // A1TxL/H ($43x2 and $43x3)
+			Byte aBank = 0xff;           // A1Bx ($43x4)
+			Word count = 0xffff;         // DASxL/H ($43x5 and $43x6): the byte count for DMA, the indirect address for HDMA
+			Byte indirectBank = 0xff;    // DASBx ($43x7)
+			Word tableAddress = 0xffff;  // A2AxL/H ($43x8 and $43x9)
+			Byte lineCounter = 0xff;     // NTRLx ($43xA)
+			Byte unused = 0xff;          // UNUSEDx ($43xB, mirrored at $43xF)
+
+			//=== HDMA state ===
+			// cleared when the channel reaches the end of its table
+			bool hdmaActive = false;
+
+			// whether the channel transfers anything on the next line
+			bool hdmaDoTransfer = false;
+		};
+
+		std::array<Channel, CHANNEL_COUNT> channels;
+
+		// HDMAEN ($420C)
+		Byte hdmaEnable = 0;
+
+		explicit DMA(Scheduler& scheduler);
+
+		// runs general purpose DMA on the channels whose bits are set (which is what writing to MDMAEN does).
+		// returns the number of master cycles it took (which have already been charged to the CPU).
+		Cycles start(Byte channelMask);
+
+		//=== MMIODevice ===
+		// the bus maps this to the page at $4000 through $4FFF, with the 16-bit address as the offset
+		Byte read8(Address offset) override;
+		Word read16(Address offset) override;
+		Address read24(Address offset) override;
+
+		void write8(Address offset, Byte value) override;
+		void write16(Address offset, Word value) override;
+		void write24(Address offset, Address value) override;
+
+		void reset(Bus* bus) override;
+
+		void saveState(StateWriter& writer) const override;
+		void loadState(StateReader& reader) override;
+
+	private:
+		Bus* _bus = nullptr;
+		Scheduler& _scheduler;
+		Scheduler::EventType _hdmaInitEvent;
+		Scheduler::EventType _hdmaLineEvent;
+
+		// returns the number of master cycles it took
+		Cycles runChannel(Channel& channel);
+
+		// copies as much of the rest of a channel's transfer as it can at once, returning the number of bytes copied (0 if it
+		// can't do anything faster than copying them one at a time)
+		size_t transferBlock(Channel& channel, size_t remaining, size_t transferred);
+
+		// moves a single byte; `offset` is added to the channel's B-bus address
+		void transferByte(Channel& channel, Address aAddress, Byte offset);
+
+		// schedules the next frame's HDMA setup, unless it's already pending
+		void scheduleHDMAInit();
+
+		void initHDMA(MasterCycles scheduledTime);
+		void runHDMALine(MasterCycles scheduledTime);
+
+		// reads the next entry from the channel's HDMA table. returns the number of master cycles it took.
+		Cycles loadHDMAEntry(Channel& channel);
+	};
+} // namespace Blaze
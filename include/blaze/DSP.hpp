@@ -0,0 +1,168 @@
+#pragma once
+
+#include <blaze/MemTypes.hpp>
+#include <blaze/simd.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Blaze {
+	class StateWriter;
+	class StateReader;
+
+	//
+	// The S-DSP: 8 voices playing BRR-compressed samples from the APU's RAM, each with its own pitch, envelope, and
+	// volume, mixed together with an echo (a delay line in APU RAM, filtered through an 8-tap FIR filter).
+	//
+	// It's run one output sample (32 kHz) at a time. Within a sample, each step is run for all the voices before the next
+	// one rather than interleaved like on the real chip, so register writes only take effect at sample boundaries. the
+	// voices' state is kept as one array per field (rather than one struct per voice) so that the steps that are the same
+	// for every voice (interpolation, applying the envelope, and the volumes) can run on all 8 at once with `simd::I32Vector`.
+	//
+	// Decoded BRR blocks are cached, since it's common for several voices to play the same sample, or for one to loop
+	// over the same few blocks. anything else that writes to APU RAM has to call `aramWritten` to keep the cache current.
+	//
+	class DSP {
+	public:
+		static constexpr unsigned VOICE_COUNT = 8;
+		static constexpr size_t REGISTER_COUNT = 0x80;
+
+		// the registers of each voice are at $x0 through $x9, where x is the voice number
+		enum VoiceRegister: Byte {
+			VOLL = 0x0,
+			VOLR,
+			PITCHL,
+			PITCHH,
+			SRCN,
+			ADSR1,
+			ADSR2,
+			GAIN,
+			ENVX,
+			OUTX,
+		};
+
+		enum GlobalRegister: Byte {
+			MVOLL = 0x0c,
+			MVOLR = 0x1c,
+			EVOLL = 0x2c,
+			EVOLR = 0x3c,
+			KON = 0x4c,
+			KOFF = 0x5c,
+			FLG = 0x6c,
+			ENDX = 0x7c,
+			EFB = 0x0d,
+			PMON = 0x2d,
+			NON = 0x3d,
+			EON = 0x4d,
+			DIR = 0x5d,
+			ESA = 0x6d,
+			EDL = 0x7d,
+			// the echo filter's coefficients are at $xF
+			FIR = 0x0f,
+		};
+
+		std::array<Byte, REGISTER_COUNT> registers {};
+
+		// reads samples from (and writes the echo to) the given 64 KiB of APU RAM
+		explicit DSP(Byte* aram);
+
+		void reset();
+
+		Byte read(Byte address) const {
+			return registers[address & (REGISTER_COUNT - 1)];
+		};
+		void write(Byte address, Byte value);
+
+		// marks the cached blocks around the given address as out of date
+		void aramWritten(Word address) {
+			++_lineVersions[address >> ARAM_LINE_BITS];
+		};
+
+		// produces the next output sample
+		void runSample(int16_t& outLeft, int16_t& outRight);
+
+		void saveState(StateWriter& writer) const;
+		void loadState(StateReader& reader);
+
+	private:
+		enum class EnvelopeMode: Byte {
+			Attack,
+			Decay,
+			Sustain,
+			Release,
+		};
+
+		template<typename T>
+		using PerVoice = std::array<T, VOICE_COUNT>;
+
+		Byte* _aram;
+
+		//=== Voices ===
+		// the BRR block each voice is playing, decoded
+		PerVoice<Word> _blockAddress {};
+		PerVoice<std::array<int16_t, 16>> _block {};
+		PerVoice<Byte> _blockIndex {};
+
+		// each voice's last 4 samples, oldest first (the output is interpolated between the middle two)
+		alignas(simd::ALIGNMENT) std::array<PerVoice<int32_t>, 4> _samples {};
+		// how far each voice is between them (12-bit fraction)
+		alignas(simd::ALIGNMENT) PerVoice<int32_t> _position {};
+
+		PerVoice<EnvelopeMode> _envelopeMode {};
+		alignas(simd::ALIGNMENT) PerVoice<int32_t> _envelope {};
+		PerVoice<int16_t> _hiddenEnvelope {}; // (the envelope as of the last step, even if the step didn't take effect)
+
+		alignas(simd::ALIGNMENT) PerVoice<int32_t> _output {};
+
+		//=== BRR block cache ===
+		// APU RAM is split into lines whose versions go up with every write to them; a cached block is only good as long as
+		// the lines it's in haven't changed since it was decoded
+		static constexpr unsigned ARAM_LINE_BITS = 6;
+		static constexpr size_t ARAM_LINE_COUNT = 0x10000 >> ARAM_LINE_BITS;
+		static constexpr size_t BLOCK_CACHE_SIZE = 512;
+
+		struct CachedBlock {
+			bool valid = false;
+			Word address = 0;
+			// the filters carry on from the samples before the block, so it's only good for the same ones
+			int16_t previous1 = 0;
+			int16_t previous2 = 0;
+			std::array<uint32_t, 2> versions {};
+			std::array<int16_t, 16> samples {};
+		};
+
+		std::array<CachedBlock, BLOCK_CACHE_SIZE> _blockCache {};
+		std::array<uint32_t, ARAM_LINE_COUNT> _lineVersions {};
+
+		void clearBlockCache();
+
+		// voices that were keyed on since the last sample
+		Byte _keyOn = 0;
+
+		// counts down once per sample; envelope and noise steps happen when it hits a multiple of their rate's period
+		uint16_t _counter = 0;
+		uint16_t _noise = 0;
+
+		// the echo buffer's read/write position (a byte offset into it) and the echo samples that went into the filter. each
+		// channel's history is stored twice over, so that the last 8 are always in order at `_echoHistoryPosition`.
+		uint16_t _echoOffset = 0;
+		alignas(simd::ALIGNMENT) std::array<std::array<int32_t, 16>, 2> _echoHistory {};
+		Byte _echoHistoryPosition = 0;
+
+		Byte voiceRegister(unsigned voice, VoiceRegister reg) const {
+			return registers[(voice << 4) | reg];
+		};
+
+		bool rateTicks(unsigned rate) const;
+
+		void keyOn(unsigned index);
+		void decodeBlock(unsigned index);
+		void advanceSample(unsigned index);
+		void runEnvelope(unsigned index);
+
+		// works out every voice's output (after the envelope, before the volume)
+		void runVoiceOutputs();
+		void runEcho(int mainLeft, int mainRight, int echoLeft, int echoRight, int16_t& outLeft, int16_t& outRight);
+	};
+} // namespace Blaze
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <blaze/MemTypes.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Blaze {
+	struct Bus;
+
+	//
+	// Caches pre-decoded basic blocks, so that hot code doesn't have to be fetched through the bus (and decoded) every
+	// time it runs.
+	//
+	// A block is a straight-line run of instructions that ends at the first instruction that (possibly) jumps somewhere
+	// else or changes the `m`/`x` flags, or at the end of a memory page. Blocks are keyed by their 24-bit start address
+	// *and* the `m`/`x` flags they were decoded with, since those decide the size of immediate operands.
+	//
+	// Only directly readable memory (RAM and ROM) is cached. Blocks decoded from RAM are dropped when anything writes to
+	// the RAM they came from; the bus calls `invalidateRAM` for that.
+	//
+	class DecodeCache {
+	public:
+		struct DecodedInstruction {
+			Address pc;
+			Address operand; // the operand bytes, little-endian (only the first `size - 1` are valid)
+			Byte opcode;
+			Byte size;
+		};
+
+		// the byte that fetching the instruction would have left on the data bus (see `Bus::openBus`)
+		static Byte lastFetchedByte(const DecodedInstruction& instruction) {
+			return (instruction.size > 1) ? static_cast<Byte>(instruction.operand >> ((instruction.size - 2) * 8)) : instruction.opcode;
+		};
+
+		struct Block {
+			Byte modeFlags;
+			std::vector<DecodedInstruction> instructions;
+
+			//=== JIT data ===
+			uint32_t executionCount = 0;
+
+			// native code for this block, if the JIT compiled it. it's dropped along with the block.
+			const void* compiledCode = nullptr;
+
+			// the blocks that were run after this one, so the JIT doesn't have to look them up every time.
+			// they're only valid while `generation` matches the cache's generation.
+			struct Link {
+				Address pc = 0;
+				Block* block = nullptr;
+				uint64_t generation = 0;
+			};
+			std::array<Link, 2> links;
+			Byte nextLink = 0;
+		};
+
+		// RAM is tracked in lines of this size; a write drops every block that has code in the same line
+		static constexpr Address RAM_LINE_SHIFT = 8;
+		static constexpr Address RAM_SIZE = 128 * 1024;
+		static constexpr Address RAM_LINE_COUNT = RAM_SIZE >> RAM_LINE_SHIFT;
+
+		static constexpr size_t MAX_BLOCK_INSTRUCTIONS = 32;
+
+		// if a program generates more blocks than this (e.g. by constantly rewriting code in RAM), the whole cache is flushed
+		static constexpr size_t MAX_BLOCKS = 1 << 16;
+
+		bool enabled = true;
+
+		// returns the pre-decoded instruction at `pc` (decoding a new block if necessary), or null if the code there can't be cached.
+		// `modeFlags` are the current `m`/`x` flags (i.e. `P & (m | x)`).
+		//
+		// consecutive calls that walk through a block don't need any lookups.
+		const DecodedInstruction* fetch(const Bus& bus, Address pc, Byte modeFlags) {
+			if (_cursor.generation == _generation && _cursor.index < _cursor.block->instructions.size()) {
+				const auto& next = _cursor.block->instructions[_cursor.index];
+				if (next.pc == pc && _cursor.block->modeFlags == modeFlags) {
+					++_cursor.index;
+					return &next;
+				}
+			}
+
+			return fetchSlow(bus, pc, modeFlags);
+		};
+
+		// returns the block starting at `pc` (decoding it if necessary), or null if the code there can't be cached.
+		// the block stays valid until the cache's generation changes.
+		Block* findBlock(const Bus& bus, Address pc, Byte modeFlags);
+
+		// changes whenever blocks are dropped
+		uint64_t generation() const {
+			return _generation;
+		};
+
+		// called by the bus after it writes to RAM. lines without any code in them only cost a lookup each.
+		void invalidateRAM(Address ramOffset, Address size) {
+			Address firstLine = ramOffset >> RAM_LINE_SHIFT;
+			Address lastLine = (ramOffset + size - 1) >> RAM_LINE_SHIFT;
+			for (Address line = firstLine; line <= lastLine && line < RAM_LINE_COUNT; ++line) {
+				if (_ramLineHasCode[line] != 0) {
+					invalidateRAMLine(line);
+				}
+			}
+		};
+
+		// drops everything (e.g. when the memory map changes or a save state is loaded)
+		void clear();
+
+		size_t blockCount() const {
+			return _blocks.size();
+		};
+
+	private:
+		struct Cursor {
+			const Block* block = nullptr;
+			size_t index = 0;
+			uint64_t generation = 0;
+		};
+
+		// bumped whenever blocks are dropped, which invalidates the cursor (since it points into a block)
+		uint64_t _generation = 1;
+		Cursor _cursor;
+
+		// keyed by `(modeFlags << 20) | pc`, so that the flags end up above the 24-bit address
+		std::unordered_map<uint32_t, Block> _blocks;
+
+		std::array<Byte, RAM_LINE_COUNT> _ramLineHasCode {};
+		std::array<std::vector<uint32_t>, RAM_LINE_COUNT> _ramLineBlocks;
+
+		const DecodedInstruction* fetchSlow(const Bus& bus, Address pc, Byte modeFlags);
+
+		// decodes the block starting at `pc`, which has to be in directly readable memory
+		static void decodeBlock(const Byte* page, Address pc, Byte modeFlags, Block& outBlock);
+
+		void invalidateRAMLine(Address line);
+	};
+} // namespace Blaze
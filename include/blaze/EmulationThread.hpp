@@ -0,0 +1,101 @@
+#pragma once
+
+#include <blaze/PPU.hpp>
+#include <blaze/Rewind.hpp>
+#include <blaze/Scheduler.hpp>
+#include <blaze/TripleBuffer.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace Blaze {
+	struct Bus;
+
+	// everything the emulation thread hands off to the render thread at the end of a frame
+	struct FrameOutput {
+		uint64_t frameNumber = 0;
+		std::string debugText;
+
+		// the PPU's picture, in BGR555 (see `PPU::frameBuffer`)
+		std::array<Word, PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT> frameBuffer {};
+	};
+
+	//
+	// Runs the emulator on its own thread, one frame's worth of master clock cycles at a time,
+	// paced to the real SNES frame rate.
+	//
+	// Finished frames are handed to the render thread through a `TripleBuffer`, so neither
+	// thread ever blocks the other.
+	//
+	// The bus must not be touched from other threads while the emulation thread is running;
+	// call `stop()` first (e.g. to load a ROM) and `start()` afterwards.
+	//
+	class EmulationThread {
+	public:
+		// if we fall further behind than this (e.g. because the process was suspended), we don't try to catch up
+		static constexpr uint32_t MAX_FRAMES_BEHIND = 4;
+
+		//=== Constructor & Destructor ===
+		explicit EmulationThread(Bus& bus);
+		~EmulationThread();
+
+		EmulationThread(const EmulationThread&) = delete;
+		EmulationThread& operator=(const EmulationThread&) = delete;
+
+		//=== Control (render thread) ===
+		void start();
+		void stop();
+
+		bool running() const {
+			return _thread.joinable();
+		};
+
+		// replaces the debug text and publishes it right away. may only be called while stopped.
+		void setDebugText(std::string text);
+
+		// runs a single frame on the calling thread and publishes it. may only be called while stopped.
+		void runFrame();
+
+		// while rewinding, the emulation thread steps back through the rewind history (one snapshot per frame)
+		// instead of running frames. can be called at any time.
+		void setRewinding(bool rewinding) {
+			_rewinding.store(rewinding, std::memory_order_relaxed);
+		};
+
+		// may only be called while stopped
+		Rewind& rewind() {
+			return _rewind;
+		};
+
+		//=== Frame Handoff (render thread) ===
+		// returns true if a new frame was published since the last call; the frame is then available from `frame()`
+		bool acquireFrame() {
+			return _frames.acquire();
+		};
+
+		const FrameOutput& frame() const {
+			return _frames.front();
+		};
+
+	private:
+		Bus& _bus;
+		std::thread _thread;
+		std::atomic<bool> _stopRequested { false };
+		std::atomic<bool> _rewinding { false };
+
+		//=== Emulation thread state ===
+		std::string _debugText;
+		uint64_t _frameNumber = 0;
+		bool _halted = false; // set when the processor stops or emulation fails
+		Rewind _rewind;
+
+		TripleBuffer<FrameOutput> _frames;
+
+		void threadMain();
+		void rewindFrame();
+		void publishFrame();
+	};
+} // namespace Blaze
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <blaze/DecodeCache.hpp>
+#include <blaze/MemTypes.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+
+namespace Blaze {
+	struct CPU;
+	using Cycles = uint32_t;
+
+	//
+	// An optional dynamic recompiler that turns hot basic blocks (from the CPU's `DecodeCache`) into native x86-64 code.
+	//
+	// The common instructions are translated directly: flag changes, index register increments/decrements, register
+	// transfers, and loads, stores, logic ops and compares with immediate, direct page and absolute operands. Memory
+	// operands still go through the bus (with a call), since anything could be mapped there. Everything else (branches,
+	// jumps, arithmetic, the stack, and the other addressing modes) is compiled into a call to the interpreter
+	// (`CPU::execute`), so the JIT never has to handle every instruction itself. Each block checks on entry that the
+	// `m`/`x` flags still match the ones it was compiled for. The `e` flag isn't part of the check (or of the block's key):
+	// emulation mode forces `m` and `x` to 1, so it can't change any widths, and the only instructions that can behave
+	// differently in it (the stack, branches, `XCE`, `RTI`) always go through the interpreter, which reads `e` itself.
+	//
+	// Compiled blocks always return to `step` rather than jumping straight into the next one, so that interrupts, DMA
+	// and the scheduler get a look in between blocks. `step` remembers which blocks followed each block (see
+	// `DecodeCache::Block::links`), so finding the next one is usually just a couple of compares, not a cache lookup.
+	//
+	// Compiled code is attached to its decode cache block, so it's dropped whenever the block is (e.g. when the RAM it
+	// came from is written to). When the code buffer fills up, everything is flushed and compiled again as needed.
+	//
+	// The JIT is only available on x86-64 with the System V calling convention (i.e. not on Windows); elsewhere,
+	// `supported()` returns false and `step` just runs the interpreter.
+	//
+	// To use it, create one for a CPU and point `CPU::jit` at it. The JIT isn't used while tracing, so that every instruction
+	// gets recorded.
+	//
+	class JIT {
+	public:
+		static constexpr size_t DEFAULT_CODE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+		// how many times a block has to be run (by the interpreter) before it's compiled
+		static constexpr uint32_t HOT_BLOCK_THRESHOLD = 8;
+
+		// the state shared between `step` and the compiled code (which accesses it directly)
+		struct RunState {
+			// the number of instructions the block executed before it returned
+			uint32_t instructions = 0;
+
+			// set by the interpreter calls when the rest of the block can't run (an exception, the code changed, or the run ended)
+			Byte bail = 0;
+
+			uint64_t entryGeneration = 0;
+			std::exception_ptr error;
+		};
+
+		static bool supported();
+
+		explicit JIT(CPU& cpu, size_t codeBufferSize = DEFAULT_CODE_BUFFER_SIZE);
+
+		// drops all the compiled code from the CPU's decode cache
+		~JIT();
+
+		JIT(const JIT&) = delete;
+		JIT& operator=(const JIT&) = delete;
+
+		// runs the block at the CPU's current PC (compiling it once it's hot enough), or a single instruction if the code
+		// there can't be cached. returns the number of instructions executed; `outCycles` receives the number of master cycles they took.
+		uint32_t step(Cycles& outCycles);
+
+		size_t compiledBlockCount() const {
+			return _compiledBlocks;
+		};
+
+		size_t codeBytesUsed() const {
+			return _codeUsed;
+		};
+
+	private:
+		CPU& _cpu;
+
+		Byte* _code = nullptr;
+		size_t _codeSize = 0;
+		size_t _codeUsed = 0;
+		size_t _compiledBlocks = 0;
+
+		RunState _state;
+
+		// the block that ran last (for remembering which block came after it)
+		DecodeCache::Block* _previous = nullptr;
+		uint64_t _previousGeneration = 0;
+
+		DecodeCache::Block* findBlock(Address pc, Byte modeFlags);
+
+		// runs the block with the interpreter, one instruction at a time
+		uint32_t interpretBlock(const DecodeCache::Block& block, Cycles& outCycles);
+
+		// returns null if the block couldn't be compiled (e.g. because the code buffer is full)
+		const void* compile(const DecodeCache::Block& block);
+
+		// drops all compiled code
+		void flush();
+	};
+} // namespace Blaze
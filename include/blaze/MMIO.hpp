@@ -4,6 +4,8 @@
 
 namespace Blaze {
 	struct Bus;
+	class StateWriter;
+	class StateReader;
 
 	// An abstract class (interface) for memory-mapped I/O devices
 	class MMIODevice {
@@ -19,5 +21,23 @@ namespace Blaze {
 		virtual void write24(Address offset, Address value) = 0;
 
 		virtual void reset(Bus* bus) = 0;
+
+		// Devices that are backed by plain memory (i.e. with no side effects on access) can return a pointer
+		// to the host memory for the `size` bytes starting at `offset`. The bus uses these to access that memory
+		// directly instead of going through the (virtual) read/write methods.
+		//
+		// Return `nullptr` if the range can't be accessed directly (this is the default).
+		virtual const Byte* directReadPointer(Address offset, Address size) {
+			return nullptr;
+		};
+
+		virtual Byte* directWritePointer(Address offset, Address size) {
+			return nullptr;
+		};
+
+		// Devices with state that isn't fixed (e.g. RAM or registers) write it out here, and read it back in
+		// the same order in `loadState` (see `SaveState.hpp`).
+		virtual void saveState(StateWriter& writer) const {};
+		virtual void loadState(StateReader& reader) {};
 	};
 } // namespace Blaze
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <blaze/MemTypes.hpp>
+
+#include <cstddef>
+#include <string>
+
+namespace Blaze {
+	//
+	// A read-only memory mapping of a whole file.
+	//
+	// The OS only reads pages in from the file when they're first touched, and processes that map the
+	// same file share the same physical pages.
+	//
+	class MappedFile {
+		const Byte* _data = nullptr;
+		size_t _size = 0;
+
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		// returns false if the file couldn't be mapped (e.g. it doesn't exist, or it's empty).
+		// any previous mapping is closed either way.
+		bool open(const std::string& path);
+		void close();
+
+		bool isOpen() const {
+			return _data != nullptr;
+		};
+
+		const Byte* data() const {
+			return _data;
+		};
+
+		size_t size() const {
+			return _size;
+		};
+	};
+} // namespace Blaze
@@ -2,15 +2,22 @@
 
 #include <blaze/MemTypes.hpp>
 #include <blaze/MMIO.hpp>
+#include <blaze/BBus.hpp>
 #include <array>
 
 namespace Blaze {
-	class MemRam: public MMIODevice {
+	// the console's 128 KiB of work RAM. it's also accessible through the WRAM ports on the B-bus (WMDATA and WMADDL/M/H, at $2180 through $2183).
+	class MemRam: public MMIODevice, public BBusDevice {
 		static constexpr uint32_t MEM_SIZE = 1024 * 128;
 
 		std::array<Byte, MEM_SIZE> data;
 
+		Bus* _bus = nullptr;
+
 	public:
+		// WMADD: the address WMDATA reads from or writes to next (17 bits; it's incremented after every access)
+		Address portAddress = 0;
+
 		MemRam();
 
 		Byte read8(Address offset) override;
@@ -22,5 +29,16 @@ namespace Blaze {
 		void write24(Address offset, Address value) override;
 
 		void reset(Bus* bus) override;
+
+		const Byte* directReadPointer(Address offset, Address size) override;
+		Byte* directWritePointer(Address offset, Address size) override;
+
+		//=== BBusDevice ===
+		Byte readB(Byte address) override;
+		void writeB(Byte address, Byte value) override;
+		bool writeBlockB(Byte address, bool alternating, const Byte* source, size_t size) override;
+
+		void saveState(StateWriter& writer) const override;
+		void loadState(StateReader& reader) override;
 	};
 } // namespace Blaze
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <blaze/BBus.hpp>
+#include <blaze/MemTypes.hpp>
+#include <blaze/Scheduler.hpp>
+#include <blaze/simd.hpp>
+#include <blaze/TileCache.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Blaze {
+	struct Bus;
+	class StateWriter;
+	class StateReader;
+
+	//
+	// The picture processing unit: VRAM, CGRAM (the palette), and OAM (the sprite table), plus the registers that
+	// control how they're turned into a picture. It's on the B-bus at $00 through $3F ($2100 through $213F for the CPU).
+	//
+	// The picture is rendered a scanline at a time, at the start of each visible line's H-blank (so that register
+	// changes between lines, e.g. from HDMA, show up where they should). Each line is rendered in two steps:
+	//
+	//   1. every enabled layer (the backgrounds for the current BG mode, and the sprites) is drawn into its own line
+	//      buffer, with a depth value for each pixel (0 where it's transparent; higher values are in front). tiles come
+	//      from a `TileCache`, so they're only decoded again after they're written to;
+	//   2. the layers are composited into the main and sub screens, color math is applied, and the result is written to
+	//      the frame buffer. this part works on whole lines with SIMD (see `simd.hpp`).
+	//
+	// Hi-res modes (5 and 6) are rendered at 256 pixels wide, showing only the main screen's pixels. Interlacing,
+	// pseudo hi-res, and the sprite time-over limit aren't emulated.
+	//
+	// `blaze-bench ppu` times whole frames of a busy mode 1 scene (three scrolled BGs, a full OAM, a window and color
+	// math). the background columns are the biggest part of a frame, then the sprites, compositing, and color math.
+	//
+	class PPU: public BBusDevice {
+	public:
+		static constexpr size_t SCREEN_WIDTH = 256;
+		static constexpr size_t SCREEN_HEIGHT = 224;
+
+		static constexpr size_t VRAM_WORDS = 0x8000;
+		static constexpr size_t CGRAM_COLORS = 256;
+		static constexpr size_t OAM_SIZE = 544;
+
+		// only this many sprites can be on the same line
+		static constexpr unsigned SPRITES_PER_LINE = 32;
+
+		// each visible line is rendered this long after it starts (at the start of H-blank)
+		static constexpr MasterCycles RENDER_TIME = 1096;
+
+		// lines 1 through 224 are visible; V-blank starts after that
+		static constexpr unsigned FIRST_VISIBLE_LINE = 1;
+		static constexpr unsigned VBLANK_LINE = FIRST_VISIBLE_LINE + SCREEN_HEIGHT;
+
+		// B-bus addresses of the registers
+		enum Register: Byte {
+			INIDISP = 0x00,
+			OBSEL,
+			OAMADDL,
+			OAMADDH,
+			OAMDATA,
+			BGMODE,
+			MOSAIC,
+			BG1SC,
+			BG2SC,
+			BG3SC,
+			BG4SC,
+			BG12NBA,
+			BG34NBA,
+			BG1HOFS,
+			BG1VOFS,
+			BG2HOFS,
+			BG2VOFS,
+			BG3HOFS,
+			BG3VOFS,
+			BG4HOFS,
+			BG4VOFS,
+			VMAIN,
+			VMADDL,
+			VMADDH,
+			VMDATAL,
+			VMDATAH,
+			M7SEL,
+			M7A,
+			M7B,
+			M7C,
+			M7D,
+			M7X,
+			M7Y,
+			CGADD,
+			CGDATA,
+			W12SEL,
+			W34SEL,
+			WOBJSEL,
+			WH0,
+			WH1,
+			WH2,
+			WH3,
+			WBGLOG,
+			WOBJLOG,
+			TM,
+			TS,
+			TMW,
+			TSW,
+			CGWSEL,
+			CGADSUB,
+			COLDATA,
+			SETINI,
+			MPYL,
+			MPYM,
+			MPYH,
+			SLHV,
+			RDOAM,
+			RDVRAML,
+			RDVRAMH,
+			RDCGRAM,
+			OPHCT,
+			OPVCT,
+			STAT77,
+			STAT78,
+
+			REGISTER_COUNT,
+		};
+
+		//=== Memory ===
+		// (the renderer caches decoded tiles, so anything writing to this directly rather than through the ports has to
+		// tell it, with `invalidateTiles`)
+		std::array<Word, VRAM_WORDS> vram {};
+		std::array<Word, CGRAM_COLORS> cgram {};
+		std::array<Byte, OAM_SIZE> oam {};
+
+		// the picture, in BGR555, one row after another. lines are written as they're rendered, so this only holds a
+		// complete frame from the start of V-blank until the next frame starts.
+		alignas(simd::ALIGNMENT) std::array<Word, SCREEN_WIDTH * SCREEN_HEIGHT> frameBuffer {};
+
+		// the number of frames that have been completed (i.e. the number of V-blanks so far)
+		uint64_t frameCount = 0;
+
+		//=== Registers ===
+		// the last value written to each of the write-only registers. the renderer decodes these as it needs them.
+		std::array<Byte, SETINI + 1> registers {};
+
+		// the registers that are written twice (or that are addresses into memory) are kept decoded
+		std::array<Word, 4> bgHOffset {};
+		std::array<Word, 4> bgVOffset {};
+		Word m7HOffset = 0;
+		Word m7VOffset = 0;
+
+		// M7A through M7D, M7X, and M7Y
+		std::array<int16_t, 4> m7Matrix {};
+		int16_t m7X = 0;
+		int16_t m7Y = 0;
+
+		Word vramAddress = 0;
+		Word oamAddress = 0; // the word address last written to OAMADDL/H
+		Word cgramAddress = 0;
+
+		// the backdrop color for the sub screen (COLDATA)
+		Word fixedColor = 0;
+
+		explicit PPU(Scheduler& scheduler);
+
+		void reset(Bus* bus);
+
+		// renders the given line (`FIRST_VISIBLE_LINE` through `VBLANK_LINE - 1`) into the frame buffer
+		void renderLine(unsigned line);
+
+		// marks the tiles in the given VRAM words as changed (or all of them, without any arguments) after `vram` was
+		// written to directly
+		void invalidateTiles(Word address, size_t count = 1) {
+			_tiles.invalidate(address, count);
+		};
+		void invalidateTiles() {
+			_tiles.invalidateAll();
+		};
+
+		//=== BBusDevice ===
+		Byte readB(Byte address) override;
+		void writeB(Byte address, Byte value) override;
+
+		// VRAM, CGRAM, and OAM data (i.e. the usual DMA targets) are written without going through `writeB` for every byte
+		bool writeBlockB(Byte address, bool alternating, const Byte* data, size_t size) override;
+
+		void saveState(StateWriter& writer) const;
+		void loadState(StateReader& reader);
+
+	private:
+		Bus* _bus = nullptr;
+		Scheduler& _scheduler;
+		Scheduler::EventType _lineEvent;
+
+		//=== Internal state ===
+		Byte _bgOffsetLatch = 0;
+		Byte _bgHOffsetLatch = 0;
+		Byte _m7Latch = 0;
+		Word _vramPrefetch = 0;
+		Word _oamInternalAddress = 0; // a byte address (10 bits)
+		Byte _oamLatch = 0;
+		Byte _cgramLatch = 0;
+		bool _cgramHighByte = false;
+		Word _hCounterLatch = 0;
+		Word _vCounterLatch = 0;
+		bool _countersLatched = false;
+		bool _hCounterHighByte = false;
+		bool _vCounterHighByte = false;
+
+		// decoded tiles, kept up to date by invalidating them whenever VRAM is written. (it's only a cache, so rendering
+		// doesn't count as changing the PPU.)
+		mutable TileCache _tiles { vram.data() };
+
+		void runLine(MasterCycles scheduledTime);
+
+		Word vramRemappedAddress() const;
+		void incrementVRAMAddress(bool highByte);
+		void writeVRAM(Byte value, bool highByte);
+		void writeOAM(Byte value);
+		void writeCGRAM(Byte value);
+
+		//=== Rendering (see `PPURender.cpp`) ===
+		// one layer's worth of a line
+		struct LayerLine {
+			alignas(simd::ALIGNMENT) std::array<Word, SCREEN_WIDTH> color;
+
+			// 0 where the layer is transparent
+			alignas(simd::ALIGNMENT) std::array<Word, SCREEN_WIDTH> depth;
+
+			// which layer each pixel came from (see `PPURender.cpp`); it decides whether color math applies to it.
+			// (only sprites and the screens fill this in: every pixel of a BG comes from that BG.)
+			alignas(simd::ALIGNMENT) std::array<Word, SCREEN_WIDTH> source;
+		};
+
+		// BG1 through BG4, then sprites
+		std::array<LayerLine, 5> _layers;
+		LayerLine _mainScreen;
+		LayerLine _subScreen;
+
+		// 0xffff where the window in question covers the pixel. (the layers' windows are indexed like `_layers`, and
+		// the color window comes last.)
+		alignas(simd::ALIGNMENT) std::array<std::array<Word, SCREEN_WIDTH>, 6> _windowMasks;
+
+		// W12SEL through WOBJLOG, as they were when `_windowMasks` was last computed
+		std::array<Byte, WOBJLOG - W12SEL + 1> _windowRegisters {};
+		bool _windowMasksValid = false;
+
+		// the sprites on each line (by their number in OAM, in the order they're found in), worked out for every line at
+		// once, and only again when OAM or the registers that decide which sprites are on a line change. (`oam` is public,
+		// so this keeps a copy of what it was worked out from, rather than relying on every write to say so.)
+		std::array<std::array<Byte, SPRITES_PER_LINE>, SCREEN_HEIGHT> _lineSprites;
+		std::array<Byte, SCREEN_HEIGHT> _lineSpriteCounts {};
+		std::array<Byte, OAM_SIZE> _lineSpritesOAM {};
+		Byte _lineSpritesOBSEL = 0;
+		unsigned _lineSpritesFirst = 0;
+		bool _lineSpritesValid = false;
+
+		// (`hidden`, if it isn't null, is 0xffff where the BG can be left undrawn)
+		void renderBackground(size_t index, unsigned line, const Word* hidden, LayerLine& out) const;
+		void renderMode7(unsigned line, LayerLine& bg1, LayerLine* bg2) const;
+		void findSprites();
+		void renderSprites(unsigned line, LayerLine& out) const;
+		void applyMosaic(LayerLine& out) const;
+		void computeWindows();
+		void composite(Byte layerMask, Byte windowMask, Word backdrop, LayerLine& out) const;
+		void applyColorMath(Word* destination) const;
+	};
+} // namespace Blaze
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <blaze/CPU.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// the profiler is compiled out unless this is set to 1 (see the `BLAZE_PROFILER` CMake option)
+#ifndef BLAZE_PROFILER
+	#define BLAZE_PROFILER 0
+#endif
+
+#if BLAZE_PROFILER && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+	#define BLAZE_PROFILER_RDTSC 1
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#else
+		#include <x86intrin.h>
+	#endif
+#else
+	#define BLAZE_PROFILER_RDTSC 0
+#endif
+
+namespace Blaze {
+	struct ProfileCounters {
+		uint64_t executions = 0;
+		uint64_t cycles = 0; // master cycles, not counting DMA stalls
+		uint64_t ticks = 0; // host time spent in the handlers (see `Profiler::timestamp`)
+
+		ProfileCounters& operator+=(const ProfileCounters& other) {
+			executions += other.executions;
+			cycles += other.cycles;
+			ticks += other.ticks;
+			return *this;
+		};
+	};
+
+	//
+	// Everything the profiler counted so far, per handler (i.e. indexed with `CPU::dispatchIndex`, just like
+	// `CPU::DISPATCH_TABLE`), with the other views worked out from that.
+	//
+	struct ProfileSnapshot {
+		std::array<ProfileCounters, 1024> handlers {};
+
+		// how long a tick is on this machine
+		double nanosecondsPerTick = 1.0;
+
+		ProfileCounters total() const;
+		ProfileCounters opcode(CPU::Opcode opcode) const;
+		ProfileCounters addressingMode(CPU::AddressingMode mode) const;
+
+		// `m` and `x` as they were when the instructions ran (true = 8-bit)
+		ProfileCounters width(bool memoryIs8Bit, bool indexIs8Bit) const;
+
+		// a summary sorted by host time: the top `limit` handlers, then every opcode, addressing mode and width
+		void writeReport(std::ostream& stream, size_t limit = 20) const;
+	};
+
+	//
+	// An opt-in profiler for the CPU's instruction handlers.
+	//
+	// When built with `BLAZE_PROFILER` set, the CPU counts every instruction it runs through `execute` or `run`: how many
+	// times each handler ran, how many emulated cycles it took, and how long the host spent in it (in TSC ticks on x86,
+	// `steady_clock` ticks elsewhere). Instructions run by the JIT aren't counted, since they never go through a handler.
+	// (reading the TSC takes a few nanoseconds itself, so the host times of the smallest handlers are a bit inflated.)
+	//
+	// The counters are per-thread, so the hot path never touches anything shared: `record` is a couple of plain
+	// increments. `snapshot` adds up every thread's counters (including threads that have exited since).
+	//
+	// Without `BLAZE_PROFILER`, `ENABLED` is false and the CPU compiles the hooks out entirely.
+	//
+	class Profiler {
+	public:
+		static constexpr bool ENABLED = BLAZE_PROFILER != 0;
+
+		static uint64_t timestamp() {
+#if BLAZE_PROFILER_RDTSC
+			return __rdtsc();
+#else
+			return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+		};
+
+		static void record(size_t handler, uint64_t cycles, uint64_t ticks) {
+			ThreadCounters* counters = _threadCounters;
+			if (counters == nullptr) {
+				counters = registerThread();
+			}
+
+			// only this thread ever writes these, so they don't need to be read-modify-write atomics;
+			// they're only atomic so that `snapshot` can read them at the same time
+			auto& entry = counters->handlers[handler];
+			entry.executions.store(entry.executions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			entry.cycles.store(entry.cycles.load(std::memory_order_relaxed) + cycles, std::memory_order_relaxed);
+			entry.ticks.store(entry.ticks.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+		};
+
+		static ProfileSnapshot snapshot();
+
+		// zeroes every thread's counters. counts recorded while this runs may or may not survive it, so it's best
+		// done while the emulation is paused.
+		static void reset();
+
+	private:
+		struct ThreadCounters {
+			struct Entry {
+				std::atomic<uint64_t> executions { 0 };
+				std::atomic<uint64_t> cycles { 0 };
+				std::atomic<uint64_t> ticks { 0 };
+			};
+
+			std::array<Entry, 1024> handlers {};
+		};
+
+		// owns a thread's counters, and adds them to the totals of exited threads when the thread exits
+		struct ThreadRegistration;
+
+		static inline thread_local ThreadCounters* _threadCounters = nullptr;
+
+		// allocates this thread's counters the first time it records anything
+		static ThreadCounters* registerThread();
+	};
+} // namespace Blaze
@@ -2,6 +2,7 @@
 
 #include <blaze/MemTypes.hpp>
 #include <blaze/MMIO.hpp>
+#include <blaze/MappedFile.hpp>
 
 #include <string>
 #include <array>
@@ -33,6 +34,15 @@ namespace Blaze {
 			Europe = 2,
 		};
 
+		enum class StorageMode: Byte {
+			// the ROM file is mapped into memory (read-only). the OS only reads in the parts that are actually used,
+			// and the memory is shared with every other process that has the same ROM loaded.
+			MemoryMapped,
+
+			// the whole ROM file is read into memory owned by this ROM
+			Copied,
+		};
+
 		struct HeaderFieldOffset {
 			enum IgnoreMe: Byte {
 				MakerCode = 0x00,
@@ -54,17 +64,41 @@ namespace Blaze {
 		};
 
 	private:
-		std::vector<Byte> _memory;
+		// the ROM contents; this points into either `_mappedFile` or `_copiedMemory`
+		const Byte* _memory = nullptr;
+		size_t _memorySize = 0;
+
+		MappedFile _mappedFile;
+		std::vector<Byte> _copiedMemory;
+
 		Type _type = Type::INVALID;
 
 		size_t headerOffset() const;
+		void unload();
 
 	public:
 		Type type() const;
 		size_t byteSize() const;
+
+		// the size of the loaded image (`byteSize` is the size the header claims)
+		size_t imageSize() const {
+			return _memorySize;
+		};
 		std::string name() const;
 
-		void load(const std::string& path);
+		// the checksum from the ROM header (0 if no ROM is loaded)
+		Word checksum() const;
+
+		// NOTE: after loading a ROM, the bus needs to be reset (or at least have its memory map updated)
+		//       before it can access the new ROM contents.
+		//
+		// if the file can't be memory-mapped, it's copied instead (see `storageMode`).
+		void load(const std::string& path, StorageMode mode = StorageMode::MemoryMapped);
+
+		// how the currently loaded ROM is stored
+		StorageMode storageMode() const {
+			return _mappedFile.isOpen() ? StorageMode::MemoryMapped : StorageMode::Copied;
+		};
 
 		Byte read8(Address offset) override;
 		Word read16(Address offset) override;
@@ -75,5 +109,11 @@ namespace Blaze {
 		void write24(Address offset, Address value) override;
 
 		void reset(Bus* bus) override;
+
+		const Byte* directReadPointer(Address offset, Address size) override;
+
+		// the ROM contents aren't saved, only enough to make sure a state is loaded with the same ROM it was saved with
+		void saveState(StateWriter& writer) const override;
+		void loadState(StateReader& reader) override;
 	};
 } // namespace Blaze
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <blaze/MemTypes.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace Blaze {
+	struct Bus;
+
+	//
+	// Keeps a history of machine states so that emulation can be stepped backwards.
+	//
+	// A snapshot (a full save state) is taken every few frames. Only the newest snapshot is kept in full;
+	// every older one is stored as a delta that turns the snapshot after it back into it: the XOR of the
+	// two states, run-length encoded. Since most of RAM doesn't change between snapshots, the XOR is
+	// mostly zeros and the deltas end up tiny.
+	//
+	// The deltas live in a fixed-size ring buffer; when it fills up, the oldest ones are dropped.
+	//
+	class Rewind {
+	public:
+		static constexpr size_t DEFAULT_CAPACITY = 16 * 1024 * 1024;
+		static constexpr uint32_t DEFAULT_FRAMES_PER_SNAPSHOT = 4;
+
+		explicit Rewind(Bus& bus, size_t capacity = DEFAULT_CAPACITY, uint32_t framesPerSnapshot = DEFAULT_FRAMES_PER_SNAPSHOT);
+
+		// meant to be called once per emulated frame; takes a snapshot every `framesPerSnapshot` frames
+		void onFrame();
+
+		void takeSnapshot();
+
+		// restores the newest snapshot and drops it from the history, so that the next call goes further back.
+		// returns false if there's nothing left to restore.
+		bool stepBack();
+
+		void clear();
+
+		size_t snapshotCount() const {
+			return _entries.size() + (_hasNewest ? 1 : 0);
+		};
+
+		// the number of bytes used in the ring buffer
+		size_t deltaBytesUsed() const {
+			return _ringUsed;
+		};
+
+	private:
+		struct Entry {
+			size_t offset; // in `_ring`
+			size_t size;
+
+			// the size of the state this delta restores (states don't all have the same size)
+			size_t stateSize;
+		};
+
+		Bus& _bus;
+		uint32_t _framesPerSnapshot;
+		uint32_t _framesUntilSnapshot = 0;
+
+		// the newest snapshot, in full
+		std::vector<Byte> _newest;
+		bool _hasNewest = false;
+
+		// the deltas, oldest first
+		std::vector<Byte> _ring;
+		size_t _ringHead = 0; // where the next delta is written
+		size_t _ringUsed = 0;
+		std::deque<Entry> _entries;
+
+		// reused between snapshots to avoid reallocating
+		std::vector<Byte> _state;
+		std::vector<Byte> _delta;
+
+		void pushDelta(const std::vector<Byte>& delta, size_t stateSize);
+		void popDelta(std::vector<Byte>& outDelta);
+		void dropOldestDelta();
+
+		// encodes `from ^ to` (with the shorter one padded with zeros) into `outDelta`
+		static void encodeDelta(const std::vector<Byte>& from, const std::vector<Byte>& to, std::vector<Byte>& outDelta);
+
+		// applies a delta made by `encodeDelta(state, target)` to `state`, turning it into `target` (whose size is `targetSize`)
+		static void applyDelta(std::vector<Byte>& state, const std::vector<Byte>& delta, size_t targetSize);
+	};
+} // namespace Blaze
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <blaze/MemTypes.hpp>
+
+#include <cstdint>
+
+namespace Blaze {
+	class APU;
+	class StateWriter;
+	class StateReader;
+
+	//
+	// The sound CPU: an 8-bit processor (the SPC700, in the S-SMP) running at about 1.024 MHz, with the APU's 64 KiB of
+	// RAM as its whole address space (see `APU` for what's mapped where).
+	//
+	// Instructions are executed whole, one at a time; `step` returns how many of the SPC700's own cycles each one took,
+	// which is all the APU needs to keep its timers and the DSP in step with it.
+	//
+	class SPC700 {
+	public:
+		// PSW bits
+		struct flags {
+			static constexpr Byte c = 0x01; // carry
+			static constexpr Byte z = 0x02; // zero
+			static constexpr Byte i = 0x04; // interrupts enabled (there's nothing to interrupt it on the SNES, though)
+			static constexpr Byte h = 0x08; // half-carry
+			static constexpr Byte b = 0x10; // break
+			static constexpr Byte p = 0x20; // direct page ($0100 instead of $0000)
+			static constexpr Byte v = 0x40; // overflow
+			static constexpr Byte n = 0x80; // negative
+		};
+
+		//=== Registers ===
+		Byte A = 0;
+		Byte X = 0;
+		Byte Y = 0;
+		Byte SP = 0;
+		Byte PSW = 0;
+		Word PC = 0;
+
+		// set by `SLEEP` and `STOP`; nothing wakes it up again short of a reset
+		bool stopped = false;
+
+		void reset(APU* apu);
+
+		// executes the instruction at the PC, returning the number of cycles it took
+		unsigned step();
+
+		void saveState(StateWriter& writer) const;
+		void loadState(StateReader& reader);
+
+	private:
+		APU* _apu = nullptr;
+
+		Byte read(Word address);
+		void write(Word address, Byte value);
+		Word read16(Word address);
+
+		Byte fetch() {
+			return read(PC++);
+		};
+		Word fetch16();
+
+		// direct page accesses wrap around within the page
+		Word direct(Byte offset) const {
+			return ((PSW & flags::p) != 0 ? 0x0100 : 0x0000) | offset;
+		};
+		Word readDirect16(Byte offset);
+		void writeDirect16(Byte offset, Word value);
+
+		void push(Byte value);
+		Byte pop();
+		void call(Word address);
+
+		// returns the extra cycles a taken branch costs
+		unsigned branch(bool condition);
+
+		void setFlag(Byte flag, bool set) {
+			PSW = set ? (PSW | flag) : (PSW & ~flag);
+		};
+		Byte setZN(Byte value) {
+			setFlag(flags::z, value == 0);
+			setFlag(flags::n, (value & 0x80) != 0);
+			return value;
+		};
+		void setZN16(Word value) {
+			setFlag(flags::z, value == 0);
+			setFlag(flags::n, (value & 0x8000) != 0);
+		};
+
+		//=== ALU ===
+		Byte opOR(Byte left, Byte right);
+		Byte opAND(Byte left, Byte right);
+		Byte opEOR(Byte left, Byte right);
+		Byte opCMP(Byte left, Byte right);
+		Byte opADC(Byte left, Byte right);
+		Byte opSBC(Byte left, Byte right);
+		Byte opASL(Byte value);
+		Byte opROL(Byte value);
+		Byte opLSR(Byte value);
+		Byte opROR(Byte value);
+		Byte opINC(Byte value);
+		Byte opDEC(Byte value);
+
+		using AluOp = Byte (SPC700::*)(Byte, Byte);
+		using ShiftOp = Byte (SPC700::*)(Byte);
+
+		// runs an ALU instruction from one of the first 12 rows of columns 4 through 9, given its column and whether its row
+		// is odd (which together pick the addressing mode). `CMP` doesn't write its result back to memory.
+		void aluInstruction(AluOp op, bool writes, Byte column, bool oddRow);
+	};
+} // namespace Blaze
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Blaze {
+	//
+	// A lock-free single-producer/single-consumer ring buffer of interleaved 16-bit stereo samples.
+	//
+	// Neither side ever waits for the other: the producer writes as many frames as there's room for (and drops the
+	// rest), and the consumer reads as many as there are. The head and tail only ever count up (wrapping around at the
+	// size of `size_t`), so full and empty are told apart without wasting a slot.
+	//
+	// "Single producer" means one at a time: the producer can move between threads as long as something else (like a
+	// mutex) orders one thread's writes before the next one's.
+	//
+	class SampleRing {
+	public:
+		static constexpr size_t CHANNELS = 2;
+
+		// the capacity is rounded up to a power of 2
+		explicit SampleRing(size_t capacityFrames):
+			_mask(roundUpToPowerOf2(capacityFrames) - 1),
+			_samples((_mask + 1) * CHANNELS)
+		{};
+
+		SampleRing(const SampleRing&) = delete;
+		SampleRing& operator=(const SampleRing&) = delete;
+
+		size_t capacity() const {
+			return _mask + 1;
+		};
+
+		// how many frames are waiting to be read. (from the producer's side, there may be fewer by the time this returns;
+		// from the consumer's, there may be more.)
+		size_t available() const {
+			return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+		};
+
+		//=== Producer ===
+		// returns how many frames were written
+		size_t write(const int16_t* samples, size_t frames) {
+			size_t head = _head.load(std::memory_order_relaxed);
+			size_t tail = _tail.load(std::memory_order_acquire);
+			frames = std::min(frames, capacity() - (head - tail));
+
+			copy(samples, head, frames, [this](size_t index, const int16_t* source, size_t count) {
+				std::memcpy(&_samples[index * CHANNELS], source, count * CHANNELS * sizeof(int16_t));
+			});
+
+			_head.store(head + frames, std::memory_order_release);
+			return frames;
+		};
+
+		//=== Consumer ===
+		// returns how many frames were read
+		size_t read(int16_t* samples, size_t frames) {
+			size_t tail = _tail.load(std::memory_order_relaxed);
+			size_t head = _head.load(std::memory_order_acquire);
+			frames = std::min(frames, head - tail);
+
+			copy(samples, tail, frames, [this](size_t index, int16_t* destination, size_t count) {
+				std::memcpy(destination, &_samples[index * CHANNELS], count * CHANNELS * sizeof(int16_t));
+			});
+
+			_tail.store(tail + frames, std::memory_order_release);
+			return frames;
+		};
+
+	private:
+		size_t _mask;
+		std::vector<int16_t> _samples;
+
+		// (on separate cache lines, since each one is written by a different thread)
+		alignas(64) std::atomic<size_t> _head { 0 }; // only the producer moves this
+		alignas(64) std::atomic<size_t> _tail { 0 }; // only the consumer moves this
+
+		static size_t roundUpToPowerOf2(size_t value) {
+			size_t result = 1;
+			while (result < value) {
+				result <<= 1;
+			}
+			return result;
+		};
+
+		// calls `function(ringIndex, other, count)` for the (up to 2) contiguous pieces of the given range of the ring
+		template<typename Pointer, typename Function>
+		void copy(Pointer other, size_t position, size_t frames, Function function) {
+			size_t index = position & _mask;
+			size_t first = std::min(frames, capacity() - index);
+			function(index, other, first);
+			if (first < frames) {
+				function(0, other + first * CHANNELS, frames - first);
+			}
+		};
+	};
+} // namespace Blaze
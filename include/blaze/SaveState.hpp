@@ -0,0 +1,101 @@
+#pragma once
+
+#include <blaze/MemTypes.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace Blaze {
+	//
+	// Save state format
+	//
+	// A save state is a flat little-endian byte stream with no padding:
+	//
+	//   magic ("BLZS"), u16 version, then the state of each component in a fixed order
+	//   (see `Bus::saveState`). each component writes its fields with `StateWriter` and
+	//   reads them back in the same order with `StateReader`.
+	//
+	// Bump `SAVE_STATE_VERSION` whenever the layout changes; older states are rejected.
+	//
+	static constexpr Byte SAVE_STATE_MAGIC[4] = { 'B', 'L', 'Z', 'S' };
+	static constexpr Word SAVE_STATE_VERSION = 6;
+
+	// writes state into a caller-provided buffer.
+	// with a null buffer, it only counts the bytes that would be written (which is how `Bus::saveStateSize` works).
+	class StateWriter {
+		Byte* _buffer;
+		size_t _capacity;
+		size_t _offset = 0;
+
+	public:
+		StateWriter(Byte* buffer, size_t capacity):
+			_buffer(buffer),
+			_capacity(capacity)
+			{};
+
+		size_t offset() const {
+			return _offset;
+		};
+
+		void writeBytes(const Byte* data, size_t size) {
+			if (_buffer != nullptr) {
+				if (size > _capacity - _offset) {
+					throw std::runtime_error("Save state buffer is too small");
+				}
+				std::memcpy(_buffer + _offset, data, size);
+			}
+			_offset += size;
+		};
+
+		template<typename T>
+		void write(T value) {
+			static_assert(std::is_integral_v<T>, "only integers can be written directly");
+
+			Byte bytes[sizeof(T)];
+			for (size_t i = 0; i < sizeof(T); ++i) {
+				bytes[i] = static_cast<Byte>(static_cast<std::make_unsigned_t<T>>(value) >> (i * 8));
+			}
+			writeBytes(bytes, sizeof(T));
+		};
+	};
+
+	class StateReader {
+		const Byte* _buffer;
+		size_t _size;
+		size_t _offset = 0;
+
+	public:
+		StateReader(const Byte* buffer, size_t size):
+			_buffer(buffer),
+			_size(size)
+			{};
+
+		size_t offset() const {
+			return _offset;
+		};
+
+		void readBytes(Byte* data, size_t size) {
+			if (size > _size - _offset) {
+				throw std::runtime_error("Save state is truncated");
+			}
+			std::memcpy(data, _buffer + _offset, size);
+			_offset += size;
+		};
+
+		template<typename T>
+		T read() {
+			static_assert(std::is_integral_v<T>, "only integers can be read directly");
+
+			Byte bytes[sizeof(T)];
+			readBytes(bytes, sizeof(T));
+
+			std::make_unsigned_t<T> value = 0;
+			for (size_t i = 0; i < sizeof(T); ++i) {
+				value |= static_cast<std::make_unsigned_t<T>>(bytes[i]) << (i * 8);
+			}
+			return static_cast<T>(value);
+		};
+	};
+} // namespace Blaze
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace Blaze {
+	class StateWriter;
+	class StateReader;
+
+	// timestamps and durations on the SNES master clock
+	using MasterCycles = uint64_t;
+
+	//=== Timing (NTSC) ===
+	static constexpr MasterCycles MASTER_CLOCK_HZ = 21'477'272;
+	static constexpr MasterCycles MASTER_CYCLES_PER_SCANLINE = 1364;
+	static constexpr MasterCycles SCANLINES_PER_FRAME = 262;
+	static constexpr MasterCycles MASTER_CYCLES_PER_FRAME = MASTER_CYCLES_PER_SCANLINE * SCANLINES_PER_FRAME;
+
+	//
+	// Keeps track of the master clock and of the timed events devices have scheduled on it.
+	//
+	// Devices register a callback for each kind of event once (e.g. H-blank, V-blank, IRQ timers, DMA) and then
+	// schedule it for specific points in time. Pending events are kept in a min-heap, so the core can ask when
+	// the next one is due and run everything up to that point without polling the devices.
+	//
+	class Scheduler {
+	public:
+		using EventType = uint32_t;
+
+		// receives the time the event was scheduled for (which may be slightly in the past, since the CPU can't be
+		// interrupted mid-instruction). periodic events should reschedule themselves relative to it to avoid drift.
+		using Callback = std::function<void(MasterCycles scheduledTime)>;
+
+		static constexpr MasterCycles NEVER = std::numeric_limits<MasterCycles>::max();
+
+		// resets the time to 0 and drops all pending events. registered event types stay registered.
+		void reset();
+
+		MasterCycles now() const {
+			return _now;
+		};
+
+		EventType registerEvent(Callback callback);
+
+		// called with the time of every event that gets scheduled. the bus uses this to find out about events that are
+		// scheduled while the CPU is running a batch of instructions, since the batch might have to end before them.
+		std::function<void(MasterCycles time)> scheduleHook;
+
+		// an event type can be pending more than once; each call schedules another occurrence
+		void schedule(EventType type, MasterCycles time);
+		void scheduleIn(EventType type, MasterCycles delay) {
+			schedule(type, _now + delay);
+		};
+
+		// drops all pending occurrences of the given event type
+		void cancel(EventType type);
+		bool isPending(EventType type) const;
+
+		// returns `NEVER` if nothing is pending
+		MasterCycles nextEventTime() const {
+			return _queue.empty() ? NEVER : _queue.front().time;
+		};
+
+		// moves time forward, running the callbacks of all the events that become due (in order)
+		void advance(MasterCycles cycles) {
+			advanceTo(_now + cycles);
+		};
+		void advanceTo(MasterCycles time);
+
+		// pending events are saved by type, so the same event types need to be registered (in the same order) when loading
+		void saveState(StateWriter& writer) const;
+		void loadState(StateReader& reader);
+
+	private:
+		struct PendingEvent {
+			MasterCycles time;
+			uint64_t sequence; // keeps events scheduled for the same time in the order they were scheduled
+			EventType type;
+		};
+
+		// for the heap functions, "less" means "runs later", which puts the earliest event at the front
+		static bool runsLater(const PendingEvent& lhs, const PendingEvent& rhs) {
+			return (lhs.time != rhs.time) ? (lhs.time > rhs.time) : (lhs.sequence > rhs.sequence);
+		};
+
+		MasterCycles _now = 0;
+		uint64_t _nextSequence = 0;
+		std::vector<Callback> _callbacks;
+		std::vector<PendingEvent> _queue;
+	};
+} // namespace Blaze
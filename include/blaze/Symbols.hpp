@@ -0,0 +1,37 @@
+#pragma once
+
+#include <blaze/MemTypes.hpp>
+
+#include <istream>
+#include <map>
+#include <string>
+
+namespace Blaze {
+	//
+	// Label names for ROM addresses, from the symbol files asar writes with `--symbols=wla` (or `--symbols=nocash`).
+	//
+	// Both formats have one label per line: "bb:aaaa name" for WLA (under a "[labels]" heading) and "bbaaaaaa name" for
+	// no$sns. Comments (from `;`), anonymous (`+`/`-`) labels and every other section of the file are skipped.
+	//
+	class SymbolTable {
+	public:
+		// adds the labels in the given file. throws `std::runtime_error` if it can't be read.
+		void load(const std::string& path);
+		void load(std::istream& stream);
+
+		void add(Address address, const std::string& name) {
+			_labels[address & 0xffffff] = name;
+		};
+
+		size_t size() const {
+			return _labels.size();
+		};
+
+		// the label at the address, or the closest one before it in the same bank plus an offset (e.g. "main+$12"),
+		// or just the address (e.g. "00:8012") if the bank has no labels before it
+		std::string name(Address address) const;
+
+	private:
+		std::map<Address, std::string> _labels;
+	};
+} // namespace Blaze
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <blaze/MemTypes.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Blaze {
+	//
+	// Keeps the tiles in VRAM decoded from their planar format (2, 4, or 8 bitplanes) into color indices, so the renderer
+	// doesn't have to decode every tile again on every line it shows up on.
+	//
+	// VRAM is viewed as an array of tiles for each bit depth. Each of those views has a dirty bit per tile, which is set
+	// when any of the tile's words is written (the PPU calls `invalidate` for that); dirty tiles are decoded again the
+	// next time they're used, or all at once with `decodeDirty`. Tiles that aren't written don't get decoded again at all.
+	//
+	class TileCache {
+	public:
+		static constexpr size_t VRAM_WORDS = 0x8000;
+
+		// decodes from the given VRAM, which has to outlive the cache. everything starts out dirty.
+		explicit TileCache(const Word* vram);
+
+		// one row of a tile: 8 color indices (one per byte, leftmost pixel in the lowest byte).
+		// `address` is the word address of the tile, which is a multiple of the tile's size (`depth * 4` words).
+		uint64_t row(Byte depth, Word address, unsigned row) {
+			DepthCache& cache = _caches[depth >> 2];
+			size_t tile = (address & (VRAM_WORDS - 1)) >> cache.shift;
+			uint64_t& dirtyWord = cache.dirty[tile >> 6];
+			uint64_t dirtyBit = uint64_t(1) << (tile & 63);
+			if ((dirtyWord & dirtyBit) != 0) {
+				decode(depth, tile);
+				dirtyWord &= ~dirtyBit;
+			}
+			return cache.rows[tile * 8 + row];
+		};
+
+		// one depth's worth of tiles, all decoded (see `decodeDirty`)
+		struct DecodedTiles {
+			const uint64_t* rows;
+			size_t tileMask;
+
+			// like `TileCache::row`, but by tile number (the tile's address divided by its size, wrapping around VRAM)
+			uint64_t row(size_t tile, unsigned row) const {
+				return rows[(tile & tileMask) * 8 + row];
+			};
+		};
+
+		// decodes every dirty tile of the given depth now, and returns them all, to be read until the next write. the
+		// renderer does this once per line for each depth it draws, which keeps the dirty check (and the call to
+		// `decode` behind it, which the compiler has to make room for) out of its inner loops.
+		DecodedTiles decodeDirty(Byte depth);
+
+		// marks the tiles containing the given word(s) as dirty
+		void invalidate(Word address) {
+			size_t word = address & (VRAM_WORDS - 1);
+			for (DepthCache& cache: _caches) {
+				size_t tile = word >> cache.shift;
+				cache.dirty[tile >> 6] |= uint64_t(1) << (tile & 63);
+				cache.anyDirty = true;
+			}
+		};
+		void invalidate(Word address, size_t count);
+		void invalidateAll();
+
+	private:
+		struct DepthCache {
+			// tiles are `1 << shift` words long
+			unsigned shift = 0;
+			std::vector<uint64_t> rows;
+			std::vector<uint64_t> dirty;
+			// whether any of `dirty` might be set (only `decodeDirty` clears it, so that it's cheap when nothing is)
+			bool anyDirty = false;
+		};
+
+		const Word* _vram;
+
+		// 2bpp, 4bpp, and 8bpp (indexed by `depth >> 2`)
+		std::array<DepthCache, 3> _caches;
+
+		void decode(Byte depth, size_t tile);
+	};
+} // namespace Blaze
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <blaze/CPU.hpp>
+#include <blaze/MemTypes.hpp>
+#include <blaze/Scheduler.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Blaze {
+	//
+	// Instruction traces
+	//
+	// When tracing is enabled (by pointing `CPU::trace` at a `TraceBuffer`), the CPU appends one `TraceRecord`
+	// per instruction, with the registers as they were *before* the instruction executed.
+	//
+	// The buffer is a preallocated ring, so recording never allocates; once it's full, the oldest records are
+	// overwritten. Dumps can be saved to a file and disassembled offline with `blaze-trace`.
+	//
+	// Trace file format (little-endian, no padding):
+	//
+	//   magic ("BLZT"), u16 version, u64 record count, then the records oldest first,
+	//   each one `TRACE_RECORD_SIZE` bytes long (in the order of the fields in `TraceRecord`)
+	//
+	static constexpr Byte TRACE_MAGIC[4] = { 'B', 'L', 'Z', 'T' };
+	static constexpr Word TRACE_VERSION = 1;
+	static constexpr size_t TRACE_RECORD_SIZE = 32;
+
+	struct TraceRecord {
+		MasterCycles cycle; // the master clock when the instruction started
+		Address pc;         // `CPU::executingPC`
+		Byte bytes[4];      // the instruction bytes (only the first `size` are valid)
+		Word a;
+		Word x;
+		Word y;
+		Word sp;
+		Word dr;
+		Byte p;
+		Byte dbr;
+		Byte e;
+		Byte size;
+		Byte reserved[2];
+	};
+
+	static_assert(sizeof(TraceRecord) == TRACE_RECORD_SIZE, "trace records should be packed into 32 bytes");
+
+	//
+	// A single-producer ring buffer of trace records.
+	//
+	// Only the emulation thread records; other threads can read the records back at any time without locking,
+	// but they'll only get an exact copy while emulation is paused (the oldest records may be overwritten mid-copy otherwise).
+	//
+	class TraceBuffer {
+	public:
+		// 32 MiB worth of records
+		static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+
+		// the capacity is rounded up to a power of two
+		explicit TraceBuffer(size_t capacity = DEFAULT_CAPACITY);
+
+		void record(const TraceRecord& record) {
+			uint64_t written = _written.load(std::memory_order_relaxed);
+			_records[written & _mask] = record;
+			_written.store(written + 1, std::memory_order_release);
+		};
+
+		size_t capacity() const {
+			return _records.size();
+		};
+
+		// how many records have been recorded in total (including the ones that have been overwritten already)
+		uint64_t totalRecorded() const {
+			return _written.load(std::memory_order_acquire);
+		};
+
+		// how many records are still in the buffer
+		size_t size() const;
+
+		void clear() {
+			_written.store(0, std::memory_order_release);
+		};
+
+		// copies the records that are still in the buffer, oldest first
+		std::vector<TraceRecord> records() const;
+
+		void save(const std::string& path) const;
+
+	private:
+		std::vector<TraceRecord> _records;
+		size_t _mask;
+		std::atomic<uint64_t> _written { 0 };
+	};
+
+	std::vector<TraceRecord> loadTrace(const std::string& path);
+
+	// disassembles a single instruction, e.g. "LDA $1234,x". `pc` is the address of the instruction (for branch targets).
+	std::string disassemble(const Byte* bytes, Byte size, Address pc);
+
+	// the names of the `CPU::Opcode` and `CPU::AddressingMode` values, e.g. "LDA" and "AbsoluteIndexedX".
+	// (every branch is just "BRA" here; `disassemble` shows the condition.)
+	const char* opcodeName(CPU::Opcode opcode);
+	const char* addressingModeName(CPU::AddressingMode mode);
+
+	// formats a record as a single line of a trace listing: address, bytes, disassembly, and registers
+	std::string formatTraceRecord(const TraceRecord& record);
+} // namespace Blaze
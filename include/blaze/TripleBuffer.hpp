@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Blaze {
+	//
+	// A lock-free single-producer/single-consumer handoff of the most recent value.
+	//
+	// The producer fills in `back()` and then calls `publish()`; the consumer calls `acquire()`
+	// and, if it returns true, reads the newest published value from `front()`. Neither side
+	// ever waits for the other: if the producer publishes faster than the consumer acquires,
+	// the older values are simply skipped.
+	//
+	// Note that the buffer returned by `back()` after a publish contains stale data (whatever
+	// was last swapped out), so the producer needs to overwrite it completely.
+	//
+	template<typename T>
+	class TripleBuffer {
+		static constexpr uint8_t INDEX_MASK = 0x03;
+		static constexpr uint8_t FRESH_BIT = 0x04;
+
+		std::array<T, 3> _buffers {};
+
+		// the buffer in the middle, owned by neither side (plus `FRESH_BIT` if it was published and not yet acquired)
+		std::atomic<uint8_t> _middle { 1 };
+
+		uint8_t _back = 0; // owned by the producer
+		uint8_t _front = 2; // owned by the consumer
+
+	public:
+		//=== Producer ===
+		T& back() {
+			return _buffers[_back];
+		};
+
+		void publish() {
+			_back = _middle.exchange(_back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+		};
+
+		//=== Consumer ===
+		// returns true if a new value was published since the last call
+		bool acquire() {
+			if ((_middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0) {
+				return false;
+			}
+
+			_front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX_MASK;
+			return true;
+		};
+
+		const T& front() const {
+			return _buffers[_front];
+		};
+	};
+} // namespace Blaze
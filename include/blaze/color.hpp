@@ -1,15 +1,34 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace Blaze {
 	struct Color {
-		std::uint8_t r;
-		std::uint8_t g;
-		std::uint8_t b;
-		std::uint8_t a;
+		std::uint8_t r = 0;
+		std::uint8_t g = 0;
+		std::uint8_t b = 0;
+		std::uint8_t a = 255;
 
+		constexpr Color() = default;
 		constexpr Color(std::uint8_t r, std::uint8_t g, std::uint8_t b, std::uint8_t a = 255): // NOLINT
 			r(r), g(g), b(b), a(a) {};
+
+		// converts a 15-bit BGR555 color (what the PPU outputs), repeating the top bits of each component in the bottom ones
+		// so that 31 becomes 255
+		static constexpr Color fromBGR555(std::uint16_t color) {
+			return Color(expand5(color & 0x1f), expand5((color >> 5) & 0x1f), expand5((color >> 10) & 0x1f));
+		};
+
+	private:
+		static constexpr std::uint8_t expand5(unsigned component) {
+			return static_cast<std::uint8_t>((component << 3) | (component >> 2));
+		};
 	};
+
+	// `Color`s are laid out as 4 bytes in RGBA order (i.e. `SDL_PIXELFORMAT_RGBA32`), so whole frames can be handed to SDL
+	static_assert(sizeof(Color) == 4, "Color has to be 4 bytes");
+
+	// converts `count` BGR555 colors with `Color::fromBGR555`, several at a time (with SIMD). this is for whole frames.
+	void convertBGR555(const std::uint16_t* source, Color* destination, size_t count);
 } // namespace Blaze
@@ -0,0 +1,334 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//
+// Thin wrappers around the handful of SIMD operations the renderers and the DSP need, so that the same code can be
+// compiled for AVX2, SSE2, or plain scalar code (which is just a "vector" with one lane).
+//
+// The instruction set is picked at compile time from what the compiler targets (e.g. `-mavx2`); define
+// `BLAZE_SIMD_LEVEL` to 0 (scalar), 1 (SSE2), or 2 (AVX2) to override that.
+//
+#ifndef BLAZE_SIMD_LEVEL
+	#if defined(__AVX2__)
+		#define BLAZE_SIMD_LEVEL 2
+	#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define BLAZE_SIMD_LEVEL 1
+	#else
+		#define BLAZE_SIMD_LEVEL 0
+	#endif
+#endif
+
+#if BLAZE_SIMD_LEVEL >= 2
+	#include <immintrin.h>
+#elif BLAZE_SIMD_LEVEL >= 1
+	#include <emmintrin.h>
+#endif
+
+namespace Blaze::simd {
+	// the alignment that's enough for any of the vector types (for arrays that are loaded and stored a vector at a time)
+	static constexpr size_t ALIGNMENT = 32;
+
+	// the instruction set this was compiled for (for reports)
+#if BLAZE_SIMD_LEVEL >= 2
+	static constexpr const char* LEVEL_NAME = "AVX2";
+#elif BLAZE_SIMD_LEVEL >= 1
+	static constexpr const char* LEVEL_NAME = "SSE2";
+#else
+	static constexpr const char* LEVEL_NAME = "scalar";
+#endif
+
+	//
+	// A vector of unsigned 16-bit lanes.
+	//
+	// Comparisons return all ones in the lanes where they're true, and all zeroes where they're false (i.e. masks for
+	// `select`). `greaterThan`, `min`, and `max` compare the lanes as *signed* numbers, since that's all SSE2 has; the
+	// renderers only use them for values below $8000.
+	//
+#if BLAZE_SIMD_LEVEL >= 2
+	struct U16Vector {
+		static constexpr size_t LANES = 16;
+		__m256i value;
+
+		static U16Vector load(const uint16_t* source) {
+			return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)) };
+		};
+		void store(uint16_t* destination) const {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), value);
+		};
+		static U16Vector broadcast(uint16_t lane) {
+			return { _mm256_set1_epi16(static_cast<short>(lane)) };
+		};
+
+		friend U16Vector operator&(U16Vector a, U16Vector b) { return { _mm256_and_si256(a.value, b.value) }; };
+		friend U16Vector operator|(U16Vector a, U16Vector b) { return { _mm256_or_si256(a.value, b.value) }; };
+		friend U16Vector operator^(U16Vector a, U16Vector b) { return { _mm256_xor_si256(a.value, b.value) }; };
+		friend U16Vector operator+(U16Vector a, U16Vector b) { return { _mm256_add_epi16(a.value, b.value) }; };
+		friend U16Vector operator-(U16Vector a, U16Vector b) { return { _mm256_sub_epi16(a.value, b.value) }; };
+		friend U16Vector operator*(U16Vector a, U16Vector b) { return { _mm256_mullo_epi16(a.value, b.value) }; };
+
+		// `~a & b`
+		static U16Vector andNot(U16Vector a, U16Vector b) { return { _mm256_andnot_si256(a.value, b.value) }; };
+		static U16Vector subtractSaturated(U16Vector a, U16Vector b) { return { _mm256_subs_epu16(a.value, b.value) }; };
+		static U16Vector equal(U16Vector a, U16Vector b) { return { _mm256_cmpeq_epi16(a.value, b.value) }; };
+		static U16Vector greaterThan(U16Vector a, U16Vector b) { return { _mm256_cmpgt_epi16(a.value, b.value) }; };
+		static U16Vector min(U16Vector a, U16Vector b) { return { _mm256_min_epi16(a.value, b.value) }; };
+		static U16Vector max(U16Vector a, U16Vector b) { return { _mm256_max_epi16(a.value, b.value) }; };
+
+		template<int Bits> U16Vector shiftLeft() const { return { _mm256_slli_epi16(value, Bits) }; };
+		template<int Bits> U16Vector shiftRight() const { return { _mm256_srli_epi16(value, Bits) }; };
+
+		// `mask ? a : b`, lane by lane
+		static U16Vector select(U16Vector mask, U16Vector a, U16Vector b) {
+			return { _mm256_blendv_epi8(b.value, a.value, mask.value) };
+		};
+
+		// stores this vector's lanes alternating with `other`'s (i.e. `LANES * 2` lanes, starting with this one's first)
+		void storeInterleaved(U16Vector other, void* destination) const {
+			// (the unpack instructions work within each 128-bit half, so the halves have to be put back in order)
+			__m256i low = _mm256_unpacklo_epi16(value, other.value);
+			__m256i high = _mm256_unpackhi_epi16(value, other.value);
+			auto* out = static_cast<__m256i*>(destination);
+			_mm256_storeu_si256(out, _mm256_permute2x128_si256(low, high, 0x20));
+			_mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(low, high, 0x31));
+		};
+	};
+#elif BLAZE_SIMD_LEVEL >= 1
+	struct U16Vector {
+		static constexpr size_t LANES = 8;
+		__m128i value;
+
+		static U16Vector load(const uint16_t* source) {
+			return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(source)) };
+		};
+		void store(uint16_t* destination) const {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination), value);
+		};
+		static U16Vector broadcast(uint16_t lane) {
+			return { _mm_set1_epi16(static_cast<short>(lane)) };
+		};
+
+		friend U16Vector operator&(U16Vector a, U16Vector b) { return { _mm_and_si128(a.value, b.value) }; };
+		friend U16Vector operator|(U16Vector a, U16Vector b) { return { _mm_or_si128(a.value, b.value) }; };
+		friend U16Vector operator^(U16Vector a, U16Vector b) { return { _mm_xor_si128(a.value, b.value) }; };
+		friend U16Vector operator+(U16Vector a, U16Vector b) { return { _mm_add_epi16(a.value, b.value) }; };
+		friend U16Vector operator-(U16Vector a, U16Vector b) { return { _mm_sub_epi16(a.value, b.value) }; };
+		friend U16Vector operator*(U16Vector a, U16Vector b) { return { _mm_mullo_epi16(a.value, b.value) }; };
+
+		static U16Vector andNot(U16Vector a, U16Vector b) { return { _mm_andnot_si128(a.value, b.value) }; };
+		static U16Vector subtractSaturated(U16Vector a, U16Vector b) { return { _mm_subs_epu16(a.value, b.value) }; };
+		static U16Vector equal(U16Vector a, U16Vector b) { return { _mm_cmpeq_epi16(a.value, b.value) }; };
+		static U16Vector greaterThan(U16Vector a, U16Vector b) { return { _mm_cmpgt_epi16(a.value, b.value) }; };
+		static U16Vector min(U16Vector a, U16Vector b) { return { _mm_min_epi16(a.value, b.value) }; };
+		static U16Vector max(U16Vector a, U16Vector b) { return { _mm_max_epi16(a.value, b.value) }; };
+
+		template<int Bits> U16Vector shiftLeft() const { return { _mm_slli_epi16(value, Bits) }; };
+		template<int Bits> U16Vector shiftRight() const { return { _mm_srli_epi16(value, Bits) }; };
+
+		// (SSE2 doesn't have a blend instruction)
+		static U16Vector select(U16Vector mask, U16Vector a, U16Vector b) {
+			return { _mm_or_si128(_mm_and_si128(mask.value, a.value), _mm_andnot_si128(mask.value, b.value)) };
+		};
+
+		void storeInterleaved(U16Vector other, void* destination) const {
+			auto* out = static_cast<__m128i*>(destination);
+			_mm_storeu_si128(out, _mm_unpacklo_epi16(value, other.value));
+			_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(value, other.value));
+		};
+	};
+#else
+	struct U16Vector {
+		static constexpr size_t LANES = 1;
+		uint16_t value;
+
+		static U16Vector load(const uint16_t* source) {
+			return { *source };
+		};
+		void store(uint16_t* destination) const {
+			*destination = value;
+		};
+		static U16Vector broadcast(uint16_t lane) {
+			return { lane };
+		};
+
+		friend U16Vector operator&(U16Vector a, U16Vector b) { return { static_cast<uint16_t>(a.value & b.value) }; };
+		friend U16Vector operator|(U16Vector a, U16Vector b) { return { static_cast<uint16_t>(a.value | b.value) }; };
+		friend U16Vector operator^(U16Vector a, U16Vector b) { return { static_cast<uint16_t>(a.value ^ b.value) }; };
+		friend U16Vector operator+(U16Vector a, U16Vector b) { return { static_cast<uint16_t>(a.value + b.value) }; };
+		friend U16Vector operator-(U16Vector a, U16Vector b) { return { static_cast<uint16_t>(a.value - b.value) }; };
+		friend U16Vector operator*(U16Vector a, U16Vector b) { return { static_cast<uint16_t>(a.value * b.value) }; };
+
+		static U16Vector andNot(U16Vector a, U16Vector b) { return { static_cast<uint16_t>(~a.value & b.value) }; };
+		static U16Vector subtractSaturated(U16Vector a, U16Vector b) { return { static_cast<uint16_t>((a.value > b.value) ? (a.value - b.value) : 0) }; };
+		static U16Vector equal(U16Vector a, U16Vector b) { return { static_cast<uint16_t>((a.value == b.value) ? 0xffff : 0) }; };
+		static U16Vector greaterThan(U16Vector a, U16Vector b) {
+			return { static_cast<uint16_t>((static_cast<int16_t>(a.value) > static_cast<int16_t>(b.value)) ? 0xffff : 0) };
+		};
+		static U16Vector min(U16Vector a, U16Vector b) { return (static_cast<int16_t>(a.value) < static_cast<int16_t>(b.value)) ? a : b; };
+		static U16Vector max(U16Vector a, U16Vector b) { return (static_cast<int16_t>(a.value) > static_cast<int16_t>(b.value)) ? a : b; };
+
+		template<int Bits> U16Vector shiftLeft() const { return { static_cast<uint16_t>(value << Bits) }; };
+		template<int Bits> U16Vector shiftRight() const { return { static_cast<uint16_t>(value >> Bits) }; };
+
+		static U16Vector select(U16Vector mask, U16Vector a, U16Vector b) {
+			return (mask.value != 0) ? a : b;
+		};
+
+		void storeInterleaved(U16Vector other, void* destination) const {
+			const uint16_t lanes[2] = { value, other.value };
+			std::memcpy(destination, lanes, sizeof(lanes));
+		};
+	};
+#endif
+
+	//
+	// A vector of 8 signed 32-bit lanes.
+	//
+	// Unlike `U16Vector`, this has the same number of lanes with every instruction set (the DSP uses one per voice), so
+	// with SSE2 it's a pair of registers, and the scalar version is a plain loop over all 8.
+	//
+	// `multiply16` only multiplies the low 16 bits of each lane (as signed numbers), since that's all SSE2 can do without
+	// SSE4.1's 32-bit multiply; the lanes have to be sign-extended 16-bit values for the result to be right.
+	//
+#if BLAZE_SIMD_LEVEL >= 2
+	struct I32Vector {
+		static constexpr size_t LANES = 8;
+		__m256i value;
+
+		static I32Vector load(const int32_t* source) {
+			return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)) };
+		};
+		void store(int32_t* destination) const {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), value);
+		};
+		static I32Vector broadcast(int32_t lane) {
+			return { _mm256_set1_epi32(lane) };
+		};
+
+		friend I32Vector operator&(I32Vector a, I32Vector b) { return { _mm256_and_si256(a.value, b.value) }; };
+		friend I32Vector operator+(I32Vector a, I32Vector b) { return { _mm256_add_epi32(a.value, b.value) }; };
+
+		static I32Vector multiply16(I32Vector a, I32Vector b) { return { _mm256_mullo_epi32(a.value, b.value) }; };
+		static I32Vector equal(I32Vector a, I32Vector b) { return { _mm256_cmpeq_epi32(a.value, b.value) }; };
+
+		// arithmetic (sign-extending) shift
+		template<int Bits> I32Vector shiftRight() const { return { _mm256_srai_epi32(value, Bits) }; };
+
+		// keeps the low 16 bits of each lane, sign-extended (i.e. the lanes wrap around like `int16_t`s)
+		I32Vector wrap16() const {
+			return { _mm256_srai_epi32(_mm256_slli_epi32(value, 16), 16) };
+		};
+		// clamps each lane to the range of an `int16_t`
+		I32Vector clamp16() const {
+			// (the packs and unpacks both work within 128-bit halves, so the lanes stay where they are)
+			__m256i packed = _mm256_packs_epi32(value, value);
+			return { _mm256_srai_epi32(_mm256_unpacklo_epi16(packed, packed), 16) };
+		};
+
+		static I32Vector select(I32Vector mask, I32Vector a, I32Vector b) {
+			return { _mm256_blendv_epi8(b.value, a.value, mask.value) };
+		};
+	};
+#elif BLAZE_SIMD_LEVEL >= 1
+	struct I32Vector {
+		static constexpr size_t LANES = 8;
+		__m128i low;
+		__m128i high;
+
+		static I32Vector load(const int32_t* source) {
+			auto* in = reinterpret_cast<const __m128i*>(source);
+			return { _mm_loadu_si128(in), _mm_loadu_si128(in + 1) };
+		};
+		void store(int32_t* destination) const {
+			auto* out = reinterpret_cast<__m128i*>(destination);
+			_mm_storeu_si128(out, low);
+			_mm_storeu_si128(out + 1, high);
+		};
+		static I32Vector broadcast(int32_t lane) {
+			return { _mm_set1_epi32(lane), _mm_set1_epi32(lane) };
+		};
+
+		friend I32Vector operator&(I32Vector a, I32Vector b) { return { _mm_and_si128(a.low, b.low), _mm_and_si128(a.high, b.high) }; };
+		friend I32Vector operator+(I32Vector a, I32Vector b) { return { _mm_add_epi32(a.low, b.low), _mm_add_epi32(a.high, b.high) }; };
+
+		static I32Vector multiply16(I32Vector a, I32Vector b) {
+			// with the top halves of `b`'s lanes cleared, the multiply-add only leaves the product of the bottom halves
+			__m128i bottom = _mm_set1_epi32(0xffff);
+			return {
+				_mm_madd_epi16(a.low, _mm_and_si128(b.low, bottom)),
+				_mm_madd_epi16(a.high, _mm_and_si128(b.high, bottom)),
+			};
+		};
+		static I32Vector equal(I32Vector a, I32Vector b) {
+			return { _mm_cmpeq_epi32(a.low, b.low), _mm_cmpeq_epi32(a.high, b.high) };
+		};
+
+		template<int Bits> I32Vector shiftRight() const { return { _mm_srai_epi32(low, Bits), _mm_srai_epi32(high, Bits) }; };
+
+		I32Vector wrap16() const {
+			return { _mm_srai_epi32(_mm_slli_epi32(low, 16), 16), _mm_srai_epi32(_mm_slli_epi32(high, 16), 16) };
+		};
+		I32Vector clamp16() const {
+			__m128i packed = _mm_packs_epi32(low, high);
+			return { _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16), _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16) };
+		};
+
+		static I32Vector select(I32Vector mask, I32Vector a, I32Vector b) {
+			return {
+				_mm_or_si128(_mm_and_si128(mask.low, a.low), _mm_andnot_si128(mask.low, b.low)),
+				_mm_or_si128(_mm_and_si128(mask.high, a.high), _mm_andnot_si128(mask.high, b.high)),
+			};
+		};
+	};
+#else
+	struct I32Vector {
+		static constexpr size_t LANES = 8;
+		int32_t value[LANES];
+
+		template<typename Function>
+		static I32Vector map(Function function) {
+			I32Vector result;
+			for (size_t i = 0; i < LANES; ++i) {
+				result.value[i] = function(i);
+			}
+			return result;
+		};
+
+		static I32Vector load(const int32_t* source) {
+			return map([&](size_t i) { return source[i]; });
+		};
+		void store(int32_t* destination) const {
+			std::memcpy(destination, value, sizeof(value));
+		};
+		static I32Vector broadcast(int32_t lane) {
+			return map([&](size_t) { return lane; });
+		};
+
+		friend I32Vector operator&(I32Vector a, I32Vector b) { return map([&](size_t i) { return a.value[i] & b.value[i]; }); };
+		friend I32Vector operator+(I32Vector a, I32Vector b) { return map([&](size_t i) { return a.value[i] + b.value[i]; }); };
+
+		static I32Vector multiply16(I32Vector a, I32Vector b) {
+			return map([&](size_t i) { return static_cast<int16_t>(a.value[i]) * static_cast<int16_t>(b.value[i]); });
+		};
+		static I32Vector equal(I32Vector a, I32Vector b) {
+			return map([&](size_t i) { return (a.value[i] == b.value[i]) ? -1 : 0; });
+		};
+
+		template<int Bits> I32Vector shiftRight() const { return map([&](size_t i) { return value[i] >> Bits; }); };
+
+		I32Vector wrap16() const {
+			return map([&](size_t i) { return static_cast<int32_t>(static_cast<int16_t>(value[i])); });
+		};
+		I32Vector clamp16() const {
+			return map([&](size_t i) { return std::clamp<int32_t>(value[i], INT16_MIN, INT16_MAX); });
+		};
+
+		static I32Vector select(I32Vector mask, I32Vector a, I32Vector b) {
+			return map([&](size_t i) { return (mask.value[i] != 0) ? a.value[i] : b.value[i]; });
+		};
+	};
+#endif
+} // namespace Blaze::simd
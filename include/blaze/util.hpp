@@ -27,7 +27,7 @@ namespace Blaze {
 		lo = static_cast<uint16_t>(val & 0xffff);
 	};
 
-	static constexpr void split24(uint32_t val, uint8_t hi, uint8_t mid, uint8_t lo) {
+	static constexpr void split24(uint32_t val, uint8_t& hi, uint8_t& mid, uint8_t& lo) {
 		uint16_t tmp = 0;
 		split24(val, hi, tmp);
 		split16(tmp, mid, lo);
@@ -82,7 +82,7 @@ namespace Blaze {
 		return shift ? (unshifted >> shiftBits) : unshifted;
 	};
 
-	static std::string valueToHexString(uint32_t value) {
+	inline std::string valueToHexString(uint32_t value) {
 		std::stringstream stream;
 		stream << std::hex << std::nouppercase << value;
 		return stream.str();
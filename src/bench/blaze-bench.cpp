@@ -0,0 +1,272 @@
+#include <blaze/Bus.hpp>
+#include <blaze/PPU.hpp>
+#include <blaze/color.hpp>
+#include <blaze/simd.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Blaze {
+	struct BenchOptions {
+		uint64_t frames = 1000;
+		std::vector<std::string> benchmarks; // empty = all of them
+	};
+} // namespace Blaze
+
+static void printUsage(const char* programName) {
+	std::cerr
+		<< "Usage: " << programName << " [options] [benchmark...]\n"
+		<< "\n"
+		<< "Times the parts of the emulator that run once per frame on synthetic (but busy) inputs, and prints the\n"
+		<< "average time per frame (and for `ppu`, the fastest frame). Without any benchmarks named, all of them are run.\n"
+		<< "\n"
+		<< "Benchmarks:\n"
+		<< "  ppu                     render frames of a mode 1 scene: 3 scrolled BGs, 128 sprites, windows and color math\n"
+		<< "  color                   convert frames from BGR555 to RGBA: one color at a time, with a lookup table, and\n"
+		<< "                          with `convertBGR555` (SIMD, at whatever level it was built for)\n"
+		<< "\n"
+		<< "Options:\n"
+		<< "  -n, --frames <count>    how many frames each benchmark runs for (default: 1000)\n"
+		<< "  -h, --help              show this message\n";
+};
+
+static bool parseArguments(int argc, char** argv, Blaze::BenchOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		if (arg == "-h" || arg == "--help") {
+			return false;
+		} else if (arg == "-n" || arg == "--frames") {
+			try {
+				size_t consumed = 0;
+				if (i + 1 >= argc) {
+					throw std::invalid_argument("missing count");
+				}
+				options.frames = std::stoull(argv[i + 1], &consumed, 0);
+				if (consumed != std::strlen(argv[i + 1]) || options.frames == 0) {
+					throw std::invalid_argument("trailing characters");
+				}
+			} catch (const std::exception&) {
+				std::cerr << "Invalid or missing count for " << arg << '\n';
+				return false;
+			}
+			++i;
+		} else if (!arg.empty() && arg[0] == '-') {
+			std::cerr << "Unknown option: " << arg << '\n';
+			return false;
+		} else if (arg == "ppu" || arg == "color") {
+			options.benchmarks.push_back(arg);
+		} else {
+			std::cerr << "Unknown benchmark: " << arg << '\n';
+			return false;
+		}
+	}
+
+	if (options.benchmarks.empty()) {
+		options.benchmarks = { "ppu", "color" };
+	}
+
+	return true;
+};
+
+// the same numbers every run, so that runs can be compared
+class Random {
+	uint32_t _state = 0x12345678;
+
+public:
+	uint32_t next() {
+		_state = _state * 1664525u + 1013904223u;
+		return _state >> 8;
+	};
+};
+
+static void writePPU(Blaze::Bus& bus, Blaze::Byte reg, Blaze::Byte value) {
+	bus.write(0x2100 | static_cast<Blaze::Address>(reg), value);
+};
+
+struct FrameTimes {
+	double average;
+	// the quickest single frame: what a frame costs when nothing else (e.g. another process, or another VM on the same
+	// host) gets in the way, which makes it the better number for comparing changes on a busy machine
+	double fastest;
+};
+
+// runs `frame` `frames` times (after one untimed warm-up run) and returns how long they took, in milliseconds
+template<typename Frame>
+static FrameTimes timeFrames(uint64_t frames, Frame&& frame) {
+	using Clock = std::chrono::steady_clock;
+	frame();
+
+	FrameTimes times { 0, std::numeric_limits<double>::infinity() };
+	Clock::time_point start = Clock::now();
+	Clock::time_point frameStart = start;
+	for (uint64_t i = 0; i < frames; ++i) {
+		frame();
+
+		Clock::time_point frameEnd = Clock::now();
+		times.fastest = std::min(times.fastest, std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+		frameStart = frameEnd;
+	}
+	times.average = std::chrono::duration<double, std::milli>(frameStart - start).count() / static_cast<double>(frames);
+	return times;
+};
+
+static void benchmarkPPU(const Blaze::BenchOptions& options) {
+	using Blaze::PPU;
+	auto bus = std::make_unique<Blaze::Bus>();
+	auto& ppu = bus->ppu;
+	Random random;
+
+	// every bit of VRAM is noise, so the tiles are all busy; the tilemaps get sensible entries below
+	writePPU(*bus, PPU::VMAIN, 0x80);
+	writePPU(*bus, PPU::VMADDL, 0x00);
+	writePPU(*bus, PPU::VMADDH, 0x00);
+	for (size_t word = 0; word < PPU::VRAM_WORDS; ++word) {
+		auto value = static_cast<Blaze::Word>(random.next());
+
+		// BG1-BG3's tilemaps are at $0000, $0400, and $0800 (with every tile flip and priority)
+		if (word < 0x0c00) {
+			value = static_cast<Blaze::Word>(value & 0xe3ff);
+		}
+		writePPU(*bus, PPU::VMDATAL, static_cast<Blaze::Byte>(value));
+		writePPU(*bus, PPU::VMDATAH, static_cast<Blaze::Byte>(value >> 8));
+	}
+
+	writePPU(*bus, PPU::CGADD, 0);
+	for (size_t color = 0; color < PPU::CGRAM_COLORS; ++color) {
+		auto value = static_cast<Blaze::Word>(random.next() & 0x7fff);
+		writePPU(*bus, PPU::CGDATA, static_cast<Blaze::Byte>(value));
+		writePPU(*bus, PPU::CGDATA, static_cast<Blaze::Byte>(value >> 8));
+	}
+
+	// 128 16x16 and 32x32 sprites all over the screen (so most lines hit the 32 sprite limit)
+	writePPU(*bus, PPU::OAMADDL, 0);
+	writePPU(*bus, PPU::OAMADDH, 0);
+	for (size_t byte = 0; byte < PPU::OAM_SIZE; ++byte) {
+		writePPU(*bus, PPU::OAMDATA, static_cast<Blaze::Byte>(random.next()));
+	}
+
+	// mode 1: BG1 and BG2 are 4bpp (tiles at $2000 and $4000), BG3 is 2bpp (tiles at $6000); sprites are at $c000
+	writePPU(*bus, PPU::INIDISP, 0x0f);
+	writePPU(*bus, PPU::BGMODE, 0x01);
+	writePPU(*bus, PPU::OBSEL, (0x03 << 5) | 0x06);
+	writePPU(*bus, PPU::BG1SC, 0x00);
+	writePPU(*bus, PPU::BG2SC, 0x04);
+	writePPU(*bus, PPU::BG3SC, 0x08);
+	writePPU(*bus, PPU::BG12NBA, 0x42);
+	writePPU(*bus, PPU::BG34NBA, 0x06);
+
+	// BG1 and sprites on the main screen, BG2 and BG3 on the sub screen, added together at half strength
+	writePPU(*bus, PPU::TM, 0x11);
+	writePPU(*bus, PPU::TS, 0x06);
+	writePPU(*bus, PPU::CGWSEL, 0x02);
+	writePPU(*bus, PPU::CGADSUB, 0x41 | 0x10);
+
+	// and a window that clips BG1 on part of the screen
+	writePPU(*bus, PPU::W12SEL, 0x02);
+	writePPU(*bus, PPU::WH0, 64);
+	writePPU(*bus, PPU::WH1, 191);
+	writePPU(*bus, PPU::TMW, 0x01);
+
+	unsigned scroll = 0;
+	FrameTimes times = timeFrames(options.frames, [&]() {
+		// scrolled by a few pixels every frame, so it's never the same frame twice
+		++scroll;
+		for (Blaze::Byte layer = 0; layer < 3; ++layer) {
+			writePPU(*bus, static_cast<Blaze::Byte>(PPU::BG1HOFS + layer * 2), static_cast<Blaze::Byte>(scroll * (layer + 1)));
+			writePPU(*bus, static_cast<Blaze::Byte>(PPU::BG1HOFS + layer * 2), 0);
+			writePPU(*bus, static_cast<Blaze::Byte>(PPU::BG1VOFS + layer * 2), static_cast<Blaze::Byte>(scroll));
+			writePPU(*bus, static_cast<Blaze::Byte>(PPU::BG1VOFS + layer * 2), 0);
+		}
+
+		for (unsigned line = PPU::FIRST_VISIBLE_LINE; line < PPU::VBLANK_LINE; ++line) {
+			ppu.renderLine(line);
+		}
+	});
+
+	std::printf("ppu: %.3f ms/frame, %.3f ms for the fastest frame (%s)\n", times.average, times.fastest, Blaze::simd::LEVEL_NAME);
+};
+
+static void benchmarkColor(const Blaze::BenchOptions& options) {
+	using Blaze::Color;
+	using Blaze::PPU;
+	constexpr size_t PIXELS = PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT;
+
+	Random random;
+	std::vector<Blaze::Word> frame(PIXELS);
+	for (auto& color: frame) {
+		color = static_cast<Blaze::Word>(random.next() & 0x7fff);
+	}
+
+	std::vector<Color> expected(PIXELS);
+	std::vector<Color> converted(PIXELS);
+	auto check = [&](const char* name) {
+		for (size_t i = 0; i < PIXELS; ++i) {
+			const Color& a = expected[i];
+			const Color& b = converted[i];
+			if (a.r != b.r || a.g != b.g || a.b != b.b || a.a != b.a) {
+				throw std::runtime_error(std::string("color: ") + name + " converted pixel " + std::to_string(i) + " wrong");
+			}
+		}
+	};
+
+	double scalar = timeFrames(options.frames, [&]() {
+		for (size_t i = 0; i < PIXELS; ++i) {
+			expected[i] = Color::fromBGR555(frame[i]);
+		}
+	}).average;
+
+	// (128 KiB, so it doesn't fit in L1 and most lookups are L2 hits at best)
+	auto table = std::make_unique<std::array<Color, 0x8000>>();
+	for (size_t color = 0; color < table->size(); ++color) {
+		(*table)[color] = Color::fromBGR555(static_cast<Blaze::Word>(color));
+	}
+	double lookup = timeFrames(options.frames, [&]() {
+		for (size_t i = 0; i < PIXELS; ++i) {
+			converted[i] = (*table)[frame[i] & 0x7fff];
+		}
+	}).average;
+	check("lookup table");
+
+	std::fill(converted.begin(), converted.end(), Color());
+	double vector = timeFrames(options.frames, [&]() {
+		Blaze::convertBGR555(frame.data(), converted.data(), PIXELS);
+	}).average;
+	check(Blaze::simd::LEVEL_NAME);
+
+	std::printf("color: %.3f ms/frame (scalar), %.3f ms/frame (lookup table), %.3f ms/frame (%s)\n",
+		scalar, lookup, vector, Blaze::simd::LEVEL_NAME);
+};
+
+int main(int argc, char** argv) {
+	Blaze::BenchOptions options;
+	if (!parseArguments(argc, argv, options)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	try {
+		for (const auto& benchmark: options.benchmarks) {
+			if (benchmark == "ppu") {
+				benchmarkPPU(options);
+			} else if (benchmark == "color") {
+				benchmarkColor(options);
+			}
+		}
+	} catch (const std::runtime_error& e) {
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+
+	return 0;
+};
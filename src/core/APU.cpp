@@ -0,0 +1,390 @@
+#include <blaze/APU.hpp>
+#include <blaze/Bus.hpp>
+#include <blaze/SaveState.hpp>
+
+#include <stdexcept>
+
+// CONTROL ($F1) bits
+static constexpr Blaze::Byte CONTROL_CLEAR_PORTS_01 = 0x10;
+static constexpr Blaze::Byte CONTROL_CLEAR_PORTS_23 = 0x20;
+static constexpr Blaze::Byte CONTROL_IPL_ENABLE = 0x80;
+
+// timers 0 and 1 step at 8 kHz, and timer 2 at 64 kHz (in SPC700 cycles)
+static constexpr unsigned TIMER_PERIODS[3] = { 128, 128, 16 };
+
+const std::array<Blaze::Byte, Blaze::APU::IPL_SIZE> Blaze::APU::IPL_ROM = {
+	0xcd, 0xef, 0xbd, 0xe8, 0x00, 0xc6, 0x1d, 0xd0, 0xfc, 0x8f, 0xaa, 0xf4, 0x8f, 0xbb, 0xf5, 0x78,
+	0xcc, 0xf4, 0xd0, 0xfb, 0x2f, 0x19, 0xeb, 0xf4, 0xd0, 0xfc, 0x7e, 0xf4, 0xd0, 0x0b, 0xe4, 0xf5,
+	0xcb, 0xf4, 0xd7, 0x00, 0xfc, 0xd0, 0xf3, 0xab, 0x01, 0x10, 0xef, 0x7e, 0xf4, 0x10, 0xeb, 0xba,
+	0xf6, 0xda, 0x00, 0xba, 0xf4, 0xc4, 0xf4, 0xdd, 0x5d, 0xd0, 0xdb, 0x1f, 0x00, 0x00, 0xc0, 0xff,
+};
+
+Blaze::APU::APU() {
+	_samples.reserve(SAMPLE_CHUNK_FRAMES * 2);
+};
+
+Blaze::APU::~APU() {
+	stopThread();
+};
+
+void Blaze::APU::reset(Bus* bus) {
+	std::lock_guard<std::mutex> lock(_runMutex);
+
+	_bus = bus;
+
+	aram.fill(0);
+	_timers.fill(Timer());
+	_iplEnabled = true;
+	_dspAddress = 0;
+	_inputPorts.fill(0);
+	_outputPorts.fill(0);
+
+	dsp.reset();
+	spc.reset(this);
+
+	_time.store(0, std::memory_order_release);
+	_horizon.store(0);
+	_clockRemainder = 0;
+	_cyclesDue = 0;
+	_sampleCycles = 0;
+	_samples.clear();
+	_queueTail.store(_queueHead.load(std::memory_order_relaxed), std::memory_order_release);
+};
+
+//=== I/O registers ===
+
+Blaze::Byte Blaze::APU::readIO(Word address) {
+	switch (address & 0x0f) {
+		case 0x2:
+			return _dspAddress;
+
+		case 0x3:
+			// (addresses $80 and up mirror the registers)
+			return dsp.read(_dspAddress);
+
+		case 0x4:
+		case 0x5:
+		case 0x6:
+		case 0x7:
+			return _inputPorts[address & 0x03];
+
+		case 0x8:
+		case 0x9:
+			// these two are just RAM
+			return aram[address];
+
+		case 0xd:
+		case 0xe:
+		case 0xf: {
+			Timer& timer = _timers[(address & 0x0f) - 0xd];
+			Byte counter = timer.counter;
+			timer.counter = 0;
+			return counter;
+		}
+
+		default:
+			// TEST, CONTROL, and the timer targets are write-only
+			return 0;
+	}
+};
+
+void Blaze::APU::writeIO(Word address, Byte value) {
+	switch (address & 0x0f) {
+		case 0x1:
+			for (unsigned i = 0; i < _timers.size(); ++i) {
+				Timer& timer = _timers[i];
+				bool enable = (value & (1 << i)) != 0;
+				if (enable && !timer.enabled) {
+					timer.stage = 0;
+					timer.counter = 0;
+				}
+				timer.enabled = enable;
+			}
+			if ((value & CONTROL_CLEAR_PORTS_01) != 0) {
+				_inputPorts[0] = 0;
+				_inputPorts[1] = 0;
+			}
+			if ((value & CONTROL_CLEAR_PORTS_23) != 0) {
+				_inputPorts[2] = 0;
+				_inputPorts[3] = 0;
+			}
+			_iplEnabled = (value & CONTROL_IPL_ENABLE) != 0;
+			break;
+
+		case 0x2:
+			_dspAddress = value;
+			break;
+
+		case 0x3:
+			// (the mirrors at $80 and up are read-only)
+			if (_dspAddress < DSP::REGISTER_COUNT) {
+				dsp.write(_dspAddress, value);
+			}
+			break;
+
+		case 0x4:
+		case 0x5:
+		case 0x6:
+		case 0x7:
+			_outputPorts[address & 0x03] = value;
+			break;
+
+		case 0xa:
+		case 0xb:
+		case 0xc:
+			_timers[(address & 0x0f) - 0xa].target = value;
+			break;
+	}
+};
+
+//=== Running ===
+
+void Blaze::APU::catchUp(MasterCycles time) {
+	for (;;) {
+		size_t tail = _queueTail.load(std::memory_order_relaxed);
+		if (tail == _queueHead.load(std::memory_order_acquire)) {
+			break;
+		}
+
+		const PortWrite& write = _queue[tail % QUEUE_SIZE];
+		if (write.time > time) {
+			break;
+		}
+
+		runTo(write.time);
+		_inputPorts[write.port] = write.value;
+		_queueTail.store(tail + 1, std::memory_order_release);
+	}
+
+	runTo(time);
+};
+
+void Blaze::APU::runTo(MasterCycles time) {
+	MasterCycles current = _time.load(std::memory_order_relaxed);
+	if (time <= current) {
+		return;
+	}
+
+	// (the clocks don't divide evenly, so the remainder carries over to the next run)
+	uint64_t scaled = (time - current) * CLOCK_HZ + _clockRemainder;
+	_clockRemainder = scaled % MASTER_CLOCK_HZ;
+	runCycles(scaled / MASTER_CLOCK_HZ);
+
+	_time.store(time, std::memory_order_release);
+};
+
+void Blaze::APU::runCycles(uint64_t cycles) {
+	_cyclesDue += static_cast<int64_t>(cycles);
+
+	while (_cyclesDue > 0) {
+		unsigned taken = spc.step();
+		_cyclesDue -= taken;
+		runTimers(taken);
+
+		_sampleCycles += taken;
+		if (_sampleCycles >= CYCLES_PER_SAMPLE) {
+			_sampleCycles -= CYCLES_PER_SAMPLE;
+
+			int16_t left = 0;
+			int16_t right = 0;
+			dsp.runSample(left, right);
+			_samples.push_back(left);
+			_samples.push_back(right);
+			if (_samples.size() >= SAMPLE_CHUNK_FRAMES * 2) {
+				flushSamples();
+			}
+		}
+	}
+};
+
+void Blaze::APU::runTimers(unsigned cycles) {
+	for (unsigned i = 0; i < _timers.size(); ++i) {
+		Timer& timer = _timers[i];
+		if (!timer.enabled) {
+			continue;
+		}
+
+		timer.cycles += cycles;
+		while (timer.cycles >= TIMER_PERIODS[i]) {
+			timer.cycles -= TIMER_PERIODS[i];
+			// (a target of 0 wraps around after 256 steps)
+			if (++timer.stage == timer.target) {
+				timer.stage = 0;
+				timer.counter = (timer.counter + 1) & 0x0f;
+			}
+		}
+	}
+};
+
+void Blaze::APU::flushSamples() {
+	if (sampleHook) {
+		sampleHook(_samples.data(), _samples.size() / 2);
+	}
+	_samples.clear();
+};
+
+void Blaze::APU::sync(MasterCycles time) {
+	std::lock_guard<std::mutex> lock(_runMutex);
+	catchUp(time);
+};
+
+void Blaze::APU::publish(MasterCycles time) {
+	_horizon.store(time);
+
+	// (see `threadMain` for why this can't miss the thread going to sleep)
+	if (_sleeping.load() && time >= _time.load(std::memory_order_relaxed) + WAKE_INTERVAL) {
+		std::lock_guard<std::mutex> lock(_wakeMutex);
+		_wake.notify_one();
+	}
+};
+
+//=== Thread ===
+
+void Blaze::APU::startThread() {
+	if (threaded()) {
+		return;
+	}
+
+	_stopRequested.store(false);
+	_thread = std::thread(&APU::threadMain, this);
+};
+
+void Blaze::APU::stopThread() {
+	if (!threaded()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_wakeMutex);
+		_stopRequested.store(true);
+		_wake.notify_one();
+	}
+	_thread.join();
+};
+
+void Blaze::APU::threadMain() {
+	for (;;) {
+		{
+			// `_sleeping` is set before checking the horizon, and `publish` sets the horizon before checking `_sleeping`
+			// (all sequentially consistent), so either we see the new horizon here or `publish` sees that we're asleep
+			std::unique_lock<std::mutex> lock(_wakeMutex);
+			_sleeping.store(true);
+			_wake.wait(lock, [this] {
+				return _stopRequested.load() || _horizon.load() >= _time.load(std::memory_order_relaxed) + WAKE_INTERVAL;
+			});
+			_sleeping.store(false);
+		}
+
+		if (_stopRequested.load()) {
+			return;
+		}
+
+		// the horizon is read after taking the lock, since loading a state can move it backwards
+		std::lock_guard<std::mutex> lock(_runMutex);
+		catchUp(_horizon.load(std::memory_order_acquire));
+	}
+};
+
+//=== BBusDevice ===
+
+Blaze::Byte Blaze::APU::readB(Byte address) {
+	_bus->cpu.endRun();
+
+	std::lock_guard<std::mutex> lock(_runMutex);
+	catchUp(_bus->scheduler.now());
+	return _outputPorts[address & 0x03];
+};
+
+void Blaze::APU::writeB(Byte address, Byte value) {
+	_bus->cpu.endRun();
+	MasterCycles now = _bus->scheduler.now();
+
+	size_t head = _queueHead.load(std::memory_order_relaxed);
+	if (head - _queueTail.load(std::memory_order_acquire) >= QUEUE_SIZE) {
+		// everything in the queue is due by now, so this empties it
+		sync(now);
+	}
+
+	_queue[head % QUEUE_SIZE] = { now, static_cast<Byte>(address & 0x03), value };
+	_queueHead.store(head + 1, std::memory_order_release);
+};
+
+//=== Save States ===
+
+void Blaze::APU::saveState(StateWriter& writer) const {
+	std::lock_guard<std::mutex> lock(_runMutex);
+
+	writer.writeBytes(aram.data(), aram.size());
+	spc.saveState(writer);
+	dsp.saveState(writer);
+
+	for (const Timer& timer: _timers) {
+		writer.write(static_cast<Byte>(timer.enabled));
+		writer.write(timer.target);
+		writer.write(timer.stage);
+		writer.write(timer.counter);
+		writer.write(static_cast<uint32_t>(timer.cycles));
+	}
+	writer.write(static_cast<Byte>(_iplEnabled));
+	writer.write(_dspAddress);
+	writer.writeBytes(_inputPorts.data(), _inputPorts.size());
+	writer.writeBytes(_outputPorts.data(), _outputPorts.size());
+
+	writer.write(_time.load(std::memory_order_relaxed));
+	writer.write(_clockRemainder);
+	writer.write(_cyclesDue);
+	writer.write(static_cast<uint32_t>(_sampleCycles));
+
+	// (the CPU is the only one adding writes, and that's who's saving)
+	size_t tail = _queueTail.load(std::memory_order_relaxed);
+	size_t head = _queueHead.load(std::memory_order_relaxed);
+	writer.write(static_cast<uint32_t>(head - tail));
+	for (size_t i = tail; i != head; ++i) {
+		const PortWrite& write = _queue[i % QUEUE_SIZE];
+		writer.write(write.time);
+		writer.write(write.port);
+		writer.write(write.value);
+	}
+};
+
+void Blaze::APU::loadState(StateReader& reader) {
+	std::lock_guard<std::mutex> lock(_runMutex);
+
+	reader.readBytes(aram.data(), aram.size());
+	spc.loadState(reader);
+	dsp.loadState(reader);
+
+	for (Timer& timer: _timers) {
+		timer.enabled = reader.read<Byte>() != 0;
+		timer.target = reader.read<Byte>();
+		timer.stage = reader.read<Byte>();
+		timer.counter = reader.read<Byte>() & 0x0f;
+		timer.cycles = reader.read<uint32_t>();
+	}
+	_iplEnabled = reader.read<Byte>() != 0;
+	_dspAddress = reader.read<Byte>();
+	reader.readBytes(_inputPorts.data(), _inputPorts.size());
+	reader.readBytes(_outputPorts.data(), _outputPorts.size());
+
+	MasterCycles time = reader.read<MasterCycles>();
+	_clockRemainder = reader.read<uint64_t>() % MASTER_CLOCK_HZ;
+	_cyclesDue = reader.read<int64_t>();
+	_sampleCycles = reader.read<uint32_t>() % CYCLES_PER_SAMPLE;
+
+	auto pending = reader.read<uint32_t>();
+	if (pending > QUEUE_SIZE) {
+		throw std::runtime_error("Save state has too many APU port writes queued");
+	}
+	for (size_t i = 0; i < pending; ++i) {
+		PortWrite& write = _queue[i];
+		write.time = reader.read<MasterCycles>();
+		write.port = reader.read<Byte>() & 0x03;
+		write.value = reader.read<Byte>();
+	}
+	_queueTail.store(0, std::memory_order_relaxed);
+	_queueHead.store(pending, std::memory_order_release);
+
+	_time.store(time, std::memory_order_release);
+	_horizon.store(time);
+	_samples.clear();
+};
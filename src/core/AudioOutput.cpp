@@ -0,0 +1,94 @@
+#include <blaze/AudioOutput.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// a 4-point (Catmull-Rom) Hermite spline through the samples, between the middle two
+static int16_t interpolate(int32_t y0, int32_t y1, int32_t y2, int32_t y3, double t) {
+	double a = -0.5 * y0 + 1.5 * y1 - 1.5 * y2 + 0.5 * y3;
+	double b = y0 - 2.5 * y1 + 2.0 * y2 - 0.5 * y3;
+	double c = -0.5 * y0 + 0.5 * y2;
+	double value = ((a * t + b) * t + c) * t + y1;
+	return static_cast<int16_t>(std::clamp(std::lround(value), -0x8000L, 0x7fffL));
+};
+
+Blaze::AudioOutput::AudioOutput(unsigned inputRate, unsigned outputRate, size_t latencyFrames):
+	// (room for the target latency, plus plenty of slack for the emulation running ahead in bursts)
+	_ring(latencyFrames * 4),
+	_baseRatio(static_cast<double>(inputRate) / static_cast<double>(outputRate)),
+	_targetFrames(std::max<size_t>(latencyFrames, 1)),
+	_ratio(_baseRatio),
+	_input(_ring.capacity() * CHANNELS)
+{};
+
+void Blaze::AudioOutput::push(const int16_t* samples, size_t frames) {
+	size_t written = _ring.write(samples, frames);
+	if (written < frames) {
+		_droppedFrames.fetch_add(frames - written, std::memory_order_relaxed);
+	}
+};
+
+void Blaze::AudioOutput::pull(int16_t* samples, size_t frames) {
+	if (frames == 0) {
+		return;
+	}
+
+	size_t available = _ring.available();
+	if (!_playing) {
+		if (available < _targetFrames) {
+			std::fill(samples, samples + frames * CHANNELS, int16_t(0));
+			return;
+		}
+		_playing = true;
+		_fill = static_cast<double>(available);
+	}
+
+	// fuller than the target means we're behind, so play it back a bit faster (and the other way around)
+	_fill += (static_cast<double>(available) - _fill) * FILL_SMOOTHING;
+	double error = std::clamp((_fill - _targetFrames) / _targetFrames, -1.0, 1.0);
+	double ratio = _baseRatio * (1.0 + MAX_RATE_ADJUSTMENT * error);
+	_ratio.store(ratio, std::memory_order_relaxed);
+
+	// read (almost) everything this will need up front. the count errs on the low side, since with the rounding it could
+	// be off by one; the rest are read one at a time as they're needed.
+	double advances = std::floor(_position + ratio * static_cast<double>(frames - 1));
+	size_t needed = (advances > 1.0) ? static_cast<size_t>(advances) - 1 : 0;
+	size_t inputFrames = _ring.read(_input.data(), std::min(needed, _input.size() / CHANNELS));
+	size_t used = 0;
+
+	for (size_t frame = 0; frame < frames; ++frame) {
+		while (_position >= 1.0) {
+			if (used == inputFrames) {
+				used = 0;
+				inputFrames = _ring.read(_input.data(), 1);
+			}
+			if (used == inputFrames) {
+				// ran dry; go quiet until there's enough to start again
+				_underruns.fetch_add(1, std::memory_order_relaxed);
+				_playing = false;
+				_position = 0;
+				_history = {};
+				std::fill(samples + frame * CHANNELS, samples + frames * CHANNELS, int16_t(0));
+				return;
+			}
+
+			std::copy(_history.begin() + 1, _history.end(), _history.begin());
+			for (size_t channel = 0; channel < CHANNELS; ++channel) {
+				_history[3][channel] = _input[used * CHANNELS + channel];
+			}
+			++used;
+			_position -= 1.0;
+		}
+
+		for (size_t channel = 0; channel < CHANNELS; ++channel) {
+			samples[frame * CHANNELS + channel] = interpolate(
+				_history[0][channel],
+				_history[1][channel],
+				_history[2][channel],
+				_history[3][channel],
+				_position
+			);
+		}
+		_position += ratio;
+	}
+};
@@ -0,0 +1,89 @@
+#include <blaze/BBus.hpp>
+#include <blaze/Bus.hpp>
+#include <blaze/util.hpp>
+
+static constexpr Blaze::Address B_BUS_START = 0x2100;
+static constexpr Blaze::Address B_BUS_END = 0x2200;
+
+void Blaze::BBus::attach(Byte first, Byte last, BBusDevice* device) {
+	for (Address address = first; address <= last; ++address) {
+		_devices[address] = device;
+	}
+};
+
+Blaze::Byte Blaze::BBus::read(Byte address) {
+	if (_devices[address] == nullptr) {
+		return _bus->unmappedRead(B_BUS_START | address);
+	}
+	return _devices[address]->readB(address);
+};
+
+void Blaze::BBus::write(Byte address, Byte value) {
+	if (_devices[address] == nullptr) {
+		_bus->unmappedWrite(B_BUS_START | address);
+		return;
+	}
+	_devices[address]->writeB(address, value);
+};
+
+bool Blaze::BBus::writeBlock(Byte address, bool alternating, const Byte* data, size_t size) {
+	BBusDevice* device = _devices[address];
+	if (device == nullptr) {
+		return false;
+	}
+
+	// both registers have to belong to the same device
+	if (alternating && _devices[static_cast<Byte>(address + 1)] != device) {
+		return false;
+	}
+
+	return device->writeBlockB(address, alternating, data, size);
+};
+
+Blaze::Byte Blaze::BBus::read8(Address offset) {
+	if (offset < B_BUS_START || offset >= B_BUS_END) {
+		return _bus->unmappedRead(offset);
+	}
+	return read(static_cast<Byte>(offset));
+};
+
+Blaze::Word Blaze::BBus::read16(Address offset) {
+	Byte low = read8(offset);
+	return concat16(read8(offset + 1), low);
+};
+
+Blaze::Address Blaze::BBus::read24(Address offset) {
+	Byte low = read8(offset);
+	Byte middle = read8(offset + 1);
+	return concat24(read8(offset + 2), middle, low);
+};
+
+void Blaze::BBus::write8(Address offset, Byte value) {
+	if (offset < B_BUS_START || offset >= B_BUS_END) {
+		_bus->unmappedWrite(offset);
+		return;
+	}
+	write(static_cast<Byte>(offset), value);
+};
+
+void Blaze::BBus::write16(Address offset, Word value) {
+	Byte high = 0;
+	Byte low = 0;
+	split16(value, high, low);
+	write8(offset, low);
+	write8(offset + 1, high);
+};
+
+void Blaze::BBus::write24(Address offset, Address value) {
+	Byte high = 0;
+	Byte middle = 0;
+	Byte low = 0;
+	split24(value, high, middle, low);
+	write8(offset, low);
+	write8(offset + 1, middle);
+	write8(offset + 2, high);
+};
+
+void Blaze::BBus::reset(Bus* bus) {
+	_bus = bus;
+};
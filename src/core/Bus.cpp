@@ -1,5 +1,9 @@
 #include "blaze/Bus.hpp"
 #include <blaze/util.hpp>
+#include <blaze/SaveState.hpp>
+
+#include <algorithm>
+#include <cstring>
 
 static constexpr Blaze::Address BANK_SIZE = 0x010000;
 static constexpr Blaze::Address BANK_HALF_SIZE = BANK_SIZE / 2;
@@ -18,72 +22,395 @@ static constexpr bool addressIsUpperHalf(Blaze::Word address) {
 	return address >= UPPER_HALF_MIN && address <= UPPER_HALF_MAX;
 };
 
+// the speed of CPU accesses to the page starting at the given address (in master cycles).
+// this is decided purely by the address (and MEMSEL), regardless of what's mapped there.
+static constexpr Blaze::Byte accessCyclesForPage(Blaze::Address pageStart, bool fastROM) {
+	Blaze::Byte bank = 0;
+	Blaze::Word addr = 0;
+	Blaze::split24(pageStart, bank, addr);
+
+	// with FastROM, banks $C0 through $FF and the upper half of banks $80 through $BF are fast
+	if (fastROM && bank >= 0x80 && (bank >= 0xc0 || addressIsUpperHalf(addr))) {
+		return Blaze::Bus::FAST_ACCESS_CYCLES;
+	}
+
+	// only the system area ($0000 through $5FFF in banks $00 through $3F and $80 through $BF) has I/O with different speeds
+	if ((bank & 0x7f) > 0x3f) {
+		return Blaze::Bus::SLOW_ACCESS_CYCLES;
+	}
+
+	if (addr >= 0x2000 && addr < 0x4000) {
+		// B-bus (PPU, APU, and WRAM ports)
+		return Blaze::Bus::FAST_ACCESS_CYCLES;
+	}
+
+	if (addr >= 0x4000 && addr < 0x6000) {
+		// the joypad registers ($4000 through $41FF) are actually extra slow (12 master cycles), but they share a page with
+		// the CPU's own registers ($4200 and up), which are accessed much more often
+		return Blaze::Bus::FAST_ACCESS_CYCLES;
+	}
+
+	return Blaze::Bus::SLOW_ACCESS_CYCLES;
+};
+
 namespace Blaze
 {
     //=== Constructor ===
     Bus::Bus()
     {
+		bBus.attach(0x00, 0x3f, &ppu);
+
+		// the APU's ports, mirrored every 4 bytes
+		bBus.attach(0x40, 0x7f, &apu);
+
+		// the WRAM ports (WMDATA and WMADDL/M/H)
+		bBus.attach(0x80, 0x83, &ram);
+
 		// on startup, we reset all components
 		reset();
+
+		// a device might schedule an event while the CPU is running (e.g. when it's written to), in which case the CPU
+		// has to stop in time for it
+		scheduler.scheduleHook = [this](MasterCycles time) {
+			if (time < _batchEnd) {
+				cpu.endRun();
+			}
+		};
     }
 
     //=== Writing to the bus ===
     void Bus::write(Address addr, Byte data)
     {
-		MMIODevice* device = nullptr;
-		Address offset = 0;
-		findDeviceAndOffset(addr, device, offset);
-		device->write8(offset, data);
+		const auto& page = pageForAddress(addr);
+		Address pageOffset = addr & PAGE_OFFSET_MASK;
+		if (page.directWrite != nullptr) {
+			page.directWrite[pageOffset] = data;
+		} else if (page.device != nullptr) {
+			page.device->write8(page.offset + pageOffset, data);
+		} else {
+			unmappedWrite(addr);
+		}
+		openBus = data;
+		invalidateCode(page, pageOffset, 1);
     }
     void Bus::write(Address addr, Word data)
     {
-		MMIODevice* device = nullptr;
-		Address offset = 0;
-		findDeviceAndOffset(addr, device, offset);
-		device->write16(offset, data);
+		const auto& page = pageForAddress(addr);
+		Address pageOffset = addr & PAGE_OFFSET_MASK;
+		// multi-byte accesses that would cross into the next page go through the device
+		if (page.directWrite != nullptr && pageOffset <= PAGE_SIZE - 2) {
+			split16(data, page.directWrite[pageOffset + 1], page.directWrite[pageOffset]);
+		} else if (page.device != nullptr) {
+			page.device->write16(page.offset + pageOffset, data);
+		} else {
+			unmappedWrite(addr);
+		}
+		// the high byte goes out last
+		openBus = static_cast<Byte>(data >> 8);
+		invalidateCode(page, pageOffset, 2);
     }
     void Bus::write(Address addr, Address data)
     {
-		MMIODevice* device = nullptr;
-		Address offset = 0;
-		findDeviceAndOffset(addr, device, offset);
-		device->write24(offset, data);
+		const auto& page = pageForAddress(addr);
+		Address pageOffset = addr & PAGE_OFFSET_MASK;
+		if (page.directWrite != nullptr && pageOffset <= PAGE_SIZE - 3) {
+			split24(data, page.directWrite[pageOffset + 2], page.directWrite[pageOffset + 1], page.directWrite[pageOffset]);
+		} else if (page.device != nullptr) {
+			page.device->write24(page.offset + pageOffset, data);
+		} else {
+			unmappedWrite(addr);
+		}
+		openBus = static_cast<Byte>(data >> 16);
+		invalidateCode(page, pageOffset, 3);
     }
 
     //=== Reading from the bus ===
     Byte Bus::read8(Address addr)
     {
-		MMIODevice* device = nullptr;
-		Address offset = 0;
-		findDeviceAndOffset(addr, device, offset);
-		return device->read8(offset);
+		const auto& page = pageForAddress(addr);
+		Address pageOffset = addr & PAGE_OFFSET_MASK;
+		if (page.directRead != nullptr) {
+			openBus = page.directRead[pageOffset];
+		} else if (page.device != nullptr) {
+			openBus = page.device->read8(page.offset + pageOffset);
+		} else {
+			openBus = unmappedRead(addr);
+		}
+		return openBus;
     }
 
     Word Bus::read16(Address addr)
     {
-		MMIODevice* device = nullptr;
-		Address offset = 0;
-		findDeviceAndOffset(addr, device, offset);
-		return device->read16(offset);
+		const auto& page = pageForAddress(addr);
+		Address pageOffset = addr & PAGE_OFFSET_MASK;
+		Word value;
+		if (page.directRead != nullptr && pageOffset <= PAGE_SIZE - 2) {
+			value = concat16(page.directRead[pageOffset + 1], page.directRead[pageOffset]);
+		} else if (page.device != nullptr) {
+			value = page.device->read16(page.offset + pageOffset);
+		} else {
+			// both bytes read the same open bus value
+			Byte byte = unmappedRead(addr);
+			value = concat16(byte, byte);
+		}
+		openBus = static_cast<Byte>(value >> 8);
+		return value;
     }
 
     Address Bus::read24(Address addr)
     {
-		MMIODevice* device = nullptr;
-		Address offset = 0;
-		findDeviceAndOffset(addr, device, offset);
-		return device->read24(offset);
+		const auto& page = pageForAddress(addr);
+		Address pageOffset = addr & PAGE_OFFSET_MASK;
+		Address value;
+		if (page.directRead != nullptr && pageOffset <= PAGE_SIZE - 3) {
+			value = concat24(page.directRead[pageOffset + 2], page.directRead[pageOffset + 1], page.directRead[pageOffset]);
+		} else if (page.device != nullptr) {
+			value = page.device->read24(page.offset + pageOffset);
+		} else {
+			Byte byte = unmappedRead(addr);
+			value = concat24(byte, byte, byte);
+		}
+		openBus = static_cast<Byte>(value >> 16);
+		return value;
     }
 
+	bool Bus::copyDirect(Address destination, Address source, Address size, bool descending) {
+		const auto& sourcePage = pageForAddress(source);
+		const auto& destinationPage = pageForAddress(destination);
+		Address sourceOffset = source & PAGE_OFFSET_MASK;
+		Address destinationOffset = destination & PAGE_OFFSET_MASK;
+
+		if (size == 0 || sourcePage.directRead == nullptr || destinationPage.directWrite == nullptr) {
+			return false;
+		}
+		if (size > PAGE_SIZE - sourceOffset || size > PAGE_SIZE - destinationOffset) {
+			return false;
+		}
+
+		const Byte* from = sourcePage.directRead + sourceOffset;
+		Byte* to = destinationPage.directWrite + destinationOffset;
+
+		// copying one byte at a time only matches `memmove` if the copy never gets to bytes it already wrote.
+		// (RAM mirrors mean that different addresses can still overlap, so this compares the host pointers.)
+		auto fromAddress = reinterpret_cast<uintptr_t>(from);
+		auto toAddress = reinterpret_cast<uintptr_t>(to);
+		bool readsOverwrittenBytes = descending
+			? (fromAddress > toAddress && fromAddress < toAddress + size)
+			: (toAddress > fromAddress && toAddress < fromAddress + size);
+		if (readsOverwrittenBytes) {
+			return false;
+		}
+
+		std::memmove(to, from, size);
+
+		openBus = descending ? to[0] : to[size - 1];
+		invalidateCode(destinationPage, destinationOffset, size);
+		return true;
+	};
+
 	void Bus::reset() {
+		// devices schedule their events when they're reset, so the scheduler goes first
+		scheduler.reset();
+
 		ram.reset(this);
+		bBus.reset(this);
+		dma.reset(this);
+		ppu.reset(this);
+		apu.reset(this);
 		// *don't* reset the ROM
 		//rom.reset(this);
+
+		// the ROM might have changed since the last reset, so we need to remap it.
+		// this has to happen before resetting the CPU, since it reads the reset vector.
+		_fastROM = false;
+		updateMemoryMap();
+
+		openBus = 0;
 		cpu.reset(this);
 	};
+
+	Bus::RunResult Bus::runFor(MasterCycles cycles) {
+		MasterCycles end = scheduler.now() + cycles;
+		bool firstInstruction = true;
+
+		while (scheduler.now() < end) {
+			apu.publish(scheduler.now());
+
+			if (cpu.stopped) {
+				apu.sync(scheduler.now());
+				return RunResult::Stopped;
+			}
+
+			// run whatever is already due first (it might e.g. raise an interrupt)
+			MasterCycles batchEnd = std::min(end, scheduler.nextEventTime());
+			if (batchEnd <= scheduler.now()) {
+				scheduler.advance(0);
+				continue;
+			}
+
+			if (cpu.waitingForInterrupt) {
+				// nothing happens on the CPU until some device does something, so skip straight to the next event
+				scheduler.advanceTo(batchEnd);
+				// (and if a device halted it in the meantime, it wasn't doing anything anyway)
+				cpu.stalledCycles = 0;
+				continue;
+			}
+
+			Cycles budget = static_cast<Cycles>(std::min(batchEnd - scheduler.now(), MAX_BATCH_CYCLES));
+			Cycles used = 0;
+			_batchEnd = batchEnd;
+
+			if (breakpoints.empty()) {
+				instructionsExecuted += cpu.run(budget, used);
+			} else {
+				// `endRun` works here, too
+				cpu.runBudget = budget;
+				while (used < cpu.runBudget && !cpu.stopped && !cpu.waitingForInterrupt) {
+					if (!firstInstruction && isBreakpoint(concat24(cpu.PBR, cpu.PC))) {
+						_batchEnd = Scheduler::NEVER;
+						scheduler.advance(used);
+						apu.sync(scheduler.now());
+						return RunResult::Breakpoint;
+					}
+
+					firstInstruction = false;
+					used += cpu.execute();
+					++instructionsExecuted;
+				}
+			}
+
+			_batchEnd = Scheduler::NEVER;
+			firstInstruction = false;
+			scheduler.advance(used);
+		}
+
+		apu.sync(scheduler.now());
+		return cpu.stopped ? RunResult::Stopped : RunResult::Finished;
+	};
+
+	Bus::RunResult Bus::runFrame() {
+		MasterCycles now = scheduler.now();
+		MasterCycles frameEnd = (now / MASTER_CYCLES_PER_FRAME + 1) * MASTER_CYCLES_PER_FRAME;
+		return runFor(frameEnd - now);
+	};
+
+	bool Bus::isBreakpoint(Address address) const {
+		return std::find(breakpoints.begin(), breakpoints.end(), address) != breakpoints.end();
+	};
+
+	size_t Bus::saveStateSize() const {
+		// a writer without a buffer just counts
+		return saveState(nullptr, 0);
+	};
+
+	size_t Bus::saveState(Byte* buffer, size_t size) const {
+		StateWriter writer(buffer, size);
+
+		writer.writeBytes(SAVE_STATE_MAGIC, sizeof(SAVE_STATE_MAGIC));
+		writer.write(SAVE_STATE_VERSION);
+
+		// the ROM goes first so that loading a state for a different ROM fails before anything is changed
+		rom.saveState(writer);
+		cpu.saveState(writer);
+		scheduler.saveState(writer);
+		ram.saveState(writer);
+		dma.saveState(writer);
+		ppu.saveState(writer);
+		apu.saveState(writer);
+		writer.write(openBus);
+		writer.write(static_cast<Byte>(_fastROM));
+
+		return writer.offset();
+	};
+
+	void Bus::loadState(const Byte* buffer, size_t size) {
+		StateReader reader(buffer, size);
+
+		Byte magic[sizeof(SAVE_STATE_MAGIC)];
+		reader.readBytes(magic, sizeof(magic));
+		if (std::memcmp(magic, SAVE_STATE_MAGIC, sizeof(magic)) != 0) {
+			throw std::runtime_error("Not a save state");
+		}
+
+		auto version = reader.read<Word>();
+		if (version != SAVE_STATE_VERSION) {
+			throw std::runtime_error("Unsupported save state version: " + std::to_string(version));
+		}
+
+		rom.loadState(reader);
+		cpu.loadState(reader);
+		scheduler.loadState(reader);
+		ram.loadState(reader);
+		dma.loadState(reader);
+		ppu.loadState(reader);
+		apu.loadState(reader);
+		openBus = reader.read<Byte>();
+		setFastROM(reader.read<Byte>() != 0);
+
+		// RAM was replaced wholesale, without going through `write`
+		cpu.decodeCache.clear();
+	};
+
+	void Bus::updateMemoryMap() {
+		_pages.assign(PAGE_COUNT, MemoryPage());
+
+		// anything that was decoded may not be mapped at the same address anymore
+		cpu.decodeCache.clear();
+
+		for (Address index = 0; index < PAGE_COUNT; ++index) {
+			auto& page = _pages[index];
+
+			page.accessCycles = accessCyclesForPage(index << PAGE_SHIFT, _fastROM);
+
+			// the mapping never changes within a page, so we only need to look up the start of each one
+			if (!findDeviceAndOffset(index << PAGE_SHIFT, page.device, page.offset)) {
+				continue;
+			}
+
+			// the parts of the ROM area that the ROM is too small to fill are open bus
+			if (page.device == &rom && page.offset >= rom.imageSize()) {
+				page.device = nullptr;
+				page.offset = 0;
+				continue;
+			}
+
+			page.directRead = page.device->directReadPointer(page.offset, PAGE_SIZE);
+			page.directWrite = page.device->directWritePointer(page.offset, PAGE_SIZE);
+		}
+	};
+
+	void Bus::setFastROM(bool enabled) {
+		if (enabled == _fastROM) {
+			return;
+		}
+		_fastROM = enabled;
+
+		// only banks $80 through $FF can change speed
+		for (Address index = PAGE_COUNT / 2; index < PAGE_COUNT; ++index) {
+			_pages[index].accessCycles = accessCyclesForPage(index << PAGE_SHIFT, _fastROM);
+		}
+
+		// the JIT bakes the speed of the code it compiles into its blocks
+		cpu.decodeCache.clear();
+	};
+
+	Byte Bus::unmappedRead(Address address) {
+		++unmappedAccesses;
+		if (faultHook) {
+			faultHook(address, false);
+		}
+		return openBus;
+	};
+
+	void Bus::unmappedWrite(Address address) {
+		++unmappedAccesses;
+		if (faultHook) {
+			faultHook(address, true);
+		}
+	};
 }
 
-void Blaze::Bus::findDeviceAndOffset(Address fullAddress, MMIODevice*& outDevice, Address& outOffset) {
+bool Blaze::Bus::findDeviceAndOffset(Address fullAddress, MMIODevice*& outDevice, Address& outOffset) {
 	bool usingHiROM = rom.type() == ROM::Type::HiROM || rom.type() == ROM::Type::ExHiROM;
 
 	Byte bank;
@@ -102,23 +429,23 @@ void Blaze::Bus::findDeviceAndOffset(Address fullAddress, MMIODevice*& outDevice
 	if (bank == 0x7e || bank == 0x7f) {
 		outDevice = &ram;
 		outOffset = addr + ((bank == 0x7f) ? BANK_SIZE : 0);
-		return;
+		return true;
 	}
 
 	// the first 2 pages of RAM are mirrored into the first 2 pages of every bank in banks $00 through $3F
-	if (bank >= 0x00 && bank <= 0x3f && addr < 0x2000) {
+	if (bank <= 0x3f && addr < 0x2000) {
 		outDevice = &ram;
 		outOffset = addr;
-		return;
+		return true;
 	}
 
 	if (usingHiROM) {
 		// in HiROM, the upper half of banks $00 through $3F map the corresponding ROM banks
-		if (bank >= 0x00 && bank <= 0x3f && addressIsUpperHalf(addr)) {
+		if (bank <= 0x3f && addressIsUpperHalf(addr)) {
 			outDevice = &rom;
 			// in this case, the corresponding offset is exactly the same as the full input address
 			outOffset = fullAddress;
-			return;
+			return true;
 		}
 
 		// in HiROM, banks $40 through $7D map the ROM out linearly
@@ -126,38 +453,51 @@ void Blaze::Bus::findDeviceAndOffset(Address fullAddress, MMIODevice*& outDevice
 			outDevice = &rom;
 			// since this is mapped out linearly (full banks used), we can just subtract the start address to get the ROM offset
 			outOffset = fullAddress - HIROM_LINEAR_START;
-			return;
+			return true;
 		}
 
 		// in HiROM, banks $FE and $FF map the final 128 KiB of the ROM
-		if (bank >= 0xfe && bank <= 0xff) {
+		if (bank >= 0xfe) {
 			outDevice = &rom;
 			// again: this is mapped out linearly (full banks used), so we can just subtract the start address (and add the offset start) to get the ROM offset
 			outOffset = (fullAddress - HIROM_FINAL_128KIB_MEMORY_START) + HIROM_FINAL_128KIB_OFFSET_START;
-			return;
+			return true;
 		}
 	} else {
 		// in LoROM, the upper half of banks $00 through $7D map the ROM out linearly
-		if (bank >= 0x00 && bank <= 0x7d && addressIsUpperHalf(addr)) {
+		if (bank <= 0x7d && addressIsUpperHalf(addr)) {
 			outDevice = &rom;
 			outOffset = (addr - UPPER_HALF_MIN) + (bank * BANK_HALF_SIZE);
-			return;
+			return true;
 		}
 
 		// in LoROM, the upper half of banks $FE and $FF map the final 64 KiB of the ROM
-		if (bank >= 0xfe && bank <= 0xff && addressIsUpperHalf(addr)) {
+		if (bank >= 0xfe && addressIsUpperHalf(addr)) {
 			outDevice = &rom;
 			outOffset = (addr - UPPER_HALF_MIN) + LOROM_FINAL_64KIB + ((bank == 0xfe) ? 0 : BANK_HALF_SIZE);
-			return;
+			return true;
 		}
 	}
 
+	// the I/O registers are in banks $00 through $3F: the B-bus at $2100 through $21FF, and the CPU's own registers
+	// (including DMA) at $4200 through $43FF. the rest of those pages is open bus.
+	if (bank <= 0x3f && addr >= 0x2000 && addr < 0x3000) {
+		outDevice = &bBus;
+		outOffset = addr;
+		return true;
+	}
+
+	if (bank <= 0x3f && addr >= 0x4000 && addr < 0x5000) {
+		outDevice = &dma;
+		outOffset = addr;
+		return true;
+	}
+
 	// TODO:
 	//   LoROM SRAM in lower half ($0000 through $7FFF) of banks $70 through $7D and banks $FE and $FF
 	//   HiROM SRAM in $6000 through $7FFF of banks $20 through $3F
-	//   all the SNES MMIO peripherals
+	//   the rest of the SNES MMIO peripherals (joypads, coprocessors)
 
-	// if we got here, we were unable to map this access.
-	// TODO: report the issue back up to the caller (usually the CPU).
-	throw std::runtime_error("Failed to map memory access to address 0x" + valueToHexString(fullAddress));
+	// if we got here, we were unable to map this address.
+	return false;
 };
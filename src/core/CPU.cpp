@@ -2,9 +2,26 @@
 #include "blaze/Bus.hpp"
 #include <cassert>
 #include <blaze/util.hpp>
-
-// TODO: fill in cycle info
-const std::unordered_map<Blaze::Byte, Blaze::CPU::Instruction> Blaze::CPU::INSTRUCTIONS_WITH_NO_PATTERN {
+#include <blaze/SaveState.hpp>
+#include <blaze/CallProfiler.hpp>
+#include <blaze/Profiler.hpp>
+#include <blaze/Trace.hpp>
+#include <blaze/JIT.hpp>
+#include <algorithm>
+#include <utility>
+
+using Instruction = Blaze::CPU::Instruction;
+using Opcode = Blaze::CPU::Opcode;
+using AddressingMode = Blaze::CPU::AddressingMode;
+using ConditionCode = Blaze::CPU::ConditionCode;
+
+struct NoPatternInstruction {
+	Blaze::Byte opcode;
+	Instruction info;
+};
+
+// the cycle counts are filled in from `OPCODE_BASE_CYCLES` (like for all the other instructions), so they're left as 0 here
+static constexpr std::array<NoPatternInstruction, 69> INSTRUCTIONS_WITH_NO_PATTERN {{
 	{ 0x40, Instruction(Opcode::RTI, 1, 0) },
 	{ 0x60, Instruction(Opcode::RTS, 1, 0) },
 	{ 0x08, Instruction(Opcode::PHP, 1, 0) },
@@ -61,14 +78,14 @@ const std::unordered_map<Blaze::Byte, Blaze::CPU::Instruction> Blaze::CPU::INSTR
 	{ 0x82, Instruction(Opcode::BRL, 3, 0) },
 	{ 0xc2, Instruction(Opcode::REP, 2, 0, AddressingMode::Immediate) },
 	{ 0xe2, Instruction(Opcode::SEP, 2, 0, AddressingMode::Immediate) },
-	{ 0x44, Instruction(Opcode::MVP, 3, 0, AddressingMode::BlockMove) },
-	{ 0x54, Instruction(Opcode::MVN, 3, 0, AddressingMode::BlockMove) },
+	{ 0x44, Instruction(Opcode::MVP, 3, 7, AddressingMode::BlockMove) }, // 7 cycles per byte moved
+	{ 0x54, Instruction(Opcode::MVN, 3, 7, AddressingMode::BlockMove) },
 	{ 0xd4, Instruction(Opcode::PEI, 2, 0) },
 	{ 0xf4, Instruction(Opcode::PEA, 3, 0) },
 	{ 0xdc, Instruction(Opcode::JML, 3, 0, AddressingMode::AbsoluteIndirect) },
 
 	{ 0x20, Instruction(Opcode::JSR, 3, 0, AddressingMode::Absolute) },
-	{ 0x89, Instruction(Opcode::BIT, 2, 0, AddressingMode::Immediate) },
+	{ 0x89, Instruction(Opcode::BIT, 0, 0, AddressingMode::Immediate) }, // (the size depends on `m`, like the other immediates)
 	{ 0x14, Instruction(Opcode::TRB, 2, 0, AddressingMode::Direct) },
 	{ 0x1c, Instruction(Opcode::TRB, 3, 0, AddressingMode::Absolute) },
 	{ 0x64, Instruction(Opcode::STZ, 2, 0, AddressingMode::Direct) },
@@ -77,6 +94,33 @@ const std::unordered_map<Blaze::Byte, Blaze::CPU::Instruction> Blaze::CPU::INSTR
 	{ 0x9e, Instruction(Opcode::STZ, 3, 0, AddressingMode::AbsoluteIndexedX) },
 	{ 0x5c, Instruction(Opcode::JMP, 4, 0, AddressingMode::AbsoluteLong) },
 	{ 0xfc, Instruction(Opcode::JSR, 3, 0, AddressingMode::AbsoluteIndexedIndirect) },
+}};
+
+// the base number of CPU cycles for each opcode, from the opcode matrix in the W65C816S datasheet (see `doc/notes.md`).
+// these are the counts with 8-bit accumulator/memory and index registers and without any of the datasheet's
+// other penalties; `INSTRUCTION_TIMINGS` (further down) accounts for the rest.
+//
+// the matrix has a couple of typos, which are corrected here:
+//   * `STA [d]` ($87) takes 6 cycles (like all the other `[d]` instructions), not 2.
+//   * `RTI` ($40) takes 6 cycles in emulation mode; the matrix lists the native mode count (7).
+static constexpr std::array<Blaze::Byte, 256> OPCODE_BASE_CYCLES {
+//  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF
+	7, 6, 7, 4, 5, 3, 5, 6, 3, 2, 2, 4, 6, 4, 6, 5, // 0x
+	2, 5, 5, 7, 5, 4, 6, 6, 2, 4, 2, 2, 6, 4, 7, 5, // 1x
+	6, 6, 8, 4, 3, 3, 5, 6, 4, 2, 2, 5, 4, 4, 6, 5, // 2x
+	2, 5, 5, 7, 4, 4, 6, 6, 2, 4, 2, 2, 4, 4, 7, 5, // 3x
+	6, 6, 2, 4, 7, 3, 5, 6, 3, 2, 2, 3, 3, 4, 6, 5, // 4x
+	2, 5, 5, 7, 7, 4, 6, 6, 2, 4, 3, 2, 4, 4, 7, 5, // 5x
+	6, 6, 6, 4, 3, 3, 5, 6, 4, 2, 2, 6, 5, 4, 6, 5, // 6x
+	2, 5, 5, 7, 4, 4, 6, 6, 2, 4, 4, 2, 6, 4, 7, 5, // 7x
+	2, 6, 4, 4, 3, 3, 3, 6, 2, 2, 2, 3, 4, 4, 4, 5, // 8x
+	2, 6, 5, 7, 4, 4, 4, 6, 2, 5, 2, 2, 4, 5, 5, 5, // 9x
+	2, 6, 2, 4, 3, 3, 3, 6, 2, 2, 2, 4, 4, 4, 4, 5, // Ax
+	2, 5, 5, 7, 4, 4, 4, 6, 2, 4, 2, 2, 4, 4, 4, 5, // Bx
+	2, 6, 3, 4, 3, 3, 5, 6, 2, 2, 2, 3, 4, 4, 6, 5, // Cx
+	2, 5, 5, 7, 6, 4, 6, 6, 2, 4, 3, 3, 6, 4, 7, 5, // Dx
+	2, 6, 3, 4, 3, 3, 5, 6, 2, 2, 2, 3, 4, 4, 6, 5, // Ex
+	2, 5, 5, 7, 5, 4, 6, 6, 2, 4, 4, 2, 8, 4, 7, 5, // Fx
 };
 
 // NOLINTBEGIN(readability-magic-numbers, readability-identifier-length)
@@ -114,12 +158,58 @@ void Blaze::CPU::reset(Bus* theBus) {
 
 	// the processor starts out in emulation mode
 	e = 1;
+
+	stopped = false;
+	waitingForInterrupt = false;
+	pendingCycles = 0;
+	stalledCycles = 0;
 }
 
+void Blaze::CPU::saveState(StateWriter& writer) const {
+	writer.write(A.forceLoadFull());
+	writer.write(X.forceLoadFull());
+	writer.write(Y.forceLoadFull());
+	writer.write(DR);
+	writer.write(PC);
+	writer.write(SP);
+	writer.write(DBR);
+	writer.write(PBR);
+	writer.write(P);
+	writer.write(e);
+	writer.write(executingPC);
+	writer.write(static_cast<Byte>(stopped));
+	writer.write(static_cast<Byte>(waitingForInterrupt));
+	writer.write(pendingCycles);
+	writer.write(stalledCycles);
+};
+
+void Blaze::CPU::loadState(StateReader& reader) {
+	A.forceStoreFull(reader.read<Word>());
+	X.forceStoreFull(reader.read<Word>());
+	Y.forceStoreFull(reader.read<Word>());
+	DR = reader.read<Word>();
+	PC = reader.read<Word>();
+	SP = reader.read<Word>();
+	DBR = reader.read<Byte>();
+	PBR = reader.read<Byte>();
+	P = reader.read<Byte>();
+	e = reader.read<Byte>();
+	executingPC = reader.read<Address>();
+	stopped = reader.read<Byte>() != 0;
+	waitingForInterrupt = reader.read<Byte>() != 0;
+	pendingCycles = reader.read<Cycles>();
+	stalledCycles = reader.read<Cycles>();
+};
+
 void Blaze::CPU::irq() {
+	// an IRQ ends a `WAI` even if it's masked (in which case execution just continues after the `WAI`)
+	waitingForInterrupt = false;
+
 	// If the interrupt is not masked
 	if (!getFlag(flags::i))
 	{
+		Word interruptedSP = SP;
+
 		if (!usingEmulationMode()) {
 			// in native mode: push the PBR
 			store8(SP, PBR);
@@ -130,11 +220,12 @@ void Blaze::CPU::irq() {
 		store16(SP - 1, PC);
 		SP -= 2;
 
-		// Set some interrupt flags first and then push the status register onto the stack
-		setFlag(flags::b, false);
-		setFlag(flags::i, true);
-		store8(SP, P);
+		// push the status register as it was (`RTI` restores it), then mask IRQs for the handler.
+		// in emulation mode, the pushed B flag tells the handler it wasn't a `BRK`; in native mode, that bit is `x`.
+		store8(SP, usingEmulationMode() ? static_cast<Byte>(P & ~flags::b) : P);
 		SP--;
+		setFlag(flags::i, true);
+		setFlag(flags::d, false);
 
 		// the PBR is forced to 0
 		PBR = 0;
@@ -142,12 +233,19 @@ void Blaze::CPU::irq() {
 		// Read the interrupt program address from the interrupt table
 		PC = load16(usingEmulationMode() ? ExceptionVectorAddress::EmulatedIRQ : ExceptionVectorAddress::NativeIRQ);
 
+		if (callProfiler != nullptr) {
+			callProfiler->interrupt(CallProfiler::FrameKind::IRQ, PC, interruptedSP);
+		}
+
 		// Handling IRQs takes 7 CPU cycles
-		cyclesCountDown = 7;
+		pendingCycles += 7;
 	}
 }
 
 void Blaze::CPU::nmi() {
+	waitingForInterrupt = false;
+	Word interruptedSP = SP;
+
 	if (!usingEmulationMode()) {
 		// in native mode: push the PBR
 		store8(SP, PBR);
@@ -157,20 +255,27 @@ void Blaze::CPU::nmi() {
 	store16(SP - 1, PC);
 	SP -= 2;
 
-	setFlag(flags::b, false);
-	setFlag(flags::i, true);
-	store8(SP, P);
+	// (just like `irq`)
+	store8(SP, usingEmulationMode() ? static_cast<Byte>(P & ~flags::b) : P);
 	SP--;
+	setFlag(flags::i, true);
+	setFlag(flags::d, false);
 
 	// the PBR is forced to 0
 	PBR = 0;
 
 	PC = load16(usingEmulationMode() ? ExceptionVectorAddress::EmulatedNMI : ExceptionVectorAddress::NativeNMI);
 
-	cyclesCountDown = 8;
+	if (callProfiler != nullptr) {
+		callProfiler->interrupt(CallProfiler::FrameKind::NMI, PC, interruptedSP);
+	}
+
+	pendingCycles += 8;
 }
 
 void Blaze::CPU::abort() {
+	Word interruptedSP = SP;
+
 	store8(SP, PBR);
 	SP--;
 
@@ -187,7 +292,11 @@ void Blaze::CPU::abort() {
 
 	PC = load16(usingEmulationMode() ? ExceptionVectorAddress::EmulatedABORT : ExceptionVectorAddress::NativeABORT);
 
-	cyclesCountDown = 8;
+	if (callProfiler != nullptr) {
+		callProfiler->interrupt(CallProfiler::FrameKind::Abort, PC, interruptedSP);
+	}
+
+	pendingCycles += 8;
 }
 
 void Blaze::CPU::setZeroNegFlags(const Register& reg) {
@@ -205,28 +314,186 @@ void Blaze::CPU::setOverflowFlag(Word leftOperand, Word rightOperand, Word resul
 	setFlag(flags::v, (leftSign == rightSign) && (leftSign != resultSign));
 };
 
-void Blaze::CPU::execute() {
+template<bool Is8Bit>
+void Blaze::CPU::setZeroNegFlags(Word value) {
+	if constexpr (Is8Bit) {
+		setFlag(flags::n, msb8(value));
+		setFlag(flags::z, lo8(value) == 0);
+	} else {
+		setFlag(flags::n, msb16(value));
+		setFlag(flags::z, value == 0);
+	}
+};
+
+template<bool Is8Bit>
+void Blaze::CPU::setOverflowFlag(Word leftOperand, Word rightOperand, Word result) {
+	bool leftSign = msb(leftOperand, Is8Bit);
+	bool rightSign = msb(rightOperand, Is8Bit);
+	bool resultSign = msb(result, Is8Bit);
+	// same as the runtime version
+	setFlag(flags::v, (leftSign == rightSign) && (leftSign != resultSign));
+};
+
+Blaze::Cycles Blaze::CPU::execute() {
+	if (stopped || waitingForInterrupt) {
+		// only a reset can start the processor again (or an interrupt, for `WAI`)
+		return 0;
+	}
+
+	Instruction info = fetchInstruction();
+	return executeFetched(info);
+};
+
+Blaze::Cycles Blaze::CPU::execute(const DecodeCache::DecodedInstruction& decoded) {
+	if (stopped || waitingForInterrupt) {
+		return 0;
+	}
 
-	// Read first 8 bytes of next instruction
-	//Byte* instruction = bus->read(PC);
+	executingPC = decoded.pc;
+	executingOpcode = decoded.opcode;
+	operandBytes = decoded.operand;
+	bus->openBus = DecodeCache::lastFetchedByte(decoded);
+
+	Instruction info = OPCODE_TABLE[executingOpcode];
+	info.size = decoded.size;
+	return executeFetched(info);
+};
 
+Blaze::CPU::Instruction Blaze::CPU::fetchInstruction() {
 	// update `executingPC` to point to the instruction we're about to execute
 	executingPC = concat24(PBR, PC);
 
-	// decode instruction and get info (e.g. # of cycles to run, instruction size)
-	auto info = decodeInstruction(load8(executingPC));
+	// fetch the instruction, preferably from the decode cache
+	const DecodeCache::DecodedInstruction* decoded = decodeCache.enabled ? decodeCache.fetch(*bus, executingPC, P & (flags::m | flags::x)) : nullptr;
+	if (decoded != nullptr) {
+		executingOpcode = decoded->opcode;
+		operandBytes = decoded->operand;
+		Instruction info = OPCODE_TABLE[executingOpcode];
+		info.size = decoded->size;
+
+		// these bytes didn't actually go through the bus, but they would have on the real thing
+		bus->openBus = DecodeCache::lastFetchedByte(*decoded);
+		return info;
+	}
+
+	executingOpcode = load8(executingPC);
+	Instruction info = decodeInstruction(executingOpcode);
+
+	operandBytes = 0;
+	for (Byte i = 1; i < info.size; ++i) {
+		// instructions wrap around within their bank
+		operandBytes |= static_cast<Address>(load8(PBR, static_cast<Word>(PC + i))) << ((i - 1) * 8);
+	}
+
+	return info;
+};
+
+Blaze::Cycles Blaze::CPU::beginInstruction(const Instruction& info, size_t index) {
+	const auto& timing = INSTRUCTION_TIMINGS[index];
+
+	if (trace != nullptr) {
+		recordTrace(info);
+	}
+
+	// the penalties depend on the registers *before* the instruction executes
+	Cycles cycles = timing.cycles + pendingCycles;
+	pendingCycles = 0;
+
+	if (timing.directPagePenalty && lo8(DR) != 0) {
+		++cycles;
+	}
+
+	if (timing.pageCrossPenalty) {
+		// only absolute indexed and `(d),y` reads with 8-bit index registers get here
+		unsigned baseLow = lo8(operandBytes);
+		if (info.addressingMode == AddressingMode::DirectIndirectIndexed) {
+			// the base is the pointer in the direct page. it's peeked at rather than read through the bus, since the
+			// instruction reads it again (and reading I/O registers can have side effects); pointers anywhere that can't be
+			// peeked at, like the I/O registers, are never charged.
+			auto pointerAddress = static_cast<Word>(DR + baseLow);
+			const Byte* memory = bus->pageForAddress(pointerAddress).directRead;
+			baseLow = (memory != nullptr) ? memory[pointerAddress & Bus::PAGE_OFFSET_MASK] : 0;
+		}
+		Byte index = (info.addressingMode == AddressingMode::AbsoluteIndexedX) ? X.load<true>() : Y.load<true>();
+		if (baseLow + index > 0xff) {
+			++cycles;
+		}
+	}
 
 	// the PC is always incremented to the next instruction before the current instruction starts executing
 	PC += info.size;
 
+	return cycles;
+};
+
+Blaze::Cycles Blaze::CPU::executeFetched(const Instruction& info) {
+	// pick the handler (and timing) specialized for the current `m` and `x` flags
+	size_t index = dispatchIndex(executingOpcode);
+	Cycles cycles = beginInstruction(info, index);
+
 	// execute instruction with the info
-	info.cycles = executeInstruction(info);
+	if constexpr (Profiler::ENABLED) {
+		uint64_t start = Profiler::timestamp();
+		cycles += (this->*DISPATCH_TABLE[index])(info);
+		Profiler::record(index, cycles * bus->accessCycles(executingPC), Profiler::timestamp() - start);
+	} else {
+		cycles += (this->*DISPATCH_TABLE[index])(info);
+	}
 
-	// Count down cycles
-	while(info.cycles > 0)
-	{
-		--info.cycles;
+	// (every cycle takes as long as the opcode fetch did; see `CPU` for why)
+	Cycles masterCycles = cycles * bus->accessCycles(executingPC) + std::exchange(stalledCycles, 0);
+
+	if (callProfiler != nullptr) {
+		callProfiler->charge(masterCycles);
 	}
+
+	return masterCycles;
+};
+
+void Blaze::CPU::recordTrace(const Instruction& info) const {
+	TraceRecord record {};
+	record.cycle = bus->scheduler.now();
+	record.pc = executingPC;
+	record.size = std::min<Byte>(info.valid() ? info.size : 1, sizeof(record.bytes));
+	record.bytes[0] = executingOpcode;
+	for (Byte i = 1; i < record.size; ++i) {
+		record.bytes[i] = static_cast<Byte>(operandBytes >> ((i - 1) * 8));
+	}
+	record.a = A.forceLoadFull();
+	record.x = X.forceLoadFull();
+	record.y = Y.forceLoadFull();
+	record.sp = SP;
+	record.dr = DR;
+	record.p = P;
+	record.dbr = DBR;
+	record.e = e;
+
+	trace->record(record);
+}
+
+uint32_t Blaze::CPU::clock() {
+	if (stopped || waitingForInterrupt) {
+		// nothing happens on the CPU until some device does something, so skip straight to the next event
+		// (or just let a single cycle pass if nothing is scheduled)
+		MasterCycles nextEvent = bus->scheduler.nextEventTime();
+		if (nextEvent == Scheduler::NEVER) {
+			bus->scheduler.advance(Bus::FAST_ACCESS_CYCLES);
+		} else {
+			bus->scheduler.advanceTo(nextEvent);
+		}
+		stalledCycles = 0;
+		return 0;
+	}
+
+	if (jit != nullptr) {
+		Cycles cycles = 0;
+		uint32_t instructions = jit->step(cycles);
+		bus->scheduler.advance(cycles);
+		return instructions;
+	}
+
+	bus->scheduler.advance(execute());
+	return 1;
 }
 
 void Blaze::CPU::setFlag(Byte flag, bool s) {
@@ -292,22 +559,25 @@ void Blaze::CPU::store24(Byte bank, Word addressLow, Address value) {
 	return store24(concat24(bank, addressLow), value);
 };
 
+template<bool IndexIs8Bit>
 Blaze::Address Blaze::CPU::decodeAddress(AddressingMode mode) const {
-	Address addressStart = executingPC + 1;
+	// the operand bytes were already fetched by `execute`
+	Word operand16 = lo16(operandBytes);
+	Byte operand8 = lo8(operandBytes);
 
 	switch (mode) {
 		case AddressingMode::Absolute:
-			return concat24(DBR, load16(addressStart));
+			return concat24(DBR, operand16);
 		case AddressingMode::AbsoluteIndexedIndirect:
-			return load16(0, load16(addressStart) + X.load());
+			return load16(0, operand16 + X.load<IndexIs8Bit>());
 		case AddressingMode::AbsoluteIndexedX:
-			return concat24(DBR, load16(addressStart) + X.load());
+			return concat24(DBR, operand16 + X.load<IndexIs8Bit>());
 		case AddressingMode::AbsoluteIndexedY:
-			return concat24(DBR, load16(addressStart) + Y.load());
+			return concat24(DBR, operand16 + Y.load<IndexIs8Bit>());
 
 		case AddressingMode::AbsoluteIndirect: {
-			auto base = load16(addressStart);
-			if (load8(executingPC) == /* JML */ 0xdc) {
+			auto base = operand16;
+			if (executingOpcode == /* JML */ 0xdc) {
 				return load24(0, base);
 			} else {
 				return load16(0, base);
@@ -315,35 +585,35 @@ Blaze::Address Blaze::CPU::decodeAddress(AddressingMode mode) const {
 		} break;
 
 		case AddressingMode::AbsoluteLongIndexedX:
-			return load24(addressStart) + X.load();
+			return operandBytes + X.load<IndexIs8Bit>();
 		case AddressingMode::AbsoluteLong:
-			return load24(addressStart);
+			return operandBytes;
 		case AddressingMode::DirectIndexedIndirect:
-			return concat24(DBR, load16(0, DR + X.load() + load8(addressStart)));
+			return concat24(DBR, load16(0, DR + X.load<IndexIs8Bit>() + operand8));
 		case AddressingMode::DirectIndexedX:
-			return concat24(0, DR + X.load() + load8(addressStart));
+			return concat24(0, DR + X.load<IndexIs8Bit>() + operand8);
 		case AddressingMode::DirectIndexedY:
-			return concat24(0, DR + Y.load() + load8(addressStart));
+			return concat24(0, DR + Y.load<IndexIs8Bit>() + operand8);
 		case AddressingMode::DirectIndirectIndexed:
-			return concat24(DBR, load16(0, DR + load8(addressStart))) + Y.load();
+			return concat24(DBR, load16(0, DR + operand8)) + Y.load<IndexIs8Bit>();
 		case AddressingMode::DirectIndirectLongIndexed:
-			return load24(0, DR + load8(addressStart)) + Y.load();
+			return load24(0, DR + operand8) + Y.load<IndexIs8Bit>();
 		case AddressingMode::DirectIndirectLong:
-			return load24(0, DR + load8(addressStart));
+			return load24(0, DR + operand8);
 		case AddressingMode::DirectIndirect:
-			return concat24(DBR, load16(0, DR + load8(addressStart)));
+			return concat24(DBR, load16(0, DR + operand8));
 		case AddressingMode::Direct:
-			return concat24(0, DR + load8(addressStart));
+			return concat24(0, DR + operand8);
 		case AddressingMode::ProgramCounterRelativeLong:
-			// `PC + 3` since the PC used for the calculation is the address of the *next* instruction
-			return static_cast<uint16_t>(static_cast<int16_t>(PC + 3) + static_cast<int16_t>(load16(addressStart)));
+			// relative to the *next* instruction, which is where the PC already points (see `beginInstruction`)
+			return static_cast<uint16_t>(static_cast<int16_t>(PC) + static_cast<int16_t>(operand16));
 		case AddressingMode::ProgramCounterRelative:
 			// ditto
-			return static_cast<uint16_t>(static_cast<int16_t>(PC + 2) + static_cast<int8_t>(load8(addressStart)));
+			return static_cast<uint16_t>(static_cast<int16_t>(PC) + static_cast<int8_t>(operand8));
 		case AddressingMode::StackRelative:
-			return concat24(0, SP + load8(addressStart));
+			return concat24(0, SP + operand8);
 		case AddressingMode::StackRelativeIndirectIndexed:
-			return concat24(DBR, load16(0, SP + load8(addressStart))) + Y.load();
+			return concat24(DBR, load16(0, SP + operand8)) + Y.load<IndexIs8Bit>();
 
 		case AddressingMode::Accumulator:
 		case AddressingMode::BlockMove:
@@ -355,10 +625,14 @@ Blaze::Address Blaze::CPU::decodeAddress(AddressingMode mode) const {
 	}
 };
 
+Blaze::Address Blaze::CPU::decodeAddress(AddressingMode mode) const {
+	return indexRegistersAre8Bit() ? decodeAddress<true>(mode) : decodeAddress<false>(mode);
+};
+
 Blaze::Word Blaze::CPU::loadOperand(AddressingMode addressingMode, bool use8BitImmediate) const {
 	Address operand = decodeAddress(addressingMode);
 	if (addressingMode == AddressingMode::Immediate) {
-		operand = use8BitImmediate ? load8(executingPC + 1) : load16(executingPC + 1);
+		operand = use8BitImmediate ? lo8(operandBytes) : lo16(operandBytes);
 	} else {
 		operand = load16(operand);
 	}
@@ -369,17 +643,64 @@ Blaze::Word Blaze::CPU::loadOperand(AddressingMode addressingMode, bool use8BitI
 	return operand;
 };
 
+template<bool OperandIs8Bit, bool IndexIs8Bit>
+Blaze::Word Blaze::CPU::loadOperand(AddressingMode addressingMode) const {
+	if (addressingMode == AddressingMode::Immediate) {
+		return OperandIs8Bit ? lo8(operandBytes) : lo16(operandBytes);
+	}
+
+	Address address = decodeAddress<IndexIs8Bit>(addressingMode);
+	return OperandIs8Bit ? load8(address) : load16(address);
+};
+
+// performs a read-modify-write of the operand with the given addressing mode (either the accumulator or a memory operand),
+// returning the new value (truncated to the operand width).
+template<bool MemoryIs8Bit, bool IndexIs8Bit, typename Operation>
+static Blaze::Word modifyOperand(Blaze::CPU& cpu, AddressingMode mode, Operation&& operation) {
+	constexpr Blaze::Word wordMask = MemoryIs8Bit ? 0xff : 0xffff;
+
+	if (mode == AddressingMode::Accumulator) {
+		Blaze::Word result = operation(cpu.A.load<MemoryIs8Bit>()) & wordMask;
+		cpu.A.store<MemoryIs8Bit>(result);
+		return result;
+	}
+
+	Blaze::Address address = cpu.decodeAddress<IndexIs8Bit>(mode);
+
+	if constexpr (MemoryIs8Bit) {
+		Blaze::Word result = operation(cpu.load8(address)) & wordMask;
+		cpu.store8(address, static_cast<Blaze::Byte>(result));
+		return result;
+	} else {
+		Blaze::Word result = operation(cpu.load16(address));
+		cpu.store16(address, result);
+		return result;
+	}
+};
+
 // special thanks to https://llx.com/Neil/a2/opcodes.html for some wisdom on how to intelligently decode the instructions
 // (without having a giant switch statement)
-Blaze::CPU::Instruction Blaze::CPU::decodeInstruction(Byte inst0) const {
+//
+// this decodes the opcode without looking at the CPU flags. for instructions whose size depends on the flags
+// (i.e. those with Immediate addressing), the returned instruction has a size of 0; `CPU::decodeInstruction`
+// fills in the actual size at runtime.
+//
+// this is `constexpr` so that we can run it for every possible opcode at compile time and build `CPU::OPCODE_TABLE` from it.
+static constexpr Instruction decodeOpcodeOperationByPattern(Blaze::Byte inst0) {
+	using Group1Opcode = Blaze::CPU::Group1Opcode;
+	using Group2Opcode = Blaze::CPU::Group2Opcode;
+	using Group3Opcode = Blaze::CPU::Group3Opcode;
+	using CPU = Blaze::CPU;
+
 	// before doing any smart decoding, we first do some simple opcode comparisons.
 	// there are some instructions that only require a single byte (their opcode).
 	// then there are those instructions that require multiple bytes, but have no
 	// clear pattern that can be used to decode them "intelligently".
 
-	auto entry = INSTRUCTIONS_WITH_NO_PATTERN.find(inst0);
-	if (entry != INSTRUCTIONS_WITH_NO_PATTERN.end()) {
-		return entry->second;
+	for (const auto& entry: INSTRUCTIONS_WITH_NO_PATTERN) {
+		if (entry.opcode == inst0) {
+			return entry.info;
+		}
 	}
 
 	// this is a super special case
@@ -405,8 +726,8 @@ Blaze::CPU::Instruction Blaze::CPU::decodeInstruction(Byte inst0) const {
 	switch (groupSelect) {
 		case 1: {
 			// Group 1
-			AddressingMode mode = GROUP1_6502_ADDRESS_MODE_MAP[namespacedAddrMode];
-			auto instructionSize = instructionSizeWithAddressingMode(mode);
+			AddressingMode mode = CPU::GROUP1_6502_ADDRESS_MODE_MAP[namespacedAddrMode];
+			auto instructionSize = CPU::instructionSizeWithAddressingMode(mode);
 			auto opcode = static_cast<Group1Opcode>(namespacedOpcode);
 
 			// in this group, all addressing mode values are valid, so no need to check that.
@@ -415,15 +736,9 @@ Blaze::CPU::Instruction Blaze::CPU::decodeInstruction(Byte inst0) const {
 				return Instruction();
 			}
 
-			if (instructionSize == 0) {
-				// there are only 2 cases where this happens: Immediate and Stack
-				// Stack is impossible because it's not supported in this group,
-				// so it must be Immediate. in this case, the instruction size depends
-				// on the CPU flags.
-				//
-				// when the `m` flag is unset, it takes up 3 bytes instead of 2.
-				instructionSize = !getFlag(flags::m) ? 3 : 2;
-			}
+			// if the instruction size is 0 here, there is only 1 case where this can happen: Immediate
+			// (Stack is impossible because it's not supported in this group). in this case, the instruction
+			// size depends on the CPU flags, so we leave it as 0 for `CPU::decodeInstruction` to fill in.
 
 			switch (opcode) {
 				case Group1Opcode::ORA: return Instruction(Opcode::ORA, instructionSize, 0, mode);
@@ -442,7 +757,7 @@ Blaze::CPU::Instruction Blaze::CPU::decodeInstruction(Byte inst0) const {
 			// Group 2
 
 			// if the address mode matches the special 65C02 address mode, we process it as a Group 1 instruction instead.
-			if (namespacedAddrMode == GROUP2_65C02_ADDRESS_MODE) {
+			if (namespacedAddrMode == CPU::GROUP2_65C02_ADDRESS_MODE) {
 				switch (static_cast<Group1Opcode>(namespacedOpcode)) {
 					case Group1Opcode::ORA: return Instruction(Opcode::ORA, 2, 0, AddressingMode::DirectIndirect);
 					case Group1Opcode::AND: return Instruction(Opcode::AND, 2, 0, AddressingMode::DirectIndirect);
@@ -456,8 +771,8 @@ Blaze::CPU::Instruction Blaze::CPU::decodeInstruction(Byte inst0) const {
 				}
 			}
 
-			AddressingMode mode = GROUP2_ADDRESS_MODE_MAP[namespacedAddrMode];
-			auto instructionSize = instructionSizeWithAddressingMode(mode);
+			AddressingMode mode = CPU::GROUP2_ADDRESS_MODE_MAP[namespacedAddrMode];
+			auto instructionSize = CPU::instructionSizeWithAddressingMode(mode);
 			auto opcode = static_cast<Group2Opcode>(namespacedOpcode);
 
 			if (mode == AddressingMode::INVALID) {
@@ -489,11 +804,6 @@ Blaze::CPU::Instruction Blaze::CPU::decodeInstruction(Byte inst0) const {
 				}
 			}
 
-			if (instructionSize == 0) {
-				// same as for Group 1 instructions
-				instructionSize = !getFlag(flags::m) ? 3 : 2;
-			}
-
 			switch (opcode) {
 				case Group2Opcode::ASL: return Instruction(Opcode::ASL, instructionSize, 0, mode);
 				case Group2Opcode::ROL: return Instruction(Opcode::ROL, instructionSize, 0, mode);
@@ -511,12 +821,12 @@ Blaze::CPU::Instruction Blaze::CPU::decodeInstruction(Byte inst0) const {
 			// Group 3
 
 			// if the address mode matches the special condition address mode, we process it as a branch instruction with a condition.
-			if (namespacedAddrMode == GROUP3_CONDITION_ADDRESS_MODE) {
+			if (namespacedAddrMode == CPU::GROUP3_CONDITION_ADDRESS_MODE) {
 				return Instruction(Opcode::BRA, 2, 0, static_cast<ConditionCode>(namespacedOpcode >> 1), (namespacedOpcode & 0x01) != 0);
 			}
 
-			AddressingMode mode = GROUP3_ADDRESS_MODE_MAP[namespacedAddrMode];
-			auto instructionSize = instructionSizeWithAddressingMode(mode);
+			AddressingMode mode = CPU::GROUP3_ADDRESS_MODE_MAP[namespacedAddrMode];
+			auto instructionSize = CPU::instructionSizeWithAddressingMode(mode);
 			auto opcode = static_cast<Group3Opcode>(namespacedOpcode);
 
 			if (mode == AddressingMode::INVALID) {
@@ -538,11 +848,6 @@ Blaze::CPU::Instruction Blaze::CPU::decodeInstruction(Byte inst0) const {
 				return Instruction();
 			}
 
-			if (instructionSize == 0) {
-				// same as for Group 1 instructions
-				instructionSize = !getFlag(flags::m) ? 3 : 2;
-			}
-
 			switch (opcode) {
 				case Group3Opcode::TSB:         return Instruction(Opcode::TSB, instructionSize, 0, mode);
 				case Group3Opcode::BIT:         return Instruction(Opcode::BIT, instructionSize, 0, mode);
@@ -568,17 +873,12 @@ Blaze::CPU::Instruction Blaze::CPU::decodeInstruction(Byte inst0) const {
 
 		case 3: {
 			// Group 1 but with new 65C816 addressing modes
-			AddressingMode mode = GROUP1_65C816_ADDRESS_MODE_MAP[namespacedAddrMode];
-			auto instructionSize = instructionSizeWithAddressingMode(mode);
+			AddressingMode mode = CPU::GROUP1_65C816_ADDRESS_MODE_MAP[namespacedAddrMode];
+			auto instructionSize = CPU::instructionSizeWithAddressingMode(mode);
 			auto opcode = static_cast<Group1Opcode>(namespacedOpcode);
 
 			// in this group, all addressing mode values are valid, so no need to check that.
 
-			if (instructionSize == 0) {
-				// same as for Group 1 instructions
-				instructionSize = !getFlag(flags::m) ? 3 : 2;
-			}
-
 			switch (opcode) {
 				case Group1Opcode::ORA: return Instruction(Opcode::ORA, instructionSize, 0, mode);
 				case Group1Opcode::AND: return Instruction(Opcode::AND, instructionSize, 0, mode);
@@ -597,8 +897,49 @@ Blaze::CPU::Instruction Blaze::CPU::decodeInstruction(Byte inst0) const {
 	}
 };
 
-Blaze::Cycles Blaze::CPU::executeInstruction(const Instruction& info) {
-	switch (info.opcode) {
+// same as above, but with the base cycle count filled in
+static constexpr Instruction decodeOpcodeByPattern(Blaze::Byte inst0) {
+	auto info = decodeOpcodeOperationByPattern(inst0);
+	if (info.opcode != Opcode::INVALID) {
+		info.cycles = OPCODE_BASE_CYCLES[inst0];
+	}
+	return info;
+};
+
+static constexpr std::array<Instruction, 256> buildOpcodeTable() {
+	std::array<Instruction, 256> table {};
+	for (size_t i = 0; i < table.size(); ++i) {
+		table[i] = decodeOpcodeByPattern(static_cast<Blaze::Byte>(i));
+	}
+	return table;
+};
+
+// the initializer is a constant expression, so this is filled in at compile time (no dynamic initialization)
+const std::array<Blaze::CPU::Instruction, 256> Blaze::CPU::OPCODE_TABLE = buildOpcodeTable();
+
+Blaze::CPU::Instruction Blaze::CPU::decodeInstructionByPattern(Byte inst0, bool memoryAndAccumulatorAre8Bit, bool indexRegistersAre8Bit) {
+	auto info = decodeOpcodeByPattern(inst0);
+	if (info.size == 0 && info.opcode != Opcode::INVALID) {
+		// when the `m` (or, for the index register instructions, `x`) flag is unset, the immediate operand takes up
+		// 2 bytes instead of 1.
+		info.size = immediateInstructionSize(info.opcode, memoryAndAccumulatorAre8Bit, indexRegistersAre8Bit);
+	}
+	return info;
+};
+
+Blaze::CPU::Instruction Blaze::CPU::decodeInstruction(Byte inst0) const {
+	auto info = OPCODE_TABLE[inst0];
+	if (info.size == 0 && info.opcode != Opcode::INVALID) {
+		// same as in `decodeInstructionByPattern`
+		info.size = immediateInstructionSize(info.opcode, memoryAndAccumulatorAre8Bit(), indexRegistersAre8Bit());
+	}
+	return info;
+};
+
+// since `Op` is a template parameter, the compiler reduces this switch to a direct call of the right handler
+template<Blaze::CPU::Opcode Op, bool MemoryIs8Bit, bool IndexIs8Bit>
+Blaze::Cycles Blaze::CPU::executeOpcode(const Instruction& info) {
+	switch (Op) {
 		case Opcode::BRK: return executeBRK();
 		case Opcode::BRL: return executeBRL();
 		case Opcode::CLC: return executeCLC();
@@ -606,31 +947,31 @@ Blaze::Cycles Blaze::CPU::executeInstruction(const Instruction& info) {
 		case Opcode::CLI: return executeCLI();
 		case Opcode::CLV: return executeCLV();
 		case Opcode::COP: return executeCOP();
-		case Opcode::DEX: return executeDEX();
-		case Opcode::DEY: return executeDEY();
-		case Opcode::INX: return executeINX();
-		case Opcode::INY: return executeINY();
+		case Opcode::DEX: return executeDEX<IndexIs8Bit>();
+		case Opcode::DEY: return executeDEY<IndexIs8Bit>();
+		case Opcode::INX: return executeINX<IndexIs8Bit>();
+		case Opcode::INY: return executeINY<IndexIs8Bit>();
 		case Opcode::JML: return executeJML();
 		case Opcode::JSL: return executeJSL();
-		case Opcode::MVN: return executeMVN();
-		case Opcode::MVP: return executeMVP();
+		case Opcode::MVN: return executeBlockMove<false, IndexIs8Bit>();
+		case Opcode::MVP: return executeBlockMove<true, IndexIs8Bit>();
 		case Opcode::NOP: return executeNOP();
 		case Opcode::PEA: return executePEA();
 		case Opcode::PEI: return executePEI();
 		case Opcode::PER: return executePER();
-		case Opcode::PHA: return executePHA();
+		case Opcode::PHA: return executePHA<MemoryIs8Bit>();
 		case Opcode::PHB: return executePHB();
 		case Opcode::PHD: return executePHD();
 		case Opcode::PHK: return executePHK();
 		case Opcode::PHP: return executePHP();
-		case Opcode::PHX: return executePHX();
-		case Opcode::PHY: return executePHY();
-		case Opcode::PLA: return executePLA();
+		case Opcode::PHX: return executePHX<IndexIs8Bit>();
+		case Opcode::PHY: return executePHY<IndexIs8Bit>();
+		case Opcode::PLA: return executePLA<MemoryIs8Bit>();
 		case Opcode::PLB: return executePLB();
 		case Opcode::PLD: return executePLD();
 		case Opcode::PLP: return executePLP();
-		case Opcode::PLX: return executePLX();
-		case Opcode::PLY: return executePLY();
+		case Opcode::PLX: return executePLX<IndexIs8Bit>();
+		case Opcode::PLY: return executePLY<IndexIs8Bit>();
 		case Opcode::REP: return executeREP();
 		case Opcode::RTI: return executeRTI();
 		case Opcode::RTL: return executeRTL();
@@ -640,49 +981,49 @@ Blaze::Cycles Blaze::CPU::executeInstruction(const Instruction& info) {
 		case Opcode::SEI: return executeSEI();
 		case Opcode::SEP: return executeSEP();
 		case Opcode::STP: return executeSTP();
-		case Opcode::TAX: return executeTAX();
-		case Opcode::TAY: return executeTAY();
+		case Opcode::TAX: return executeTAX<IndexIs8Bit>();
+		case Opcode::TAY: return executeTAY<IndexIs8Bit>();
 		case Opcode::TCD: return executeTCD();
 		case Opcode::TCS: return executeTCS();
-		case Opcode::TDC: return executeTDC();
-		case Opcode::TSC: return executeTSC();
-		case Opcode::TSX: return executeTSX();
-		case Opcode::TXA: return executeTXA();
-		case Opcode::TXS: return executeTXS();
-		case Opcode::TXY: return executeTXY();
-		case Opcode::TYA: return executeTYA();
-		case Opcode::TYX: return executeTYX();
+		case Opcode::TDC: return executeTDC<MemoryIs8Bit>();
+		case Opcode::TSC: return executeTSC<MemoryIs8Bit>();
+		case Opcode::TSX: return executeTSX<IndexIs8Bit>();
+		case Opcode::TXA: return executeTXA<MemoryIs8Bit, IndexIs8Bit>();
+		case Opcode::TXS: return executeTXS<IndexIs8Bit>();
+		case Opcode::TXY: return executeTXY<IndexIs8Bit>();
+		case Opcode::TYA: return executeTYA<MemoryIs8Bit, IndexIs8Bit>();
+		case Opcode::TYX: return executeTYX<IndexIs8Bit>();
 		case Opcode::WAI: return executeWAI();
 		case Opcode::WDM: return executeWDM();
 		case Opcode::XBA: return executeXBA();
 		case Opcode::XCE: return executeXCE();
 
-		case Opcode::ADC: return executeADC(info.addressingMode);
-		case Opcode::AND: return executeAND(info.addressingMode);
-		case Opcode::ASL: return executeASL(info.addressingMode);
-		case Opcode::BIT: return executeBIT(info.addressingMode);
-		case Opcode::CMP: return executeCMP(info.addressingMode);
-		case Opcode::CPX: return executeCPX(info.addressingMode);
-		case Opcode::CPY: return executeCPY(info.addressingMode);
-		case Opcode::DEC: return executeDEC(info.addressingMode);
-		case Opcode::EOR: return executeEOR(info.addressingMode);
-		case Opcode::INC: return executeINC(info.addressingMode);
-		case Opcode::JMP: return executeJMP(info.addressingMode);
-		case Opcode::JSR: return executeJSR(info.addressingMode);
-		case Opcode::LDA: return executeLDA(info.addressingMode);
-		case Opcode::LDX: return executeLDX(info.addressingMode);
-		case Opcode::LDY: return executeLDY(info.addressingMode);
-		case Opcode::LSR: return executeLSR(info.addressingMode);
-		case Opcode::ORA: return executeORA(info.addressingMode);
-		case Opcode::ROL: return executeROL(info.addressingMode);
-		case Opcode::ROR: return executeROR(info.addressingMode);
-		case Opcode::SBC: return executeSBC(info.addressingMode);
-		case Opcode::STA: return executeSTA(info.addressingMode);
-		case Opcode::STX: return executeSTX(info.addressingMode);
-		case Opcode::STY: return executeSTY(info.addressingMode);
-		case Opcode::STZ: return executeSTZ(info.addressingMode);
-		case Opcode::TRB: return executeTRB(info.addressingMode);
-		case Opcode::TSB: return executeTSB(info.addressingMode);
+		case Opcode::ADC: return executeADC<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::AND: return executeAND<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::ASL: return executeASL<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::BIT: return executeBIT<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::CMP: return executeCMP<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::CPX: return executeCPX<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::CPY: return executeCPY<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::DEC: return executeDEC<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::EOR: return executeEOR<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::INC: return executeINC<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::JMP: return executeJMP<IndexIs8Bit>(info.addressingMode);
+		case Opcode::JSR: return executeJSR<IndexIs8Bit>(info.addressingMode);
+		case Opcode::LDA: return executeLDA<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::LDX: return executeLDX<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::LDY: return executeLDY<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::LSR: return executeLSR<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::ORA: return executeORA<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::ROL: return executeROL<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::ROR: return executeROR<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::SBC: return executeSBC<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::STA: return executeSTA<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::STX: return executeSTX<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::STY: return executeSTY<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::STZ: return executeSTZ<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::TRB: return executeTRB<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
+		case Opcode::TSB: return executeTSB<MemoryIs8Bit, IndexIs8Bit>(info.addressingMode);
 
 		case Opcode::BRA: return executeBRA(info.condition, info.passConditionIfBitSet);
 
@@ -691,14 +1032,367 @@ Blaze::Cycles Blaze::CPU::executeInstruction(const Instruction& info) {
 	}
 };
 
+static constexpr size_t OPCODE_COUNT = static_cast<size_t>(Opcode::Last) + 1;
+
+template<bool MemoryIs8Bit, bool IndexIs8Bit, size_t... Index>
+static constexpr std::array<Blaze::CPU::InstructionHandler, sizeof...(Index)> makeOpcodeHandlers(std::index_sequence<Index...> /* unused */) {
+	return { &Blaze::CPU::executeOpcode<static_cast<Opcode>(Index), MemoryIs8Bit, IndexIs8Bit>... };
+};
+
+// indexed by `(m << 1) | x` (the same as the upper bits of `CPU::dispatchIndex`), then by `Opcode`
+static constexpr std::array<std::array<Blaze::CPU::InstructionHandler, OPCODE_COUNT>, 4> OPCODE_HANDLERS {
+	makeOpcodeHandlers<false, false>(std::make_index_sequence<OPCODE_COUNT>()),
+	makeOpcodeHandlers<false, true>(std::make_index_sequence<OPCODE_COUNT>()),
+	makeOpcodeHandlers<true, false>(std::make_index_sequence<OPCODE_COUNT>()),
+	makeOpcodeHandlers<true, true>(std::make_index_sequence<OPCODE_COUNT>()),
+};
+
+static constexpr std::array<Blaze::CPU::InstructionHandler, 1024> buildDispatchTable() {
+	constexpr auto opcodeTable = buildOpcodeTable();
+	std::array<Blaze::CPU::InstructionHandler, 1024> table {};
+	for (size_t i = 0; i < table.size(); ++i) {
+		auto opcode = opcodeTable[i & 0xff].opcode;
+		if (opcode > Opcode::Last) {
+			table[i] = &Blaze::CPU::executeOpcode<Opcode::INVALID, false, false>;
+		} else {
+			table[i] = OPCODE_HANDLERS[i >> 8][static_cast<size_t>(opcode)];
+		}
+	}
+	return table;
+};
+
+const std::array<Blaze::CPU::InstructionHandler, 1024> Blaze::CPU::DISPATCH_TABLE = buildDispatchTable();
+
+static constexpr bool isDirectPageMode(AddressingMode mode) {
+	switch (mode) {
+		case AddressingMode::DirectIndexedIndirect:
+		case AddressingMode::DirectIndexedX:
+		case AddressingMode::DirectIndexedY:
+		case AddressingMode::DirectIndirectIndexed:
+		case AddressingMode::DirectIndirectLongIndexed:
+		case AddressingMode::DirectIndirectLong:
+		case AddressingMode::DirectIndirect:
+		case AddressingMode::Direct:
+			return true;
+
+		default:
+			return false;
+	}
+};
+
+// applies the penalties from the notes of the datasheet's cycle table that only depend on the opcode and the `m`/`x` flags.
+// the rest (e.g. taken branches) are returned by the instruction handlers.
+static constexpr Blaze::CPU::InstructionTiming timingForInstruction(const Instruction& info, bool memoryIs8Bit, bool indexIs8Bit) {
+	Blaze::CPU::InstructionTiming timing;
+	timing.cycles = static_cast<Blaze::Byte>(info.cycles);
+
+	bool readsIndexedOperand = false;
+
+	switch (info.opcode) {
+		// instructions that read a memory operand with the width of the accumulator
+		case Opcode::ADC:
+		case Opcode::AND:
+		case Opcode::BIT:
+		case Opcode::CMP:
+		case Opcode::EOR:
+		case Opcode::LDA:
+		case Opcode::ORA:
+		case Opcode::SBC:
+			readsIndexedOperand = true;
+			[[fallthrough]];
+
+		// ditto, but they write it instead
+		case Opcode::STA:
+		case Opcode::STZ:
+		case Opcode::PHA:
+		case Opcode::PLA:
+			if (!memoryIs8Bit) {
+				timing.cycles += 1;
+			}
+			break;
+
+		// read-modify-write instructions take 2 extra cycles (one to read and one to write the extra byte)
+		case Opcode::ASL:
+		case Opcode::DEC:
+		case Opcode::INC:
+		case Opcode::LSR:
+		case Opcode::ROL:
+		case Opcode::ROR:
+		case Opcode::TRB:
+		case Opcode::TSB:
+			if (!memoryIs8Bit && info.addressingMode != AddressingMode::Accumulator) {
+				timing.cycles += 2;
+			}
+			break;
+
+		// instructions that read a memory operand with the width of the index registers
+		case Opcode::CPX:
+		case Opcode::CPY:
+		case Opcode::LDX:
+		case Opcode::LDY:
+			readsIndexedOperand = true;
+			[[fallthrough]];
+
+		// ditto, but they write it instead
+		case Opcode::STX:
+		case Opcode::STY:
+		case Opcode::PHX:
+		case Opcode::PHY:
+		case Opcode::PLX:
+		case Opcode::PLY:
+			if (!indexIs8Bit) {
+				timing.cycles += 1;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	// reads with indexed addressing take an extra cycle to fix up the high byte of the address when needed
+	// (the fixed cycle counts of stores and read-modify-writes already include it)
+	if (readsIndexedOperand) {
+		switch (info.addressingMode) {
+			case AddressingMode::AbsoluteIndexedX:
+			case AddressingMode::AbsoluteIndexedY:
+			case AddressingMode::DirectIndirectIndexed:
+				if (indexIs8Bit) {
+					timing.pageCrossPenalty = true;
+				} else {
+					timing.cycles += 1;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	// `PEI` reads its pointer from the direct page, but it's not decoded with a direct page addressing mode
+	timing.directPagePenalty = isDirectPageMode(info.addressingMode) || info.opcode == Opcode::PEI;
+
+	return timing;
+};
+
+static constexpr std::array<Blaze::CPU::InstructionTiming, 1024> buildInstructionTimings() {
+	constexpr auto opcodeTable = buildOpcodeTable();
+	std::array<Blaze::CPU::InstructionTiming, 1024> table {};
+	for (size_t i = 0; i < table.size(); ++i) {
+		// same layout as `CPU::dispatchIndex`
+		bool memoryIs8Bit = (i & 0x200) != 0;
+		bool indexIs8Bit = (i & 0x100) != 0;
+		table[i] = timingForInstruction(opcodeTable[i & 0xff], memoryIs8Bit, indexIs8Bit);
+	}
+	return table;
+};
+
+const std::array<Blaze::CPU::InstructionTiming, 1024> Blaze::CPU::INSTRUCTION_TIMINGS = buildInstructionTimings();
+
+Blaze::Cycles Blaze::CPU::executeInstruction(const Instruction& info) {
+	if (info.opcode > Opcode::Last) {
+		return invalidInstruction();
+	}
+
+	auto handler = OPCODE_HANDLERS[dispatchIndex(0) >> 8][static_cast<size_t>(info.opcode)];
+	return (this->*handler)(info);
+};
+
+// the run loop needs a separate copy of every handler (see `CPU::run`); these turn a `dispatchIndex` into the template
+// arguments of its `executeOpcode` instantiation (the same one `DISPATCH_TABLE` has)
+static constexpr auto RUN_LOOP_OPCODE_TABLE = buildOpcodeTable();
+
+template<size_t Index>
+static constexpr Opcode runLoopOpcode() {
+	auto opcode = RUN_LOOP_OPCODE_TABLE[Index & 0xff].opcode;
+	return (opcode > Opcode::Last) ? Opcode::INVALID : opcode;
+};
+
+// expands `M(n)` for every `n` from 0x000 to 0x3ff (as hex literals, so they can be pasted into label names)
+#define BLAZE_REPEAT_16(M, prefix) \
+	M(prefix##0) M(prefix##1) M(prefix##2) M(prefix##3) M(prefix##4) M(prefix##5) M(prefix##6) M(prefix##7) \
+	M(prefix##8) M(prefix##9) M(prefix##a) M(prefix##b) M(prefix##c) M(prefix##d) M(prefix##e) M(prefix##f)
+#define BLAZE_REPEAT_256(M, prefix) \
+	BLAZE_REPEAT_16(M, prefix##0) BLAZE_REPEAT_16(M, prefix##1) BLAZE_REPEAT_16(M, prefix##2) BLAZE_REPEAT_16(M, prefix##3) \
+	BLAZE_REPEAT_16(M, prefix##4) BLAZE_REPEAT_16(M, prefix##5) BLAZE_REPEAT_16(M, prefix##6) BLAZE_REPEAT_16(M, prefix##7) \
+	BLAZE_REPEAT_16(M, prefix##8) BLAZE_REPEAT_16(M, prefix##9) BLAZE_REPEAT_16(M, prefix##a) BLAZE_REPEAT_16(M, prefix##b) \
+	BLAZE_REPEAT_16(M, prefix##c) BLAZE_REPEAT_16(M, prefix##d) BLAZE_REPEAT_16(M, prefix##e) BLAZE_REPEAT_16(M, prefix##f)
+#define BLAZE_REPEAT_1024(M) \
+	BLAZE_REPEAT_256(M, 0x0) BLAZE_REPEAT_256(M, 0x1) BLAZE_REPEAT_256(M, 0x2) BLAZE_REPEAT_256(M, 0x3)
+
+#define BLAZE_RUN_HANDLER(n) executeOpcode<runLoopOpcode<n>(), ((n) & 0x200) != 0, ((n) & 0x100) != 0>(info)
+
+// block moves can use up whatever is left of the budget (see `CPU::blockMoveBudget`)
+#define BLAZE_RUN_BLOCK_MOVE_BUDGET(n) \
+	if constexpr (runLoopOpcode<n>() == Opcode::MVN || runLoopOpcode<n>() == Opcode::MVP) { \
+		blockMoveBudget = runBudget - used; \
+	}
+
+// when profiling, every handler is timed on its own (the fetch and decode in between aren't counted)
+#define BLAZE_RUN_PROFILE_START() \
+	if constexpr (Profiler::ENABLED) { \
+		profileStart = Profiler::timestamp(); \
+	}
+#define BLAZE_RUN_PROFILE_RECORD() \
+	if constexpr (Profiler::ENABLED) { \
+		Profiler::record(index, cycles * bus->accessCycles(executingPC), Profiler::timestamp() - profileStart); \
+	}
+
+// threaded dispatch needs the "labels as values" extension (GCC and Clang have it, MSVC doesn't)
+#ifndef BLAZE_THREADED_DISPATCH
+	#if defined(__GNUC__) || defined(__clang__)
+		#define BLAZE_THREADED_DISPATCH 1
+	#else
+		#define BLAZE_THREADED_DISPATCH 0
+	#endif
+#endif
+
+uint32_t Blaze::CPU::run(Cycles budget, Cycles& outCycles) {
+	Cycles used = 0;
+	uint32_t instructions = 0;
+
+	// this is a member so that `endRun` can change it while we're running
+	runBudget = budget;
+
+	if (jit != nullptr) {
+		while (used < runBudget && !stopped && !waitingForInterrupt) {
+			Cycles cycles = 0;
+			instructions += jit->step(cycles);
+			used += cycles;
+		}
+
+		outCycles = used;
+		return instructions;
+	}
+
+	// the call profiler has to see every instruction on its own, so this goes through `execute` instead
+	if (callProfiler != nullptr) {
+		while (used < runBudget && !stopped && !waitingForInterrupt) {
+			blockMoveBudget = runBudget - used;
+			used += execute();
+			++instructions;
+		}
+
+		outCycles = used;
+		return instructions;
+	}
+
+	Instruction info;
+	size_t index = 0;
+	Cycles cycles = 0;
+	[[maybe_unused]] uint64_t profileStart = 0;
+
+#if BLAZE_THREADED_DISPATCH
+	// every handler gets its own copy of the code that fetches the next instruction and jumps to its handler.
+	// that way, each of those indirect jumps only has to predict what usually comes after one particular instruction,
+	// rather than a single jump having to predict every instruction in the program.
+	#define BLAZE_RUN_LABEL_ADDRESS(n) &&handler_##n,
+	static const void* const HANDLER_LABELS[1024] = { BLAZE_REPEAT_1024(BLAZE_RUN_LABEL_ADDRESS) };
+
+	#define BLAZE_RUN_NEXT() \
+		if (used >= runBudget || stopped || waitingForInterrupt) { \
+			goto done; \
+		} \
+		info = fetchInstruction(); \
+		index = dispatchIndex(executingOpcode); \
+		cycles = beginInstruction(info, index); \
+		goto *HANDLER_LABELS[index];
+
+	#define BLAZE_RUN_LABEL(n) \
+		handler_##n: \
+		BLAZE_RUN_BLOCK_MOVE_BUDGET(n) \
+		BLAZE_RUN_PROFILE_START() \
+		cycles += BLAZE_RUN_HANDLER(n); \
+		BLAZE_RUN_PROFILE_RECORD() \
+		used += cycles * bus->accessCycles(executingPC); \
+		++instructions; \
+		BLAZE_RUN_NEXT()
+
+	BLAZE_RUN_NEXT()
+	BLAZE_REPEAT_1024(BLAZE_RUN_LABEL)
+
+done:
+	#undef BLAZE_RUN_LABEL_ADDRESS
+	#undef BLAZE_RUN_NEXT
+	#undef BLAZE_RUN_LABEL
+#else
+	// same thing, but with a single switch that does all the dispatching
+	#define BLAZE_RUN_CASE(n) \
+		case n: \
+			BLAZE_RUN_BLOCK_MOVE_BUDGET(n) \
+			cycles += BLAZE_RUN_HANDLER(n); \
+			break;
+
+	while (used < runBudget && !stopped && !waitingForInterrupt) {
+		info = fetchInstruction();
+		index = dispatchIndex(executingOpcode);
+		cycles = beginInstruction(info, index);
+
+		BLAZE_RUN_PROFILE_START()
+		switch (index) {
+			BLAZE_REPEAT_1024(BLAZE_RUN_CASE)
+		}
+		BLAZE_RUN_PROFILE_RECORD()
+
+		used += cycles * bus->accessCycles(executingPC);
+		++instructions;
+	}
+
+	#undef BLAZE_RUN_CASE
+#endif
+
+	// anything that halted the CPU (e.g. DMA) also ended the run, so that's charged here rather than after every instruction
+	outCycles = used + std::exchange(stalledCycles, 0);
+	return instructions;
+};
+
+#undef BLAZE_RUN_HANDLER
+#undef BLAZE_RUN_BLOCK_MOVE_BUDGET
+#undef BLAZE_RUN_PROFILE_START
+#undef BLAZE_RUN_PROFILE_RECORD
+#undef BLAZE_REPEAT_1024
+#undef BLAZE_REPEAT_256
+#undef BLAZE_REPEAT_16
+
 Blaze::Cycles Blaze::CPU::invalidInstruction() {
-	// TODO
+	// every one of the 256 opcodes is a valid 65C816 instruction, so this only happens if the opcode table is broken.
+	// stop (like `STP`) rather than carry on with whatever comes after the bytes we couldn't decode.
+	stopped = true;
 	return 0;
 };
 
+Blaze::Cycles Blaze::CPU::softwareInterrupt(Address nativeVector, Address emulatedVector) {
+	Word interruptedSP = SP;
+
+	// (just like `irq`. the PC pushed is the one after the signature byte, so `RTI` skips over it)
+	if (!usingEmulationMode()) {
+		store8(SP, PBR);
+		SP--;
+	}
+
+	store16(SP - 1, PC);
+	SP -= 2;
+
+	// P is pushed as it is: in emulation mode, that means the B flag is set (`x` is always set there), which is how an
+	// IRQ handler tells a `BRK` apart from an IRQ (they share a vector)
+	store8(SP, P);
+	SP--;
+	setFlag(flags::i, true);
+	setFlag(flags::d, false);
+
+	PBR = 0;
+	PC = load16(usingEmulationMode() ? emulatedVector : nativeVector);
+
+	if (callProfiler != nullptr) {
+		// (the handler is entered by the instruction itself, so it's a call rather than an interrupt between instructions)
+		callProfiler->call(PC, interruptedSP);
+	}
+
+	// (native mode takes an extra cycle to push the PBR)
+	return usingEmulationMode() ? 0 : 1;
+};
+
 Blaze::Cycles Blaze::CPU::executeBRK() {
-	// TODO
-	return 0;
+	return softwareInterrupt(ExceptionVectorAddress::NativeBRK, ExceptionVectorAddress::EmulatedBRK);
 };
 
 Blaze::Cycles Blaze::CPU::executeBRL() {
@@ -727,31 +1421,34 @@ Blaze::Cycles Blaze::CPU::executeCLV() {
 };
 
 Blaze::Cycles Blaze::CPU::executeCOP() {
-	// TODO
-	return 0;
+	return softwareInterrupt(ExceptionVectorAddress::NativeCOP, ExceptionVectorAddress::EmulatedCOP);
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeDEX() {
-	X--;
-	setZeroNegFlags(X);
+	X.store<IndexIs8Bit>(X.load<IndexIs8Bit>() - 1);
+	setZeroNegFlags<IndexIs8Bit>(X.load<IndexIs8Bit>());
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeDEY() {
-	Y--;
-	setZeroNegFlags(Y);
+	Y.store<IndexIs8Bit>(Y.load<IndexIs8Bit>() - 1);
+	setZeroNegFlags<IndexIs8Bit>(Y.load<IndexIs8Bit>());
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeINX() {
-	X++;
-	setZeroNegFlags(X);
+	X.store<IndexIs8Bit>(X.load<IndexIs8Bit>() + 1);
+	setZeroNegFlags<IndexIs8Bit>(X.load<IndexIs8Bit>());
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeINY() {
-	Y++;
-	setZeroNegFlags(Y);
+	Y.store<IndexIs8Bit>(Y.load<IndexIs8Bit>() + 1);
+	setZeroNegFlags<IndexIs8Bit>(Y.load<IndexIs8Bit>());
 	return 0;
 };
 
@@ -772,17 +1469,61 @@ Blaze::Cycles Blaze::CPU::executeJSL() {
 
 	split24(newPC, PBR, PC);
 
-	return 0;
-};
+	if (callProfiler != nullptr) {
+		// (the stack pointer from before the 3 bytes of the return address were pushed)
+		callProfiler->call(newPC, SP + 3);
+	}
 
-Blaze::Cycles Blaze::CPU::executeMVN() {
-	// TODO
 	return 0;
 };
 
-Blaze::Cycles Blaze::CPU::executeMVP() {
-	// TODO
-	return 0;
+template<bool Descending, bool IndexIs8Bit>
+Blaze::Cycles Blaze::CPU::executeBlockMove() {
+	// the destination bank comes first in the instruction
+	Byte destinationBank = lo8(operandBytes);
+	Byte sourceBank = static_cast<Byte>(operandBytes >> 8);
+	DBR = destinationBank;
+
+	Word source = X.load<IndexIs8Bit>();
+	Word destination = Y.load<IndexIs8Bit>();
+
+	// the accumulator (all 16 bits of it, regardless of `m`) holds the number of bytes left minus one
+	Address bytesLeft = static_cast<Address>(A.forceLoadFull()) + 1;
+
+	// each byte is a separate run of the instruction (which is what makes the move interruptible), but if we have time for
+	// several of them, we can move them all at once, as long as nothing wraps around and they don't cross a page
+	Cycles budget = std::exchange(blockMoveBudget, 0);
+	Cycles cyclesPerByte = 7 * bus->accessCycles(executingPC);
+
+	Address count = std::min<Address>(bytesLeft, budget / cyclesPerByte);
+	if constexpr (Descending) {
+		count = std::min<Address>({ count, Address(source & Bus::PAGE_OFFSET_MASK) + 1, Address(destination & Bus::PAGE_OFFSET_MASK) + 1 });
+	} else {
+		constexpr Address INDEX_RANGE = IndexIs8Bit ? 0x100 : 0x10000;
+		count = std::min<Address>({ count, INDEX_RANGE - source, INDEX_RANGE - destination });
+		count = std::min<Address>({ count, Bus::PAGE_SIZE - (source & Bus::PAGE_OFFSET_MASK), Bus::PAGE_SIZE - (destination & Bus::PAGE_OFFSET_MASK) });
+	}
+
+	// `copyDirect` takes the lowest address of each range
+	Word sourceStart = Descending ? static_cast<Word>(source - (count - 1)) : source;
+	Word destinationStart = Descending ? static_cast<Word>(destination - (count - 1)) : destination;
+	if (count < 2 || !bus->copyDirect(concat24(destinationBank, destinationStart), concat24(sourceBank, sourceStart), count, Descending)) {
+		count = 1;
+		store8(destinationBank, destination, load8(sourceBank, source));
+	}
+
+	Word step = Descending ? static_cast<Word>(-static_cast<int32_t>(count)) : static_cast<Word>(count);
+	X.store<IndexIs8Bit>(source + step);
+	Y.store<IndexIs8Bit>(destination + step);
+	A.forceStoreFull(static_cast<Word>(bytesLeft - count - 1));
+
+	if (bytesLeft > count) {
+		// run the instruction again for the next byte
+		PC -= 3;
+	}
+
+	// the first byte's cycles are the instruction's base cycles
+	return 7 * (count - 1);
 };
 
 Blaze::Cycles Blaze::CPU::executeNOP() {
@@ -790,7 +1531,7 @@ Blaze::Cycles Blaze::CPU::executeNOP() {
 };
 
 Blaze::Cycles Blaze::CPU::executePEA() {
-	Word address = load16(PC + 1);
+	Word address = lo16(operandBytes);
 	SP -= 2;
 	store16(0, SP + 1, address);
 	return 0;
@@ -812,13 +1553,13 @@ Blaze::Cycles Blaze::CPU::executePER() {
 	return 0;
 };
 
+template<bool MemoryIs8Bit>
 Blaze::Cycles Blaze::CPU::executePHA() {
-	if (memoryAndAccumulatorAre8Bit()) {
-		store8(SP, A.load());
-	}
-	else {
+	if constexpr (MemoryIs8Bit) {
+		store8(SP, A.load<true>());
+	} else {
 		SP--;
-		store16(SP, A.forceLoadFull());
+		store16(SP, A.load<false>());
 	}
 	SP--;
 	return 0;
@@ -854,40 +1595,40 @@ Blaze::Cycles Blaze::CPU::executePHP() {
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executePHX() {
-	if (indexRegistersAre8Bit()) {
-		store8(SP, X.load());
-	}
-	else {
+	if constexpr (IndexIs8Bit) {
+		store8(SP, X.load<true>());
+	} else {
 		SP--;
-		store16(SP, X.forceLoadFull());
+		store16(SP, X.load<false>());
 	}
 	SP--;
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executePHY() {
-	if (indexRegistersAre8Bit()) {
-		store8(SP, Y.load());
-	}
-	else {
+	if constexpr (IndexIs8Bit) {
+		store8(SP, Y.load<true>());
+	} else {
 		SP--;
-		store16(SP, Y.forceLoadFull());
+		store16(SP, Y.load<false>());
 	}
 	SP--;
 	return 0;
 };
 
+template<bool MemoryIs8Bit>
 Blaze::Cycles Blaze::CPU::executePLA() {
 	SP++;
-	if (memoryAndAccumulatorAre8Bit()) {
-		A = load8(SP);
-	}
-	else {
-		A = load16(SP);
+	if constexpr (MemoryIs8Bit) {
+		A.store<true>(load8(SP));
+	} else {
+		A.store<false>(load16(SP));
 		SP++;
 	}
-	setZeroNegFlags(A);
+	setZeroNegFlags<MemoryIs8Bit>(A.load<MemoryIs8Bit>());
 	return 0;
 };
 
@@ -923,29 +1664,29 @@ Blaze::Cycles Blaze::CPU::executePLP() {
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executePLX() {
 	SP++;
-	if (indexRegistersAre8Bit()) {
-		X = load8(SP);
-	}
-	else {
-		X = load16(SP);
+	if constexpr (IndexIs8Bit) {
+		X.store<true>(load8(SP));
+	} else {
+		X.store<false>(load16(SP));
 		SP++;
 	}
-	setZeroNegFlags(X);
+	setZeroNegFlags<IndexIs8Bit>(X.load<IndexIs8Bit>());
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executePLY() {
 	SP++;
-	if (indexRegistersAre8Bit()) {
-		Y = load8(SP);
-	}
-	else {
-		Y = load16(SP);
+	if constexpr (IndexIs8Bit) {
+		Y.store<true>(load8(SP));
+	} else {
+		Y.store<false>(load16(SP));
 		SP++;
 	}
-	setZeroNegFlags(Y);
+	setZeroNegFlags<IndexIs8Bit>(Y.load<IndexIs8Bit>());
 	return 0;
 };
 
@@ -960,8 +1701,30 @@ Blaze::Cycles Blaze::CPU::executeREP() {
 };
 
 Blaze::Cycles Blaze::CPU::executeRTI() {
-	// TODO
-	return 0;
+	// pull everything `irq`/`nmi` pushed, in reverse order
+	SP++;
+	P = load8(SP);
+	if (usingEmulationMode()) {
+		setFlag(flags::x, true);
+		setFlag(flags::m, true);
+	}
+
+	SP++;
+	PC = load16(SP);
+	SP++;
+
+	// (native mode takes an extra cycle to pull the PBR)
+	bool pullsBank = !usingEmulationMode();
+	if (pullsBank) {
+		SP++;
+		PBR = load8(SP);
+	}
+
+	if (callProfiler != nullptr) {
+		callProfiler->returned(SP);
+	}
+
+	return pullsBank ? 1 : 0;
 };
 
 Blaze::Cycles Blaze::CPU::executeRTL() {
@@ -972,6 +1735,10 @@ Blaze::Cycles Blaze::CPU::executeRTL() {
 	split24(newPC, PBR, PC);
 	++PC; // add 1 to account for the `- 1` when storing the PC (it's required)
 
+	if (callProfiler != nullptr) {
+		callProfiler->returned(SP);
+	}
+
 	return 0;
 };
 
@@ -983,6 +1750,10 @@ Blaze::Cycles Blaze::CPU::executeRTS() {
 	// add 1 to account for the `- 1` when storing the PC (it's required)
 	PC = newPC + 1;
 
+	if (callProfiler != nullptr) {
+		callProfiler->returned(SP);
+	}
+
 	return 0;
 };
 
@@ -1008,23 +1779,22 @@ Blaze::Cycles Blaze::CPU::executeSEP() {
 };
 
 Blaze::Cycles Blaze::CPU::executeSTP() {
-	// Do nothing until there is an interrup
-	while(true)
-	{
-		// Check for interrupt
-	}
+	// the processor stays stopped until it's reset (not even interrupts wake it up)
+	stopped = true;
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTAX() {
-	X = A.forceLoadFull();
-	setZeroNegFlags(X);
+	X.store<IndexIs8Bit>(A.forceLoadFull());
+	setZeroNegFlags<IndexIs8Bit>(X.load<IndexIs8Bit>());
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTAY() {
-	Y = A.forceLoadFull();
-	setZeroNegFlags(Y);
+	Y.store<IndexIs8Bit>(A.forceLoadFull());
+	setZeroNegFlags<IndexIs8Bit>(Y.load<IndexIs8Bit>());
 	return 0;
 };
 
@@ -1044,74 +1814,69 @@ Blaze::Cycles Blaze::CPU::executeTCS() {
 	return 0;
 };
 
+template<bool MemoryIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTDC() {
 	A.forceStoreFull(DR);
-	setZeroNegFlags(A);
+	setZeroNegFlags<MemoryIs8Bit>(A.load<MemoryIs8Bit>());
 	return 0;
 };
 
+template<bool MemoryIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTSC() {
 	A.forceStoreFull(SP);
-	setZeroNegFlags(A);
+	setZeroNegFlags<MemoryIs8Bit>(A.load<MemoryIs8Bit>());
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTSX() {
-	X = SP;
-	setZeroNegFlags(X);
+	X.store<IndexIs8Bit>(SP);
+	setZeroNegFlags<IndexIs8Bit>(X.load<IndexIs8Bit>());
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTXA() {
-	A = X.load();
-	setZeroNegFlags(A);
+	A.store<MemoryIs8Bit>(X.load<IndexIs8Bit>());
+	setZeroNegFlags<MemoryIs8Bit>(A.load<MemoryIs8Bit>());
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTXS() {
 	if (usingEmulationMode()) {
-		SP = 0x0100 | lo8(X.load());
+		SP = 0x0100 | lo8(X.load<IndexIs8Bit>());
 	} else {
-		SP = X.load();
+		SP = X.load<IndexIs8Bit>();
 	}
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTXY() {
-	Y = X.load();
-	setZeroNegFlags(Y);
+	Y.store<IndexIs8Bit>(X.load<IndexIs8Bit>());
+	setZeroNegFlags<IndexIs8Bit>(Y.load<IndexIs8Bit>());
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTYA() {
-	A = Y.load();
-	setZeroNegFlags(A);
+	A.store<MemoryIs8Bit>(Y.load<IndexIs8Bit>());
+	setZeroNegFlags<MemoryIs8Bit>(A.load<MemoryIs8Bit>());
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTYX() {
-	X = Y.load();
-	setZeroNegFlags(X);
+	X.store<IndexIs8Bit>(Y.load<IndexIs8Bit>());
+	setZeroNegFlags<IndexIs8Bit>(X.load<IndexIs8Bit>());
 	return 0;
 };
 
 Blaze::Cycles Blaze::CPU::executeWAI() {
-	// wait until there is an interrupt
-	while(true)
-	{
-		// Interrupt mask is set: continue with next instruction and then interrupt
-		//if()//There is an interrupt
-		{
-			if(flags::i)
-			{
-				// launch next instruction before going to interrupt
-			}
-			else
-			{
-
-			}
-		}
-	}
+	// wait until there is an interrupt.
+	// `clock` skips ahead to the next scheduled event while we're waiting, and `irq`/`nmi` wake us back up.
+	waitingForInterrupt = true;
 	return 0;
 };
 
@@ -1126,6 +1891,9 @@ Blaze::Cycles Blaze::CPU::executeWDM() {
 			return 0;
 		} break;
 
+		case CustomWDMOpcodes::Halt:
+			return executeSTP();
+
 		default:
 			return invalidInstruction();
 	}
@@ -1170,155 +1938,125 @@ Blaze::Cycles Blaze::CPU::executeXCE() {
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeADC(AddressingMode mode) {
 	// use `Address` instead of `Word` so that we have extra bits to properly compute the carry
-	Address left = A.load();
-	Address right = loadOperand(mode, memoryAndAccumulatorAre8Bit());
+	constexpr Address wordMask = MemoryIs8Bit ? 0xff : 0xffff;
+	Address left = A.load<MemoryIs8Bit>();
+	Address right = loadOperand<MemoryIs8Bit, IndexIs8Bit>(mode);
 	Address result = left + right + getCarry();
-	Address wordMask = (memoryAndAccumulatorAre8Bit() ? 0xff : 0xffff);
 	Word wordResult = result & wordMask;
 
-	A = wordResult;
+	A.store<MemoryIs8Bit>(wordResult);
 
-	setZeroNegFlags(A);
-	setOverflowFlag(left, right, wordResult);
+	setZeroNegFlags<MemoryIs8Bit>(wordResult);
+	setOverflowFlag<MemoryIs8Bit>(left, right, wordResult);
 	setFlag(flags::c, (result & ~wordMask) != 0);
 
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeAND(AddressingMode mode) {
-	Word val = loadOperand(mode, memoryAndAccumulatorAre8Bit());
-	A &= val;
-	setZeroNegFlags(A);
+	Word val = loadOperand<MemoryIs8Bit, IndexIs8Bit>(mode);
+	A.store<MemoryIs8Bit>(A.load<MemoryIs8Bit>() & val);
+	setZeroNegFlags<MemoryIs8Bit>(A.load<MemoryIs8Bit>());
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeASL(AddressingMode mode) {
-	// Get byte to shift
-	Address addr = decodeAddress(mode);
-
-	Word val;
-
-	if (mode == AddressingMode::Accumulator) {
-		val = A.load();
-	} else if (memoryAndAccumulatorAre8Bit()) {
-		val = load8(addr);
-	} else {
-		val = load16(addr);
-	}
-
-	// Set carry flag if current left bit is 1
-	setFlag(flags::c, msb(val, memoryAndAccumulatorAre8Bit()));
-
-	// Shift
-	val <<= 1;
-
-	if (mode == AddressingMode::Accumulator) {
-		A.store(val);
-	} else if (memoryAndAccumulatorAre8Bit()) {
-		store8(addr, val);
-	} else {
-		store16(addr, val);
-	}
-
-	setFlag(flags::z, val == 0);
-	setFlag(flags::n, msb(val, memoryAndAccumulatorAre8Bit()));
-
+	Word result = modifyOperand<MemoryIs8Bit, IndexIs8Bit>(*this, mode, [this](Word val) {
+		// Set carry flag if current left bit is 1
+		setFlag(flags::c, msb(val, MemoryIs8Bit));
+		return static_cast<Word>(val << 1);
+	});
+	setZeroNegFlags<MemoryIs8Bit>(result);
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeBIT(AddressingMode mode) {
-	Word val = loadOperand(mode, memoryAndAccumulatorAre8Bit());
-	setFlag(flags::z, (A & val) == 0);
-	setFlag(flags::n, msb(val, memoryAndAccumulatorAre8Bit()));
-	if (memoryAndAccumulatorAre8Bit()) {
+	Word val = loadOperand<MemoryIs8Bit, IndexIs8Bit>(mode);
+	setFlag(flags::z, (A.load<MemoryIs8Bit>() & val) == 0);
+	setFlag(flags::n, msb(val, MemoryIs8Bit));
+	if constexpr (MemoryIs8Bit) {
 		setFlag(flags::v, ((val & (1u << 6)) != 0));
-	}
-	else {
+	} else {
 		setFlag(flags::v, ((val & (1u << 14)) != 0));
 	}
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeCMP(AddressingMode mode) {
-	Word val = loadOperand(mode, memoryAndAccumulatorAre8Bit());
-	Word temp = A.load() - val;
-	setFlag(flags::z, (A == val));
-	setFlag(flags::c, (A >= val));
-	setFlag(flags::n, msb(temp, memoryAndAccumulatorAre8Bit()));
+	Word val = loadOperand<MemoryIs8Bit, IndexIs8Bit>(mode);
+	Word reg = A.load<MemoryIs8Bit>();
+	Word temp = reg - val;
+	setFlag(flags::z, (reg == val));
+	setFlag(flags::c, (reg >= val));
+	setFlag(flags::n, msb(temp, MemoryIs8Bit));
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeCPX(AddressingMode mode) {
-	Word val = loadOperand(mode, indexRegistersAre8Bit());
-	Word temp = X - val;
-	setFlag(flags::z, (X == val));
-	setFlag(flags::c, (X >= val));
-	setFlag(flags::n, msb(temp, indexRegistersAre8Bit()));
+	Word val = loadOperand<IndexIs8Bit, IndexIs8Bit>(mode);
+	Word reg = X.load<IndexIs8Bit>();
+	Word temp = reg - val;
+	setFlag(flags::z, (reg == val));
+	setFlag(flags::c, (reg >= val));
+	setFlag(flags::n, msb(temp, IndexIs8Bit));
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeCPY(AddressingMode mode) {
-	Word val = loadOperand(mode, indexRegistersAre8Bit());
-	Word temp = Y - val;
-	setFlag(flags::z, (Y == val));
-	setFlag(flags::c, (Y >= val));
-	setFlag(flags::n, msb(temp, indexRegistersAre8Bit()));
+	Word val = loadOperand<IndexIs8Bit, IndexIs8Bit>(mode);
+	Word reg = Y.load<IndexIs8Bit>();
+	Word temp = reg - val;
+	setFlag(flags::z, (reg == val));
+	setFlag(flags::c, (reg >= val));
+	setFlag(flags::n, msb(temp, IndexIs8Bit));
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeDEC(AddressingMode mode) {
-	Address addr = decodeAddress(mode);
-	Word val;
-	if (memoryAndAccumulatorAre8Bit()) {
-		val = load8(addr);
-		val--;
-		store8(addr, lo8(val));
-	}
-	else {
-		val = load16(addr);
-		val--;
-		store16(addr, val);
-	}
-	setFlag(flags::n, msb(val, memoryAndAccumulatorAre8Bit()));
-	setFlag(flags::z, (val == 0));
+	Word result = modifyOperand<MemoryIs8Bit, IndexIs8Bit>(*this, mode, [](Word val) {
+		return static_cast<Word>(val - 1);
+	});
+	setZeroNegFlags<MemoryIs8Bit>(result);
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeEOR(AddressingMode mode) {
-	Word val = loadOperand(mode, memoryAndAccumulatorAre8Bit());
-	A ^= val;
-	setZeroNegFlags(A);
+	Word val = loadOperand<MemoryIs8Bit, IndexIs8Bit>(mode);
+	A.store<MemoryIs8Bit>(A.load<MemoryIs8Bit>() ^ val);
+	setZeroNegFlags<MemoryIs8Bit>(A.load<MemoryIs8Bit>());
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeINC(AddressingMode mode) {
-	Address addr = decodeAddress(mode);
-	Word val;
-	if (memoryAndAccumulatorAre8Bit()) {
-		val = load8(addr);
-		val++;
-		store8(addr, lo8(val));
-	}
-	else {
-		val = load16(addr);
-		val++;
-		store16(addr, val);
-	}
-	setFlag(flags::n, msb(val, memoryAndAccumulatorAre8Bit()));
-	setFlag(flags::z, (val == 0));
+	Word result = modifyOperand<MemoryIs8Bit, IndexIs8Bit>(*this, mode, [](Word val) {
+		return static_cast<Word>(val + 1);
+	});
+	setZeroNegFlags<MemoryIs8Bit>(result);
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeJMP(AddressingMode mode) {
-	Address addr = decodeAddress(mode);
+	Address addr = decodeAddress<IndexIs8Bit>(mode);
 	PC = addr;
 	return 0;
 };
 
+template<bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeJSR(AddressingMode mode) {
-	Address newPC = decodeAddress(mode);
+	Address newPC = decodeAddress<IndexIs8Bit>(mode);
 	// subtract 1 because it's required
 	Word pcToStore = PC - 1;
 
@@ -1328,195 +2066,165 @@ Blaze::Cycles Blaze::CPU::executeJSR(AddressingMode mode) {
 
 	PC = newPC;
 
+	if (callProfiler != nullptr) {
+		// (the stack pointer from before the 2 bytes of the return address were pushed)
+		callProfiler->call(concat24(PBR, PC), SP + 2);
+	}
+
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeLDA(AddressingMode mode) {
-	Word val = loadOperand(mode, memoryAndAccumulatorAre8Bit());
-	A = val;
-	setZeroNegFlags(A);
+	Word val = loadOperand<MemoryIs8Bit, IndexIs8Bit>(mode);
+	A.store<MemoryIs8Bit>(val);
+	setZeroNegFlags<MemoryIs8Bit>(val);
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeLDX(AddressingMode mode) {
-	Word val = loadOperand(mode, indexRegistersAre8Bit());
-	X = val;
-	setZeroNegFlags(X);
+	Word val = loadOperand<IndexIs8Bit, IndexIs8Bit>(mode);
+	X.store<IndexIs8Bit>(val);
+	setZeroNegFlags<IndexIs8Bit>(val);
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeLDY(AddressingMode mode) {
-	Word val = loadOperand(mode, indexRegistersAre8Bit());
-	Y = val;
-	setZeroNegFlags(Y);
+	Word val = loadOperand<IndexIs8Bit, IndexIs8Bit>(mode);
+	Y.store<IndexIs8Bit>(val);
+	setZeroNegFlags<IndexIs8Bit>(val);
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeLSR(AddressingMode mode) {
-	Address addr = decodeAddress(mode);
-	Word data = memoryAndAccumulatorAre8Bit() ? load8(addr) : load16(addr);
-
-	setFlag(flags::c, (data & 0x01) != 0);
-
-	data >>= 1;
-
-	if (memoryAndAccumulatorAre8Bit()) {
-		store8(addr, data);
-	} else {
-		store16(addr, data);
-	}
-
+	Word result = modifyOperand<MemoryIs8Bit, IndexIs8Bit>(*this, mode, [this](Word val) {
+		setFlag(flags::c, (val & 0x01) != 0);
+		return static_cast<Word>(val >> 1);
+	});
+	setZeroNegFlags<MemoryIs8Bit>(result);
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeORA(AddressingMode mode) {
-	Word val = loadOperand(mode, memoryAndAccumulatorAre8Bit());
-	A |= val;
-	setZeroNegFlags(A);
+	Word val = loadOperand<MemoryIs8Bit, IndexIs8Bit>(mode);
+	A.store<MemoryIs8Bit>(A.load<MemoryIs8Bit>() | val);
+	setZeroNegFlags<MemoryIs8Bit>(A.load<MemoryIs8Bit>());
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeROL(AddressingMode mode) {
-	Address addr = decodeAddress(mode);
-	Word data = memoryAndAccumulatorAre8Bit() ? load8(addr) : load16(addr);
-	Byte carry = getCarry();
-
-	//set c to most significant bit of data
-	setFlag(flags::c, msb(data, memoryAndAccumulatorAre8Bit()));
-
-	data = (data << 1) | carry; // shift carry to least significant bit of 'data'
-
-	if (memoryAndAccumulatorAre8Bit()) {
-		store8(addr, data);
-	} else {
-		store16(addr, data);
-	}
+	Word result = modifyOperand<MemoryIs8Bit, IndexIs8Bit>(*this, mode, [this](Word val) {
+		Word carry = getCarry();
+		// set c to most significant bit of the value
+		setFlag(flags::c, msb(val, MemoryIs8Bit));
+		// shift carry into the least significant bit
+		return static_cast<Word>((val << 1) | carry);
+	});
+	setZeroNegFlags<MemoryIs8Bit>(result);
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeROR(AddressingMode mode) {
-	Address addr = decodeAddress(mode);
-	Word data = memoryAndAccumulatorAre8Bit() ? load8(addr) : load16(addr);
-	Byte carry = getCarry();
-
-	setFlag(flags::c, (data & 0x01) != 0);
-
-	data = (data >> 1) | carry;
-
-	if (memoryAndAccumulatorAre8Bit()) {
-		store8(addr, data);
-	} else {
-		store16(addr, data);
-	}
+	Word result = modifyOperand<MemoryIs8Bit, IndexIs8Bit>(*this, mode, [this](Word val) {
+		Word carry = getCarry();
+		setFlag(flags::c, (val & 0x01) != 0);
+		// shift carry into the most significant bit
+		return static_cast<Word>((val >> 1) | (carry << (MemoryIs8Bit ? 7 : 15)));
+	});
+	setZeroNegFlags<MemoryIs8Bit>(result);
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeSBC(AddressingMode mode) {
+	constexpr Address wordMask = MemoryIs8Bit ? 0xff : 0xffff;
+
 	// Fetch initial accumulator
-	Address left = A.load();
+	Address left = A.load<MemoryIs8Bit>();
 
-	// Get and (bitwise) negate the operand
-	Address operand = ~(loadOperand(mode, memoryAndAccumulatorAre8Bit()));
+	// Get and (bitwise) negate the operand (only within the operand width, otherwise we'd always produce a carry)
+	Address operand = ~static_cast<Address>(loadOperand<MemoryIs8Bit, IndexIs8Bit>(mode)) & wordMask;
 
 	// Compute
 	Address result = left + operand + getCarry();
-
-	// Handle different widths
-	Address wordMask = (memoryAndAccumulatorAre8Bit() ? 0xff : 0xffff);
 	Word wordResult = result & wordMask;
 
 	// Update accumulator
-	A = wordResult;
+	A.store<MemoryIs8Bit>(wordResult);
 
 	// Set flags
-	setZeroNegFlags(A);
-	setOverflowFlag(left, operand, wordResult);
+	setZeroNegFlags<MemoryIs8Bit>(wordResult);
+	setOverflowFlag<MemoryIs8Bit>(left, operand, wordResult);
 	setFlag(flags::c, (result & ~wordMask) != 0);
 
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeSTA(AddressingMode mode) {
-	Address address = decodeAddress(mode);
-	if (memoryAndAccumulatorAre8Bit()) {
-		store8(address, A.load());
+	Address addr = decodeAddress<IndexIs8Bit>(mode);
+	if constexpr (MemoryIs8Bit) {
+		store8(addr, static_cast<Byte>(A.load<true>()));
 	} else {
-		store16(address, A.load());
+		store16(addr, A.load<false>());
 	}
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeSTX(AddressingMode mode) {
-	Address addr = decodeAddress(mode);
-
-	// Store the X register's value at the determined address.
-	if (indexRegistersAre8Bit()) {
-		store8(addr, static_cast<Byte>(X.load()));  // Storing only lower 8 bits of X register
+	Address addr = decodeAddress<IndexIs8Bit>(mode);
+	if constexpr (IndexIs8Bit) {
+		store8(addr, static_cast<Byte>(X.load<true>()));
 	} else {
-		store16(addr, X.forceLoadFull()); // Storing full 16 bits of X register
+		store16(addr, X.load<false>());
 	}
-
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeSTY(AddressingMode mode) {
-	Address addr = decodeAddress(mode);
-
-	// Store the Y register's value at the determined address.
-	if (indexRegistersAre8Bit()) {
-		store8(addr, static_cast<Byte>(Y.load()));  // Storing only lower 8 bits of Y register
+	Address addr = decodeAddress<IndexIs8Bit>(mode);
+	if constexpr (IndexIs8Bit) {
+		store8(addr, static_cast<Byte>(Y.load<true>()));
 	} else {
-		store16(addr, Y.forceLoadFull()); // Storing full 16 bits of Y register
+		store16(addr, Y.load<false>());
 	}
-
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeSTZ(AddressingMode mode) {
-	Address addr = decodeAddress(mode);
-
-	if (memoryAndAccumulatorAre8Bit()) {
+	Address addr = decodeAddress<IndexIs8Bit>(mode);
+	if constexpr (MemoryIs8Bit) {
 		store8(addr, 0);
-	}
-	else {
+	} else {
 		store16(addr, 0);
 	}
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTRB(AddressingMode mode) {
-	Address addr = decodeAddress(mode);
-	Word val;
-	if (memoryAndAccumulatorAre8Bit()) {
-		val = load8(addr);
-		setFlag(flags::z, (val & A.load()) == 0);
-		val &= ~A.load();
-		store8(addr, lo8(val));
-	}
-	else {
-		val = load16(addr);
-		setFlag(flags::z, (val & A.load()) == 0);
-		val &= ~A.load();
-		store16(addr, val);
-	}
+	modifyOperand<MemoryIs8Bit, IndexIs8Bit>(*this, mode, [this](Word val) {
+		setFlag(flags::z, (val & A.load<MemoryIs8Bit>()) == 0);
+		return static_cast<Word>(val & ~A.load<MemoryIs8Bit>());
+	});
 	return 0;
 };
 
+template<bool MemoryIs8Bit, bool IndexIs8Bit>
 Blaze::Cycles Blaze::CPU::executeTSB(AddressingMode mode) {
-	Address addr = decodeAddress(mode);
-	Word val;
-	if (memoryAndAccumulatorAre8Bit()) {
-		val = load8(addr);
-		setFlag(flags::z, (val & A.load()) == 0);
-		val |= A.load();
-		store8(addr, lo8(val));
-	}
-	else {
-		val = load16(addr);
-		setFlag(flags::z, (val & A.load()) == 0);
-		val |= A.load();
-		store16(addr, val);
-	}
+	modifyOperand<MemoryIs8Bit, IndexIs8Bit>(*this, mode, [this](Word val) {
+		setFlag(flags::z, (val & A.load<MemoryIs8Bit>()) == 0);
+		return static_cast<Word>(val | A.load<MemoryIs8Bit>());
+	});
 	return 0;
 };
 
@@ -1524,12 +2232,12 @@ Blaze::Cycles Blaze::CPU::executeBRA(ConditionCode condition, bool passCondition
 	// Get the new PC if condition and bit are met
 	Word newPC = decodeAddress(AddressingMode::ProgramCounterRelative);
 	bool bitIsSet = false;
+	bool taken = false;
 
 
 	// No condition passed or condition == NONE -> BRA
 	if (condition == ConditionCode::NONE) {
-		// update PC
-		PC = newPC;
+		taken = true;
 	} else {
 		// Check the correct bit based on 
 		switch (condition) {
@@ -1546,11 +2254,18 @@ Blaze::Cycles Blaze::CPU::executeBRA(ConditionCode condition, bool passCondition
 		// if the bit is set and we want to pass the condition if it's set (i.e. BCS, BEQ, BMI, BVS), OR
 		// the bit is NOT set and we want to pass the condition if it's NOT set (i.e. BCC, BNQ, BPL, BVC),
 		// then we go ahead with the branch and update the PC
-		if ((bitIsSet && passConditionIfBitSet) || (!bitIsSet && !passConditionIfBitSet)) {
-			// update PC
-			PC = newPC;
-		}
+		taken = (bitIsSet && passConditionIfBitSet) || (!bitIsSet && !passConditionIfBitSet);
 	}
 
-	return 0;
+	if (!taken) {
+		return 0;
+	}
+
+	// taking the branch costs an extra cycle, plus another one in emulation mode if it lands in a different page
+	Cycles extraCycles = (usingEmulationMode() && hi8<Word>(newPC, false) != hi8<Word>(PC, false)) ? 2 : 1;
+
+	// update PC
+	PC = newPC;
+
+	return extraCycles;
 };
@@ -0,0 +1,140 @@
+#include <blaze/CallProfiler.hpp>
+#include <blaze/Symbols.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+// the root frame is never popped: no stack pointer can get back up past it
+static constexpr uint32_t ROOT_SP = 0x10000;
+
+static uint64_t childKey(uint32_t parent, Blaze::CallProfiler::FrameKind kind, Blaze::Address entry) {
+	return (static_cast<uint64_t>(parent) << 32) | (static_cast<uint64_t>(kind) << 24) | (entry & 0xffffff);
+};
+
+Blaze::CallProfiler::CallProfiler() {
+	clear();
+};
+
+void Blaze::CallProfiler::clear() {
+	_nodes.clear();
+	_children.clear();
+	_stack.clear();
+	_pending = Pending {};
+	_mismatches = 0;
+
+	_nodes.push_back(Node { 0, FrameKind::Root, 0 });
+	_stack.push_back(StackEntry { 0, ROOT_SP });
+};
+
+void Blaze::CallProfiler::interrupt(FrameKind kind, Address handler, Word sp) {
+	// (there's never anything pending between instructions, but just in case)
+	if (_pending.sp != NO_PENDING) {
+		applyPending();
+	}
+	push(kind, handler, sp);
+};
+
+void Blaze::CallProfiler::applyPending() {
+	Pending pending = std::exchange(_pending, Pending {});
+	if (pending.isCall) {
+		push(FrameKind::Subroutine, pending.target, static_cast<Word>(pending.sp));
+	} else {
+		// a return that goes back past more than one frame means some of them were never returned from
+		size_t popped = unwind(static_cast<Word>(pending.sp));
+		if (popped > 1) {
+			_mismatches += popped - 1;
+		}
+	}
+};
+
+size_t Blaze::CallProfiler::unwind(Word sp) {
+	size_t popped = 0;
+	while (_stack.size() > 1 && _stack.back().sp <= sp) {
+		_stack.pop_back();
+		++popped;
+	}
+	return popped;
+};
+
+void Blaze::CallProfiler::push(FrameKind kind, Address entry, Word sp) {
+	// anything that was called from further up the stack than this is gone (e.g. the stack pointer was reset)
+	_mismatches += unwind(sp);
+
+	if (depth() >= MAX_DEPTH) {
+		++_mismatches;
+		return;
+	}
+
+	uint32_t parent = _stack.back().node;
+	auto [child, inserted] = _children.try_emplace(childKey(parent, kind, entry), static_cast<uint32_t>(_nodes.size()));
+	if (inserted) {
+		_nodes.push_back(Node { parent, kind, entry & 0xffffff });
+	}
+	_stack.push_back(StackEntry { child->second, sp });
+};
+
+uint64_t Blaze::CallProfiler::totalCycles() const {
+	uint64_t total = 0;
+	for (const auto& node : _nodes) {
+		total += node.cycles;
+	}
+	return total;
+};
+
+void Blaze::CallProfiler::writeFolded(std::ostream& stream, const SymbolTable* symbols) const {
+	auto frameName = [&](const Node& node) -> std::string {
+		if (node.kind == FrameKind::Root) {
+			return "(root)";
+		}
+
+		std::string name;
+		if (symbols != nullptr) {
+			name = symbols->name(node.entry);
+		} else {
+			char text[16];
+			std::snprintf(text, sizeof(text), "%02x:%04x", (node.entry >> 16) & 0xff, node.entry & 0xffff);
+			name = text;
+		}
+
+		// ';' separates frames in the output, so it can't be part of a name
+		std::replace(name.begin(), name.end(), ';', '_');
+
+		switch (node.kind) {
+			case FrameKind::IRQ:   return "[irq] " + name;
+			case FrameKind::NMI:   return "[nmi] " + name;
+			case FrameKind::Abort: return "[abort] " + name;
+			default:               return name;
+		}
+	};
+
+	// every node's name is needed once for each of its descendants, so they're only worked out once
+	std::vector<std::string> names;
+	names.reserve(_nodes.size());
+	for (const auto& node : _nodes) {
+		names.push_back(frameName(node));
+	}
+
+	std::vector<uint32_t> path;
+	for (uint32_t index = 0; index < _nodes.size(); ++index) {
+		if (_nodes[index].cycles == 0) {
+			continue;
+		}
+
+		path.clear();
+		for (uint32_t node = index; node != 0; node = _nodes[node].parent) {
+			path.push_back(node);
+		}
+		path.push_back(0);
+
+		std::string line;
+		for (auto node = path.rbegin(); node != path.rend(); ++node) {
+			if (!line.empty()) {
+				line += ';';
+			}
+			line += names[*node];
+		}
+		stream << line << ' ' << _nodes[index].cycles << '\n';
+	}
+};
@@ -0,0 +1,413 @@
+#include <blaze/DMA.hpp>
+#include <blaze/Bus.hpp>
+#include <blaze/SaveState.hpp>
+#include <blaze/util.hpp>
+
+#include <algorithm>
+
+static constexpr Blaze::Address MDMAEN = 0x420b;
+static constexpr Blaze::Address HDMAEN = 0x420c;
+static constexpr Blaze::Address MEMSEL = 0x420d;
+static constexpr Blaze::Address CHANNEL_REGISTERS_START = 0x4300;
+static constexpr Blaze::Address CHANNEL_REGISTERS_END = 0x4380;
+
+// DMAPx bits
+static constexpr Blaze::Byte CONTROL_B_TO_A = 0x80;
+static constexpr Blaze::Byte CONTROL_HDMA_INDIRECT = 0x40;
+static constexpr Blaze::Byte CONTROL_DECREMENT = 0x10;
+static constexpr Blaze::Byte CONTROL_FIXED = 0x08;
+static constexpr Blaze::Byte CONTROL_MODE_MASK = 0x07;
+
+// NTRLx bits
+static constexpr Blaze::Byte LINE_COUNTER_REPEAT = 0x80;
+static constexpr Blaze::Byte LINE_COUNTER_MASK = 0x7f;
+
+// what gets added to the B-bus address for each byte, for each transfer mode. every pattern repeats after 4 bytes.
+static constexpr Blaze::Byte TRANSFER_PATTERNS[8][4] = {
+	{ 0, 0, 0, 0 },
+	{ 0, 1, 0, 1 },
+	{ 0, 0, 0, 0 },
+	{ 0, 0, 1, 1 },
+	{ 0, 1, 2, 3 },
+	{ 0, 1, 0, 1 },
+	{ 0, 0, 0, 0 },
+	{ 0, 0, 1, 1 },
+};
+
+// how many bytes HDMA transfers per line, for each transfer mode
+static constexpr Blaze::Byte TRANSFER_UNIT_SIZES[8] = { 1, 2, 2, 4, 4, 4, 2, 4 };
+
+// fixed-address transfers (e.g. for clearing VRAM) are copied in chunks of this size
+static constexpr size_t FILL_CHUNK_SIZE = 256;
+
+// how far the A-bus address moves after each byte: 1, -1, or 0 (for fixed-address transfers)
+static constexpr int addressStep(Blaze::Byte control) {
+	if ((control & CONTROL_FIXED) != 0) {
+		return 0;
+	}
+	return ((control & CONTROL_DECREMENT) != 0) ? -1 : 1;
+};
+
+Blaze::DMA::DMA(Scheduler& scheduler):
+	_scheduler(scheduler)
+{
+	_hdmaInitEvent = _scheduler.registerEvent([this](MasterCycles scheduledTime) {
+		initHDMA(scheduledTime);
+	});
+	_hdmaLineEvent = _scheduler.registerEvent([this](MasterCycles scheduledTime) {
+		runHDMALine(scheduledTime);
+	});
+};
+
+void Blaze::DMA::reset(Bus* bus) {
+	_bus = bus;
+
+	// the channel registers keep their values across resets; only the enables are cleared
+	hdmaEnable = 0;
+	for (auto& channel: channels) {
+		channel.hdmaActive = false;
+		channel.hdmaDoTransfer = false;
+	}
+
+	_scheduler.cancel(_hdmaInitEvent);
+	_scheduler.cancel(_hdmaLineEvent);
+};
+
+Blaze::Cycles Blaze::DMA::start(Byte channelMask) {
+	Cycles cycles = 0;
+
+	// the channels run one after the other, lowest first
+	for (size_t index = 0; index < CHANNEL_COUNT; ++index) {
+		if ((channelMask & (1u << index)) != 0) {
+			cycles += runChannel(channels[index]);
+		}
+	}
+
+	if (cycles > 0) {
+		cycles += DMA_OVERHEAD;
+		_bus->cpu.stall(cycles);
+	}
+
+	return cycles;
+};
+
+Blaze::Cycles Blaze::DMA::runChannel(Channel& channel) {
+	// a count of 0 means 64 KiB
+	size_t size = (channel.count == 0) ? 0x10000 : channel.count;
+	const Byte* pattern = TRANSFER_PATTERNS[channel.control & CONTROL_MODE_MASK];
+	int step = addressStep(channel.control);
+
+	size_t transferred = 0;
+	while (transferred < size) {
+		size_t copied = transferBlock(channel, size - transferred, transferred);
+		if (copied > 0) {
+			transferred += copied;
+			continue;
+		}
+
+		transferByte(channel, concat24(channel.aBank, channel.aAddress), pattern[transferred % 4]);
+		// the address wraps around within the bank
+		channel.aAddress = static_cast<Word>(channel.aAddress + step);
+		++transferred;
+	}
+
+	channel.count = 0;
+
+	return DMA_CHANNEL_OVERHEAD + static_cast<Cycles>(size) * CYCLES_PER_BYTE;
+};
+
+size_t Blaze::DMA::transferBlock(Channel& channel, size_t remaining, size_t transferred) {
+	Byte mode = channel.control & CONTROL_MODE_MASK;
+	int step = addressStep(channel.control);
+
+	// the common cases: writing to a single register (e.g. CGRAM or WRAM), or to a pair of them (e.g. VRAM), from memory
+	// that's read forwards (or from a fixed address, for fills)
+	bool single = mode == 0 || mode == 2 || mode == 6;
+	bool alternating = mode == 1 || mode == 5;
+	if ((channel.control & CONTROL_B_TO_A) != 0 || step < 0 || !(single || alternating)) {
+		return 0;
+	}
+
+	// block writes to a pair of registers always start with the first one
+	if (alternating && (transferred % 2) != 0) {
+		return 0;
+	}
+
+	const auto& page = _bus->pageForAddress(concat24(channel.aBank, channel.aAddress));
+	if (page.directRead == nullptr) {
+		return 0;
+	}
+	Address pageOffset = channel.aAddress & Bus::PAGE_OFFSET_MASK;
+
+	const Byte* data = nullptr;
+	size_t size = 0;
+	std::array<Byte, FILL_CHUNK_SIZE> fill;
+	if (step == 0) {
+		fill.fill(page.directRead[pageOffset]);
+		data = fill.data();
+		size = std::min(remaining, fill.size());
+	} else {
+		// pages never cross a bank boundary, so stopping at the end of the page also takes care of the address wrapping around
+		data = page.directRead + pageOffset;
+		size = std::min<size_t>(remaining, Bus::PAGE_SIZE - pageOffset);
+	}
+
+	if (alternating) {
+		// an odd byte at the end is left for `transferByte`
+		size &= ~static_cast<size_t>(1);
+	}
+
+	if (size == 0 || !_bus->bBus.writeBlock(channel.bAddress, alternating, data, size)) {
+		return 0;
+	}
+
+	channel.aAddress = static_cast<Word>(channel.aAddress + step * static_cast<int>(size));
+	_bus->openBus = data[size - 1];
+	return size;
+};
+
+void Blaze::DMA::transferByte(Channel& channel, Address aAddress, Byte offset) {
+	Byte bAddress = static_cast<Byte>(channel.bAddress + offset);
+	if ((channel.control & CONTROL_B_TO_A) != 0) {
+		_bus->write(aAddress, _bus->bBus.read(bAddress));
+	} else {
+		_bus->bBus.write(bAddress, _bus->read8(aAddress));
+	}
+};
+
+void Blaze::DMA::scheduleHDMAInit() {
+	if (_scheduler.isPending(_hdmaInitEvent)) {
+		return;
+	}
+
+	MasterCycles now = _scheduler.now();
+	MasterCycles time = now - (now % MASTER_CYCLES_PER_FRAME) + HDMA_INIT_TIME;
+	if (time < now) {
+		// it's too late for this frame
+		time += MASTER_CYCLES_PER_FRAME;
+	}
+	_scheduler.schedule(_hdmaInitEvent, time);
+};
+
+void Blaze::DMA::initHDMA(MasterCycles scheduledTime) {
+	if (hdmaEnable == 0) {
+		// HDMA was turned off, so this stops until it's turned on again
+		return;
+	}
+
+	Cycles cycles = HDMA_OVERHEAD;
+	for (size_t index = 0; index < CHANNEL_COUNT; ++index) {
+		auto& channel = channels[index];
+		channel.hdmaActive = (hdmaEnable & (1u << index)) != 0;
+		if (!channel.hdmaActive) {
+			continue;
+		}
+
+		channel.tableAddress = channel.aAddress;
+		cycles += HDMA_CHANNEL_OVERHEAD + loadHDMAEntry(channel);
+	}
+	_bus->cpu.stall(cycles);
+
+	MasterCycles frameStart = scheduledTime - HDMA_INIT_TIME;
+	_scheduler.cancel(_hdmaLineEvent);
+	_scheduler.schedule(_hdmaLineEvent, frameStart + HDMA_LINE_TIME);
+	_scheduler.schedule(_hdmaInitEvent, frameStart + MASTER_CYCLES_PER_FRAME + HDMA_INIT_TIME);
+};
+
+void Blaze::DMA::runHDMALine(MasterCycles scheduledTime) {
+	Cycles cycles = 0;
+
+	for (size_t index = 0; index < CHANNEL_COUNT; ++index) {
+		auto& channel = channels[index];
+		if ((hdmaEnable & (1u << index)) == 0 || !channel.hdmaActive) {
+			continue;
+		}
+
+		cycles += HDMA_CHANNEL_OVERHEAD;
+
+		if (channel.hdmaDoTransfer) {
+			Byte mode = channel.control & CONTROL_MODE_MASK;
+			bool indirect = (channel.control & CONTROL_HDMA_INDIRECT) != 0;
+			for (Byte i = 0; i < TRANSFER_UNIT_SIZES[mode]; ++i) {
+				// the data comes from the table itself, or from wherever its current entry points to
+				Address aAddress = indirect ? concat24(channel.indirectBank, channel.count++) : concat24(channel.aBank, channel.tableAddress++);
+				transferByte(channel, aAddress, TRANSFER_PATTERNS[mode][i]);
+			}
+			cycles += TRANSFER_UNIT_SIZES[mode] * CYCLES_PER_BYTE;
+		}
+
+		--channel.lineCounter;
+
+		// in repeat mode, the channel transfers on every line of the entry (instead of just the first one)
+		channel.hdmaDoTransfer = (channel.lineCounter & LINE_COUNTER_REPEAT) != 0;
+		if ((channel.lineCounter & LINE_COUNTER_MASK) == 0) {
+			cycles += loadHDMAEntry(channel);
+		}
+	}
+
+	if (cycles == 0) {
+		// every channel is done (or disabled), so there's nothing left to do this frame
+		return;
+	}
+
+	_bus->cpu.stall(cycles + HDMA_OVERHEAD);
+
+	MasterCycles line = (scheduledTime % MASTER_CYCLES_PER_FRAME) / MASTER_CYCLES_PER_SCANLINE;
+	if (line < HDMA_LAST_LINE) {
+		_scheduler.schedule(_hdmaLineEvent, scheduledTime + MASTER_CYCLES_PER_SCANLINE);
+	}
+};
+
+Blaze::Cycles Blaze::DMA::loadHDMAEntry(Channel& channel) {
+	channel.lineCounter = _bus->read8(concat24(channel.aBank, channel.tableAddress++));
+	Cycles cycles = CYCLES_PER_BYTE;
+
+	if (channel.lineCounter == 0) {
+		// the end of the table
+		channel.hdmaActive = false;
+		channel.hdmaDoTransfer = false;
+		return cycles;
+	}
+
+	if ((channel.control & CONTROL_HDMA_INDIRECT) != 0) {
+		Byte low = _bus->read8(concat24(channel.aBank, channel.tableAddress++));
+		Byte high = _bus->read8(concat24(channel.aBank, channel.tableAddress++));
+		channel.count = concat16(high, low);
+		cycles += 2 * CYCLES_PER_BYTE;
+	}
+
+	// the first line of an entry always transfers
+	channel.hdmaDoTransfer = true;
+	return cycles;
+};
+
+Blaze::Byte Blaze::DMA::read8(Address offset) {
+	if (offset >= CHANNEL_REGISTERS_START && offset < CHANNEL_REGISTERS_END) {
+		const auto& channel = channels[(offset >> 4) & 0x7];
+		switch (offset & 0xf) {
+			case 0x0: return channel.control;
+			case 0x1: return channel.bAddress;
+			case 0x2: return lo8(channel.aAddress);
+			case 0x3: return static_cast<Byte>(channel.aAddress >> 8);
+			case 0x4: return channel.aBank;
+			case 0x5: return lo8(channel.count);
+			case 0x6: return static_cast<Byte>(channel.count >> 8);
+			case 0x7: return channel.indirectBank;
+			case 0x8: return lo8(channel.tableAddress);
+			case 0x9: return static_cast<Byte>(channel.tableAddress >> 8);
+			case 0xa: return channel.lineCounter;
+			case 0xb:
+			case 0xf: return channel.unused;
+			default: break;
+		}
+	}
+
+	// MDMAEN, HDMAEN, and MEMSEL are write-only
+	return _bus->unmappedRead(offset);
+};
+
+Blaze::Word Blaze::DMA::read16(Address offset) {
+	Byte low = read8(offset);
+	return concat16(read8(offset + 1), low);
+};
+
+Blaze::Address Blaze::DMA::read24(Address offset) {
+	Byte low = read8(offset);
+	Byte middle = read8(offset + 1);
+	return concat24(read8(offset + 2), middle, low);
+};
+
+void Blaze::DMA::write8(Address offset, Byte value) {
+	if (offset == MDMAEN) {
+		start(value);
+		return;
+	}
+
+	if (offset == HDMAEN) {
+		hdmaEnable = value;
+		if (hdmaEnable != 0) {
+			scheduleHDMAInit();
+		}
+		return;
+	}
+
+	// (this isn't a DMA register, but it's the only other one in the page that's implemented, so it's handled here)
+	if (offset == MEMSEL) {
+		_bus->setFastROM((value & 0x01) != 0);
+		return;
+	}
+
+	if (offset >= CHANNEL_REGISTERS_START && offset < CHANNEL_REGISTERS_END) {
+		auto& channel = channels[(offset >> 4) & 0x7];
+		switch (offset & 0xf) {
+			case 0x0: channel.control = value; return;
+			case 0x1: channel.bAddress = value; return;
+			case 0x2: channel.aAddress = concat16(static_cast<Byte>(channel.aAddress >> 8), value); return;
+			case 0x3: channel.aAddress = concat16(value, lo8(channel.aAddress)); return;
+			case 0x4: channel.aBank = value; return;
+			case 0x5: channel.count = concat16(static_cast<Byte>(channel.count >> 8), value); return;
+			case 0x6: channel.count = concat16(value, lo8(channel.count)); return;
+			case 0x7: channel.indirectBank = value; return;
+			case 0x8: channel.tableAddress = concat16(static_cast<Byte>(channel.tableAddress >> 8), value); return;
+			case 0x9: channel.tableAddress = concat16(value, lo8(channel.tableAddress)); return;
+			case 0xa: channel.lineCounter = value; return;
+			case 0xb:
+			case 0xf: channel.unused = value; return;
+			default: break;
+		}
+	}
+
+	_bus->unmappedWrite(offset);
+};
+
+void Blaze::DMA::write16(Address offset, Word value) {
+	Byte high = 0;
+	Byte low = 0;
+	split16(value, high, low);
+	write8(offset, low);
+	write8(offset + 1, high);
+};
+
+void Blaze::DMA::write24(Address offset, Address value) {
+	Byte high = 0;
+	Byte middle = 0;
+	Byte low = 0;
+	split24(value, high, middle, low);
+	write8(offset, low);
+	write8(offset + 1, middle);
+	write8(offset + 2, high);
+};
+
+void Blaze::DMA::saveState(StateWriter& writer) const {
+	for (const auto& channel: channels) {
+		writer.write(channel.control);
+		writer.write(channel.bAddress);
+		writer.write(channel.aAddress);
+		writer.write(channel.aBank);
+		writer.write(channel.count);
+		writer.write(channel.indirectBank);
+		writer.write(channel.tableAddress);
+		writer.write(channel.lineCounter);
+		writer.write(channel.unused);
+		writer.write(static_cast<Byte>(channel.hdmaActive));
+		writer.write(static_cast<Byte>(channel.hdmaDoTransfer));
+	}
+	writer.write(hdmaEnable);
+};
+
+void Blaze::DMA::loadState(StateReader& reader) {
+	for (auto& channel: channels) {
+		channel.control = reader.read<Byte>();
+		channel.bAddress = reader.read<Byte>();
+		channel.aAddress = reader.read<Word>();
+		channel.aBank = reader.read<Byte>();
+		channel.count = reader.read<Word>();
+		channel.indirectBank = reader.read<Byte>();
+		channel.tableAddress = reader.read<Word>();
+		channel.lineCounter = reader.read<Byte>();
+		channel.unused = reader.read<Byte>();
+		channel.hdmaActive = reader.read<Byte>() != 0;
+		channel.hdmaDoTransfer = reader.read<Byte>() != 0;
+	}
+	hdmaEnable = reader.read<Byte>();
+};
@@ -0,0 +1,590 @@
+#include <blaze/DSP.hpp>
+#include <blaze/SaveState.hpp>
+
+#include <algorithm>
+
+// FLG bits
+static constexpr Blaze::Byte FLG_RESET = 0x80;
+static constexpr Blaze::Byte FLG_MUTE = 0x40;
+static constexpr Blaze::Byte FLG_ECHO_DISABLE = 0x20;
+static constexpr Blaze::Byte FLG_NOISE_RATE_MASK = 0x1f;
+
+// BRR block header bits
+static constexpr Blaze::Byte BRR_END = 0x01;
+static constexpr Blaze::Byte BRR_LOOP = 0x02;
+static constexpr size_t BRR_BLOCK_SIZE = 9;
+
+// ADSR1 bits
+static constexpr Blaze::Byte ADSR_ENABLE = 0x80;
+
+static constexpr int ENVELOPE_MAX = 0x7ff;
+
+// how many samples apart the steps for each of the 32 rates (used by the envelopes and the noise generator) are, and
+// where in the global counter's cycle they happen. rate 0 never steps.
+static constexpr uint16_t COUNTER_RANGE = 2048 * 5 * 3;
+static constexpr uint16_t COUNTER_PERIODS[32] = {
+	COUNTER_RANGE + 1, 2048, 1536, 1280, 1024, 768, 640, 512,
+	384, 320, 256, 192, 160, 128, 96, 80,
+	64, 48, 40, 32, 24, 20, 16, 12,
+	10, 8, 6, 5, 4, 3, 2, 1,
+};
+static constexpr uint16_t COUNTER_OFFSETS[32] = {
+	1, 0, 1040, 536, 0, 1040, 536, 0,
+	1040, 536, 0, 1040, 536, 0, 1040, 536,
+	0, 1040, 536, 0, 1040, 536, 0, 1040,
+	536, 0, 1040, 536, 0, 1040, 0, 0,
+};
+
+// the weights the 4-point Gaussian interpolation gives each sample, as they are in the chip's ROM: the newest sample
+// gets `GAUSS_TABLE[f]`, then `GAUSS_TABLE[256 + f]`, `GAUSS_TABLE[511 - f]`, and the oldest `GAUSS_TABLE[255 - f]`,
+// where `f` is the 8-bit fraction of the position between the middle two. (each set of four adds up to 2047 to 2049.)
+static constexpr int16_t GAUSS_TABLE[512] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2,
+	2, 2, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 5, 5, 5, 5,
+	6, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 10,
+	11, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15, 15, 16, 16, 17, 17,
+	18, 19, 19, 20, 20, 21, 21, 22, 23, 23, 24, 24, 25, 26, 27, 27,
+	28, 29, 29, 30, 31, 32, 32, 33, 34, 35, 36, 36, 37, 38, 39, 40,
+	41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56,
+	58, 59, 60, 61, 62, 64, 65, 66, 67, 69, 70, 71, 73, 74, 76, 77,
+	78, 80, 81, 83, 84, 86, 87, 89, 90, 92, 94, 95, 97, 99, 100, 102,
+	104, 106, 107, 109, 111, 113, 115, 117, 118, 120, 122, 124, 126, 128, 130, 132,
+	134, 137, 139, 141, 143, 145, 147, 150, 152, 154, 156, 159, 161, 163, 166, 168,
+	171, 173, 175, 178, 180, 183, 186, 188, 191, 193, 196, 199, 201, 204, 207, 210,
+	212, 215, 218, 221, 224, 227, 230, 233, 236, 239, 242, 245, 248, 251, 254, 257,
+	260, 263, 267, 270, 273, 276, 280, 283, 286, 290, 293, 297, 300, 304, 307, 311,
+	314, 318, 321, 325, 328, 332, 336, 339, 343, 347, 351, 354, 358, 362, 366, 370,
+	374, 378, 381, 385, 389, 393, 397, 401, 405, 410, 414, 418, 422, 426, 430, 434,
+	439, 443, 447, 451, 456, 460, 464, 469, 473, 477, 482, 486, 491, 495, 499, 504,
+	508, 513, 517, 522, 527, 531, 536, 540, 545, 550, 554, 559, 563, 568, 573, 577,
+	582, 587, 592, 596, 601, 606, 611, 615, 620, 625, 630, 635, 640, 644, 649, 654,
+	659, 664, 669, 674, 678, 683, 688, 693, 698, 703, 708, 713, 718, 723, 728, 732,
+	737, 742, 747, 752, 757, 762, 767, 772, 777, 782, 787, 792, 797, 802, 806, 811,
+	816, 821, 826, 831, 836, 841, 846, 851, 855, 860, 865, 870, 875, 880, 884, 889,
+	894, 899, 904, 908, 913, 918, 923, 927, 932, 937, 941, 946, 951, 955, 960, 965,
+	969, 974, 978, 983, 988, 992, 997, 1001, 1005, 1010, 1014, 1019, 1023, 1027, 1032, 1036,
+	1040, 1045, 1049, 1053, 1057, 1061, 1066, 1070, 1074, 1078, 1082, 1086, 1090, 1094, 1098, 1102,
+	1106, 1109, 1113, 1117, 1121, 1125, 1128, 1132, 1136, 1139, 1143, 1146, 1150, 1153, 1157, 1160,
+	1164, 1167, 1170, 1174, 1177, 1180, 1183, 1186, 1190, 1193, 1196, 1199, 1202, 1205, 1207, 1210,
+	1213, 1216, 1219, 1221, 1224, 1227, 1229, 1232, 1234, 1237, 1239, 1241, 1244, 1246, 1248, 1251,
+	1253, 1255, 1257, 1259, 1261, 1263, 1265, 1267, 1269, 1270, 1272, 1274, 1275, 1277, 1279, 1280,
+	1282, 1283, 1284, 1286, 1287, 1288, 1290, 1291, 1292, 1293, 1294, 1295, 1296, 1297, 1297, 1298,
+	1299, 1300, 1300, 1301, 1302, 1302, 1303, 1303, 1303, 1304, 1304, 1304, 1304, 1304, 1305, 1305,
+};
+
+static int clamp16(int value) {
+	return std::clamp(value, -0x8000, 0x7fff);
+};
+
+using Vector = Blaze::simd::I32Vector;
+
+// all ones in the lanes of the voices whose bits are set in `bits`
+static Vector voiceMask(Blaze::Byte bits) {
+	alignas(Blaze::simd::ALIGNMENT) static constexpr int32_t VOICE_BITS[Blaze::DSP::VOICE_COUNT] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+	Vector voiceBits = Vector::load(VOICE_BITS);
+	return Vector::equal(Vector::broadcast(bits) & voiceBits, voiceBits);
+};
+
+// decodes the BRR block at the given address, given the two samples before it
+static void decodeBRR(const Blaze::Byte* aram, Blaze::Word address, int previous1, int previous2, std::array<int16_t, 16>& out) {
+	Blaze::Byte header = aram[address];
+	unsigned shift = header >> 4;
+	unsigned filter = (header >> 2) & 0x03;
+
+	for (unsigned i = 0; i < out.size(); ++i) {
+		Blaze::Byte data = aram[static_cast<Blaze::Word>(address + 1 + i / 2)];
+		int nibble = ((i & 1) != 0) ? (data & 0x0f) : (data >> 4);
+		nibble = (nibble ^ 8) - 8;
+
+		// (shifts past 12 are invalid, and only keep the sign)
+		int sample = (shift <= 12) ? ((nibble << shift) >> 1) : (nibble < 0 ? -2048 : 0);
+
+		// the samples we keep are doubled, so these halve them again
+		int p1 = previous1;
+		int p2 = previous2 >> 1;
+		switch (filter) {
+			case 1:
+				// p1 * 15/16
+				sample += p1 >> 1;
+				sample += (-p1) >> 5;
+				break;
+			case 2:
+				// p1 * 61/32 - p2 * 15/16
+				sample += p1;
+				sample -= p2;
+				sample += p2 >> 4;
+				sample += (p1 * -3) >> 6;
+				break;
+			case 3:
+				// p1 * 115/64 - p2 * 13/16
+				sample += p1;
+				sample -= p2;
+				sample += (p1 * -13) >> 7;
+				sample += (p2 * 3) >> 4;
+				break;
+		}
+
+		sample = static_cast<int16_t>(clamp16(sample) * 2);
+		out[i] = static_cast<int16_t>(sample);
+		previous2 = previous1;
+		previous1 = sample;
+	}
+};
+
+Blaze::DSP::DSP(Byte* aram):
+	_aram(aram)
+{
+	reset();
+};
+
+void Blaze::DSP::reset() {
+	registers.fill(0);
+	// (the chip comes up muted, with everything keyed off and the echo buffer write-protected)
+	registers[FLG] = FLG_RESET | FLG_MUTE | FLG_ECHO_DISABLE;
+
+	_blockAddress.fill(0);
+	_block.fill({});
+	_blockIndex.fill(0);
+	for (auto& samples: _samples) {
+		samples.fill(0);
+	}
+	_position.fill(0);
+	_envelopeMode.fill(EnvelopeMode::Release);
+	_envelope.fill(0);
+	_hiddenEnvelope.fill(0);
+	_output.fill(0);
+	clearBlockCache();
+
+	_keyOn = 0;
+	_counter = 0;
+	_noise = 0x4000;
+	_echoOffset = 0;
+	for (auto& history: _echoHistory) {
+		history.fill(0);
+	}
+	_echoHistoryPosition = 0;
+};
+
+void Blaze::DSP::write(Byte address, Byte value) {
+	address &= REGISTER_COUNT - 1;
+
+	switch (address) {
+		case ENDX:
+			// writing any value clears all of the flags
+			registers[ENDX] = 0;
+			return;
+
+		case KON:
+			_keyOn |= value;
+			break;
+	}
+
+	registers[address] = value;
+};
+
+bool Blaze::DSP::rateTicks(unsigned rate) const {
+	return (_counter + COUNTER_OFFSETS[rate]) % COUNTER_PERIODS[rate] == 0;
+};
+
+//=== Voices ===
+
+void Blaze::DSP::keyOn(unsigned index) {
+	Word entry = static_cast<Word>((registers[DIR] << 8) + voiceRegister(index, SRCN) * 4);
+	_blockAddress[index] = static_cast<Word>(_aram[entry] | (_aram[static_cast<Word>(entry + 1)] << 8));
+	_block[index].fill(0);
+	_blockIndex[index] = 0;
+	decodeBlock(index);
+
+	for (auto& samples: _samples) {
+		samples[index] = 0;
+	}
+	_position[index] = 0;
+	_envelopeMode[index] = EnvelopeMode::Attack;
+	_envelope[index] = 0;
+	_hiddenEnvelope[index] = 0;
+
+	registers[ENDX] &= ~(1 << index);
+};
+
+void Blaze::DSP::decodeBlock(unsigned index) {
+	Word address = _blockAddress[index];
+	auto& block = _block[index];
+
+	// the filters work on the samples before this one (which may be from the previous block)
+	int16_t previous1 = block[15];
+	int16_t previous2 = block[14];
+
+	const std::array<uint32_t, 2> versions = {
+		_lineVersions[address >> ARAM_LINE_BITS],
+		_lineVersions[static_cast<Word>(address + BRR_BLOCK_SIZE - 1) >> ARAM_LINE_BITS],
+	};
+
+	CachedBlock& cached = _blockCache[address % BLOCK_CACHE_SIZE];
+	if (
+		!cached.valid ||
+		cached.address != address ||
+		cached.previous1 != previous1 ||
+		cached.previous2 != previous2 ||
+		cached.versions != versions
+	) {
+		cached.valid = true;
+		cached.address = address;
+		cached.previous1 = previous1;
+		cached.previous2 = previous2;
+		cached.versions = versions;
+		decodeBRR(_aram, address, previous1, previous2, cached.samples);
+	}
+
+	block = cached.samples;
+};
+
+void Blaze::DSP::clearBlockCache() {
+	for (CachedBlock& cached: _blockCache) {
+		cached.valid = false;
+	}
+};
+
+void Blaze::DSP::advanceSample(unsigned index) {
+	_samples[0][index] = _samples[1][index];
+	_samples[1][index] = _samples[2][index];
+	_samples[2][index] = _samples[3][index];
+	_samples[3][index] = _block[index][_blockIndex[index]];
+
+	if (++_blockIndex[index] < _block[index].size()) {
+		return;
+	}
+
+	// on to the next block
+	_blockIndex[index] = 0;
+	Byte header = _aram[_blockAddress[index]];
+	if ((header & BRR_END) != 0) {
+		registers[ENDX] |= 1 << index;
+
+		Word entry = static_cast<Word>((registers[DIR] << 8) + voiceRegister(index, SRCN) * 4 + 2);
+		_blockAddress[index] = static_cast<Word>(_aram[entry] | (_aram[static_cast<Word>(entry + 1)] << 8));
+
+		if ((header & BRR_LOOP) == 0) {
+			// (it keeps going from the loop point, but silently)
+			_envelopeMode[index] = EnvelopeMode::Release;
+			_envelope[index] = 0;
+		}
+	} else {
+		_blockAddress[index] = static_cast<Word>(_blockAddress[index] + BRR_BLOCK_SIZE);
+	}
+	decodeBlock(index);
+};
+
+void Blaze::DSP::runEnvelope(unsigned index) {
+	int envelope = _envelope[index];
+	if (_envelopeMode[index] == EnvelopeMode::Release) {
+		envelope -= 0x8;
+		_envelope[index] = std::max(envelope, 0);
+		return;
+	}
+
+	Byte adsr1 = voiceRegister(index, ADSR1);
+	Byte adsr2 = voiceRegister(index, ADSR2);
+	// (the sustain level is in the top 3 bits of whichever register drives the envelope)
+	Byte envelopeData = adsr2;
+	unsigned rate = 0;
+
+	if ((adsr1 & ADSR_ENABLE) != 0) {
+		if (_envelopeMode[index] == EnvelopeMode::Attack) {
+			rate = (adsr1 & 0x0f) * 2 + 1;
+			envelope += (rate < 31) ? 0x20 : 0x400;
+		} else {
+			// exponential decrease
+			envelope -= 1;
+			envelope -= envelope >> 8;
+			rate = (_envelopeMode[index] == EnvelopeMode::Decay) ? (((adsr1 >> 3) & 0x0e) + 0x10) : (adsr2 & 0x1f);
+		}
+	} else {
+		Byte gain = voiceRegister(index, GAIN);
+		envelopeData = gain;
+		unsigned mode = gain >> 5;
+		if (mode < 4) {
+			// direct
+			envelope = gain * 0x10;
+			rate = 31;
+		} else {
+			rate = gain & 0x1f;
+			if (mode == 4) {
+				// linear decrease
+				envelope -= 0x20;
+			} else if (mode == 5) {
+				// exponential decrease
+				envelope -= 1;
+				envelope -= envelope >> 8;
+			} else {
+				// linear increase, or bent line (which slows down past 3/4)
+				envelope += 0x20;
+				if (mode == 7 && _hiddenEnvelope[index] >= 0x600) {
+					envelope += 0x8 - 0x20;
+				}
+			}
+		}
+	}
+
+	if (_envelopeMode[index] == EnvelopeMode::Decay && (envelope >> 8) == (envelopeData >> 5)) {
+		_envelopeMode[index] = EnvelopeMode::Sustain;
+	}
+
+	_hiddenEnvelope[index] = static_cast<int16_t>(envelope);
+
+	if (envelope < 0 || envelope > ENVELOPE_MAX) {
+		envelope = (envelope < 0) ? 0 : ENVELOPE_MAX;
+		if (_envelopeMode[index] == EnvelopeMode::Attack) {
+			_envelopeMode[index] = EnvelopeMode::Decay;
+		}
+	}
+
+	if (rateTicks(rate)) {
+		_envelope[index] = envelope;
+	}
+};
+
+void Blaze::DSP::runVoiceOutputs() {
+	// (the table lookups can't be done a vector at a time without AVX2's gathers)
+	alignas(simd::ALIGNMENT) std::array<PerVoice<int32_t>, 4> weights;
+	for (unsigned index = 0; index < VOICE_COUNT; ++index) {
+		unsigned fraction = (_position[index] >> 4) & 0xff;
+		weights[0][index] = GAUSS_TABLE[255 - fraction];
+		weights[1][index] = GAUSS_TABLE[511 - fraction];
+		weights[2][index] = GAUSS_TABLE[256 + fraction];
+		weights[3][index] = GAUSS_TABLE[fraction];
+	}
+
+	// the 4-point Gaussian interpolation (the first three products wrap around instead of clamping)
+	Vector output = Vector::multiply16(Vector::load(weights[0].data()), Vector::load(_samples[0].data())).shiftRight<11>();
+	output = output + Vector::multiply16(Vector::load(weights[1].data()), Vector::load(_samples[1].data())).shiftRight<11>();
+	output = output + Vector::multiply16(Vector::load(weights[2].data()), Vector::load(_samples[2].data())).shiftRight<11>();
+	output = output.wrap16();
+	output = output + Vector::multiply16(Vector::load(weights[3].data()), Vector::load(_samples[3].data())).shiftRight<11>();
+	output = output.clamp16() & Vector::broadcast(~1);
+
+	// voices with noise turned on play that instead
+	Vector noise = Vector::broadcast(static_cast<int16_t>(_noise << 1));
+	output = Vector::select(voiceMask(registers[NON]), noise, output);
+
+	// then the envelope
+	output = Vector::multiply16(output, Vector::load(_envelope.data())).shiftRight<11>() & Vector::broadcast(~1);
+	output.store(_output.data());
+
+	for (unsigned index = 0; index < VOICE_COUNT; ++index) {
+		registers[(index << 4) | OUTX] = static_cast<Byte>(_output[index] >> 8);
+		registers[(index << 4) | ENVX] = static_cast<Byte>(_envelope[index] >> 4);
+	}
+};
+
+//=== Mixing ===
+
+void Blaze::DSP::runEcho(int mainLeft, int mainRight, int echoLeft, int echoRight, int16_t& outLeft, int16_t& outRight) {
+	Word address = static_cast<Word>((registers[ESA] << 8) + _echoOffset);
+
+	// read the oldest samples in the buffer into the filter
+	for (unsigned channel = 0; channel < 2; ++channel) {
+		Word sampleAddress = static_cast<Word>(address + channel * 2);
+		auto sample = static_cast<int16_t>(_aram[sampleAddress] | (_aram[static_cast<Word>(sampleAddress + 1)] << 8));
+		_echoHistory[channel][_echoHistoryPosition] = sample >> 1;
+		_echoHistory[channel][_echoHistoryPosition + 8] = sample >> 1;
+	}
+	_echoHistoryPosition = (_echoHistoryPosition + 1) & 7;
+
+	alignas(simd::ALIGNMENT) std::array<int32_t, 8> coefficients;
+	for (unsigned tap = 0; tap < coefficients.size(); ++tap) {
+		coefficients[tap] = static_cast<int8_t>(registers[(tap << 4) | FIR]);
+	}
+	Vector coefficientVector = Vector::load(coefficients.data());
+
+	const int main[2] = { mainLeft, mainRight };
+	const int input[2] = { echoLeft, echoRight };
+	const Byte mainVolume[2] = { MVOLL, MVOLR };
+	const Byte echoVolume[2] = { EVOLL, EVOLR };
+	int16_t* const output[2] = { &outLeft, &outRight };
+	bool writeEcho = (registers[FLG] & FLG_ECHO_DISABLE) == 0;
+
+	for (unsigned channel = 0; channel < 2; ++channel) {
+		// the oldest sample gets the first coefficient
+		alignas(simd::ALIGNMENT) std::array<int32_t, 8> taps;
+		Vector history = Vector::load(&_echoHistory[channel][_echoHistoryPosition]);
+		Vector::multiply16(history, coefficientVector).shiftRight<6>().store(taps.data());
+
+		// (the first 7 taps wrap around instead of clamping)
+		int filtered = 0;
+		for (unsigned tap = 0; tap < 7; ++tap) {
+			filtered += taps[tap];
+		}
+		filtered = static_cast<int16_t>(filtered);
+		filtered += taps[7];
+		filtered = clamp16(filtered) & ~1;
+
+		int mixed = ((main[channel] * static_cast<int8_t>(registers[mainVolume[channel]])) >> 7)
+			+ ((filtered * static_cast<int8_t>(registers[echoVolume[channel]])) >> 7);
+		*output[channel] = static_cast<int16_t>(clamp16(mixed));
+
+		if (writeEcho) {
+			int feedback = clamp16(input[channel] + ((filtered * static_cast<int8_t>(registers[EFB])) >> 7)) & ~1;
+			Word sampleAddress = static_cast<Word>(address + channel * 2);
+			_aram[sampleAddress] = static_cast<Byte>(feedback);
+			_aram[static_cast<Word>(sampleAddress + 1)] = static_cast<Byte>(feedback >> 8);
+			// (samples can be played from the echo buffer, too)
+			aramWritten(sampleAddress);
+			aramWritten(static_cast<Word>(sampleAddress + 1));
+		}
+	}
+
+	// EDL is in units of 2 KiB (or 4 bytes when it's 0)
+	unsigned length = (registers[EDL] & 0x0f) * 0x800;
+	_echoOffset = static_cast<uint16_t>(_echoOffset + 4);
+	if (_echoOffset >= std::max(length, 4u)) {
+		_echoOffset = 0;
+	}
+};
+
+void Blaze::DSP::runSample(int16_t& outLeft, int16_t& outRight) {
+	_counter = (_counter == 0) ? COUNTER_RANGE - 1 : _counter - 1;
+
+	if (rateTicks(registers[FLG] & FLG_NOISE_RATE_MASK)) {
+		int feedback = (_noise << 13) ^ (_noise << 14);
+		_noise = static_cast<uint16_t>((feedback & 0x4000) ^ (_noise >> 1));
+	}
+
+	Byte keyingOn = _keyOn;
+	_keyOn = 0;
+	Byte keyOff = registers[KOFF];
+	bool resetting = (registers[FLG] & FLG_RESET) != 0;
+
+	for (unsigned index = 0; index < VOICE_COUNT; ++index) {
+		Byte bit = static_cast<Byte>(1 << index);
+
+		if ((keyingOn & bit) != 0) {
+			keyOn(index);
+		}
+		if (resetting) {
+			_envelopeMode[index] = EnvelopeMode::Release;
+			_envelope[index] = 0;
+		} else if ((keyOff & bit) != 0) {
+			_envelopeMode[index] = EnvelopeMode::Release;
+		}
+	}
+
+	runVoiceOutputs();
+
+	// the volumes, for all the voices at once
+	alignas(simd::ALIGNMENT) PerVoice<int32_t> volumes[2];
+	for (unsigned index = 0; index < VOICE_COUNT; ++index) {
+		volumes[0][index] = static_cast<int8_t>(voiceRegister(index, VOLL));
+		volumes[1][index] = static_cast<int8_t>(voiceRegister(index, VOLR));
+	}
+	Vector output = Vector::load(_output.data());
+	alignas(simd::ALIGNMENT) PerVoice<int32_t> left;
+	alignas(simd::ALIGNMENT) PerVoice<int32_t> right;
+	Vector::multiply16(output, Vector::load(volumes[0].data())).shiftRight<7>().store(left.data());
+	Vector::multiply16(output, Vector::load(volumes[1].data())).shiftRight<7>().store(right.data());
+
+	// the sums are clamped after each voice, so adding them up can't be done in parallel
+	int mainLeft = 0;
+	int mainRight = 0;
+	int echoLeft = 0;
+	int echoRight = 0;
+
+	for (unsigned index = 0; index < VOICE_COUNT; ++index) {
+		Byte bit = static_cast<Byte>(1 << index);
+
+		mainLeft = clamp16(mainLeft + left[index]);
+		mainRight = clamp16(mainRight + right[index]);
+		if ((registers[EON] & bit) != 0) {
+			echoLeft = clamp16(echoLeft + left[index]);
+			echoRight = clamp16(echoRight + right[index]);
+		}
+
+		runEnvelope(index);
+
+		int pitch = ((voiceRegister(index, PITCHH) & 0x3f) << 8) | voiceRegister(index, PITCHL);
+		if ((registers[PMON] & bit) != 0 && index > 0) {
+			// pitch modulation by the previous voice's output
+			pitch += ((_output[index - 1] >> 5) * pitch) >> 10;
+			pitch = std::clamp(pitch, 0, 0x7fff);
+		}
+
+		int position = _position[index] + pitch;
+		while (position >= 0x1000) {
+			position -= 0x1000;
+			advanceSample(index);
+		}
+		_position[index] = position;
+	}
+
+	runEcho(mainLeft, mainRight, echoLeft, echoRight, outLeft, outRight);
+
+	if ((registers[FLG] & FLG_MUTE) != 0) {
+		outLeft = 0;
+		outRight = 0;
+	}
+};
+
+void Blaze::DSP::saveState(StateWriter& writer) const {
+	writer.writeBytes(registers.data(), registers.size());
+
+	for (unsigned index = 0; index < VOICE_COUNT; ++index) {
+		writer.write(_blockAddress[index]);
+		for (int16_t sample: _block[index]) {
+			writer.write(sample);
+		}
+		writer.write(_blockIndex[index]);
+		for (const auto& samples: _samples) {
+			writer.write(static_cast<int16_t>(samples[index]));
+		}
+		writer.write(static_cast<Word>(_position[index]));
+		writer.write(static_cast<Byte>(_envelopeMode[index]));
+		writer.write(static_cast<int16_t>(_envelope[index]));
+		writer.write(_hiddenEnvelope[index]);
+		writer.write(static_cast<int16_t>(_output[index]));
+	}
+
+	writer.write(_keyOn);
+	writer.write(_counter);
+	writer.write(_noise);
+	writer.write(_echoOffset);
+	for (const auto& history: _echoHistory) {
+		for (size_t i = 0; i < 8; ++i) {
+			writer.write(static_cast<int16_t>(history[i]));
+		}
+	}
+	writer.write(_echoHistoryPosition);
+};
+
+void Blaze::DSP::loadState(StateReader& reader) {
+	reader.readBytes(registers.data(), registers.size());
+
+	for (unsigned index = 0; index < VOICE_COUNT; ++index) {
+		_blockAddress[index] = reader.read<Word>();
+		for (int16_t& sample: _block[index]) {
+			sample = reader.read<int16_t>();
+		}
+		_blockIndex[index] = reader.read<Byte>() & 0x0f;
+		for (auto& samples: _samples) {
+			samples[index] = reader.read<int16_t>();
+		}
+		_position[index] = reader.read<Word>() & 0x0fff;
+		_envelopeMode[index] = static_cast<EnvelopeMode>(reader.read<Byte>() & 0x03);
+		_envelope[index] = std::clamp<int>(reader.read<int16_t>(), 0, ENVELOPE_MAX);
+		_hiddenEnvelope[index] = reader.read<int16_t>();
+		_output[index] = reader.read<int16_t>();
+	}
+
+	_keyOn = reader.read<Byte>();
+	_counter = reader.read<uint16_t>() % COUNTER_RANGE;
+	_noise = reader.read<uint16_t>();
+	_echoOffset = reader.read<uint16_t>();
+	for (auto& history: _echoHistory) {
+		for (size_t i = 0; i < 8; ++i) {
+			history[i] = history[i + 8] = reader.read<int16_t>();
+		}
+	}
+	_echoHistoryPosition = reader.read<Byte>() & 7;
+
+	// (the cache isn't part of the state, and APU RAM has just been replaced anyway)
+	clearBlockCache();
+};
@@ -0,0 +1,155 @@
+#include <blaze/DecodeCache.hpp>
+#include <blaze/Bus.hpp>
+#include <blaze/CPU.hpp>
+
+#include <algorithm>
+
+// whether the instruction can continue somewhere other than the next instruction, or changes how the ones after it decode
+static constexpr bool endsBlock(Blaze::CPU::Opcode opcode) {
+	using Opcode = Blaze::CPU::Opcode;
+
+	switch (opcode) {
+		case Opcode::BRA:
+		case Opcode::BRK:
+		case Opcode::BRL:
+		case Opcode::COP:
+		case Opcode::JML:
+		case Opcode::JMP:
+		case Opcode::JSL:
+		case Opcode::JSR:
+		case Opcode::MVN:
+		case Opcode::MVP:
+		case Opcode::PLP:
+		case Opcode::REP:
+		case Opcode::RTI:
+		case Opcode::RTL:
+		case Opcode::RTS:
+		case Opcode::SEP:
+		case Opcode::STP:
+		case Opcode::WAI:
+		case Opcode::WDM:
+		case Opcode::XCE:
+			return true;
+
+		default:
+			return false;
+	}
+};
+
+static constexpr uint32_t blockKey(Blaze::Address pc, Blaze::Byte modeFlags) {
+	return (static_cast<uint32_t>(modeFlags) << 20) | (pc & 0xffffff);
+};
+
+void Blaze::DecodeCache::clear() {
+	_blocks.clear();
+	_ramLineHasCode.fill(0);
+	for (auto& keys: _ramLineBlocks) {
+		keys.clear();
+	}
+	++_generation;
+};
+
+const Blaze::DecodeCache::DecodedInstruction* Blaze::DecodeCache::fetchSlow(const Bus& bus, Address pc, Byte modeFlags) {
+	Block* block = findBlock(bus, pc, modeFlags);
+	if (block == nullptr) {
+		return nullptr;
+	}
+
+	_cursor.block = block;
+	_cursor.index = 1;
+	_cursor.generation = _generation;
+
+	return &block->instructions.front();
+};
+
+Blaze::DecodeCache::Block* Blaze::DecodeCache::findBlock(const Bus& bus, Address pc, Byte modeFlags) {
+	uint32_t key = blockKey(pc, modeFlags);
+
+	auto found = _blocks.find(key);
+	if (found != _blocks.end()) {
+		return &found->second;
+	}
+
+	const auto& page = bus.pageForAddress(pc);
+	if (page.directRead == nullptr) {
+		// I/O (or nothing at all); this has to go through the bus every time
+		return nullptr;
+	}
+
+	Block block;
+	decodeBlock(page.directRead, pc, modeFlags, block);
+	if (block.instructions.empty()) {
+		return nullptr;
+	}
+
+	if (_blocks.size() >= MAX_BLOCKS) {
+		clear();
+	}
+
+	if (page.device == &bus.ram) {
+		// remember which RAM lines this block came from, so that writes to them drop it
+		const auto& last = block.instructions.back();
+		Address ramStart = page.offset + (pc & Bus::PAGE_OFFSET_MASK);
+		Address ramEnd = page.offset + (last.pc & Bus::PAGE_OFFSET_MASK) + last.size;
+
+		for (Address line = ramStart >> RAM_LINE_SHIFT; line <= ((ramEnd - 1) >> RAM_LINE_SHIFT) && line < RAM_LINE_COUNT; ++line) {
+			auto& keys = _ramLineBlocks[line];
+			if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+				keys.push_back(key);
+			}
+			_ramLineHasCode[line] = 1;
+		}
+	}
+
+	return &_blocks.emplace(key, std::move(block)).first->second;
+};
+
+void Blaze::DecodeCache::decodeBlock(const Byte* page, Address pc, Byte modeFlags, Block& outBlock) {
+	bool memoryIs8Bit = (modeFlags & CPU::flags::m) != 0;
+	bool indexIs8Bit = (modeFlags & CPU::flags::x) != 0;
+	Address offset = pc & Bus::PAGE_OFFSET_MASK;
+
+	outBlock.modeFlags = modeFlags;
+	outBlock.instructions.clear();
+
+	while (outBlock.instructions.size() < MAX_BLOCK_INSTRUCTIONS && offset < Bus::PAGE_SIZE) {
+		Byte opcode = page[offset];
+		const auto& info = CPU::OPCODE_TABLE[opcode];
+		if (info.opcode == CPU::Opcode::INVALID) {
+			// leave these to the CPU
+			break;
+		}
+
+		// same as in `CPU::decodeInstruction`
+		Byte size = (info.size == 0) ? CPU::immediateInstructionSize(info.opcode, memoryIs8Bit, indexIs8Bit) : info.size;
+
+		// instructions that straddle the end of the page are left to the CPU
+		if (offset + size > Bus::PAGE_SIZE) {
+			break;
+		}
+
+		DecodedInstruction decoded {};
+		decoded.pc = (pc & ~Bus::PAGE_OFFSET_MASK) | offset;
+		decoded.opcode = opcode;
+		decoded.size = size;
+		for (Byte i = 1; i < size; ++i) {
+			decoded.operand |= static_cast<Address>(page[offset + i]) << ((i - 1) * 8);
+		}
+		outBlock.instructions.push_back(decoded);
+
+		offset += size;
+
+		if (endsBlock(info.opcode)) {
+			break;
+		}
+	}
+};
+
+void Blaze::DecodeCache::invalidateRAMLine(Address line) {
+	for (auto key: _ramLineBlocks[line]) {
+		_blocks.erase(key);
+	}
+	_ramLineBlocks[line].clear();
+	_ramLineHasCode[line] = 0;
+	++_generation;
+};
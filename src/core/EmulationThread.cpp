@@ -0,0 +1,138 @@
+#include <blaze/EmulationThread.hpp>
+#include <blaze/Bus.hpp>
+#include <blaze/util.hpp>
+
+#include <chrono>
+#include <stdexcept>
+
+Blaze::EmulationThread::EmulationThread(Bus& bus):
+	_bus(bus),
+	_rewind(bus)
+{
+	// the ROM output goes to our debug text; it's only ever touched by whoever is running the emulation
+	_bus.cpu.putCharacterHook = [this](char character) {
+		_debugText.push_back(character);
+	};
+};
+
+Blaze::EmulationThread::~EmulationThread() {
+	stop();
+};
+
+void Blaze::EmulationThread::start() {
+	if (running()) {
+		return;
+	}
+
+	_halted = false;
+
+	// whatever was loaded while we were stopped (a new ROM, a save state) makes the old history meaningless
+	_rewind.clear();
+
+	// the APU gets a thread of its own while we're running
+	_bus.apu.startThread();
+
+	_stopRequested.store(false, std::memory_order_relaxed);
+	_thread = std::thread(&EmulationThread::threadMain, this);
+};
+
+void Blaze::EmulationThread::stop() {
+	if (!running()) {
+		return;
+	}
+
+	_stopRequested.store(true, std::memory_order_relaxed);
+	_thread.join();
+
+	_bus.apu.stopThread();
+};
+
+void Blaze::EmulationThread::setDebugText(std::string text) {
+	_debugText = std::move(text);
+	publishFrame();
+};
+
+void Blaze::EmulationThread::runFrame() {
+	try {
+		if (!_halted) {
+			switch (_bus.runFrame()) {
+				case Bus::RunResult::Finished:
+					break;
+
+				case Bus::RunResult::Breakpoint:
+					_debugText += "\nHit a breakpoint at 0x" + valueToHexString(concat24(_bus.cpu.PBR, _bus.cpu.PC)) + "\n";
+					_halted = true;
+					break;
+
+				case Bus::RunResult::Stopped:
+					_halted = true;
+					break;
+			}
+		}
+	} catch (const std::runtime_error& e) {
+		// there's nobody on this thread to report the error to, so show it along with the rest of the output
+		_debugText += "\nEmulation stopped: ";
+		_debugText += e.what();
+		_debugText += " (while executing instruction at 0x" + valueToHexString(_bus.cpu.executingPC) + ")\n";
+		_halted = true;
+	}
+
+	if (!_halted) {
+		_rewind.onFrame();
+	}
+
+	++_frameNumber;
+	publishFrame();
+};
+
+void Blaze::EmulationThread::rewindFrame() {
+	try {
+		if (_rewind.stepBack()) {
+			// going back can un-halt the processor
+			_halted = _bus.cpu.stopped;
+		}
+	} catch (const std::runtime_error& e) {
+		_debugText += "\nRewinding failed: ";
+		_debugText += e.what();
+		_debugText += "\n";
+		_rewind.clear();
+	}
+
+	publishFrame();
+};
+
+void Blaze::EmulationThread::threadMain() {
+	using Clock = std::chrono::steady_clock;
+
+	const auto framePeriod = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(static_cast<double>(MASTER_CYCLES_PER_FRAME) / MASTER_CLOCK_HZ)
+	);
+	auto nextFrame = Clock::now();
+
+	while (!_stopRequested.load(std::memory_order_relaxed)) {
+		if (_rewinding.load(std::memory_order_relaxed)) {
+			rewindFrame();
+		} else {
+			runFrame();
+		}
+
+		nextFrame += framePeriod;
+
+		auto now = Clock::now();
+		if (now > nextFrame + framePeriod * MAX_FRAMES_BEHIND) {
+			nextFrame = now;
+		} else {
+			std::this_thread::sleep_until(nextFrame);
+		}
+	}
+};
+
+void Blaze::EmulationThread::publishFrame() {
+	FrameOutput& output = _frames.back();
+
+	output.frameNumber = _frameNumber;
+	output.debugText.assign(_debugText); // reuses the buffer's existing allocation
+	output.frameBuffer = _bus.ppu.frameBuffer;
+
+	_frames.publish();
+};
@@ -0,0 +1,818 @@
+#include <blaze/JIT.hpp>
+#include <blaze/Bus.hpp>
+#include <blaze/util.hpp>
+
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(_WIN32)
+	#define BLAZE_JIT_AVAILABLE 1
+	#include <sys/mman.h>
+	#include <unistd.h>
+#else
+	#define BLAZE_JIT_AVAILABLE 0
+#endif
+
+using Block = Blaze::DecodeCache::Block;
+using DecodedInstruction = Blaze::DecodeCache::DecodedInstruction;
+using AddressingMode = Blaze::CPU::AddressingMode;
+
+// (not `e`, which nothing translated natively depends on; see `JIT.hpp`)
+static constexpr Blaze::Byte MODE_FLAGS = Blaze::CPU::flags::m | Blaze::CPU::flags::x;
+
+// compiled code is aligned to this many bytes
+static constexpr size_t CODE_ALIGNMENT = 16;
+
+// called by compiled code for every instruction it doesn't translate itself
+static uint64_t interpretInstruction(Blaze::CPU* cpu, Blaze::JIT::RunState* state, const DecodedInstruction* instruction) {
+	cpu->PC = Blaze::lo16(instruction->pc);
+
+	// exceptions can't be thrown through the compiled code (it has no unwind information), so they're passed back to `step`
+	try {
+		uint64_t cycles = cpu->execute(*instruction);
+
+		// the instruction changed some code; the block we're in might be gone, so we can't go on with it. it might also have
+		// ended the run (e.g. by starting DMA, or by touching the APU's ports), in which case the block has to end, too.
+		if (cpu->decodeCache.generation() != state->entryGeneration || cpu->runEnded) {
+			state->bail = 1;
+		}
+
+		return cycles;
+	} catch (...) {
+		state->error = std::current_exception();
+		state->bail = 1;
+		return 0;
+	}
+};
+
+// called by compiled code for the memory operands it reads and writes itself (the bus decides what's actually there)
+template<bool Is8Bit>
+static uint32_t loadMemory(Blaze::CPU* cpu, Blaze::JIT::RunState* state, uint32_t address) {
+	try {
+		return Is8Bit ? cpu->load8(address) : cpu->load16(address);
+	} catch (...) {
+		state->error = std::current_exception();
+		state->bail = 1;
+		return 0;
+	}
+};
+
+template<bool Is8Bit>
+static void storeMemory(Blaze::CPU* cpu, Blaze::JIT::RunState* state, uint32_t address, uint32_t value) {
+	try {
+		if constexpr (Is8Bit) {
+			cpu->store8(address, static_cast<Blaze::Byte>(value));
+		} else {
+			cpu->store16(address, static_cast<Blaze::Word>(value));
+		}
+
+		// just like `interpretInstruction`: the write might have dropped the block we're in, or ended the run. (if it halted
+		// the CPU, `step` charges the time.)
+		if (cpu->decodeCache.generation() != state->entryGeneration || cpu->runEnded) {
+			state->bail = 1;
+		}
+	} catch (...) {
+		state->error = std::current_exception();
+		state->bail = 1;
+	}
+};
+
+namespace {
+	//
+	// A (very) small x86-64 assembler; just enough for the handful of instruction forms the JIT needs.
+	//
+	// Register usage in compiled blocks:
+	//   rbx = the `CPU`
+	//   r12 = the master cycles taken so far
+	//   r13 = the `JIT::RunState`
+	//   eax = the value being worked on by the translated instructions (registers are loaded into it and stored from it)
+	//   ecx = the operand of the instruction (for the ALU ops)
+	//   edx, esi = scratch
+	//
+	class Emitter {
+		std::vector<Blaze::Byte> _code;
+
+	public:
+		const std::vector<Blaze::Byte>& code() const {
+			return _code;
+		};
+
+		size_t size() const {
+			return _code.size();
+		};
+
+		void bytes(std::initializer_list<Blaze::Byte> bytes) {
+			_code.insert(_code.end(), bytes);
+		};
+
+		template<typename T>
+		void value(T value) {
+			for (size_t i = 0; i < sizeof(T); ++i) {
+				_code.push_back(static_cast<Blaze::Byte>(static_cast<uint64_t>(value) >> (i * 8)));
+			}
+		};
+
+		// push rbx, r12, r13 (which also realigns the stack to 16 bytes for calls), then set up the registers
+		void prologue() {
+			bytes({ 0x53 });             // push rbx
+			bytes({ 0x41, 0x54 });       // push r12
+			bytes({ 0x41, 0x55 });       // push r13
+			bytes({ 0x48, 0x89, 0xfb }); // mov rbx, rdi
+			bytes({ 0x49, 0x89, 0xf5 }); // mov r13, rsi
+			bytes({ 0x45, 0x31, 0xe4 }); // xor r12d, r12d
+		};
+
+		// records how many instructions ran and returns the cycles they took
+		void exit(int32_t instructionsOffset, uint32_t instructions) {
+			bytes({ 0x41, 0xc7, 0x45, static_cast<Blaze::Byte>(instructionsOffset) }); // mov dword [r13 + instructionsOffset], instructions
+			value(instructions);
+			bytes({ 0x4c, 0x89, 0xe0 }); // mov rax, r12
+			bytes({ 0x41, 0x5d });       // pop r13
+			bytes({ 0x41, 0x5c });       // pop r12
+			bytes({ 0x5b });             // pop rbx
+			bytes({ 0xc3 });             // ret
+		};
+
+		// jne rel32; returns where the offset goes so it can be patched once the target is known
+		size_t jumpIfNotEqual() {
+			bytes({ 0x0f, 0x85 });
+			size_t at = size();
+			value<int32_t>(0);
+			return at;
+		};
+
+		void patchJump(size_t at, size_t target) {
+			auto offset = static_cast<int32_t>(target - (at + 4));
+			std::memcpy(&_code[at], &offset, sizeof(offset));
+		};
+
+		void addCycles(uint32_t cycles) {
+			bytes({ 0x49, 0x81, 0xc4 }); // add r12, imm32
+			value(cycles);
+		};
+
+		void andByte(int32_t cpuOffset, Blaze::Byte mask) {
+			bytes({ 0x80, 0xa3 }); // and byte [rbx + cpuOffset], imm8
+			value(cpuOffset);
+			value(mask);
+		};
+
+		void orByte(int32_t cpuOffset, Blaze::Byte bits) {
+			bytes({ 0x80, 0x8b }); // or byte [rbx + cpuOffset], imm8
+			value(cpuOffset);
+			value(bits);
+		};
+
+		void storeWord(int32_t cpuOffset, Blaze::Word word) {
+			bytes({ 0x66, 0xc7, 0x83 }); // mov word [rbx + cpuOffset], imm16
+			value(cpuOffset);
+			value(word);
+		};
+
+		void storeDword(int32_t cpuOffset, uint32_t dword) {
+			bytes({ 0xc7, 0x83 }); // mov dword [rbx + cpuOffset], imm32
+			value(cpuOffset);
+			value(dword);
+		};
+
+		void storeByteAbsolute(const void* address, Blaze::Byte byte) {
+			bytes({ 0x48, 0xb8 }); // mov rax, imm64
+			value(reinterpret_cast<uintptr_t>(address));
+			bytes({ 0xc6, 0x00 }); // mov byte [rax], imm8
+			value(byte);
+		};
+
+		// jumps to the returned patch location if `(P & (m | x)) != modeFlags`
+		size_t modeGuard(int32_t pOffset, Blaze::Byte modeFlags) {
+			bytes({ 0x0f, 0xb6, 0x83 }); // movzx eax, byte [rbx + pOffset]
+			value(pOffset);
+			bytes({ 0x83, 0xe0, MODE_FLAGS }); // and eax, MODE_FLAGS
+			bytes({ 0x83, 0xf8, modeFlags });  // cmp eax, modeFlags
+			return jumpIfNotEqual();
+		};
+
+		// increments or decrements an index register and updates the `z` and `n` flags, just like `INX`/`DEX` and friends
+		void stepIndexRegister(int32_t registerOffset, int32_t pOffset, bool increment, bool is8Bit) {
+			bytes({ 0x0f, 0xb7, 0x83 }); // movzx eax, word [rbx + registerOffset]
+			value(registerOffset);
+			if (increment) {
+				bytes({ 0xff, 0xc0 }); // inc eax
+			} else {
+				bytes({ 0xff, 0xc8 }); // dec eax
+			}
+			bytes({ 0x25 }); // and eax, 0xff or 0xffff (8-bit index registers clear their high byte)
+			value<uint32_t>(is8Bit ? 0xff : 0xffff);
+			bytes({ 0x66, 0x89, 0x83 }); // mov word [rbx + registerOffset], ax
+			value(registerOffset);
+
+			setZeroNegative(pOffset, is8Bit);
+		};
+
+		// eax = the register, as wide as `is8Bit` says
+		void loadRegister(int32_t registerOffset, bool is8Bit) {
+			bytes({ 0x0f, static_cast<Blaze::Byte>(is8Bit ? 0xb6 : 0xb7), 0x83 }); // movzx eax, byte/word [rbx + registerOffset]
+			value(registerOffset);
+		};
+
+		// stores eax into a register, the same way `Register::store` does: in 8-bit mode, the accumulator keeps its high
+		// byte, but the index registers clear theirs
+		void storeRegister(int32_t registerOffset, bool is8Bit, bool isAccumulator) {
+			if (is8Bit && isAccumulator) {
+				bytes({ 0x88, 0x83 }); // mov byte [rbx + registerOffset], al
+				value(registerOffset);
+				return;
+			}
+			if (is8Bit) {
+				bytes({ 0x0f, 0xb6, 0xc0 }); // movzx eax, al
+			}
+			bytes({ 0x66, 0x89, 0x83 }); // mov word [rbx + registerOffset], ax
+			value(registerOffset);
+		};
+
+		// ecx = the operand
+		void operandImmediate(uint32_t operand) {
+			bytes({ 0xb9 }); // mov ecx, imm32
+			value(operand);
+		};
+
+		void operandFromValue() {
+			bytes({ 0x89, 0xc1 }); // mov ecx, eax
+		};
+
+		void valueFromOperand() {
+			bytes({ 0x89, 0xc8 }); // mov eax, ecx
+		};
+
+		void clearOperand() {
+			bytes({ 0x31, 0xc9 }); // xor ecx, ecx
+		};
+
+		void andOperand() {
+			bytes({ 0x21, 0xc8 }); // and eax, ecx
+		};
+
+		void orOperand() {
+			bytes({ 0x09, 0xc8 }); // or eax, ecx
+		};
+
+		void xorOperand() {
+			bytes({ 0x31, 0xc8 }); // xor eax, ecx
+		};
+
+		// eax = the address of a direct page operand (which wraps around within bank 0)
+		void directAddress(int32_t drOffset, Blaze::Byte operand) {
+			bytes({ 0x0f, 0xb7, 0x83 }); // movzx eax, word [rbx + drOffset]
+			value(drOffset);
+			bytes({ 0x05 });             // add eax, operand
+			value<uint32_t>(operand);
+			bytes({ 0x0f, 0xb7, 0xc0 }); // movzx eax, ax
+		};
+
+		// eax = the address of an absolute operand (in the data bank)
+		void absoluteAddress(int32_t dbrOffset, Blaze::Word operand) {
+			bytes({ 0x0f, 0xb6, 0x83 }); // movzx eax, byte [rbx + dbrOffset]
+			value(dbrOffset);
+			bytes({ 0xc1, 0xe0, 0x10 }); // shl eax, 16
+			bytes({ 0x0d });             // or eax, operand
+			value<uint32_t>(operand);
+		};
+
+		// adds `cycles` if the low byte of the direct page register isn't zero
+		void directPagePenalty(int32_t drOffset, uint32_t cycles) {
+			bytes({ 0x80, 0xbb }); // cmp byte [rbx + drOffset], 0
+			value(drOffset);
+			bytes({ 0x00 });
+			bytes({ 0x74, 0x07 }); // je (past the add)
+			addCycles(cycles);
+		};
+
+		// eax = `loadMemory<is8Bit>(cpu, state, eax)`
+		void callLoad(bool is8Bit) {
+			bytes({ 0x89, 0xc2 }); // mov edx, eax
+			call(is8Bit ? reinterpret_cast<uintptr_t>(&loadMemory<true>) : reinterpret_cast<uintptr_t>(&loadMemory<false>));
+		};
+
+		// `storeMemory<is8Bit>(cpu, state, eax, ecx)`
+		void callStore(bool is8Bit) {
+			bytes({ 0x89, 0xc2 }); // mov edx, eax
+			call(is8Bit ? reinterpret_cast<uintptr_t>(&storeMemory<true>) : reinterpret_cast<uintptr_t>(&storeMemory<false>));
+		};
+
+		// compares eax with ecx and updates the `z`, `n` and `c` flags, just like `CMP`/`CPX`/`CPY`
+		void compare(int32_t pOffset, bool is8Bit) {
+			bytes({ 0x0f, 0xb6, 0xb3 }); // movzx esi, byte [rbx + pOffset]
+			value(pOffset);
+			bytes({ 0x83, 0xe6, static_cast<Blaze::Byte>(~(Blaze::CPU::flags::z | Blaze::CPU::flags::n | Blaze::CPU::flags::c)) }); // and esi, ~(z | n | c)
+
+			bytes({ 0x89, 0xc2 }); // mov edx, eax
+			bytes({ 0x29, 0xca }); // sub edx, ecx
+			if (!is8Bit) {
+				bytes({ 0xc1, 0xea, 0x08 }); // shr edx, 8 (move bit 15 down to bit 7)
+			}
+			bytes({ 0x81, 0xe2 }); // and edx, n
+			value<uint32_t>(Blaze::CPU::flags::n);
+			bytes({ 0x09, 0xd6 }); // or esi, edx
+
+			bytes({ 0x39, 0xc8 });       // cmp eax, ecx
+			bytes({ 0x0f, 0x94, 0xc2 }); // sete dl
+			bytes({ 0x0f, 0xb6, 0xd2 }); // movzx edx, dl
+			bytes({ 0xd1, 0xe2 });       // shl edx, 1 (z is bit 1)
+			bytes({ 0x09, 0xd6 });       // or esi, edx
+
+			bytes({ 0x39, 0xc8 });       // cmp eax, ecx
+			bytes({ 0x0f, 0x93, 0xc2 }); // setae dl
+			bytes({ 0x0f, 0xb6, 0xd2 }); // movzx edx, dl (c is bit 0)
+			bytes({ 0x09, 0xd6 });       // or esi, edx
+
+			bytes({ 0x40, 0x88, 0xb3 }); // mov byte [rbx + pOffset], sil
+			value(pOffset);
+		};
+
+		// updates the `z` and `n` flags from eax (which has to fit in the given width)
+		void setZeroNegative(int32_t pOffset, bool is8Bit) {
+			bytes({ 0x0f, 0xb6, 0x8b }); // movzx ecx, byte [rbx + pOffset]
+			value(pOffset);
+			bytes({ 0x83, 0xe1, static_cast<Blaze::Byte>(~(Blaze::CPU::flags::z | Blaze::CPU::flags::n)) }); // and ecx, ~(z | n)
+
+			bytes({ 0x85, 0xc0 });       // test eax, eax
+			bytes({ 0x0f, 0x94, 0xc2 }); // setz dl
+			bytes({ 0x0f, 0xb6, 0xd2 }); // movzx edx, dl
+			bytes({ 0xd1, 0xe2 });       // shl edx, 1 (z is bit 1)
+			bytes({ 0x09, 0xd1 });       // or ecx, edx
+
+			bytes({ 0x89, 0xc2 }); // mov edx, eax
+			if (!is8Bit) {
+				bytes({ 0xc1, 0xea, 0x08 }); // shr edx, 8 (move bit 15 down to bit 7)
+			}
+			bytes({ 0x81, 0xe2 }); // and edx, n
+			value<uint32_t>(Blaze::CPU::flags::n);
+			bytes({ 0x09, 0xd1 }); // or ecx, edx
+
+			bytes({ 0x88, 0x8b }); // mov byte [rbx + pOffset], cl
+			value(pOffset);
+		};
+
+		// calls `interpretInstruction(cpu, state, instruction)` and adds the cycles it returns
+		void callInterpreter(const DecodedInstruction* instruction) {
+			bytes({ 0x48, 0xba }); // mov rdx, imm64
+			value(reinterpret_cast<uintptr_t>(instruction));
+			call(reinterpret_cast<uintptr_t>(&interpretInstruction));
+			bytes({ 0x49, 0x01, 0xc4 }); // add r12, rax
+		};
+
+		// calls `function(cpu, state, edx/rdx, ecx)`
+		void call(uintptr_t function) {
+			bytes({ 0x48, 0x89, 0xdf }); // mov rdi, rbx
+			bytes({ 0x4c, 0x89, 0xee }); // mov rsi, r13
+			bytes({ 0x48, 0xb8 });       // mov rax, imm64
+			value(function);
+			bytes({ 0xff, 0xd0 });       // call rax
+		};
+
+		// jumps to the returned patch location if `state.bail` is set
+		size_t bailCheck(int32_t bailOffset) {
+			bytes({ 0x41, 0x80, 0x7d, static_cast<Blaze::Byte>(bailOffset), 0x00 }); // cmp byte [r13 + bailOffset], 0
+			return jumpIfNotEqual();
+		};
+	};
+} // namespace
+
+bool Blaze::JIT::supported() {
+	return BLAZE_JIT_AVAILABLE != 0;
+};
+
+Blaze::JIT::JIT(CPU& cpu, size_t codeBufferSize):
+	_cpu(cpu)
+{
+#if BLAZE_JIT_AVAILABLE
+	void* memory = mmap(nullptr, codeBufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory != MAP_FAILED) {
+		_code = static_cast<Byte*>(memory);
+		_codeSize = codeBufferSize;
+	}
+#endif
+};
+
+Blaze::JIT::~JIT() {
+	// the blocks would otherwise keep pointing into the code buffer
+	_cpu.decodeCache.clear();
+
+#if BLAZE_JIT_AVAILABLE
+	if (_code != nullptr) {
+		munmap(_code, _codeSize);
+	}
+#endif
+};
+
+uint32_t Blaze::JIT::step(Cycles& outCycles) {
+	auto& cache = _cpu.decodeCache;
+
+	// without a code buffer (or the decode cache), or while tracing or profiling calls, this is just the interpreter
+	if (_code == nullptr || !cache.enabled || _cpu.trace != nullptr || _cpu.callProfiler != nullptr) {
+		outCycles = _cpu.execute();
+		return 1;
+	}
+
+	Address pc = concat24(_cpu.PBR, _cpu.PC);
+	Block* block = findBlock(pc, _cpu.P & MODE_FLAGS);
+	if (block == nullptr) {
+		_previous = nullptr;
+		outCycles = _cpu.execute();
+		return 1;
+	}
+
+	if (block->compiledCode == nullptr) {
+		if (++block->executionCount < HOT_BLOCK_THRESHOLD) {
+			uint32_t instructions = interpretBlock(*block, outCycles);
+			if (instructions == 0) {
+				outCycles = _cpu.execute();
+				instructions = 1;
+			}
+			return instructions;
+		}
+
+		block->compiledCode = compile(*block);
+		if (block->compiledCode == nullptr) {
+			// the code buffer is full; start over (which drops this block, too)
+			flush();
+			outCycles = _cpu.execute();
+			return 1;
+		}
+	}
+
+	// interrupt entry cycles are normally charged by `execute`, but the block might not call it
+	Cycles cycles = _cpu.pendingCycles * _cpu.bus->accessCycles(pc);
+	_cpu.pendingCycles = 0;
+
+	_state.instructions = 0;
+	_state.bail = 0;
+	_state.entryGeneration = cache.generation();
+	_cpu.runEnded = false;
+
+	auto function = reinterpret_cast<uint64_t (*)(CPU*, RunState*)>(const_cast<void*>(block->compiledCode));
+	cycles += static_cast<Cycles>(function(&_cpu, &_state));
+
+	// (instructions that go through `execute` charge their own stalls, but the ones translated natively don't)
+	cycles += std::exchange(_cpu.stalledCycles, 0);
+
+	if (_state.error) {
+		auto error = std::exchange(_state.error, nullptr);
+		_previous = nullptr;
+		std::rethrow_exception(error);
+	}
+
+	uint32_t instructions = _state.instructions;
+	if (instructions == 0) {
+		// the mode guard failed
+		cycles += _cpu.execute();
+		instructions = 1;
+	}
+
+	if (cache.generation() == _state.entryGeneration) {
+		_previous = block;
+		_previousGeneration = _state.entryGeneration;
+	} else {
+		_previous = nullptr;
+	}
+
+	outCycles = cycles;
+	return instructions;
+};
+
+Blaze::DecodeCache::Block* Blaze::JIT::findBlock(Address pc, Byte modeFlags) {
+	auto& cache = _cpu.decodeCache;
+	uint64_t generation = cache.generation();
+
+	// most of the time, the next block is one we've already gone to from the previous one
+	bool canLink = _previous != nullptr && _previousGeneration == generation;
+	if (canLink) {
+		for (const auto& link: _previous->links) {
+			if (link.generation == generation && link.pc == pc && link.block->modeFlags == modeFlags) {
+				return link.block;
+			}
+		}
+	}
+
+	Block* block = cache.findBlock(*_cpu.bus, pc, modeFlags);
+
+	// decoding a new block can flush the cache, in which case the previous block is gone
+	if (block != nullptr && canLink && cache.generation() == generation) {
+		auto& link = _previous->links[_previous->nextLink];
+		_previous->nextLink = (_previous->nextLink + 1) % _previous->links.size();
+		link.pc = pc;
+		link.block = block;
+		link.generation = generation;
+	}
+
+	return block;
+};
+
+uint32_t Blaze::JIT::interpretBlock(const Block& block, Cycles& outCycles) {
+	auto& cache = _cpu.decodeCache;
+	uint64_t generation = cache.generation();
+	Byte modeFlags = block.modeFlags;
+
+	Cycles cycles = 0;
+	uint32_t instructions = 0;
+	_cpu.runEnded = false;
+
+	// the block can be dropped by any of its instructions, so it's only safe to look at while the generation stays the same.
+	// (like a compiled block, it also ends with the run.)
+	for (size_t i = 0; i < block.instructions.size() && cache.generation() == generation && !_cpu.runEnded; ++i) {
+		if (concat24(_cpu.PBR, _cpu.PC) != block.instructions[i].pc || (_cpu.P & MODE_FLAGS) != modeFlags || _cpu.stopped || _cpu.waitingForInterrupt) {
+			break;
+		}
+
+		cycles += _cpu.execute(block.instructions[i]);
+		++instructions;
+	}
+
+	_previous = (cache.generation() == generation) ? const_cast<Block*>(&block) : nullptr;
+	_previousGeneration = generation;
+
+	outCycles = cycles;
+	return instructions;
+};
+
+const void* Blaze::JIT::compile(const Block& block) {
+#if BLAZE_JIT_AVAILABLE
+	// the offsets of the fields the compiled code accesses directly
+	auto cpuOffset = [this](const void* field) {
+		return static_cast<int32_t>(static_cast<const Byte*>(field) - reinterpret_cast<const Byte*>(&_cpu));
+	};
+	auto stateOffset = [this](const void* field) {
+		return static_cast<int32_t>(static_cast<const Byte*>(field) - reinterpret_cast<const Byte*>(&_state));
+	};
+
+	const int32_t pOffset = cpuOffset(&_cpu.P);
+	const int32_t pcOffset = cpuOffset(&_cpu.PC);
+	const int32_t executingPCOffset = cpuOffset(&_cpu.executingPC);
+	const int32_t drOffset = cpuOffset(&_cpu.DR);
+	const int32_t dbrOffset = cpuOffset(&_cpu.DBR);
+	const int32_t aOffset = cpuOffset(_cpu.A.address());
+	const int32_t xOffset = cpuOffset(_cpu.X.address());
+	const int32_t yOffset = cpuOffset(_cpu.Y.address());
+	const int32_t instructionsOffset = stateOffset(&_state.instructions);
+	const int32_t bailOffset = stateOffset(&_state.bail);
+
+	const bool memoryIs8Bit = (block.modeFlags & CPU::flags::m) != 0;
+	const bool indexIs8Bit = (block.modeFlags & CPU::flags::x) != 0;
+
+	// blocks never cross a page, so they all run at the same speed
+	const Cycles accessCycles = _cpu.bus->accessCycles(block.instructions.front().pc);
+
+	Emitter emitter;
+	std::vector<std::pair<size_t, uint32_t>> exits; // (jump to patch, instructions executed)
+
+	emitter.prologue();
+	exits.emplace_back(emitter.modeGuard(pOffset, block.modeFlags), 0);
+
+	// the PC (and the rest of the state the interpreter keeps about the current instruction) is only stored when the
+	// interpreter or the bus might need it, and at the end of the block
+	bool pcIsUpToDate = true;
+	auto storeInstructionState = [&](const DecodedInstruction& instruction) {
+		emitter.storeWord(pcOffset, static_cast<Word>(instruction.pc + instruction.size));
+		emitter.storeDword(executingPCOffset, instruction.pc);
+		emitter.storeByteAbsolute(&_cpu.bus->openBus, DecodeCache::lastFetchedByte(instruction));
+	};
+
+	for (size_t i = 0; i < block.instructions.size(); ++i) {
+		const auto& instruction = block.instructions[i];
+		const auto& info = CPU::OPCODE_TABLE[instruction.opcode];
+		const auto& timing = CPU::INSTRUCTION_TIMINGS[(static_cast<size_t>(block.modeFlags) << 4) | instruction.opcode];
+
+		// the register an instruction works on, and how wide it is
+		int32_t registerOffset = aOffset;
+		bool is8Bit = memoryIs8Bit;
+		switch (info.opcode) {
+			case CPU::Opcode::LDX: case CPU::Opcode::STX: case CPU::Opcode::CPX: registerOffset = xOffset; is8Bit = indexIs8Bit; break;
+			case CPU::Opcode::LDY: case CPU::Opcode::STY: case CPU::Opcode::CPY: registerOffset = yOffset; is8Bit = indexIs8Bit; break;
+			default: break;
+		}
+		const Word widthMask = is8Bit ? 0xff : 0xffff;
+
+		const bool hasMemoryOperand = info.addressingMode == AddressingMode::Direct || info.addressingMode == AddressingMode::Absolute;
+		const bool hasTranslatableOperand = hasMemoryOperand || info.addressingMode == AddressingMode::Immediate;
+
+		// loads the operand into ecx. memory reads can fail, so they can end the block early.
+		auto loadOperand = [&]() {
+			if (info.addressingMode == AddressingMode::Immediate) {
+				emitter.operandImmediate(instruction.operand & widthMask);
+				return;
+			}
+			storeInstructionState(instruction);
+			if (info.addressingMode == AddressingMode::Direct) {
+				emitter.directAddress(drOffset, static_cast<Byte>(instruction.operand));
+			} else {
+				emitter.absoluteAddress(dbrOffset, static_cast<Word>(instruction.operand));
+			}
+			emitter.callLoad(is8Bit);
+			exits.emplace_back(emitter.bailCheck(bailOffset), static_cast<uint32_t>(i + 1));
+			emitter.operandFromValue();
+		};
+
+		// ditto, but it stores ecx to the operand. writes can also drop the block, so they can end it, too.
+		auto storeOperand = [&]() {
+			storeInstructionState(instruction);
+			if (info.addressingMode == AddressingMode::Direct) {
+				emitter.directAddress(drOffset, static_cast<Byte>(instruction.operand));
+			} else {
+				emitter.absoluteAddress(dbrOffset, static_cast<Word>(instruction.operand));
+			}
+			emitter.callStore(is8Bit);
+			exits.emplace_back(emitter.bailCheck(bailOffset), static_cast<uint32_t>(i + 1));
+		};
+
+		// copies one register to another, just like the `T??` instructions: the value is read with the width of the
+		// destination, except for the accumulator, which gets the value of the index register
+		auto transfer = [&](int32_t from, int32_t to) {
+			bool toAccumulator = (to == aOffset);
+			bool toIs8Bit = toAccumulator ? memoryIs8Bit : indexIs8Bit;
+			emitter.loadRegister(from, toAccumulator ? indexIs8Bit : toIs8Bit);
+			emitter.storeRegister(to, toIs8Bit, toAccumulator);
+			emitter.loadRegister(to, toIs8Bit);
+			emitter.setZeroNegative(pOffset, toIs8Bit);
+		};
+
+		// the cycles are added before the instruction runs, so they've already been counted if a memory access ends the block
+		bool translated = true;
+		switch (info.opcode) {
+			case CPU::Opcode::CLC:
+			case CPU::Opcode::CLD:
+			case CPU::Opcode::CLI:
+			case CPU::Opcode::CLV:
+			case CPU::Opcode::SEC:
+			case CPU::Opcode::SED:
+			case CPU::Opcode::SEI:
+			case CPU::Opcode::NOP:
+			case CPU::Opcode::INX:
+			case CPU::Opcode::INY:
+			case CPU::Opcode::DEX:
+			case CPU::Opcode::DEY:
+			case CPU::Opcode::TAX:
+			case CPU::Opcode::TAY:
+			case CPU::Opcode::TXA:
+			case CPU::Opcode::TYA:
+			case CPU::Opcode::TXY:
+			case CPU::Opcode::TYX:
+				break;
+
+			case CPU::Opcode::LDA:
+			case CPU::Opcode::LDX:
+			case CPU::Opcode::LDY:
+			case CPU::Opcode::AND:
+			case CPU::Opcode::ORA:
+			case CPU::Opcode::EOR:
+			case CPU::Opcode::CMP:
+			case CPU::Opcode::CPX:
+			case CPU::Opcode::CPY:
+				translated = hasTranslatableOperand;
+				break;
+
+			case CPU::Opcode::STA:
+			case CPU::Opcode::STX:
+			case CPU::Opcode::STY:
+			case CPU::Opcode::STZ:
+				translated = hasMemoryOperand;
+				break;
+
+			default:
+				translated = false;
+				break;
+		}
+
+		if (!translated) {
+			emitter.callInterpreter(&instruction);
+			exits.emplace_back(emitter.bailCheck(bailOffset), static_cast<uint32_t>(i + 1));
+			pcIsUpToDate = true;
+			continue;
+		}
+
+		// (none of the translated instructions have page crossing penalties)
+		emitter.addCycles(timing.cycles * accessCycles);
+		if (timing.directPagePenalty) {
+			emitter.directPagePenalty(drOffset, accessCycles);
+		}
+
+		switch (info.opcode) {
+			case CPU::Opcode::CLC: emitter.andByte(pOffset, static_cast<Byte>(~CPU::flags::c)); break;
+			case CPU::Opcode::CLD: emitter.andByte(pOffset, static_cast<Byte>(~CPU::flags::d)); break;
+			case CPU::Opcode::CLI: emitter.andByte(pOffset, static_cast<Byte>(~CPU::flags::i)); break;
+			case CPU::Opcode::CLV: emitter.andByte(pOffset, static_cast<Byte>(~CPU::flags::v)); break;
+			case CPU::Opcode::SEC: emitter.orByte(pOffset, CPU::flags::c); break;
+			case CPU::Opcode::SED: emitter.orByte(pOffset, CPU::flags::d); break;
+			case CPU::Opcode::SEI: emitter.orByte(pOffset, CPU::flags::i); break;
+			case CPU::Opcode::NOP: break;
+			case CPU::Opcode::INX: emitter.stepIndexRegister(xOffset, pOffset, true, indexIs8Bit); break;
+			case CPU::Opcode::INY: emitter.stepIndexRegister(yOffset, pOffset, true, indexIs8Bit); break;
+			case CPU::Opcode::DEX: emitter.stepIndexRegister(xOffset, pOffset, false, indexIs8Bit); break;
+			case CPU::Opcode::DEY: emitter.stepIndexRegister(yOffset, pOffset, false, indexIs8Bit); break;
+			case CPU::Opcode::TAX: transfer(aOffset, xOffset); break;
+			case CPU::Opcode::TAY: transfer(aOffset, yOffset); break;
+			case CPU::Opcode::TXA: transfer(xOffset, aOffset); break;
+			case CPU::Opcode::TYA: transfer(yOffset, aOffset); break;
+			case CPU::Opcode::TXY: transfer(xOffset, yOffset); break;
+			case CPU::Opcode::TYX: transfer(yOffset, xOffset); break;
+
+			case CPU::Opcode::LDA:
+			case CPU::Opcode::LDX:
+			case CPU::Opcode::LDY:
+				loadOperand();
+				emitter.valueFromOperand();
+				emitter.storeRegister(registerOffset, is8Bit, registerOffset == aOffset);
+				emitter.setZeroNegative(pOffset, is8Bit);
+				break;
+
+			case CPU::Opcode::AND:
+			case CPU::Opcode::ORA:
+			case CPU::Opcode::EOR:
+				loadOperand();
+				emitter.loadRegister(aOffset, memoryIs8Bit);
+				if (info.opcode == CPU::Opcode::AND) {
+					emitter.andOperand();
+				} else if (info.opcode == CPU::Opcode::ORA) {
+					emitter.orOperand();
+				} else {
+					emitter.xorOperand();
+				}
+				emitter.storeRegister(aOffset, memoryIs8Bit, true);
+				emitter.setZeroNegative(pOffset, memoryIs8Bit);
+				break;
+
+			case CPU::Opcode::CMP:
+			case CPU::Opcode::CPX:
+			case CPU::Opcode::CPY:
+				loadOperand();
+				emitter.loadRegister(registerOffset, is8Bit);
+				emitter.compare(pOffset, is8Bit);
+				break;
+
+			case CPU::Opcode::STA:
+			case CPU::Opcode::STX:
+			case CPU::Opcode::STY:
+				emitter.loadRegister(registerOffset, is8Bit);
+				emitter.operandFromValue();
+				storeOperand();
+				break;
+
+			case CPU::Opcode::STZ:
+				emitter.clearOperand();
+				storeOperand();
+				break;
+
+			default:
+				break;
+		}
+
+		pcIsUpToDate = hasMemoryOperand;
+	}
+
+	if (!pcIsUpToDate) {
+		// the interpreter takes care of this for the instructions it runs
+		storeInstructionState(block.instructions.back());
+	}
+	emitter.exit(instructionsOffset, static_cast<uint32_t>(block.instructions.size()));
+
+	for (const auto& [jump, instructions]: exits) {
+		emitter.patchJump(jump, emitter.size());
+		emitter.exit(instructionsOffset, instructions);
+	}
+
+	const auto& code = emitter.code();
+	size_t start = (_codeUsed + CODE_ALIGNMENT - 1) & ~(CODE_ALIGNMENT - 1);
+	if (start + code.size() > _codeSize) {
+		return nullptr;
+	}
+
+	// the buffer is only ever writable or executable, never both. only the pages the block goes in are switched over,
+	// so compiling doesn't cost more as the buffer fills up.
+	static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t firstPage = start & ~(pageSize - 1);
+	size_t pagesLength = ((start + code.size() + pageSize - 1) & ~(pageSize - 1)) - firstPage;
+
+	if (mprotect(_code + firstPage, pagesLength, PROT_READ | PROT_WRITE) != 0) {
+		return nullptr;
+	}
+	std::memcpy(_code + start, code.data(), code.size());
+	if (mprotect(_code + firstPage, pagesLength, PROT_READ | PROT_EXEC) != 0) {
+		return nullptr;
+	}
+
+	_codeUsed = start + code.size();
+	++_compiledBlocks;
+
+	return _code + start;
+#else
+	(void)block;
+	return nullptr;
+#endif
+};
+
+void Blaze::JIT::flush() {
+	_cpu.decodeCache.clear();
+	_previous = nullptr;
+	_codeUsed = 0;
+	_compiledBlocks = 0;
+};
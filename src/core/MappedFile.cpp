@@ -0,0 +1,112 @@
+#include <blaze/MappedFile.hpp>
+
+#include <utility>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif // _WIN32
+
+Blaze::MappedFile::~MappedFile() {
+	close();
+};
+
+Blaze::MappedFile::MappedFile(MappedFile&& other) noexcept:
+	_data(std::exchange(other._data, nullptr)),
+	_size(std::exchange(other._size, 0)) {};
+
+Blaze::MappedFile& Blaze::MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		_data = std::exchange(other._data, nullptr);
+		_size = std::exchange(other._size, 0);
+	}
+	return *this;
+};
+
+#ifdef _WIN32
+bool Blaze::MappedFile::open(const std::string& path) {
+	close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		// (empty files can't be mapped)
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	// the view keeps the mapping (and the file) alive, so we don't need the handles anymore
+	CloseHandle(mapping);
+	CloseHandle(file);
+
+	if (view == nullptr) {
+		return false;
+	}
+
+	_data = static_cast<const Byte*>(view);
+	_size = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+};
+
+void Blaze::MappedFile::close() {
+	if (_data != nullptr) {
+		UnmapViewOfFile(_data);
+	}
+	_data = nullptr;
+	_size = 0;
+};
+#else
+bool Blaze::MappedFile::open(const std::string& path) {
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info {};
+	if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+		// (empty files can't be mapped)
+		::close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// the mapping stays valid after the file descriptor is closed
+	::close(fd);
+
+	if (view == MAP_FAILED) {
+		return false;
+	}
+
+	_data = static_cast<const Byte*>(view);
+	_size = static_cast<size_t>(info.st_size);
+	return true;
+};
+
+void Blaze::MappedFile::close() {
+	if (_data != nullptr) {
+		munmap(const_cast<Byte*>(_data), _size);
+	}
+	_data = nullptr;
+	_size = 0;
+};
+#endif // _WIN32
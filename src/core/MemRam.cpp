@@ -1,14 +1,27 @@
 #include <blaze/MemRam.hpp>
+#include <blaze/Bus.hpp>
 #include <blaze/util.hpp>
+#include <blaze/SaveState.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+// B-bus addresses of the WRAM ports
+static constexpr Blaze::Byte WMDATA = 0x80;
+static constexpr Blaze::Byte WMADDL = 0x81;
+static constexpr Blaze::Byte WMADDM = 0x82;
+static constexpr Blaze::Byte WMADDH = 0x83;
 
 Blaze::MemRam::MemRam() {
 	reset(nullptr);
 }
 
 void Blaze::MemRam::reset(Bus* bus) {
+	_bus = bus;
 	for (Byte & i : data) {
 		i = 0;
 	}
+	portAddress = 0;
 };
 
 Blaze::Byte Blaze::MemRam::read8(Address offset) {
@@ -34,3 +47,87 @@ void Blaze::MemRam::write16(Address offset, Word value) {
 void Blaze::MemRam::write24(Address offset, Address value) {
 	split24(value, data[offset + 2], data[offset + 1], data[offset]);
 };
+
+const Blaze::Byte* Blaze::MemRam::directReadPointer(Address offset, Address size) {
+	return directWritePointer(offset, size);
+};
+
+Blaze::Byte* Blaze::MemRam::directWritePointer(Address offset, Address size) {
+	if (offset >= MEM_SIZE || size > MEM_SIZE - offset) {
+		return nullptr;
+	}
+	return &data[offset];
+};
+
+Blaze::Byte Blaze::MemRam::readB(Byte address) {
+	if (address == WMDATA) {
+		Byte value = data[portAddress];
+		portAddress = (portAddress + 1) % MEM_SIZE;
+		return value;
+	}
+
+	// the address registers are write-only
+	return (_bus != nullptr) ? _bus->unmappedRead(0x2100 | address) : 0;
+};
+
+void Blaze::MemRam::writeB(Byte address, Byte value) {
+	switch (address) {
+		case WMDATA:
+			data[portAddress] = value;
+			if (_bus != nullptr) {
+				_bus->invalidateRAMCode(portAddress, 1);
+			}
+			portAddress = (portAddress + 1) % MEM_SIZE;
+			break;
+
+		case WMADDL:
+			portAddress = (portAddress & 0x1ff00) | value;
+			break;
+
+		case WMADDM:
+			portAddress = (portAddress & 0x100ff) | (static_cast<Address>(value) << 8);
+			break;
+
+		case WMADDH:
+			// only the lowest bit is used
+			portAddress = (portAddress & 0x0ffff) | (static_cast<Address>(value & 1) << 16);
+			break;
+
+		default:
+			break;
+	}
+};
+
+bool Blaze::MemRam::writeBlockB(Byte address, bool alternating, const Byte* source, size_t size) {
+	// only a plain stream of bytes into WMDATA can be copied at once
+	if (address != WMDATA || alternating) {
+		return false;
+	}
+
+	while (size > 0) {
+		// the address wraps around at the end of RAM
+		size_t chunk = std::min<size_t>(size, MEM_SIZE - portAddress);
+
+		// (the source could be RAM, too)
+		std::memmove(&data[portAddress], source, chunk);
+		if (_bus != nullptr) {
+			_bus->invalidateRAMCode(portAddress, static_cast<Address>(chunk));
+		}
+
+		portAddress = static_cast<Address>((portAddress + chunk) % MEM_SIZE);
+		source += chunk;
+		size -= chunk;
+	}
+
+	return true;
+};
+
+void Blaze::MemRam::saveState(StateWriter& writer) const {
+	writer.writeBytes(data.data(), data.size());
+	writer.write(portAddress);
+};
+
+void Blaze::MemRam::loadState(StateReader& reader) {
+	reader.readBytes(data.data(), data.size());
+	portAddress = reader.read<Address>() % MEM_SIZE;
+};
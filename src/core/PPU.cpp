@@ -0,0 +1,478 @@
+#include <blaze/PPU.hpp>
+#include <blaze/Bus.hpp>
+#include <blaze/SaveState.hpp>
+#include <blaze/util.hpp>
+
+#include <algorithm>
+
+// VMAIN bits
+static constexpr Blaze::Byte VMAIN_INCREMENT_AFTER_HIGH = 0x80;
+static constexpr Blaze::Byte VMAIN_REMAP_MASK = 0x0c;
+static constexpr Blaze::Byte VMAIN_STEP_MASK = 0x03;
+
+static constexpr Blaze::Word VRAM_STEPS[4] = { 1, 32, 128, 128 };
+
+// M7X and M7Y (and the mode 7 scroll registers) are 13-bit signed numbers
+static constexpr int16_t signExtend13(Blaze::Word value) {
+	return static_cast<int16_t>(static_cast<int16_t>(value << 3) >> 3);
+};
+
+Blaze::PPU::PPU(Scheduler& scheduler):
+	_scheduler(scheduler)
+{
+	_lineEvent = _scheduler.registerEvent([this](MasterCycles scheduledTime) {
+		runLine(scheduledTime);
+	});
+};
+
+void Blaze::PPU::reset(Bus* bus) {
+	_bus = bus;
+
+	vram.fill(0);
+	cgram.fill(0);
+	oam.fill(0);
+	frameBuffer.fill(0);
+	frameCount = 0;
+	_tiles.invalidateAll();
+
+	registers.fill(0);
+	// the screen starts out blanked
+	registers[INIDISP] = 0x80;
+
+	bgHOffset.fill(0);
+	bgVOffset.fill(0);
+	m7HOffset = 0;
+	m7VOffset = 0;
+	m7Matrix.fill(0);
+	m7X = 0;
+	m7Y = 0;
+	vramAddress = 0;
+	oamAddress = 0;
+	cgramAddress = 0;
+	fixedColor = 0;
+
+	_bgOffsetLatch = 0;
+	_bgHOffsetLatch = 0;
+	_m7Latch = 0;
+	_vramPrefetch = 0;
+	_oamInternalAddress = 0;
+	_oamLatch = 0;
+	_cgramLatch = 0;
+	_cgramHighByte = false;
+	_hCounterLatch = 0;
+	_vCounterLatch = 0;
+	_countersLatched = false;
+	_hCounterHighByte = false;
+	_vCounterHighByte = false;
+
+	_scheduler.cancel(_lineEvent);
+	_scheduler.schedule(_lineEvent, FIRST_VISIBLE_LINE * MASTER_CYCLES_PER_SCANLINE + RENDER_TIME);
+};
+
+void Blaze::PPU::runLine(MasterCycles scheduledTime) {
+	MasterCycles frameStart = scheduledTime - (scheduledTime % MASTER_CYCLES_PER_FRAME);
+	auto line = static_cast<unsigned>((scheduledTime - frameStart) / MASTER_CYCLES_PER_SCANLINE);
+
+	if (line < VBLANK_LINE) {
+		renderLine(line);
+		_scheduler.schedule(_lineEvent, scheduledTime + MASTER_CYCLES_PER_SCANLINE);
+		return;
+	}
+
+	// V-blank: the frame is done
+	++frameCount;
+
+	// the OAM address goes back to where it was last set
+	if ((registers[INIDISP] & 0x80) == 0) {
+		_oamInternalAddress = static_cast<Word>(oamAddress << 1);
+	}
+
+	_scheduler.schedule(_lineEvent, frameStart + MASTER_CYCLES_PER_FRAME + FIRST_VISIBLE_LINE * MASTER_CYCLES_PER_SCANLINE + RENDER_TIME);
+};
+
+//=== VRAM ===
+Blaze::Word Blaze::PPU::vramRemappedAddress() const {
+	Word address = vramAddress;
+	switch ((registers[VMAIN] & VMAIN_REMAP_MASK) >> 2) {
+		// these rotate the lowest 8, 9, or 10 bits left by 3 (for writing 2bpp, 4bpp, or 8bpp tiles a row at a time)
+		case 1: address = (address & 0xff00) | ((address & 0x001f) << 3) | ((address >> 5) & 7); break;
+		case 2: address = (address & 0xfe00) | ((address & 0x003f) << 3) | ((address >> 6) & 7); break;
+		case 3: address = (address & 0xfc00) | ((address & 0x007f) << 3) | ((address >> 7) & 7); break;
+		default: break;
+	}
+	return address & (VRAM_WORDS - 1);
+};
+
+void Blaze::PPU::incrementVRAMAddress(bool highByte) {
+	// the address moves on after accessing the low or the high byte, depending on VMAIN
+	if (highByte == ((registers[VMAIN] & VMAIN_INCREMENT_AFTER_HIGH) != 0)) {
+		vramAddress = static_cast<Word>(vramAddress + VRAM_STEPS[registers[VMAIN] & VMAIN_STEP_MASK]);
+	}
+};
+
+void Blaze::PPU::writeVRAM(Byte value, bool highByte) {
+	Word address = vramRemappedAddress();
+	Word& word = vram[address];
+	word = highByte ? concat16(value, lo8(word)) : concat16(static_cast<Byte>(word >> 8), value);
+	_tiles.invalidate(address);
+	incrementVRAMAddress(highByte);
+};
+
+//=== OAM ===
+void Blaze::PPU::writeOAM(Byte value) {
+	Word address = _oamInternalAddress;
+	if (address >= 0x200) {
+		// the high table (32 bytes) is written right away, and mirrored through the rest of the address space
+		oam[0x200 + (address & 0x1f)] = value;
+	} else if ((address & 1) == 0) {
+		_oamLatch = value;
+	} else {
+		// the low table is only written a word at a time
+		oam[address - 1] = _oamLatch;
+		oam[address] = value;
+	}
+	_oamInternalAddress = (address + 1) & 0x3ff;
+};
+
+//=== CGRAM ===
+void Blaze::PPU::writeCGRAM(Byte value) {
+	if (!_cgramHighByte) {
+		_cgramLatch = value;
+	} else {
+		cgram[cgramAddress] = concat16(value & 0x7f, _cgramLatch);
+		cgramAddress = (cgramAddress + 1) & 0xff;
+	}
+	_cgramHighByte = !_cgramHighByte;
+};
+
+//=== Registers ===
+Blaze::Byte Blaze::PPU::readB(Byte address) {
+	switch (address) {
+		case MPYL:
+		case MPYM:
+		case MPYH: {
+			// M7A times the last byte written to M7B (which is always its high byte)
+			auto product = static_cast<int32_t>(m7Matrix[0]) * static_cast<int8_t>(m7Matrix[1] >> 8);
+			return static_cast<Byte>(product >> ((address - MPYL) * 8));
+		}
+
+		case SLHV: {
+			MasterCycles now = _scheduler.now();
+			_hCounterLatch = static_cast<Word>((now % MASTER_CYCLES_PER_SCANLINE) / 4);
+			_vCounterLatch = static_cast<Word>((now % MASTER_CYCLES_PER_FRAME) / MASTER_CYCLES_PER_SCANLINE);
+			_countersLatched = true;
+			return _bus->openBus;
+		}
+
+		case RDOAM: {
+			Word oamAddressNow = _oamInternalAddress;
+			_oamInternalAddress = (oamAddressNow + 1) & 0x3ff;
+			return (oamAddressNow >= 0x200) ? oam[0x200 + (oamAddressNow & 0x1f)] : oam[oamAddressNow];
+		}
+
+		case RDVRAML:
+		case RDVRAMH: {
+			// reads come from a prefetch buffer, which is refilled before the address moves on
+			bool highByte = address == RDVRAMH;
+			Byte value = highByte ? static_cast<Byte>(_vramPrefetch >> 8) : lo8(_vramPrefetch);
+			if (highByte == ((registers[VMAIN] & VMAIN_INCREMENT_AFTER_HIGH) != 0)) {
+				_vramPrefetch = vram[vramRemappedAddress()];
+				incrementVRAMAddress(highByte);
+			}
+			return value;
+		}
+
+		case RDCGRAM: {
+			Word color = cgram[cgramAddress];
+			Byte value = _cgramHighByte ? static_cast<Byte>(color >> 8) : lo8(color);
+			if (_cgramHighByte) {
+				cgramAddress = (cgramAddress + 1) & 0xff;
+			}
+			_cgramHighByte = !_cgramHighByte;
+			return value;
+		}
+
+		case OPHCT: {
+			Byte value = _hCounterHighByte ? static_cast<Byte>((_hCounterLatch >> 8) & 1) : lo8(_hCounterLatch);
+			_hCounterHighByte = !_hCounterHighByte;
+			return value;
+		}
+
+		case OPVCT: {
+			Byte value = _vCounterHighByte ? static_cast<Byte>((_vCounterLatch >> 8) & 1) : lo8(_vCounterLatch);
+			_vCounterHighByte = !_vCounterHighByte;
+			return value;
+		}
+
+		case STAT77:
+			// the PPU1 version
+			return 0x01;
+
+		case STAT78: {
+			// the PPU2 version, and whether the counters were latched since the last read
+			Byte value = 0x03 | (_countersLatched ? 0x40 : 0x00);
+			_countersLatched = false;
+			_hCounterHighByte = false;
+			_vCounterHighByte = false;
+			return value;
+		}
+
+		default:
+			// everything else is write-only
+			return _bus->unmappedRead(0x2100 | address);
+	}
+};
+
+void Blaze::PPU::writeB(Byte address, Byte value) {
+	if (address >= REGISTER_COUNT) {
+		// $40 through $7F belong to the APU
+		_bus->unmappedWrite(0x2100 | address);
+		return;
+	}
+
+	if (address <= SETINI) {
+		registers[address] = value;
+	}
+
+	switch (address) {
+		case OAMADDL:
+		case OAMADDH:
+			oamAddress = concat16(registers[OAMADDH] & 1, registers[OAMADDL]);
+			_oamInternalAddress = static_cast<Word>(oamAddress << 1);
+			break;
+
+		case OAMDATA:
+			writeOAM(value);
+			break;
+
+		case BG1HOFS:
+		case BG2HOFS:
+		case BG3HOFS:
+		case BG4HOFS: {
+			size_t index = (address - BG1HOFS) / 2;
+			bgHOffset[index] = ((value << 8) | (_bgOffsetLatch & ~7) | (_bgHOffsetLatch & 7)) & 0x3ff;
+			_bgOffsetLatch = value;
+			_bgHOffsetLatch = value;
+
+			// BG1's registers double as mode 7's
+			if (address == BG1HOFS) {
+				m7HOffset = ((value << 8) | _m7Latch) & 0x1fff;
+				_m7Latch = value;
+			}
+			break;
+		}
+
+		case BG1VOFS:
+		case BG2VOFS:
+		case BG3VOFS:
+		case BG4VOFS: {
+			size_t index = (address - BG1VOFS) / 2;
+			bgVOffset[index] = ((value << 8) | _bgOffsetLatch) & 0x3ff;
+			_bgOffsetLatch = value;
+
+			if (address == BG1VOFS) {
+				m7VOffset = ((value << 8) | _m7Latch) & 0x1fff;
+				_m7Latch = value;
+			}
+			break;
+		}
+
+		case VMADDL:
+		case VMADDH:
+			vramAddress = concat16(registers[VMADDH], registers[VMADDL]);
+			_vramPrefetch = vram[vramRemappedAddress()];
+			break;
+
+		case VMDATAL:
+		case VMDATAH:
+			writeVRAM(value, address == VMDATAH);
+			break;
+
+		case M7A:
+		case M7B:
+		case M7C:
+		case M7D:
+			m7Matrix[address - M7A] = static_cast<int16_t>(concat16(value, _m7Latch));
+			_m7Latch = value;
+			break;
+
+		case M7X:
+			m7X = signExtend13(concat16(value, _m7Latch));
+			_m7Latch = value;
+			break;
+
+		case M7Y:
+			m7Y = signExtend13(concat16(value, _m7Latch));
+			_m7Latch = value;
+			break;
+
+		case CGADD:
+			cgramAddress = value;
+			_cgramHighByte = false;
+			break;
+
+		case CGDATA:
+			writeCGRAM(value);
+			break;
+
+		case COLDATA: {
+			// the top 3 bits pick which of the components get set to the intensity in the low 5 bits
+			Word intensity = value & 0x1f;
+			if ((value & 0x20) != 0) {
+				fixedColor = (fixedColor & ~0x001f) | intensity;
+			}
+			if ((value & 0x40) != 0) {
+				fixedColor = (fixedColor & ~0x03e0) | (intensity << 5);
+			}
+			if ((value & 0x80) != 0) {
+				fixedColor = (fixedColor & ~0x7c00) | (intensity << 10);
+			}
+			break;
+		}
+
+		default:
+			if (address > SETINI) {
+				// the read-only registers
+				_bus->unmappedWrite(0x2100 | address);
+			}
+			break;
+	}
+};
+
+bool Blaze::PPU::writeBlockB(Byte address, bool alternating, const Byte* data, size_t size) {
+	switch (address) {
+		case VMDATAL:
+			if (alternating && (registers[VMAIN] & (VMAIN_INCREMENT_AFTER_HIGH | VMAIN_REMAP_MASK | VMAIN_STEP_MASK)) == VMAIN_INCREMENT_AFTER_HIGH) {
+				// the usual way of loading VRAM: whole words, to consecutive addresses
+				_tiles.invalidate(vramAddress, size / 2);
+				for (size_t i = 0; i + 1 < size; i += 2) {
+					vram[vramAddress & (VRAM_WORDS - 1)] = concat16(data[i + 1], data[i]);
+					++vramAddress;
+				}
+				return true;
+			}
+
+			for (size_t i = 0; i < size; ++i) {
+				writeVRAM(data[i], alternating && (i & 1) != 0);
+			}
+			return true;
+
+		case VMDATAH:
+			if (alternating) {
+				return false;
+			}
+			for (size_t i = 0; i < size; ++i) {
+				writeVRAM(data[i], true);
+			}
+			return true;
+
+		case OAMDATA:
+			if (alternating) {
+				return false;
+			}
+			for (size_t i = 0; i < size; ++i) {
+				writeOAM(data[i]);
+			}
+			return true;
+
+		case CGDATA:
+			if (alternating) {
+				return false;
+			}
+			for (size_t i = 0; i < size; ++i) {
+				writeCGRAM(data[i]);
+			}
+			return true;
+
+		default:
+			return false;
+	}
+};
+
+//=== Save States ===
+void Blaze::PPU::saveState(StateWriter& writer) const {
+	for (Word word: vram) {
+		writer.write(word);
+	}
+	for (Word color: cgram) {
+		writer.write(color);
+	}
+	writer.writeBytes(oam.data(), oam.size());
+	writer.write(frameCount);
+
+	writer.writeBytes(registers.data(), registers.size());
+	for (size_t i = 0; i < bgHOffset.size(); ++i) {
+		writer.write(bgHOffset[i]);
+		writer.write(bgVOffset[i]);
+	}
+	writer.write(m7HOffset);
+	writer.write(m7VOffset);
+	for (int16_t value: m7Matrix) {
+		writer.write(value);
+	}
+	writer.write(m7X);
+	writer.write(m7Y);
+	writer.write(vramAddress);
+	writer.write(oamAddress);
+	writer.write(cgramAddress);
+	writer.write(fixedColor);
+
+	writer.write(_bgOffsetLatch);
+	writer.write(_bgHOffsetLatch);
+	writer.write(_m7Latch);
+	writer.write(_vramPrefetch);
+	writer.write(_oamInternalAddress);
+	writer.write(_oamLatch);
+	writer.write(_cgramLatch);
+	writer.write(static_cast<Byte>(_cgramHighByte));
+	writer.write(_hCounterLatch);
+	writer.write(_vCounterLatch);
+	writer.write(static_cast<Byte>(_countersLatched));
+	writer.write(static_cast<Byte>(_hCounterHighByte));
+	writer.write(static_cast<Byte>(_vCounterHighByte));
+
+	// the frame buffer isn't saved; it's redrawn by the next frame anyway
+};
+
+void Blaze::PPU::loadState(StateReader& reader) {
+	for (Word& word: vram) {
+		word = reader.read<Word>();
+	}
+	_tiles.invalidateAll();
+	for (Word& color: cgram) {
+		color = reader.read<Word>();
+	}
+	reader.readBytes(oam.data(), oam.size());
+	frameCount = reader.read<uint64_t>();
+
+	reader.readBytes(registers.data(), registers.size());
+	for (size_t i = 0; i < bgHOffset.size(); ++i) {
+		bgHOffset[i] = reader.read<Word>();
+		bgVOffset[i] = reader.read<Word>();
+	}
+	m7HOffset = reader.read<Word>();
+	m7VOffset = reader.read<Word>();
+	for (int16_t& value: m7Matrix) {
+		value = reader.read<int16_t>();
+	}
+	m7X = reader.read<int16_t>();
+	m7Y = reader.read<int16_t>();
+	vramAddress = reader.read<Word>();
+	oamAddress = reader.read<Word>();
+	cgramAddress = reader.read<Word>() & 0xff;
+	fixedColor = reader.read<Word>();
+
+	_bgOffsetLatch = reader.read<Byte>();
+	_bgHOffsetLatch = reader.read<Byte>();
+	_m7Latch = reader.read<Byte>();
+	_vramPrefetch = reader.read<Word>();
+	_oamInternalAddress = reader.read<Word>();
+	_oamLatch = reader.read<Byte>();
+	_cgramLatch = reader.read<Byte>();
+	_cgramHighByte = reader.read<Byte>() != 0;
+	_hCounterLatch = reader.read<Word>();
+	_vCounterLatch = reader.read<Word>();
+	_countersLatched = reader.read<Byte>() != 0;
+	_hCounterHighByte = reader.read<Byte>() != 0;
+	_vCounterHighByte = reader.read<Byte>() != 0;
+};
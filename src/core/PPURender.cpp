@@ -0,0 +1,845 @@
+#include <blaze/PPU.hpp>
+#include <blaze/util.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+//
+// The scanline renderer. See `PPU.hpp` for the overview.
+//
+// Depth values: each BG mode has a fixed order for the layers (and each layer's two priorities); the tables below
+// number them from back (1) to front, so compositing just keeps the highest number at each pixel. 0 is transparent.
+//
+// Sources: every pixel also remembers where it came from, as the bit CGADSUB uses for it (so that checking whether
+// color math applies is a single AND): BG1-BG4 are bits 0-3, sprites are bit 4, and the backdrop is bit 5. sprites
+// using palettes 0-3 never take part in color math, so they get a bit that CGADSUB doesn't have.
+//
+
+using Blaze::Byte;
+using Blaze::Word;
+using Vector = Blaze::simd::U16Vector;
+
+static constexpr Word SOURCE_OBJ = 0x10;
+static constexpr Word SOURCE_BACKDROP = 0x20;
+static constexpr Word SOURCE_OBJ_NO_MATH = 0x80;
+
+static constexpr size_t OBJ_LAYER = 4;
+static constexpr size_t COLOR_WINDOW = 5;
+
+// bits per pixel of each background, by BG mode (0 for backgrounds the mode doesn't have; mode 7 is special)
+static constexpr Byte BG_DEPTHS[8][4] = {
+	{ 2, 2, 2, 2 },
+	{ 4, 4, 2, 0 },
+	{ 4, 4, 0, 0 },
+	{ 8, 4, 0, 0 },
+	{ 8, 2, 0, 0 },
+	{ 4, 2, 0, 0 },
+	{ 4, 0, 0, 0 },
+	{ 8, 0, 0, 0 },
+};
+
+struct LayerOrder {
+	Word bg[4][2]; // by background, then by tile priority
+	Word obj[4];   // by sprite priority
+};
+
+static constexpr LayerOrder MODE_0_ORDER = { { { 8, 11 }, { 7, 10 }, { 2, 5 }, { 1, 4 } }, { 3, 6, 9, 12 } };
+static constexpr LayerOrder MODE_1_ORDER = { { { 6, 9 }, { 5, 8 }, { 1, 3 }, { 0, 0 } }, { 2, 4, 7, 10 } };
+// (BGMODE bit 3 moves BG3's high priority tiles in front of everything)
+static constexpr LayerOrder MODE_1_BG3_ORDER = { { { 5, 8 }, { 4, 7 }, { 1, 10 }, { 0, 0 } }, { 2, 3, 6, 9 } };
+static constexpr LayerOrder MODE_2_TO_6_ORDER = { { { 3, 7 }, { 1, 5 }, { 0, 0 }, { 0, 0 } }, { 2, 4, 6, 8 } };
+// (mode 7's BG1 has no priority bit; BG2 is EXTBG, which takes its priority from the pixel)
+static constexpr LayerOrder MODE_7_ORDER = { { { 3, 3 }, { 1, 5 }, { 0, 0 }, { 0, 0 } }, { 2, 4, 6, 7 } };
+
+static const LayerOrder& layerOrder(Byte bgMode) {
+	switch (bgMode & 7) {
+		case 0: return MODE_0_ORDER;
+		case 1: return ((bgMode & 0x08) != 0) ? MODE_1_BG3_ORDER : MODE_1_ORDER;
+		case 7: return MODE_7_ORDER;
+		default: return MODE_2_TO_6_ORDER;
+	}
+};
+
+// reverses the order of the pixels in a row from the `TileCache`
+static constexpr uint64_t reverseBytes(uint64_t row) {
+	row = ((row & 0x00ff00ff00ff00ffull) << 8) | ((row >> 8) & 0x00ff00ff00ff00ffull);
+	row = ((row & 0x0000ffff0000ffffull) << 16) | ((row >> 16) & 0x0000ffff0000ffffull);
+	return (row << 32) | (row >> 32);
+};
+
+// packs pixels 1, 3, 5, and 7 of a row into the low 4 bytes (for the hi-res modes)
+static constexpr uint64_t oddBytes(uint64_t row) {
+	row = (row >> 8) & 0x00ff00ff00ff00ffull;
+	row = (row | (row >> 8)) & 0x0000ffff0000ffffull;
+	return (row | (row >> 16)) & 0x00000000ffffffffull;
+};
+
+// a bit for each pixel of a row that isn't 0 (i.e. each opaque pixel), leftmost pixel in the lowest bit
+static constexpr unsigned opaqueBits(uint64_t row) {
+	// (a 1 in each opaque pixel's byte first, which the multiply then gathers into the top byte)
+	uint64_t bytes = ((((row & 0x7f7f7f7f7f7f7f7full) + 0x7f7f7f7f7f7f7f7full) | row) >> 7) & 0x0101010101010101ull;
+	return static_cast<unsigned>((bytes * 0x0102040810204080ull) >> 56);
+};
+
+// by `opaqueBits`, 0xffff for each opaque pixel and 0 for the rest (4 pixels to each `uint64_t`)
+static constexpr auto OPAQUE_MASKS = [] {
+	std::array<std::array<uint64_t, 2>, 256> table {};
+	for (unsigned bits = 0; bits < 256; ++bits) {
+		for (unsigned pixel = 0; pixel < 8; ++pixel) {
+			if (((bits >> pixel) & 1) != 0) {
+				table[bits][pixel / 4] |= uint64_t(0xffff) << ((pixel % 4) * 16);
+			}
+		}
+	}
+	return table;
+}();
+
+// 8bpp pixels can be BGR233 colors instead of palette indices, with 3 more bits from the tile's palette number
+static constexpr Word directColor(Byte pixel, Byte palette) {
+	return static_cast<Word>(
+		((pixel & 0x07) << 2) | ((palette & 1) << 1) |
+		((pixel & 0x38) << 4) | ((palette & 2) << 5) |
+		((pixel & 0xc0) << 7) | ((palette & 4) << 10)
+	);
+};
+
+void Blaze::PPU::renderLine(unsigned line) {
+	Word* destination = &frameBuffer[(line - FIRST_VISIBLE_LINE) * SCREEN_WIDTH];
+
+	// forced blank
+	if ((registers[INIDISP] & 0x80) != 0) {
+		std::fill(destination, destination + SCREEN_WIDTH, Word(0));
+		return;
+	}
+
+	Byte mode = registers[BGMODE] & 7;
+	Byte mainLayers = registers[TM] & 0x1f;
+	Byte subLayers = registers[TS] & 0x1f;
+	bool useSubScreen = (registers[CGWSEL] & 0x02) != 0;
+
+	// the layers this mode has
+	Byte modeLayers = 0x10;
+	for (size_t index = 0; index < 4; ++index) {
+		if (BG_DEPTHS[mode][index] != 0) {
+			modeLayers |= 1 << index;
+		}
+	}
+	if (mode == 7 && (registers[SETINI] & 0x40) != 0) {
+		modeLayers |= 0x02;
+	}
+	mainLayers &= modeLayers;
+	subLayers = useSubScreen ? (subLayers & modeLayers) : 0;
+
+	computeWindows();
+
+	Byte layers = mainLayers | subLayers;
+	if (mode == 7) {
+		if ((layers & 0x03) != 0) {
+			renderMode7(line, _layers[0], ((layers & 0x02) != 0) ? &_layers[1] : nullptr);
+		}
+	} else {
+		// a BG that's windowed on every screen it's on doesn't need drawing where the window covers it, since
+		// `composite` hides it there anyway (unless it's mosaicked, which spreads pixels sideways)
+		Byte windowedLayers = static_cast<Byte>(
+			~(mainLayers & ~registers[TMW]) & ~(subLayers & ~registers[TSW]) & ~registers[MOSAIC]);
+		for (size_t index = 0; index < 4; ++index) {
+			if ((layers & (1 << index)) != 0) {
+				const Word* hidden = ((windowedLayers & (1 << index)) != 0) ? _windowMasks[index].data() : nullptr;
+				renderBackground(index, line, hidden, _layers[index]);
+			}
+		}
+	}
+	for (size_t index = 0; index < 4; ++index) {
+		if ((layers & (1 << index)) != 0 && (registers[MOSAIC] & (1 << index)) != 0) {
+			applyMosaic(_layers[index]);
+		}
+	}
+	if ((layers & 0x10) != 0) {
+		findSprites();
+		renderSprites(line, _layers[OBJ_LAYER]);
+	}
+
+	composite(mainLayers, registers[TMW], cgram[0], _mainScreen);
+	if (useSubScreen) {
+		// the sub screen's backdrop is the fixed color
+		composite(subLayers, registers[TSW], fixedColor, _subScreen);
+	}
+	applyColorMath(destination);
+};
+
+void Blaze::PPU::renderBackground(size_t index, unsigned line, const Word* hidden, LayerLine& out) const {
+	Byte bgMode = registers[BGMODE];
+	Byte mode = bgMode & 7;
+	Byte depth = BG_DEPTHS[mode][index];
+	const LayerOrder& order = layerOrder(bgMode);
+
+	// (decoded up front, so that the columns below don't have to check)
+	TileCache::DecodedTiles tiles = _tiles.decodeDirty(depth);
+
+	Word characterBase = static_cast<Word>(((registers[BG12NBA + index / 2] >> ((index & 1) * 4)) & 0x0f) << 12);
+	size_t firstTile = characterBase / (depth * 4u);
+
+	// hi-res modes always use 16 pixel wide tiles (and are sampled at every other pixel)
+	bool hires = mode == 5 || mode == 6;
+	bool largeTiles = (bgMode & (0x10 << index)) != 0;
+	unsigned tileWidthShift = (largeTiles || hires) ? 4 : 3;
+	unsigned tileHeightShift = largeTiles ? 4 : 3;
+
+	Word paletteBase = (mode == 0) ? static_cast<Word>(index * 32) : 0;
+	unsigned paletteSize = 1u << depth;
+	bool direct = depth == 8 && (registers[CGWSEL] & 0x01) != 0;
+
+	// offset-per-tile: BG3's tilemap holds scroll values for each column of BG1 and BG2
+	bool offsetPerTile = (mode == 2 || mode == 4 || mode == 6) && index < 2;
+	Word offsetEnable = (index == 0) ? 0x2000 : 0x4000;
+
+	// vertical mosaic repeats the first line of each block
+	unsigned y = line;
+	if ((registers[MOSAIC] & (1 << index)) != 0) {
+		y -= (line - FIRST_VISIBLE_LINE) % ((registers[MOSAIC] >> 4) + 1u);
+	}
+
+	// the tilemap is 1 to 4 screens of 32x32 tiles. entries are found in two steps, since the row only changes between
+	// columns with offset-per-tile: the address of a row, then the entry in it. (`settings` is the BGnSC value)
+	auto tilemapRow = [&](Byte settings, unsigned tileY) {
+		unsigned address = ((settings & 0xfc) << 8) + ((tileY & 0x1f) << 5);
+		if ((tileY & 0x20) != 0 && (settings & 0x02) != 0) {
+			address += ((settings & 0x01) != 0) ? 0x800 : 0x400;
+		}
+		return address;
+	};
+	auto tilemapEntry = [&](Byte settings, unsigned rowAddress, unsigned tileX) {
+		unsigned address = rowAddress + (tileX & 0x1f);
+		if ((tileX & 0x20) != 0 && (settings & 0x01) != 0) {
+			address += 0x400;
+		}
+		return vram[address & (VRAM_WORDS - 1)];
+	};
+
+	Byte screenSettings = registers[BG1SC + index];
+	Word hScroll = bgHOffset[index];
+	Word vScroll = bgVOffset[index];
+	int fineScroll = hScroll & 7;
+
+	// the columns are drawn by one of two versions of the same loop: one for the usual case (8x8 tiles, and none of
+	// offset-per-tile, hi-res, or direct color), and one for everything. this is where most of a frame's time goes,
+	// and the usual version has few enough things to keep track of that they all fit in registers.
+	auto drawColumns = [&](auto usualCase) {
+		constexpr bool USUAL = decltype(usualCase)::value;
+		unsigned widthShift = USUAL ? 3 : tileWidthShift;
+		unsigned heightShift = USUAL ? 3 : tileHeightShift;
+		unsigned heightMask = (1u << heightShift) - 1;
+
+		// the line of the tilemap that `rowEntries` is for, and that row's entries on the left and right screens (which
+		// are the same screen when there's only one across)
+		unsigned rowY = ~0u;
+		const Word* rowEntries[2] = {};
+
+		// draws the `column`th column of the line (counting the one that's partly off the left edge, if any)
+		auto drawColumn = [&](unsigned column, Word* columnColors, Word* columnDepths) {
+			Word columnHScroll = hScroll;
+			Word columnVScroll = vScroll;
+			if (!USUAL && offsetPerTile && column > 0) {
+				// the entries for each column are in BG3's first two rows, scrolled by BG3's scroll values
+				unsigned offsetX = ((column - 1) * 8 + (bgHOffset[2] & ~7)) & 0x3ff;
+				unsigned offsetY = bgVOffset[2];
+				Word hEntry = tilemapEntry(registers[BG3SC], tilemapRow(registers[BG3SC], offsetY / 8), offsetX / 8);
+				Word vEntry = tilemapEntry(registers[BG3SC], tilemapRow(registers[BG3SC], offsetY / 8 + 1), offsetX / 8);
+				if (mode == 4) {
+					// mode 4 only has one row; bit 15 says which scroll value it replaces
+					vEntry = ((hEntry & 0x8000) != 0) ? hEntry : 0;
+					hEntry = ((hEntry & 0x8000) != 0) ? 0 : hEntry;
+				}
+				if ((hEntry & offsetEnable) != 0) {
+					columnHScroll = static_cast<Word>((hEntry & 0x3f8) | (hScroll & 7));
+				}
+				if ((vEntry & offsetEnable) != 0) {
+					columnVScroll = vEntry & 0x3ff;
+				}
+			}
+
+			// the pixel in the tilemap that this column starts at (in hi-res pixels for the hi-res modes)
+			unsigned px = (column * 8 + (columnHScroll & ~7u)) & 0x3ff;
+			if (!USUAL && hires) {
+				px = (px * 2) & 0x3ff;
+			}
+			unsigned py = (y + columnVScroll) & 0x3ff;
+			if (py != rowY) {
+				rowY = py;
+				unsigned rowAddress = tilemapRow(screenSettings, py >> heightShift);
+				rowEntries[0] = &vram[rowAddress & (VRAM_WORDS - 1)];
+				rowEntries[1] = &vram[(rowAddress + (((screenSettings & 0x01) != 0) ? 0x400 : 0)) & (VRAM_WORDS - 1)];
+			}
+
+			// flips are all over the place in most tilemaps, so they're applied without branching on them. (flipping
+			// a row vertically is the same as XORing it with the last row, since tiles are 8 or 16 rows tall.)
+			unsigned tileX = px >> widthShift;
+			Word entry = rowEntries[(tileX >> 5) & 1][tileX & 0x1f];
+			unsigned hFlip = (entry >> 14) & 1;
+			unsigned row = (py & heightMask) ^ (heightMask & (0u - (entry >> 15)));
+
+			// 16 pixel tiles are made of 8x8 ones: +1 to the right, +16 below
+			Word name = static_cast<Word>((entry & 0x3ff) + ((row >= 8) ? 16 : 0));
+			auto tileRow = [&](unsigned half) {
+				return tiles.row(firstTile + ((name + half) & 0x3ff), row & 7);
+			};
+			auto flip = [&](uint64_t pixels) {
+				return pixels ^ ((pixels ^ reverseBytes(pixels)) & (uint64_t(0) - hFlip));
+			};
+
+			// the column's 8 pixels, in the order they're shown
+			uint64_t pixels;
+			if (!USUAL && hires) {
+				// every other pixel of both halves
+				uint64_t left = flip(tileRow(hFlip));
+				uint64_t right = flip(tileRow(hFlip ^ 1));
+				pixels = oddBytes(left) | (oddBytes(right) << 32);
+			} else {
+				unsigned half = (widthShift == 4) ? (((px >> 3) & 1) ^ hFlip) : 0;
+				pixels = flip(tileRow(half));
+			}
+
+			if (pixels == 0) {
+				std::fill(columnDepths, columnDepths + 8, Word(0));
+				return;
+			}
+
+			Word tileDepth = order.bg[index][(entry >> 13) & 1];
+			Byte palette = (entry >> 10) & 7;
+			Word paletteStart = static_cast<Word>(paletteBase + palette * paletteSize);
+
+			// every pixel is written whether it's transparent or not (transparent ones just get a depth of 0),
+			// since that's a lot cheaper than branching on pixels that are all over the place. the depths are done
+			// 4 pixels at a time, masked by which pixels are opaque.
+			const auto& opaque = OPAQUE_MASKS[opaqueBits(pixels)];
+			uint64_t tileDepths = tileDepth * 0x0001000100010001ull;
+			uint64_t leftDepths = opaque[0] & tileDepths;
+			uint64_t rightDepths = opaque[1] & tileDepths;
+			std::memcpy(columnDepths, &leftDepths, sizeof(leftDepths));
+			std::memcpy(columnDepths + 4, &rightDepths, sizeof(rightDepths));
+
+			// (the colors are looked up from the row's bytes in memory, which takes fewer instructions than
+			// shifting each one out of `pixels`; the palette lookups are written out, since a loop's own
+			// bookkeeping would be about as much work as they are.)
+			Byte indices[8];
+			std::memcpy(indices, &pixels, sizeof(indices));
+			if (!USUAL && direct) {
+				for (unsigned pixel = 0; pixel < 8; ++pixel) {
+					columnColors[pixel] = directColor(indices[pixel], palette);
+				}
+			} else {
+				const Word* paletteColors = &cgram[paletteStart & 0xff];
+				columnColors[0] = paletteColors[indices[0]];
+				columnColors[1] = paletteColors[indices[1]];
+				columnColors[2] = paletteColors[indices[2]];
+				columnColors[3] = paletteColors[indices[3]];
+				columnColors[4] = paletteColors[indices[4]];
+				columnColors[5] = paletteColors[indices[5]];
+				columnColors[6] = paletteColors[indices[6]];
+				columnColors[7] = paletteColors[indices[7]];
+			}
+		};
+
+		// every column is drawn whole, straight into the line where it's all on screen. (when the line is scrolled by
+		// a few pixels, the columns at either end hang over it: those are drawn into `edgeColors` and `edgeDepths`
+		// first, and only their visible part is copied over.) columns that are all `hidden` are skipped.
+		Word edgeColors[8];
+		Word edgeDepths[8];
+		unsigned columns = (fineScroll != 0) ? SCREEN_WIDTH / 8 + 1 : SCREEN_WIDTH / 8;
+		for (unsigned column = 0; column < columns; ++column) {
+			int screenX = static_cast<int>(column * 8) - fineScroll;
+			bool edge = screenX < 0 || screenX > static_cast<int>(SCREEN_WIDTH) - 8;
+			if (hidden != nullptr && !edge) {
+				uint64_t halves[2];
+				std::memcpy(halves, &hidden[screenX], sizeof(halves));
+				if ((halves[0] & halves[1]) == ~uint64_t(0)) {
+					continue;
+				}
+			}
+			drawColumn(column, edge ? edgeColors : &out.color[screenX], edge ? edgeDepths : &out.depth[screenX]);
+
+			if (edge) {
+				int first = std::max(0, -screenX);
+				int last = std::min(8, static_cast<int>(SCREEN_WIDTH) - screenX);
+				std::copy(edgeColors + first, edgeColors + last, out.color.data() + screenX + first);
+				std::copy(edgeDepths + first, edgeDepths + last, out.depth.data() + screenX + first);
+			}
+		}
+	};
+	if (!largeTiles && !offsetPerTile && !hires && !direct) {
+		drawColumns(std::true_type {});
+	} else {
+		drawColumns(std::false_type {});
+	}
+};
+
+void Blaze::PPU::renderMode7(unsigned line, LayerLine& bg1, LayerLine* bg2) const {
+	Byte settings = registers[M7SEL];
+	bool hFlip = (settings & 0x01) != 0;
+	bool vFlip = (settings & 0x02) != 0;
+	Byte screenOver = settings >> 6;
+	bool direct = (registers[CGWSEL] & 0x01) != 0;
+	const LayerOrder& order = MODE_7_ORDER;
+
+	// the same math as the hardware, including where it drops precision
+	auto clip = [](int value) {
+		return ((value & 0x2000) != 0) ? (value | ~0x3ff) : (value & 0x3ff);
+	};
+	auto signExtend = [](Word value) {
+		return static_cast<int>(static_cast<int16_t>(value << 3) >> 3);
+	};
+
+	int a = m7Matrix[0];
+	int b = m7Matrix[1];
+	int c = m7Matrix[2];
+	int d = m7Matrix[3];
+	int centerX = m7X;
+	int centerY = m7Y;
+	int hScroll = signExtend(m7HOffset);
+	int vScroll = signExtend(m7VOffset);
+
+	int y = static_cast<int>(vFlip ? (255 - line) : line);
+	int startX = ((a * clip(hScroll - centerX)) & ~63) + ((b * clip(vScroll - centerY)) & ~63) + ((b * y) & ~63) + (centerX << 8);
+	int startY = ((c * clip(hScroll - centerX)) & ~63) + ((d * clip(vScroll - centerY)) & ~63) + ((d * y) & ~63) + (centerY << 8);
+
+	bg1.depth.fill(0);
+	if (bg2 != nullptr) {
+		bg2->depth.fill(0);
+	}
+
+	for (int x = 0; x < static_cast<int>(SCREEN_WIDTH); ++x) {
+		int sx = hFlip ? (255 - x) : x;
+		int px = (startX + a * sx) >> 8;
+		int py = (startY + c * sx) >> 8;
+
+		// the playing field is 1024x1024 pixels; screen over decides what's outside of it
+		Byte tile;
+		if (((px | py) & ~0x3ff) == 0 || screenOver < 2) {
+			tile = static_cast<Byte>(vram[((py & 0x3ff) >> 3) * 128 + ((px & 0x3ff) >> 3)]);
+		} else if (screenOver == 2) {
+			continue;
+		} else {
+			tile = 0;
+		}
+		auto pixel = static_cast<Byte>(vram[tile * 64 + (py & 7) * 8 + (px & 7)] >> 8);
+
+		if (pixel != 0) {
+			bg1.color[x] = direct ? directColor(pixel, 0) : cgram[pixel];
+			bg1.depth[x] = order.bg[0][0];
+		}
+
+		// EXTBG: the same pixels as 7-bit colors, with a priority bit
+		if (bg2 != nullptr && (pixel & 0x7f) != 0) {
+			bg2->color[x] = cgram[pixel & 0x7f];
+			bg2->depth[x] = order.bg[1][pixel >> 7];
+		}
+	}
+};
+
+// (small, large) sizes, by OBSEL's size bits
+static constexpr Byte SPRITE_SIZES[8][2][2] = {
+	{ { 8, 8 }, { 16, 16 } },
+	{ { 8, 8 }, { 32, 32 } },
+	{ { 8, 8 }, { 64, 64 } },
+	{ { 16, 16 }, { 32, 32 } },
+	{ { 16, 16 }, { 64, 64 } },
+	{ { 32, 32 }, { 64, 64 } },
+	{ { 16, 32 }, { 32, 64 } },
+	{ { 16, 32 }, { 32, 32 } },
+};
+
+void Blaze::PPU::findSprites() {
+	// with priority rotation, the sprite OAMADD points at comes first
+	unsigned first = ((registers[OAMADDH] & 0x80) != 0) ? ((oamAddress >> 1) & 0x7f) : 0;
+
+	// OAM is usually only written during V-blank, so this is hardly ever more than once a frame
+	if (_lineSpritesValid && _lineSpritesFirst == first && _lineSpritesOBSEL == registers[OBSEL] && _lineSpritesOAM == oam) {
+		return;
+	}
+	_lineSpritesValid = true;
+	_lineSpritesFirst = first;
+	_lineSpritesOBSEL = registers[OBSEL];
+	_lineSpritesOAM = oam;
+
+	// each sprite is added to the lines it's on, until they're full
+	const auto& sizes = SPRITE_SIZES[registers[OBSEL] >> 5];
+	_lineSpriteCounts.fill(0);
+	for (unsigned n = 0; n < 128; ++n) {
+		unsigned sprite = (first + n) & 0x7f;
+		const Byte* entry = &oam[sprite * 4];
+		Byte extra = static_cast<Byte>(oam[0x200 + sprite / 4] >> ((sprite & 3) * 2));
+
+		// sprites entirely off the left edge aren't found at all (so they don't count towards the limit)
+		int x = entry[0] | ((extra & 0x01) << 8);
+		if (x >= 256) {
+			x -= 512;
+		}
+		const Byte* size = sizes[(extra >> 1) & 1];
+		if (x <= -static_cast<int>(size[0])) {
+			continue;
+		}
+
+		// (sprites wrap around from the bottom of the screen to the top)
+		for (unsigned dy = 0; dy < size[1]; ++dy) {
+			unsigned spriteLine = (entry[1] + dy) & 0xff;
+			if (spriteLine < SCREEN_HEIGHT && _lineSpriteCounts[spriteLine] < SPRITES_PER_LINE) {
+				_lineSprites[spriteLine][_lineSpriteCounts[spriteLine]++] = static_cast<Byte>(sprite);
+			}
+		}
+	}
+};
+
+void Blaze::PPU::renderSprites(unsigned line, LayerLine& out) const {
+	Byte objectSelect = registers[OBSEL];
+	const auto& sizes = SPRITE_SIZES[objectSelect >> 5];
+	Word nameBase = static_cast<Word>((objectSelect & 0x07) << 13);
+	Word nameGap = static_cast<Word>((((objectSelect >> 3) & 0x03) + 1) << 12);
+	const LayerOrder& order = layerOrder(registers[BGMODE]);
+
+	out.depth.fill(0);
+	TileCache::DecodedTiles tiles = _tiles.decodeDirty(4);
+
+	// (`findSprites` has already found the sprites on this line)
+	unsigned spriteLine = line - FIRST_VISIBLE_LINE;
+	const auto& lineSprites = _lineSprites[spriteLine];
+
+	// they're drawn back to front: earlier sprites win, whatever their priority, so they're just drawn over the later
+	// ones. (that way, no pixel has to check what's already there.)
+	for (unsigned n = _lineSpriteCounts[spriteLine]; n-- > 0;) {
+		unsigned sprite = lineSprites[n];
+		const Byte* entry = &oam[sprite * 4];
+		Byte extra = static_cast<Byte>(oam[0x200 + sprite / 4] >> ((sprite & 3) * 2));
+
+		int x = entry[0] | ((extra & 0x01) << 8);
+		if (x >= 256) {
+			x -= 512;
+		}
+		const Byte* size = sizes[(extra >> 1) & 1];
+		unsigned width = size[0];
+		unsigned height = size[1];
+		unsigned dy = (spriteLine - entry[1]) & 0xff;
+		if ((entry[3] & 0x80) != 0) {
+			dy = height - 1 - dy;
+		}
+
+		Byte attributes = entry[3];
+		bool hFlip = (attributes & 0x40) != 0;
+		Byte palette = (attributes >> 1) & 7;
+		Word spriteDepth = order.obj[(attributes >> 4) & 3];
+		Word source = (palette >= 4) ? SOURCE_OBJ : SOURCE_OBJ_NO_MATH;
+		const Word* paletteColors = &cgram[128 + palette * 16];
+		uint64_t spriteDepths = spriteDepth * 0x0001000100010001ull;
+		uint64_t sources = source * 0x0001000100010001ull;
+
+		// the tiles wrap around within the 16x16 grid of the name table
+		Word tile = entry[2];
+		Word base = static_cast<Word>(nameBase + (((attributes & 0x01) != 0) ? nameGap : 0));
+		size_t firstTile = base / 16;
+
+		for (unsigned tileX = 0; tileX < width / 8; ++tileX) {
+			int screenX = x + static_cast<int>(tileX * 8);
+			if (screenX >= static_cast<int>(SCREEN_WIDTH)) {
+				break;
+			}
+			if (screenX <= -8) {
+				continue;
+			}
+
+			unsigned column = hFlip ? (width / 8 - 1 - tileX) : tileX;
+			Word name = static_cast<Word>((((tile & 0xf0) + ((dy >> 3) << 4)) & 0xf0) | ((tile + column) & 0x0f));
+			uint64_t pixels = tiles.row(firstTile + name, dy & 7);
+			if (pixels == 0) {
+				continue;
+			}
+			if (hFlip) {
+				pixels = reverseBytes(pixels);
+			}
+
+			Byte indices[8];
+			std::memcpy(indices, &pixels, sizeof(indices));
+
+			// most tiles are all on screen. like the backgrounds' columns, those are written whole, with what was
+			// already there kept where the tile is transparent (4 pixels at a time, masked by which pixels are
+			// opaque), rather than branching on pixels that are all over the place.
+			if (screenX >= 0 && screenX <= static_cast<int>(SCREEN_WIDTH) - 8) {
+				const auto& opaque = OPAQUE_MASKS[opaqueBits(pixels)];
+				Word colors[8] = {
+					paletteColors[indices[0]], paletteColors[indices[1]], paletteColors[indices[2]], paletteColors[indices[3]],
+					paletteColors[indices[4]], paletteColors[indices[5]], paletteColors[indices[6]], paletteColors[indices[7]],
+				};
+				uint64_t leftColors;
+				uint64_t rightColors;
+				std::memcpy(&leftColors, colors, sizeof(leftColors));
+				std::memcpy(&rightColors, colors + 4, sizeof(rightColors));
+
+				size_t sx = static_cast<size_t>(screenX);
+				auto blend = [&](Word* destination, uint64_t left, uint64_t right) {
+					uint64_t before[2];
+					std::memcpy(before, destination, sizeof(before));
+					before[0] = (before[0] & ~opaque[0]) | (left & opaque[0]);
+					before[1] = (before[1] & ~opaque[1]) | (right & opaque[1]);
+					std::memcpy(destination, before, sizeof(before));
+				};
+				blend(&out.color[sx], leftColors, rightColors);
+				blend(&out.depth[sx], spriteDepths, spriteDepths);
+				blend(&out.source[sx], sources, sources);
+				continue;
+			}
+
+			unsigned firstPixel = (screenX < 0) ? static_cast<unsigned>(-screenX) : 0;
+			unsigned lastPixel = std::min(8u, static_cast<unsigned>(static_cast<int>(SCREEN_WIDTH) - screenX));
+			for (unsigned pixel = firstPixel; pixel < lastPixel; ++pixel) {
+				Byte color = indices[pixel];
+				if (color != 0) {
+					size_t sx = static_cast<size_t>(screenX + static_cast<int>(pixel));
+					out.color[sx] = paletteColors[color];
+					out.depth[sx] = spriteDepth;
+					out.source[sx] = source;
+				}
+			}
+		}
+	}
+};
+
+void Blaze::PPU::applyMosaic(LayerLine& out) const {
+	unsigned size = (registers[MOSAIC] >> 4) + 1u;
+	if (size == 1) {
+		return;
+	}
+	for (unsigned x = 0; x < SCREEN_WIDTH; ++x) {
+		unsigned from = x - x % size;
+		out.color[x] = out.color[from];
+		out.depth[x] = out.depth[from];
+	}
+};
+
+void Blaze::PPU::computeWindows() {
+	// the window registers hardly ever change between lines, so the masks are only worked out again when they do
+	const Byte* settingsRegisters = &registers[W12SEL];
+	if (_windowMasksValid && std::equal(_windowRegisters.begin(), _windowRegisters.end(), settingsRegisters)) {
+		return;
+	}
+	std::copy(settingsRegisters, settingsRegisters + _windowRegisters.size(), _windowRegisters.begin());
+	_windowMasksValid = true;
+
+	alignas(simd::ALIGNMENT) std::array<Word, SCREEN_WIDTH> window1;
+	alignas(simd::ALIGNMENT) std::array<Word, SCREEN_WIDTH> window2;
+	for (unsigned x = 0; x < SCREEN_WIDTH; ++x) {
+		window1[x] = (x >= registers[WH0] && x <= registers[WH1]) ? 0xffff : 0;
+		window2[x] = (x >= registers[WH2] && x <= registers[WH3]) ? 0xffff : 0;
+	}
+
+	// 4 bits of settings (enable and invert for each window) and 2 bits of logic for each of the 6 masks
+	const Byte settings[6] = {
+		static_cast<Byte>(registers[W12SEL] & 0x0f), static_cast<Byte>(registers[W12SEL] >> 4),
+		static_cast<Byte>(registers[W34SEL] & 0x0f), static_cast<Byte>(registers[W34SEL] >> 4),
+		static_cast<Byte>(registers[WOBJSEL] & 0x0f), static_cast<Byte>(registers[WOBJSEL] >> 4),
+	};
+	const Byte logic[6] = {
+		static_cast<Byte>(registers[WBGLOG] & 3), static_cast<Byte>((registers[WBGLOG] >> 2) & 3),
+		static_cast<Byte>((registers[WBGLOG] >> 4) & 3), static_cast<Byte>(registers[WBGLOG] >> 6),
+		static_cast<Byte>(registers[WOBJLOG] & 3), static_cast<Byte>((registers[WOBJLOG] >> 2) & 3),
+	};
+
+	for (size_t mask = 0; mask < _windowMasks.size(); ++mask) {
+		bool enable1 = (settings[mask] & 0x02) != 0;
+		bool enable2 = (settings[mask] & 0x08) != 0;
+		Vector invert1 = Vector::broadcast(((settings[mask] & 0x01) != 0) ? 0xffff : 0);
+		Vector invert2 = Vector::broadcast(((settings[mask] & 0x04) != 0) ? 0xffff : 0);
+		Word* out = _windowMasks[mask].data();
+
+		if (!enable1 && !enable2) {
+			std::fill(out, out + SCREEN_WIDTH, Word(0));
+			continue;
+		}
+
+		for (size_t x = 0; x < SCREEN_WIDTH; x += Vector::LANES) {
+			Vector inside1 = Vector::load(&window1[x]) ^ invert1;
+			Vector inside2 = Vector::load(&window2[x]) ^ invert2;
+			Vector inside;
+			if (enable1 && enable2) {
+				switch (logic[mask]) {
+					case 0: inside = inside1 | inside2; break;
+					case 1: inside = inside1 & inside2; break;
+					case 2: inside = inside1 ^ inside2; break;
+					default: inside = inside1 ^ inside2 ^ Vector::broadcast(0xffff); break;
+				}
+			} else {
+				inside = enable1 ? inside1 : inside2;
+			}
+			inside.store(out + x);
+		}
+	}
+};
+
+void Blaze::PPU::composite(Byte layerMask, Byte windowMask, Word backdrop, LayerLine& out) const {
+	// every pixel of a BG has the same source, so BGs' come from here instead (only sprites fill in their own)
+	static constexpr auto BG_SOURCES = [] {
+		std::array<std::array<Word, SCREEN_WIDTH>, 4> sources {};
+		for (size_t index = 0; index < sources.size(); ++index) {
+			for (Word& source: sources[index]) {
+				source = static_cast<Word>(1 << index);
+			}
+		}
+		return sources;
+	}();
+	// (and layers that aren't windowed use this as their window, which hides nothing)
+	static constexpr std::array<Word, SCREEN_WIDTH> NO_WINDOW {};
+
+	struct Layer {
+		const Word* color;
+		const Word* depth;
+		const Word* source;
+		const Word* window;
+	};
+	Layer layers[5];
+	size_t layerCount = 0;
+	for (size_t index = 0; index < _layers.size(); ++index) {
+		if ((layerMask & (1 << index)) != 0) {
+			const LayerLine& layer = _layers[index];
+			layers[layerCount++] = Layer {
+				layer.color.data(),
+				layer.depth.data(),
+				(index == OBJ_LAYER) ? layer.source.data() : BG_SOURCES[index].data(),
+				((windowMask & (1 << index)) != 0) ? _windowMasks[index].data() : NO_WINDOW.data(),
+			};
+		}
+	}
+
+	Vector backdropColor = Vector::broadcast(backdrop);
+	Vector backdropSource = Vector::broadcast(SOURCE_BACKDROP);
+	Vector zero = Vector::broadcast(0);
+
+	for (size_t x = 0; x < SCREEN_WIDTH; x += Vector::LANES) {
+		Vector bestColor = backdropColor;
+		Vector bestDepth = zero;
+		Vector bestSource = backdropSource;
+
+		for (size_t i = 0; i < layerCount; ++i) {
+			const Layer& layer = layers[i];
+			// the window hides the layer wherever it's "inside"
+			Vector depth = Vector::andNot(Vector::load(&layer.window[x]), Vector::load(&layer.depth[x]));
+
+			Vector inFront = Vector::greaterThan(depth, bestDepth);
+			bestDepth = Vector::max(depth, bestDepth);
+			bestColor = Vector::select(inFront, Vector::load(&layer.color[x]), bestColor);
+			bestSource = Vector::select(inFront, Vector::load(&layer.source[x]), bestSource);
+		}
+
+		bestColor.store(&out.color[x]);
+		bestDepth.store(&out.depth[x]);
+		bestSource.store(&out.source[x]);
+	}
+};
+
+void Blaze::PPU::applyColorMath(Word* destination) const {
+	Byte selection = registers[CGWSEL];
+	Byte settings = registers[CGADSUB];
+	Byte clipMode = selection >> 6;       // where the main screen is clipped to black: never, outside, inside, always
+	Byte preventMode = (selection >> 4) & 3; // where color math is allowed: always, inside, outside, never
+	bool useSubScreen = (selection & 0x02) != 0;
+	bool subtract = (settings & 0x80) != 0;
+	bool half = (settings & 0x40) != 0;
+	Byte mathSources = settings & 0x3f;
+	bool anyMath = mathSources != 0 && preventMode != 3;
+	Byte brightness = registers[INIDISP] & 0x0f;
+
+	const Vector all = Vector::broadcast(0xffff);
+	const Vector none = Vector::broadcast(0);
+	const Vector componentMask = Vector::broadcast(0x1f);
+	const Vector fixed = Vector::broadcast(fixedColor);
+	const Vector brightnessFactor = Vector::broadcast(static_cast<Word>(brightness + 1));
+	const Vector mathSourceBits = Vector::broadcast(mathSources);
+
+	// where the main screen is clipped, and where color math is allowed, are both `(window & a) ^ b`
+	const Vector clipAnd = (clipMode == 1 || clipMode == 2) ? all : none;
+	const Vector clipXor = (clipMode == 1 || clipMode == 3) ? all : none;
+	const Vector allowedAnd = (preventMode == 1 || preventMode == 2) ? all : none;
+	const Vector allowedXor = (preventMode == 1) ? none : all;
+
+	auto component = [&](Vector color, int shift) {
+		switch (shift) {
+			case 0: return color & componentMask;
+			case 5: return color.shiftRight<5>() & componentMask;
+			default: return color.shiftRight<10>() & componentMask;
+		}
+	};
+
+	// the math is done on all three components at once, each in its own bits of the lane. that needs a spare bit above
+	// each component for what carries out of it (or borrows from it), but there's only one above blue, so subtracting
+	// does red and blue first, then green.
+	const Vector componentLowBits = Vector::broadcast(0x0421);
+	const Vector componentHighBits = Vector::broadcast(0x4210);
+	const Vector redBlue = Vector::broadcast(0x7c1f);
+	const Vector redBlueBorrowBits = Vector::broadcast(0x8020);
+	const Vector green = Vector::broadcast(0x03e0);
+	const Vector greenBorrowBit = Vector::broadcast(0x0400);
+
+	// a mask of the component below each of the given carry bits
+	auto belowCarries = [](Vector carries) {
+		return carries - carries.shiftRight<5>();
+	};
+	// a - b for each component, or 0 where b is bigger
+	auto subtractComponents = [&](Vector a, Vector b) {
+		Vector redAndBlue = ((a & redBlue) | redBlueBorrowBits) - (b & redBlue);
+		Vector greenOnly = ((a & green) | greenBorrowBit) - (b & green);
+		return (redAndBlue & belowCarries(redAndBlue & redBlueBorrowBits)) | (greenOnly & belowCarries(greenOnly & greenBorrowBit));
+	};
+	// (a + b) / 2 for each component
+	auto averageComponents = [&](Vector a, Vector b) {
+		return (a & b) + Vector::andNot(componentLowBits, a ^ b).shiftRight<1>();
+	};
+	// a + b for each component, up to 31. (the components that go over are the ones whose average is 16 or more, which
+	// can't be told from the sum itself, since what carries out of one component changes the next.)
+	auto addComponents = [&](Vector a, Vector b) {
+		Vector carries = (averageComponents(a, b) & componentHighBits).shiftLeft<1>();
+		return ((a + b) - carries) | belowCarries(carries);
+	};
+
+	for (size_t x = 0; x < SCREEN_WIDTH; x += Vector::LANES) {
+		Vector color = Vector::load(&_mainScreen.color[x]);
+		Vector window = Vector::load(&_windowMasks[COLOR_WINDOW][x]);
+
+		Vector clip = (window & clipAnd) ^ clipXor;
+		color = Vector::andNot(clip, color);
+
+		if (anyMath) {
+			Vector allowed = (window & allowedAnd) ^ allowedXor;
+			Vector noMath = Vector::equal(Vector::load(&_mainScreen.source[x]) & mathSourceBits, none);
+			allowed = Vector::andNot(noMath, allowed);
+
+			Vector other = fixed;
+			Vector halve = half ? Vector::andNot(clip, all) : none;
+			if (useSubScreen) {
+				other = Vector::load(&_subScreen.color[x]);
+				// halving is skipped where the sub screen is showing its backdrop
+				Vector subBackdrop = Vector::equal(Vector::load(&_subScreen.source[x]), Vector::broadcast(SOURCE_BACKDROP));
+				halve = Vector::andNot(subBackdrop, halve);
+			}
+
+			Vector result;
+			if (subtract) {
+				result = subtractComponents(color, other);
+				if (half) {
+					result = Vector::select(halve, Vector::andNot(componentLowBits, result).shiftRight<1>(), result);
+				}
+			} else {
+				result = addComponents(color, other);
+				if (half) {
+					result = Vector::select(halve, averageComponents(color, other), result);
+				}
+			}
+			color = Vector::select(allowed, result, color);
+		}
+
+		if (brightness != 15) {
+			Vector red = (component(color, 0) * brightnessFactor).shiftRight<4>();
+			Vector green = (component(color, 5) * brightnessFactor).shiftRight<4>();
+			Vector blue = (component(color, 10) * brightnessFactor).shiftRight<4>();
+			color = red | green.shiftLeft<5>() | blue.shiftLeft<10>();
+		}
+
+		color.store(destination + x);
+	}
+};
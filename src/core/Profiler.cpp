@@ -0,0 +1,224 @@
+#include <blaze/Profiler.hpp>
+#include <blaze/Trace.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+	struct Registry {
+		std::mutex mutex;
+		std::vector<void*> threads; // (the live threads' `ThreadCounters`)
+		std::array<Blaze::ProfileCounters, 1024> exited {};
+
+		// when the first thread registered, for working out how long a tick is
+		uint64_t startTicks = 0;
+		std::chrono::steady_clock::time_point startTime;
+	};
+
+	Registry& registry() {
+		static Registry instance;
+		return instance;
+	};
+} // namespace
+
+struct Blaze::Profiler::ThreadRegistration {
+	std::unique_ptr<ThreadCounters> counters = std::make_unique<ThreadCounters>();
+
+	~ThreadRegistration() {
+		auto& shared = registry();
+		std::lock_guard lock(shared.mutex);
+
+		for (size_t i = 0; i < counters->handlers.size(); ++i) {
+			shared.exited[i].executions += counters->handlers[i].executions.load(std::memory_order_relaxed);
+			shared.exited[i].cycles += counters->handlers[i].cycles.load(std::memory_order_relaxed);
+			shared.exited[i].ticks += counters->handlers[i].ticks.load(std::memory_order_relaxed);
+		}
+		shared.threads.erase(std::find(shared.threads.begin(), shared.threads.end(), counters.get()));
+
+		_threadCounters = nullptr;
+	};
+};
+
+Blaze::Profiler::ThreadCounters* Blaze::Profiler::registerThread() {
+	static thread_local ThreadRegistration registration;
+
+	auto& shared = registry();
+	std::lock_guard lock(shared.mutex);
+
+	if (shared.startTicks == 0) {
+		shared.startTicks = timestamp();
+		shared.startTime = std::chrono::steady_clock::now();
+	}
+	shared.threads.push_back(registration.counters.get());
+
+	_threadCounters = registration.counters.get();
+	return _threadCounters;
+};
+
+Blaze::ProfileSnapshot Blaze::Profiler::snapshot() {
+	ProfileSnapshot result;
+
+	auto& shared = registry();
+	std::lock_guard lock(shared.mutex);
+
+	result.handlers = shared.exited;
+	for (void* thread : shared.threads) {
+		const auto& counters = *static_cast<ThreadCounters*>(thread);
+		for (size_t i = 0; i < counters.handlers.size(); ++i) {
+			result.handlers[i].executions += counters.handlers[i].executions.load(std::memory_order_relaxed);
+			result.handlers[i].cycles += counters.handlers[i].cycles.load(std::memory_order_relaxed);
+			result.handlers[i].ticks += counters.handlers[i].ticks.load(std::memory_order_relaxed);
+		}
+	}
+
+#if BLAZE_PROFILER_RDTSC
+	// the TSC's rate isn't something we can just ask for, so compare it with the steady clock over however long
+	// it's been since the profiler started (which will be a while, by the time anyone wants a report)
+	if (shared.startTicks != 0) {
+		auto nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - shared.startTime).count();
+		auto ticks = static_cast<double>(timestamp() - shared.startTicks);
+		if (nanoseconds > 0 && ticks > 0) {
+			result.nanosecondsPerTick = nanoseconds / ticks;
+		}
+	}
+#else
+	result.nanosecondsPerTick = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::duration(1)).count();
+#endif
+
+	return result;
+};
+
+void Blaze::Profiler::reset() {
+	auto& shared = registry();
+	std::lock_guard lock(shared.mutex);
+
+	shared.exited = {};
+	for (void* thread : shared.threads) {
+		auto& counters = *static_cast<ThreadCounters*>(thread);
+		for (auto& entry : counters.handlers) {
+			entry.executions.store(0, std::memory_order_relaxed);
+			entry.cycles.store(0, std::memory_order_relaxed);
+			entry.ticks.store(0, std::memory_order_relaxed);
+		}
+	}
+};
+
+// adds up the handlers `predicate(index)` picks
+template<typename Predicate>
+static Blaze::ProfileCounters sumHandlers(const std::array<Blaze::ProfileCounters, 1024>& handlers, Predicate predicate) {
+	Blaze::ProfileCounters sum;
+	for (size_t i = 0; i < handlers.size(); ++i) {
+		if (predicate(i)) {
+			sum += handlers[i];
+		}
+	}
+	return sum;
+};
+
+Blaze::ProfileCounters Blaze::ProfileSnapshot::total() const {
+	return sumHandlers(handlers, [](size_t) { return true; });
+};
+
+Blaze::ProfileCounters Blaze::ProfileSnapshot::opcode(CPU::Opcode opcode) const {
+	return sumHandlers(handlers, [&](size_t index) {
+		return CPU::OPCODE_TABLE[index & 0xff].opcode == opcode;
+	});
+};
+
+Blaze::ProfileCounters Blaze::ProfileSnapshot::addressingMode(CPU::AddressingMode mode) const {
+	return sumHandlers(handlers, [&](size_t index) {
+		return CPU::OPCODE_TABLE[index & 0xff].addressingMode == mode;
+	});
+};
+
+Blaze::ProfileCounters Blaze::ProfileSnapshot::width(bool memoryIs8Bit, bool indexIs8Bit) const {
+	return sumHandlers(handlers, [&](size_t index) {
+		return ((index & 0x200) != 0) == memoryIs8Bit && ((index & 0x100) != 0) == indexIs8Bit;
+	});
+};
+
+void Blaze::ProfileSnapshot::writeReport(std::ostream& stream, size_t limit) const {
+	auto total = this->total();
+	auto totalNanoseconds = static_cast<double>(total.ticks) * nanosecondsPerTick;
+
+	char line[160];
+	auto writeRow = [&](const char* name, const ProfileCounters& counters) {
+		auto nanoseconds = static_cast<double>(counters.ticks) * nanosecondsPerTick;
+		std::snprintf(line, sizeof(line), "  %-32s %14llu %16llu %12.3f %6.2f%% %8.1f\n",
+			name,
+			static_cast<unsigned long long>(counters.executions),
+			static_cast<unsigned long long>(counters.cycles),
+			nanoseconds / 1e6,
+			(totalNanoseconds > 0) ? nanoseconds * 100.0 / totalNanoseconds : 0.0,
+			(counters.executions > 0) ? nanoseconds / static_cast<double>(counters.executions) : 0.0
+		);
+		stream << line;
+	};
+	auto writeHeader = [&](const char* title) {
+		std::snprintf(line, sizeof(line), "\n%s:\n  %-32s %14s %16s %12s %7s %8s\n",
+			title, "", "executions", "master cycles", "host ms", "host", "ns/exec");
+		stream << line;
+	};
+
+	// everything below is sorted by host time, most first, leaving out anything that never ran
+	auto writeSorted = [&](std::vector<std::pair<std::string, ProfileCounters>> rows, size_t count) {
+		rows.erase(std::remove_if(rows.begin(), rows.end(), [](const auto& row) {
+			return row.second.executions == 0;
+		}), rows.end());
+		std::stable_sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+			return a.second.ticks > b.second.ticks;
+		});
+		for (size_t i = 0; i < rows.size() && i < count; ++i) {
+			writeRow(rows[i].first.c_str(), rows[i].second);
+		}
+	};
+
+	std::snprintf(line, sizeof(line), "Profiled instructions: %llu (%llu master cycles, %.3f ms in handlers)\n",
+		static_cast<unsigned long long>(total.executions),
+		static_cast<unsigned long long>(total.cycles),
+		totalNanoseconds / 1e6
+	);
+	stream << line;
+
+	std::vector<std::pair<std::string, ProfileCounters>> rows;
+	for (size_t index = 0; index < handlers.size(); ++index) {
+		// e.g. "$bd LDA AbsoluteIndexedX m8 x16"
+		const auto& info = CPU::OPCODE_TABLE[index & 0xff];
+		std::snprintf(line, sizeof(line), "$%02zx %s %s m%d x%d",
+			index & 0xff, opcodeName(info.opcode), addressingModeName(info.addressingMode),
+			(index & 0x200) ? 8 : 16, (index & 0x100) ? 8 : 16
+		);
+		rows.emplace_back(line, handlers[index]);
+	}
+	writeHeader("Top handlers");
+	writeSorted(std::move(rows), limit);
+
+	rows.clear();
+	for (size_t value = 0; value <= static_cast<size_t>(CPU::Opcode::Last); ++value) {
+		auto op = static_cast<CPU::Opcode>(value);
+		rows.emplace_back(opcodeName(op), opcode(op));
+	}
+	writeHeader("By opcode");
+	writeSorted(std::move(rows), SIZE_MAX);
+
+	rows.clear();
+	for (size_t value = 0; value <= static_cast<size_t>(CPU::AddressingMode::Last); ++value) {
+		auto mode = static_cast<CPU::AddressingMode>(value);
+		rows.emplace_back(addressingModeName(mode), addressingMode(mode));
+	}
+	rows.emplace_back(addressingModeName(CPU::AddressingMode::INVALID), addressingMode(CPU::AddressingMode::INVALID));
+	writeHeader("By addressing mode");
+	writeSorted(std::move(rows), SIZE_MAX);
+
+	rows.clear();
+	rows.emplace_back("m8 x8", width(true, true));
+	rows.emplace_back("m8 x16", width(true, false));
+	rows.emplace_back("m16 x8", width(false, true));
+	rows.emplace_back("m16 x16", width(false, false));
+	writeHeader("By width");
+	writeSorted(std::move(rows), SIZE_MAX);
+};
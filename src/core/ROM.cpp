@@ -1,5 +1,7 @@
 #include <blaze/ROM.hpp>
+#include <blaze/Bus.hpp>
 #include <blaze/util.hpp>
+#include <blaze/SaveState.hpp>
 
 #include <fstream>
 #include <cstring>
@@ -33,7 +35,7 @@ Blaze::ROM::Type Blaze::ROM::type() const {
 };
 
 size_t Blaze::ROM::byteSize() const {
-	if (_memory.empty()) {
+	if (_memory == nullptr) {
 		return 0;
 	}
 
@@ -41,7 +43,7 @@ size_t Blaze::ROM::byteSize() const {
 };
 
 std::string Blaze::ROM::name() const {
-	if (_memory.empty()) {
+	if (_memory == nullptr) {
 		return {};
 	}
 
@@ -53,30 +55,60 @@ std::string Blaze::ROM::name() const {
 	return result;
 };
 
-void Blaze::ROM::load(const std::string& path) {
-	_memory.clear();
+Blaze::Word Blaze::ROM::checksum() const {
+	if (_memory == nullptr) {
+		return 0;
+	}
+
+	size_t offset = headerOffset() + HeaderFieldOffset::Checksum;
+	return concat16(_memory[offset + 1], _memory[offset]);
+};
+
+void Blaze::ROM::unload() {
+	_memory = nullptr;
+	_memorySize = 0;
+	_mappedFile.close();
+	_copiedMemory.clear();
+	_copiedMemory.shrink_to_fit();
+	_type = Type::INVALID;
+};
+
+void Blaze::ROM::load(const std::string& path, StorageMode mode) {
+	unload();
+
+	if (mode == StorageMode::MemoryMapped && _mappedFile.open(path)) {
+		_memory = _mappedFile.data();
+		_memorySize = _mappedFile.size();
+	} else {
+		// open the file in binary mode and open it at the end (ATE) of the file to get the size
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) {
+			throw std::runtime_error("failed to open ROM");
+		}
+
+		size_t size = file.tellg();
 
-	// open the file in binary mode and open it at the end (ATE) of the file to get the size
-	std::ifstream file(path, std::ios::binary | std::ios::ate);
-	size_t size = file.tellg();
+		// move the file back to the beginning
+		file.seekg(0, std::ios::beg);
 
-	// move the file back to the beginning
-	file.seekg(0, std::ios::beg);
+		_copiedMemory.resize(size);
 
-	_memory.resize(size);
+		if (!file.read(reinterpret_cast<char*>(_copiedMemory.data()), size)) {
+			unload();
+			throw std::runtime_error("failed to read ROM");
+		}
 
-	if (!file.read(reinterpret_cast<char*>(_memory.data()), size)) {
-		throw std::runtime_error("failed to read ROM");
+		_memory = _copiedMemory.data();
+		_memorySize = _copiedMemory.size();
 	}
 
 	// determine the ROM type
 
-	if (_memory.size() < MIN_ROM_SIZE) {
+	if (_memorySize < MIN_ROM_SIZE) {
 		// this is an invalid ROM
+		size_t size = _memorySize;
+		unload();
 		throw std::runtime_error("ROM TOO SMALL: " + std::to_string(size));
-		_memory.clear();
-		_type = Type::INVALID;
-		return;
 	}
 
 	// try to see if the LoROM header is valid
@@ -84,52 +116,26 @@ void Blaze::ROM::load(const std::string& path) {
 		_type = Type::LoROM;
 	}
 	// try to see if the HiROM header is valid
-	else if (_memory[HIROM_FIXED_VALUE_OFFSET] == ROM_FIXED_VALUE) {
+	else if (_memorySize > HIROM_FIXED_VALUE_OFFSET && _memory[HIROM_FIXED_VALUE_OFFSET] == ROM_FIXED_VALUE) {
 		_type = Type::HiROM;
 	} else {
 		// invalid ROM
-		_memory.clear();
-		_type = Type::INVALID;
+		unload();
 	}
 };
 
 Blaze::Byte Blaze::ROM::read8(Address offset) {
-	if (_memory.empty()) {
-		// no ROM loaded
-		return 0;
-	}
-
-	if (offset >= _memory.size()) {
-		throw std::runtime_error("Invalid access to ROM (out-of-bounds)");
-	}
-
-	return _memory[offset];
+	// the bus doesn't map anything past the end of the ROM, but a page can still end past it if the ROM's size isn't a
+	// multiple of the page size. there's nothing there, so just read zeros.
+	return (offset < _memorySize) ? _memory[offset] : 0;
 };
 
 Blaze::Word Blaze::ROM::read16(Address offset) {
-	if (_memory.empty()) {
-		// no ROM loaded
-		return 0;
-	}
-
-	if (offset >= _memory.size()) {
-		throw std::runtime_error("Invalid access to ROM (out-of-bounds)");
-	}
-
-	return concat16(_memory[offset + 1], _memory[offset]);
+	return concat16(read8(offset + 1), read8(offset));
 };
 
 Blaze::Address Blaze::ROM::read24(Address offset) {
-	if (_memory.empty()) {
-		// no ROM loaded
-		return 0;
-	}
-
-	if (offset >= _memory.size()) {
-		throw std::runtime_error("Invalid access to ROM (out-of-bounds)");
-	}
-
-	return concat24(_memory[offset + 2], _memory[offset + 1], _memory[offset]);
+	return concat24(read8(offset + 2), read8(offset + 1), read8(offset));
 };
 
 void Blaze::ROM::write8(Address offset, Byte value) {
@@ -148,6 +154,33 @@ void Blaze::ROM::write24(Address offset, Address value) {
 };
 
 void Blaze::ROM::reset(Bus* bus) {
-	_memory.clear();
-	_type = Type::INVALID;
+	unload();
+
+	// the bus may have pointers into the memory we just freed
+	if (bus != nullptr) {
+		bus->updateMemoryMap();
+	}
+};
+
+const Blaze::Byte* Blaze::ROM::directReadPointer(Address offset, Address size) {
+	if (offset >= _memorySize || size > _memorySize - offset) {
+		return nullptr;
+	}
+	return &_memory[offset];
+};
+
+void Blaze::ROM::saveState(StateWriter& writer) const {
+	writer.write(static_cast<Byte>(_type));
+	writer.write(static_cast<uint32_t>(_memorySize));
+	writer.write(checksum());
+};
+
+void Blaze::ROM::loadState(StateReader& reader) {
+	auto type = static_cast<Type>(reader.read<Byte>());
+	auto size = reader.read<uint32_t>();
+	auto savedChecksum = reader.read<Word>();
+
+	if (type != _type || size != _memorySize || savedChecksum != checksum()) {
+		throw std::runtime_error("Save state was made with a different ROM");
+	}
 };
@@ -0,0 +1,207 @@
+#include <blaze/Rewind.hpp>
+#include <blaze/Bus.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+// a run of zeros (i.e. unchanged bytes) shorter than this isn't worth ending a literal block for
+static constexpr size_t MIN_ZERO_RUN = 4;
+
+static void writeVarint(std::vector<Blaze::Byte>& out, size_t value) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<Blaze::Byte>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<Blaze::Byte>(value));
+};
+
+static size_t readVarint(const std::vector<Blaze::Byte>& in, size_t& position) {
+	size_t value = 0;
+	for (unsigned shift = 0; position < in.size(); shift += 7) {
+		Blaze::Byte byte = in[position++];
+		value |= static_cast<size_t>(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			return value;
+		}
+	}
+	throw std::runtime_error("Corrupted rewind delta");
+};
+
+Blaze::Rewind::Rewind(Bus& bus, size_t capacity, uint32_t framesPerSnapshot):
+	_bus(bus),
+	_framesPerSnapshot(std::max<uint32_t>(framesPerSnapshot, 1)),
+	_ring(capacity) {};
+
+void Blaze::Rewind::onFrame() {
+	if (_framesUntilSnapshot > 0) {
+		--_framesUntilSnapshot;
+		return;
+	}
+
+	takeSnapshot();
+	_framesUntilSnapshot = _framesPerSnapshot - 1;
+};
+
+void Blaze::Rewind::takeSnapshot() {
+	_state.resize(_bus.saveStateSize());
+	_bus.saveState(_state.data(), _state.size());
+
+	if (_hasNewest) {
+		// the delta turns the new snapshot back into the previous one
+		encodeDelta(_state, _newest, _delta);
+		pushDelta(_delta, _newest.size());
+	}
+
+	std::swap(_newest, _state);
+	_hasNewest = true;
+};
+
+bool Blaze::Rewind::stepBack() {
+	if (!_hasNewest) {
+		return false;
+	}
+
+	_bus.loadState(_newest.data(), _newest.size());
+
+	if (_entries.empty()) {
+		_hasNewest = false;
+	} else {
+		size_t stateSize = _entries.back().stateSize;
+		popDelta(_delta);
+		applyDelta(_newest, _delta, stateSize);
+	}
+
+	// don't snapshot the state we just restored right away
+	_framesUntilSnapshot = _framesPerSnapshot - 1;
+
+	return true;
+};
+
+void Blaze::Rewind::clear() {
+	_hasNewest = false;
+	_ringHead = 0;
+	_ringUsed = 0;
+	_entries.clear();
+	_framesUntilSnapshot = 0;
+};
+
+void Blaze::Rewind::pushDelta(const std::vector<Byte>& delta, size_t stateSize) {
+	if (delta.size() > _ring.size()) {
+		// this delta doesn't fit at all. since every delta depends on the one after it, the older ones are useless without it.
+		_ringHead = 0;
+		_ringUsed = 0;
+		_entries.clear();
+		return;
+	}
+
+	while (_ring.size() - _ringUsed < delta.size()) {
+		dropOldestDelta();
+	}
+
+	// copy it in, wrapping around the end of the ring if necessary
+	size_t firstPart = std::min(delta.size(), _ring.size() - _ringHead);
+	std::copy_n(delta.begin(), firstPart, _ring.begin() + _ringHead);
+	std::copy(delta.begin() + firstPart, delta.end(), _ring.begin());
+
+	_entries.push_back({ _ringHead, delta.size(), stateSize });
+	_ringHead = (_ringHead + delta.size()) % _ring.size();
+	_ringUsed += delta.size();
+};
+
+void Blaze::Rewind::popDelta(std::vector<Byte>& outDelta) {
+	Entry entry = _entries.back();
+	_entries.pop_back();
+
+	outDelta.resize(entry.size);
+	size_t firstPart = std::min(entry.size, _ring.size() - entry.offset);
+	std::copy_n(_ring.begin() + entry.offset, firstPart, outDelta.begin());
+	std::copy_n(_ring.begin(), entry.size - firstPart, outDelta.begin() + firstPart);
+
+	// the newest delta always ends at the head, so popping it just moves the head back
+	_ringHead = entry.offset;
+	_ringUsed -= entry.size;
+};
+
+void Blaze::Rewind::dropOldestDelta() {
+	_ringUsed -= _entries.front().size;
+	_entries.pop_front();
+};
+
+//
+// delta format: a sequence of blocks, each of which is
+//
+//   varint zeroCount, varint literalCount, literalCount bytes
+//
+// `zeroCount` bytes are left unchanged, then the next `literalCount` bytes are XORed with the literal bytes.
+//
+void Blaze::Rewind::encodeDelta(const std::vector<Byte>& from, const std::vector<Byte>& to, std::vector<Byte>& outDelta) {
+	size_t length = std::max(from.size(), to.size());
+	auto xorAt = [&](size_t index) -> Byte {
+		Byte fromByte = (index < from.size()) ? from[index] : 0;
+		Byte toByte = (index < to.size()) ? to[index] : 0;
+		return fromByte ^ toByte;
+	};
+
+	outDelta.clear();
+
+	size_t index = 0;
+	while (index < length) {
+		size_t zeroStart = index;
+		while (index < length && xorAt(index) == 0) {
+			++index;
+		}
+
+		if (index == length) {
+			// nothing else changes; trailing zeros don't need to be encoded
+			break;
+		}
+
+		size_t literalStart = index;
+		while (index < length) {
+			if (xorAt(index) != 0) {
+				++index;
+				continue;
+			}
+
+			// short runs of zeros stay part of the literal
+			size_t zeroRun = 0;
+			while (index + zeroRun < length && zeroRun < MIN_ZERO_RUN && xorAt(index + zeroRun) == 0) {
+				++zeroRun;
+			}
+
+			if (zeroRun >= MIN_ZERO_RUN || index + zeroRun == length) {
+				break;
+			}
+
+			index += zeroRun;
+		}
+
+		writeVarint(outDelta, literalStart - zeroStart);
+		writeVarint(outDelta, index - literalStart);
+		for (size_t literalIndex = literalStart; literalIndex < index; ++literalIndex) {
+			outDelta.push_back(xorAt(literalIndex));
+		}
+	}
+};
+
+void Blaze::Rewind::applyDelta(std::vector<Byte>& state, const std::vector<Byte>& delta, size_t targetSize) {
+	// pad with zeros while applying (that's what the encoder did, too)
+	state.resize(std::max(state.size(), targetSize), 0);
+
+	size_t position = 0;
+	size_t index = 0;
+	while (position < delta.size()) {
+		index += readVarint(delta, position);
+		size_t literalCount = readVarint(delta, position);
+
+		if (literalCount > delta.size() - position || literalCount > state.size() - std::min(index, state.size())) {
+			throw std::runtime_error("Corrupted rewind delta");
+		}
+
+		for (size_t i = 0; i < literalCount; ++i) {
+			state[index++] ^= delta[position++];
+		}
+	}
+
+	state.resize(targetSize);
+};
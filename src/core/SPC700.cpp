@@ -0,0 +1,747 @@
+#include <blaze/SPC700.hpp>
+#include <blaze/APU.hpp>
+#include <blaze/SaveState.hpp>
+
+// how many cycles each instruction takes (branches take 2 more when they're taken)
+static constexpr Blaze::Byte CYCLES[256] = {
+	2, 8, 4, 5, 3, 4, 3, 6, 2, 6, 5, 4, 5, 4, 6, 8,
+	2, 8, 4, 5, 4, 5, 5, 6, 5, 5, 6, 5, 2, 2, 4, 6,
+	2, 8, 4, 5, 3, 4, 3, 6, 2, 6, 5, 4, 5, 4, 5, 4,
+	2, 8, 4, 5, 4, 5, 5, 6, 5, 5, 6, 5, 2, 2, 3, 8,
+	2, 8, 4, 5, 3, 4, 3, 6, 2, 6, 4, 4, 5, 4, 6, 6,
+	2, 8, 4, 5, 4, 5, 5, 6, 5, 5, 4, 5, 2, 2, 4, 3,
+	2, 8, 4, 5, 3, 4, 3, 6, 2, 6, 4, 4, 5, 4, 5, 5,
+	2, 8, 4, 5, 4, 5, 5, 6, 5, 5, 5, 5, 2, 2, 3, 6,
+	2, 8, 4, 5, 3, 4, 3, 6, 2, 6, 5, 4, 5, 2, 4, 5,
+	2, 8, 4, 5, 4, 5, 5, 6, 5, 5, 5, 5, 2, 2, 12, 5,
+	3, 8, 4, 5, 3, 4, 3, 6, 2, 6, 4, 4, 5, 2, 4, 4,
+	2, 8, 4, 5, 4, 5, 5, 6, 5, 5, 5, 5, 2, 2, 3, 4,
+	3, 8, 4, 5, 4, 5, 4, 7, 2, 5, 6, 4, 5, 2, 4, 9,
+	2, 8, 4, 5, 5, 6, 6, 7, 4, 5, 5, 5, 2, 2, 6, 3,
+	2, 8, 4, 5, 3, 4, 3, 6, 2, 4, 5, 3, 4, 3, 4, 3,
+	2, 8, 4, 5, 4, 5, 5, 6, 3, 4, 5, 4, 2, 2, 4, 3,
+};
+
+void Blaze::SPC700::reset(APU* apu) {
+	_apu = apu;
+
+	A = 0;
+	X = 0;
+	Y = 0;
+	SP = 0;
+	PSW = 0;
+	stopped = false;
+
+	// (the IPL ROM is mapped over the vectors at reset)
+	PC = read16(0xfffe);
+};
+
+Blaze::Byte Blaze::SPC700::read(Word address) {
+	return _apu->read(address);
+};
+
+void Blaze::SPC700::write(Word address, Byte value) {
+	_apu->write(address, value);
+};
+
+Blaze::Word Blaze::SPC700::read16(Word address) {
+	Byte low = read(address);
+	Byte high = read(static_cast<Word>(address + 1));
+	return static_cast<Word>((high << 8) | low);
+};
+
+Blaze::Word Blaze::SPC700::fetch16() {
+	Byte low = fetch();
+	Byte high = fetch();
+	return static_cast<Word>((high << 8) | low);
+};
+
+Blaze::Word Blaze::SPC700::readDirect16(Byte offset) {
+	Byte low = read(direct(offset));
+	Byte high = read(direct(static_cast<Byte>(offset + 1)));
+	return static_cast<Word>((high << 8) | low);
+};
+
+void Blaze::SPC700::writeDirect16(Byte offset, Word value) {
+	write(direct(offset), static_cast<Byte>(value));
+	write(direct(static_cast<Byte>(offset + 1)), static_cast<Byte>(value >> 8));
+};
+
+void Blaze::SPC700::push(Byte value) {
+	write(0x0100 | SP, value);
+	--SP;
+};
+
+Blaze::Byte Blaze::SPC700::pop() {
+	++SP;
+	return read(0x0100 | SP);
+};
+
+void Blaze::SPC700::call(Word address) {
+	push(static_cast<Byte>(PC >> 8));
+	push(static_cast<Byte>(PC));
+	PC = address;
+};
+
+unsigned Blaze::SPC700::branch(bool condition) {
+	auto offset = static_cast<int8_t>(fetch());
+	if (!condition) {
+		return 0;
+	}
+	PC = static_cast<Word>(PC + offset);
+	return 2;
+};
+
+//=== ALU ===
+
+Blaze::Byte Blaze::SPC700::opOR(Byte left, Byte right) {
+	return setZN(left | right);
+};
+
+Blaze::Byte Blaze::SPC700::opAND(Byte left, Byte right) {
+	return setZN(left & right);
+};
+
+Blaze::Byte Blaze::SPC700::opEOR(Byte left, Byte right) {
+	return setZN(left ^ right);
+};
+
+Blaze::Byte Blaze::SPC700::opCMP(Byte left, Byte right) {
+	setFlag(flags::c, left >= right);
+	setZN(static_cast<Byte>(left - right));
+	return left;
+};
+
+Blaze::Byte Blaze::SPC700::opADC(Byte left, Byte right) {
+	unsigned result = left + right + (PSW & flags::c);
+	setFlag(flags::c, result > 0xff);
+	setFlag(flags::h, ((left ^ right ^ result) & 0x10) != 0);
+	setFlag(flags::v, (~(left ^ right) & (left ^ result) & 0x80) != 0);
+	return setZN(static_cast<Byte>(result));
+};
+
+Blaze::Byte Blaze::SPC700::opSBC(Byte left, Byte right) {
+	return opADC(left, static_cast<Byte>(~right));
+};
+
+Blaze::Byte Blaze::SPC700::opASL(Byte value) {
+	setFlag(flags::c, (value & 0x80) != 0);
+	return setZN(static_cast<Byte>(value << 1));
+};
+
+Blaze::Byte Blaze::SPC700::opROL(Byte value) {
+	Byte carry = PSW & flags::c;
+	setFlag(flags::c, (value & 0x80) != 0);
+	return setZN(static_cast<Byte>((value << 1) | carry));
+};
+
+Blaze::Byte Blaze::SPC700::opLSR(Byte value) {
+	setFlag(flags::c, (value & 0x01) != 0);
+	return setZN(value >> 1);
+};
+
+Blaze::Byte Blaze::SPC700::opROR(Byte value) {
+	Byte carry = PSW & flags::c;
+	setFlag(flags::c, (value & 0x01) != 0);
+	return setZN(static_cast<Byte>((value >> 1) | (carry << 7)));
+};
+
+Blaze::Byte Blaze::SPC700::opINC(Byte value) {
+	return setZN(static_cast<Byte>(value + 1));
+};
+
+Blaze::Byte Blaze::SPC700::opDEC(Byte value) {
+	return setZN(static_cast<Byte>(value - 1));
+};
+
+void Blaze::SPC700::aluInstruction(AluOp op, bool writes, Byte column, bool oddRow) {
+	Word address = 0;
+
+	switch (column) {
+		case 0x4:
+			// A, dp / A, dp+X
+			address = direct(static_cast<Byte>(fetch() + (oddRow ? X : 0)));
+			break;
+
+		case 0x5:
+			// A, !abs / A, !abs+X
+			address = static_cast<Word>(fetch16() + (oddRow ? X : 0));
+			break;
+
+		case 0x6:
+			// A, (X) / A, !abs+Y
+			address = oddRow ? static_cast<Word>(fetch16() + Y) : direct(X);
+			break;
+
+		case 0x7:
+			// A, [dp+X] / A, [dp]+Y
+			if (oddRow) {
+				address = static_cast<Word>(readDirect16(fetch()) + Y);
+			} else {
+				address = readDirect16(static_cast<Byte>(fetch() + X));
+			}
+			break;
+
+		case 0x8:
+			if (!oddRow) {
+				// A, #imm
+				A = (this->*op)(A, fetch());
+				return;
+			} else {
+				// dp, #imm
+				Byte value = fetch();
+				Word target = direct(fetch());
+				Byte result = (this->*op)(read(target), value);
+				if (writes) {
+					write(target, result);
+				}
+				return;
+			}
+
+		case 0x9: {
+			Word target = 0;
+			Byte value = 0;
+			if (oddRow) {
+				// (X), (Y)
+				value = read(direct(Y));
+				target = direct(X);
+			} else {
+				// dp, dp (the source comes first)
+				value = read(direct(fetch()));
+				target = direct(fetch());
+			}
+			Byte result = (this->*op)(read(target), value);
+			if (writes) {
+				write(target, result);
+			}
+			return;
+		}
+	}
+
+	A = (this->*op)(A, read(address));
+};
+
+//=== Execution ===
+
+unsigned Blaze::SPC700::step() {
+	if (stopped) {
+		// (the clock keeps running while it's asleep)
+		return 2;
+	}
+
+	Byte opcode = fetch();
+	unsigned cycles = CYCLES[opcode];
+	Byte row = opcode >> 4;
+	Byte column = opcode & 0x0f;
+
+	// the first 12 rows of columns 4 through 9 are all the same 6 ALU operations with the same 12 addressing modes
+	if (column >= 0x4 && column <= 0x9 && row < 0xc) {
+		static constexpr AluOp ALU_OPS[6] = {
+			&SPC700::opOR, &SPC700::opAND, &SPC700::opEOR, &SPC700::opCMP, &SPC700::opADC, &SPC700::opSBC,
+		};
+		Byte operation = row >> 1;
+		aluInstruction(ALU_OPS[operation], operation != 3, column, (row & 1) != 0);
+		return cycles;
+	}
+
+	// and the same goes for the shifts, increments, and decrements in columns B and C
+	if ((column == 0xb || column == 0xc) && row < 0xc) {
+		static constexpr ShiftOp SHIFT_OPS[6] = {
+			&SPC700::opASL, &SPC700::opROL, &SPC700::opLSR, &SPC700::opROR, &SPC700::opDEC, &SPC700::opINC,
+		};
+		ShiftOp op = SHIFT_OPS[row >> 1];
+		bool oddRow = (row & 1) != 0;
+
+		if (column == 0xc && oddRow) {
+			A = (this->*op)(A);
+			return cycles;
+		}
+
+		Word address = 0;
+		if (column == 0xc) {
+			address = fetch16();
+		} else {
+			address = direct(static_cast<Byte>(fetch() + (oddRow ? X : 0)));
+		}
+		write(address, (this->*op)(read(address)));
+		return cycles;
+	}
+
+	switch (column) {
+		case 0x0:
+			if ((row & 1) != 0) {
+				// BPL, BMI, BVC, BVS, BCC, BCS, BNE, BEQ
+				static constexpr Byte BRANCH_FLAGS[4] = { flags::n, flags::v, flags::c, flags::z };
+				bool set = (PSW & BRANCH_FLAGS[row >> 2]) != 0;
+				return cycles + branch(set == ((row & 2) != 0));
+			}
+			break;
+
+		case 0x1:
+			// TCALL n
+			call(read16(static_cast<Word>(0xffde - row * 2)));
+			return cycles;
+
+		case 0x2: {
+			// SET1 dp.bit (even rows) / CLR1 dp.bit (odd rows)
+			Word address = direct(fetch());
+			Byte bit = static_cast<Byte>(1 << (row >> 1));
+			Byte value = read(address);
+			write(address, (row & 1) != 0 ? (value & ~bit) : (value | bit));
+			return cycles;
+		}
+
+		case 0x3: {
+			// BBS dp.bit, rel (even rows) / BBC dp.bit, rel (odd rows)
+			Byte value = read(direct(fetch()));
+			bool set = (value & (1 << (row >> 1))) != 0;
+			return cycles + branch(set == ((row & 1) == 0));
+		}
+	}
+
+	switch (opcode) {
+		//=== Column 0 ===
+		case 0x00: // NOP
+			break;
+		case 0x20: // CLRP
+			setFlag(flags::p, false);
+			break;
+		case 0x40: // SETP
+			setFlag(flags::p, true);
+			break;
+		case 0x60: // CLRC
+			setFlag(flags::c, false);
+			break;
+		case 0x80: // SETC
+			setFlag(flags::c, true);
+			break;
+		case 0xa0: // EI
+			setFlag(flags::i, true);
+			break;
+		case 0xc0: // DI
+			setFlag(flags::i, false);
+			break;
+		case 0xe0: // CLRV
+			setFlag(flags::v, false);
+			setFlag(flags::h, false);
+			break;
+
+		//=== Columns 4 through 9 (the moves) ===
+		case 0xc4: // MOV dp, A
+			write(direct(fetch()), A);
+			break;
+		case 0xd4: // MOV dp+X, A
+			write(direct(static_cast<Byte>(fetch() + X)), A);
+			break;
+		case 0xe4: // MOV A, dp
+			A = setZN(read(direct(fetch())));
+			break;
+		case 0xf4: // MOV A, dp+X
+			A = setZN(read(direct(static_cast<Byte>(fetch() + X))));
+			break;
+
+		case 0xc5: // MOV !abs, A
+			write(fetch16(), A);
+			break;
+		case 0xd5: // MOV !abs+X, A
+			write(static_cast<Word>(fetch16() + X), A);
+			break;
+		case 0xe5: // MOV A, !abs
+			A = setZN(read(fetch16()));
+			break;
+		case 0xf5: // MOV A, !abs+X
+			A = setZN(read(static_cast<Word>(fetch16() + X)));
+			break;
+
+		case 0xc6: // MOV (X), A
+			write(direct(X), A);
+			break;
+		case 0xd6: // MOV !abs+Y, A
+			write(static_cast<Word>(fetch16() + Y), A);
+			break;
+		case 0xe6: // MOV A, (X)
+			A = setZN(read(direct(X)));
+			break;
+		case 0xf6: // MOV A, !abs+Y
+			A = setZN(read(static_cast<Word>(fetch16() + Y)));
+			break;
+
+		case 0xc7: // MOV [dp+X], A
+			write(readDirect16(static_cast<Byte>(fetch() + X)), A);
+			break;
+		case 0xd7: // MOV [dp]+Y, A
+			write(static_cast<Word>(readDirect16(fetch()) + Y), A);
+			break;
+		case 0xe7: // MOV A, [dp+X]
+			A = setZN(read(readDirect16(static_cast<Byte>(fetch() + X))));
+			break;
+		case 0xf7: // MOV A, [dp]+Y
+			A = setZN(read(static_cast<Word>(readDirect16(fetch()) + Y)));
+			break;
+
+		case 0xc8: // CMP X, #imm
+			opCMP(X, fetch());
+			break;
+		case 0xd8: // MOV dp, X
+			write(direct(fetch()), X);
+			break;
+		case 0xe8: // MOV A, #imm
+			A = setZN(fetch());
+			break;
+		case 0xf8: // MOV X, dp
+			X = setZN(read(direct(fetch())));
+			break;
+
+		case 0xc9: // MOV !abs, X
+			write(fetch16(), X);
+			break;
+		case 0xd9: // MOV dp+Y, X
+			write(direct(static_cast<Byte>(fetch() + Y)), X);
+			break;
+		case 0xe9: // MOV X, !abs
+			X = setZN(read(fetch16()));
+			break;
+		case 0xf9: // MOV X, dp+Y
+			X = setZN(read(direct(static_cast<Byte>(fetch() + Y))));
+			break;
+
+		//=== Column A ===
+		case 0x0a: // OR1 C, mem.bit
+		case 0x2a: // OR1 C, /mem.bit
+		case 0x4a: // AND1 C, mem.bit
+		case 0x6a: // AND1 C, /mem.bit
+		case 0x8a: // EOR1 C, mem.bit
+		case 0xaa: { // MOV1 C, mem.bit
+			Word operand = fetch16();
+			bool bit = ((read(operand & 0x1fff) >> (operand >> 13)) & 1) != 0;
+			bool carry = (PSW & flags::c) != 0;
+			switch (opcode) {
+				case 0x0a: carry = carry || bit; break;
+				case 0x2a: carry = carry || !bit; break;
+				case 0x4a: carry = carry && bit; break;
+				case 0x6a: carry = carry && !bit; break;
+				case 0x8a: carry = carry != bit; break;
+				default: carry = bit; break;
+			}
+			setFlag(flags::c, carry);
+			break;
+		}
+		case 0xca: // MOV1 mem.bit, C
+		case 0xea: { // NOT1 mem.bit
+			Word operand = fetch16();
+			Word address = operand & 0x1fff;
+			Byte mask = static_cast<Byte>(1 << (operand >> 13));
+			Byte value = read(address);
+			if (opcode == 0xea) {
+				value ^= mask;
+			} else if ((PSW & flags::c) != 0) {
+				value |= mask;
+			} else {
+				value &= ~mask;
+			}
+			write(address, value);
+			break;
+		}
+
+		case 0x1a: // DECW dp
+		case 0x3a: { // INCW dp
+			Byte offset = fetch();
+			Word value = static_cast<Word>(readDirect16(offset) + (opcode == 0x3a ? 1 : -1));
+			writeDirect16(offset, value);
+			setZN16(value);
+			break;
+		}
+		case 0x5a: { // CMPW YA, dp
+			Word ya = static_cast<Word>((Y << 8) | A);
+			Word value = readDirect16(fetch());
+			setFlag(flags::c, ya >= value);
+			setZN16(static_cast<Word>(ya - value));
+			break;
+		}
+		case 0x7a: // ADDW YA, dp
+		case 0x9a: { // SUBW YA, dp
+			unsigned ya = (Y << 8) | A;
+			unsigned value = readDirect16(fetch());
+			unsigned result = 0;
+			if (opcode == 0x7a) {
+				result = ya + value;
+				setFlag(flags::c, result > 0xffff);
+				setFlag(flags::h, ((ya ^ value ^ result) & 0x1000) != 0);
+				setFlag(flags::v, (~(ya ^ value) & (ya ^ result) & 0x8000) != 0);
+			} else {
+				result = ya - value;
+				setFlag(flags::c, ya >= value);
+				setFlag(flags::h, ((ya ^ value ^ result) & 0x1000) == 0);
+				setFlag(flags::v, ((ya ^ value) & (ya ^ result) & 0x8000) != 0);
+			}
+			setZN16(static_cast<Word>(result));
+			A = static_cast<Byte>(result);
+			Y = static_cast<Byte>(result >> 8);
+			break;
+		}
+		case 0xba: { // MOVW YA, dp
+			Word value = readDirect16(fetch());
+			A = static_cast<Byte>(value);
+			Y = static_cast<Byte>(value >> 8);
+			setZN16(value);
+			break;
+		}
+		case 0xda: // MOVW dp, YA
+			writeDirect16(fetch(), static_cast<Word>((Y << 8) | A));
+			break;
+		case 0xfa: { // MOV dp, dp (the source comes first)
+			Byte value = read(direct(fetch()));
+			write(direct(fetch()), value);
+			break;
+		}
+
+		//=== Columns B and C (the moves) ===
+		case 0xcb: // MOV dp, Y
+			write(direct(fetch()), Y);
+			break;
+		case 0xdb: // MOV dp+X, Y
+			write(direct(static_cast<Byte>(fetch() + X)), Y);
+			break;
+		case 0xeb: // MOV Y, dp
+			Y = setZN(read(direct(fetch())));
+			break;
+		case 0xfb: // MOV Y, dp+X
+			Y = setZN(read(direct(static_cast<Byte>(fetch() + X))));
+			break;
+
+		case 0xcc: // MOV !abs, Y
+			write(fetch16(), Y);
+			break;
+		case 0xdc: // DEC Y
+			Y = opDEC(Y);
+			break;
+		case 0xec: // MOV Y, !abs
+			Y = setZN(read(fetch16()));
+			break;
+		case 0xfc: // INC Y
+			Y = opINC(Y);
+			break;
+
+		//=== Column D ===
+		case 0x0d: // PUSH PSW
+			push(PSW);
+			break;
+		case 0x2d: // PUSH A
+			push(A);
+			break;
+		case 0x4d: // PUSH X
+			push(X);
+			break;
+		case 0x6d: // PUSH Y
+			push(Y);
+			break;
+		case 0x1d: // DEC X
+			X = opDEC(X);
+			break;
+		case 0x3d: // INC X
+			X = opINC(X);
+			break;
+		case 0x5d: // MOV X, A
+			X = setZN(A);
+			break;
+		case 0x7d: // MOV A, X
+			A = setZN(X);
+			break;
+		case 0x8d: // MOV Y, #imm
+			Y = setZN(fetch());
+			break;
+		case 0x9d: // MOV X, SP
+			X = setZN(SP);
+			break;
+		case 0xad: // CMP Y, #imm
+			opCMP(Y, fetch());
+			break;
+		case 0xbd: // MOV SP, X
+			SP = X;
+			break;
+		case 0xcd: // MOV X, #imm
+			X = setZN(fetch());
+			break;
+		case 0xdd: // MOV A, Y
+			A = setZN(Y);
+			break;
+		case 0xed: // NOTC
+			PSW ^= flags::c;
+			break;
+		case 0xfd: // MOV Y, A
+			Y = setZN(A);
+			break;
+
+		//=== Column E ===
+		case 0x0e: // TSET1 !abs
+		case 0x4e: { // TCLR1 !abs
+			Word address = fetch16();
+			Byte value = read(address);
+			setZN(static_cast<Byte>(A - value));
+			write(address, opcode == 0x0e ? (value | A) : (value & ~A));
+			break;
+		}
+		case 0x1e: // CMP X, !abs
+			opCMP(X, read(fetch16()));
+			break;
+		case 0x3e: // CMP X, dp
+			opCMP(X, read(direct(fetch())));
+			break;
+		case 0x5e: // CMP Y, !abs
+			opCMP(Y, read(fetch16()));
+			break;
+		case 0x7e: // CMP Y, dp
+			opCMP(Y, read(direct(fetch())));
+			break;
+		case 0x2e: { // CBNE dp, rel
+			Byte value = read(direct(fetch()));
+			return cycles + branch(A != value);
+		}
+		case 0xde: { // CBNE dp+X, rel
+			Byte value = read(direct(static_cast<Byte>(fetch() + X)));
+			return cycles + branch(A != value);
+		}
+		case 0x6e: { // DBNZ dp, rel
+			Word address = direct(fetch());
+			Byte value = static_cast<Byte>(read(address) - 1);
+			write(address, value);
+			return cycles + branch(value != 0);
+		}
+		case 0xfe: // DBNZ Y, rel
+			--Y;
+			return cycles + branch(Y != 0);
+		case 0x8e: // POP PSW
+			PSW = pop();
+			break;
+		case 0xae: // POP A
+			A = pop();
+			break;
+		case 0xce: // POP X
+			X = pop();
+			break;
+		case 0xee: // POP Y
+			Y = pop();
+			break;
+		case 0x9e: { // DIV YA, X
+			unsigned ya = (Y << 8) | A;
+			setFlag(flags::h, (Y & 0x0f) >= (X & 0x0f));
+			setFlag(flags::v, Y >= X);
+			if (Y < (X << 1)) {
+				A = static_cast<Byte>(ya / X);
+				Y = static_cast<Byte>(ya % X);
+			} else {
+				// the quotient doesn't fit in 9 bits; this is what the hardware's divider ends up with
+				A = static_cast<Byte>(255 - (ya - (X << 9)) / (256 - X));
+				Y = static_cast<Byte>(X + (ya - (X << 9)) % (256 - X));
+			}
+			setZN(A);
+			break;
+		}
+		case 0xbe: // DAS A
+			if ((PSW & flags::c) == 0 || A > 0x99) {
+				A -= 0x60;
+				setFlag(flags::c, false);
+			}
+			if ((PSW & flags::h) == 0 || (A & 0x0f) > 0x09) {
+				A -= 0x06;
+			}
+			setZN(A);
+			break;
+
+		//=== Column F ===
+		case 0x0f: // BRK
+			call(read16(0xffde));
+			push(PSW);
+			setFlag(flags::b, true);
+			setFlag(flags::i, false);
+			break;
+		case 0x1f: // JMP [!abs+X]
+			PC = read16(static_cast<Word>(fetch16() + X));
+			break;
+		case 0x2f: // BRA rel
+			branch(true);
+			break;
+		case 0x3f: // CALL !abs
+			call(fetch16());
+			break;
+		case 0x4f: // PCALL up
+			call(0xff00 | fetch());
+			break;
+		case 0x5f: // JMP !abs
+			PC = fetch16();
+			break;
+		case 0x6f: { // RET
+			Byte low = pop();
+			Byte high = pop();
+			PC = static_cast<Word>((high << 8) | low);
+			break;
+		}
+		case 0x7f: { // RETI
+			PSW = pop();
+			Byte low = pop();
+			Byte high = pop();
+			PC = static_cast<Word>((high << 8) | low);
+			break;
+		}
+		case 0x8f: { // MOV dp, #imm
+			Byte value = fetch();
+			write(direct(fetch()), value);
+			break;
+		}
+		case 0x9f: // XCN A
+			A = setZN(static_cast<Byte>((A >> 4) | (A << 4)));
+			break;
+		case 0xaf: // MOV (X)+, A
+			write(direct(X), A);
+			++X;
+			break;
+		case 0xbf: // MOV A, (X)+
+			A = setZN(read(direct(X)));
+			++X;
+			break;
+		case 0xcf: { // MUL YA
+			Word result = static_cast<Word>(Y * A);
+			A = static_cast<Byte>(result);
+			Y = static_cast<Byte>(result >> 8);
+			// (only the high byte counts for the flags)
+			setZN(Y);
+			break;
+		}
+		case 0xdf: // DAA A
+			if ((PSW & flags::c) != 0 || A > 0x99) {
+				A += 0x60;
+				setFlag(flags::c, true);
+			}
+			if ((PSW & flags::h) != 0 || (A & 0x0f) > 0x09) {
+				A += 0x06;
+			}
+			setZN(A);
+			break;
+		case 0xef: // SLEEP
+		case 0xff: // STOP
+			stopped = true;
+			break;
+	}
+
+	return cycles;
+};
+
+void Blaze::SPC700::saveState(StateWriter& writer) const {
+	writer.write(A);
+	writer.write(X);
+	writer.write(Y);
+	writer.write(SP);
+	writer.write(PSW);
+	writer.write(PC);
+	writer.write(static_cast<Byte>(stopped));
+};
+
+void Blaze::SPC700::loadState(StateReader& reader) {
+	A = reader.read<Byte>();
+	X = reader.read<Byte>();
+	Y = reader.read<Byte>();
+	SP = reader.read<Byte>();
+	PSW = reader.read<Byte>();
+	PC = reader.read<Word>();
+	stopped = reader.read<Byte>() != 0;
+};
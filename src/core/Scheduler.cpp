@@ -0,0 +1,90 @@
+#include <blaze/Scheduler.hpp>
+#include <blaze/SaveState.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+void Blaze::Scheduler::reset() {
+	_now = 0;
+	_nextSequence = 0;
+	_queue.clear();
+};
+
+Blaze::Scheduler::EventType Blaze::Scheduler::registerEvent(Callback callback) {
+	_callbacks.push_back(std::move(callback));
+	return static_cast<EventType>(_callbacks.size() - 1);
+};
+
+void Blaze::Scheduler::schedule(EventType type, MasterCycles time) {
+	_queue.push_back({ time, _nextSequence++, type });
+	std::push_heap(_queue.begin(), _queue.end(), runsLater);
+
+	if (scheduleHook) {
+		scheduleHook(time);
+	}
+};
+
+void Blaze::Scheduler::cancel(EventType type) {
+	auto newEnd = std::remove_if(_queue.begin(), _queue.end(), [type](const PendingEvent& event) {
+		return event.type == type;
+	});
+
+	if (newEnd != _queue.end()) {
+		_queue.erase(newEnd, _queue.end());
+		std::make_heap(_queue.begin(), _queue.end(), runsLater);
+	}
+};
+
+bool Blaze::Scheduler::isPending(EventType type) const {
+	return std::any_of(_queue.begin(), _queue.end(), [type](const PendingEvent& event) {
+		return event.type == type;
+	});
+};
+
+void Blaze::Scheduler::advanceTo(MasterCycles time) {
+	while (!_queue.empty() && _queue.front().time <= time) {
+		std::pop_heap(_queue.begin(), _queue.end(), runsLater);
+		PendingEvent event = _queue.back();
+		_queue.pop_back();
+
+		// events scheduled in the past run right away, but time never goes backwards
+		_now = std::max(_now, event.time);
+
+		// the callback may schedule more events (including ones that are already due), which is why we re-check the queue every time
+		_callbacks[event.type](event.time);
+	}
+
+	_now = std::max(_now, time);
+};
+
+void Blaze::Scheduler::saveState(StateWriter& writer) const {
+	writer.write(_now);
+	writer.write(_nextSequence);
+	writer.write(static_cast<uint32_t>(_queue.size()));
+	for (const auto& event: _queue) {
+		writer.write(event.time);
+		writer.write(event.sequence);
+		writer.write(event.type);
+	}
+};
+
+void Blaze::Scheduler::loadState(StateReader& reader) {
+	_now = reader.read<MasterCycles>();
+	_nextSequence = reader.read<uint64_t>();
+
+	auto count = reader.read<uint32_t>();
+	_queue.clear();
+	for (uint32_t i = 0; i < count; ++i) {
+		PendingEvent event {};
+		event.time = reader.read<MasterCycles>();
+		event.sequence = reader.read<uint64_t>();
+		event.type = reader.read<EventType>();
+
+		if (event.type >= _callbacks.size()) {
+			throw std::runtime_error("Save state contains an unknown event type");
+		}
+
+		_queue.push_back(event);
+	}
+	std::make_heap(_queue.begin(), _queue.end(), runsLater);
+};
@@ -0,0 +1,75 @@
+#include <blaze/Symbols.hpp>
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+void Blaze::SymbolTable::load(const std::string& path) {
+	std::ifstream file(path);
+	if (!file) {
+		throw std::runtime_error("Failed to open symbol file: " + path);
+	}
+	load(file);
+};
+
+void Blaze::SymbolTable::load(std::istream& stream) {
+	// WLA files are split into sections; only "[labels]" has labels in it. no$sns files don't have any sections.
+	bool inLabels = true;
+
+	std::string line;
+	while (std::getline(stream, line)) {
+		line = line.substr(0, line.find(';'));
+
+		std::istringstream fields(line);
+		std::string address;
+		std::string name;
+		if (!(fields >> address)) {
+			continue;
+		}
+
+		if (address.front() == '[') {
+			inLabels = (address == "[labels]");
+			continue;
+		}
+		// (asar names its `+`/`-` labels ":pos_1", ":neg_1" and so on; they'd only get in the way of the real ones)
+		if (!inLabels || !(fields >> name) || name.front() == ':') {
+			continue;
+		}
+
+		// "bb:aaaa" or "bbaaaaaa"
+		if (address.size() == 7 && address[2] == ':') {
+			address.erase(2, 1);
+		}
+		if (address.size() != 6 && address.size() != 8) {
+			continue;
+		}
+
+		bool isHex = true;
+		for (char character : address) {
+			isHex = isHex && std::isxdigit(static_cast<unsigned char>(character));
+		}
+		if (isHex) {
+			add(static_cast<Address>(std::stoul(address, nullptr, 16)), name);
+		}
+	}
+};
+
+std::string Blaze::SymbolTable::name(Address address) const {
+	address &= 0xffffff;
+
+	char text[16];
+	auto label = _labels.upper_bound(address);
+	if (label == _labels.begin() || ((--label)->first >> 16) != (address >> 16)) {
+		std::snprintf(text, sizeof(text), "%02x:%04x", (address >> 16) & 0xff, address & 0xffff);
+		return text;
+	}
+
+	if (label->first == address) {
+		return label->second;
+	}
+
+	std::snprintf(text, sizeof(text), "+$%x", address - label->first);
+	return label->second + text;
+};
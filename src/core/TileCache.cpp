@@ -0,0 +1,85 @@
+#include <blaze/TileCache.hpp>
+
+#include <algorithm>
+
+// spreads the bits of one bitplane byte out into the low bit of 8 bytes, leftmost pixel (bit 7) first
+static constexpr auto PLANE_BITS = [] {
+	std::array<uint64_t, 256> table {};
+	for (unsigned value = 0; value < 256; ++value) {
+		for (unsigned pixel = 0; pixel < 8; ++pixel) {
+			if (((value >> (7 - pixel)) & 1) != 0) {
+				table[value] |= uint64_t(1) << (8 * pixel);
+			}
+		}
+	}
+	return table;
+}();
+
+Blaze::TileCache::TileCache(const Word* vram):
+	_vram(vram)
+{
+	for (unsigned depth = 2; depth <= 8; depth *= 2) {
+		DepthCache& cache = _caches[depth >> 2];
+		// a tile is 8 rows of `depth` bitplanes, two bitplanes per word
+		cache.shift = (depth == 2) ? 3 : (depth == 4) ? 4 : 5;
+		size_t tiles = VRAM_WORDS >> cache.shift;
+		cache.rows.resize(tiles * 8);
+		cache.dirty.resize((tiles + 63) / 64);
+	}
+	invalidateAll();
+};
+
+void Blaze::TileCache::invalidate(Word address, size_t count) {
+	if (count >= VRAM_WORDS) {
+		invalidateAll();
+		return;
+	}
+	// tiles are at least 8 words long, so one word per 8 is enough to hit all of them
+	size_t first = address & ~size_t(7);
+	size_t last = size_t(address) + count - 1;
+	for (size_t word = first; word <= last; word += 8) {
+		invalidate(static_cast<Word>(word));
+	}
+	invalidate(static_cast<Word>(last));
+};
+
+void Blaze::TileCache::invalidateAll() {
+	for (DepthCache& cache: _caches) {
+		std::fill(cache.dirty.begin(), cache.dirty.end(), ~uint64_t(0));
+		cache.anyDirty = true;
+	}
+};
+
+Blaze::TileCache::DecodedTiles Blaze::TileCache::decodeDirty(Byte depth) {
+	DepthCache& cache = _caches[depth >> 2];
+	if (cache.anyDirty) {
+		for (size_t word = 0; word < cache.dirty.size(); ++word) {
+			uint64_t dirtyWord = cache.dirty[word];
+			for (size_t bit = 0; dirtyWord != 0; ++bit, dirtyWord >>= 1) {
+				if ((dirtyWord & 1) != 0) {
+					decode(depth, word * 64 + bit);
+				}
+			}
+			cache.dirty[word] = 0;
+		}
+		cache.anyDirty = false;
+	}
+	return DecodedTiles { cache.rows.data(), (VRAM_WORDS >> cache.shift) - 1 };
+};
+
+void Blaze::TileCache::decode(Byte depth, size_t tile) {
+	DepthCache& cache = _caches[depth >> 2];
+	const Word* words = &_vram[tile << cache.shift];
+	uint64_t* rows = &cache.rows[tile * 8];
+
+	for (unsigned row = 0; row < 8; ++row) {
+		uint64_t pixels = 0;
+		for (Byte plane = 0; plane < depth; plane += 2) {
+			// each pair of bitplanes is 8 words after the previous one
+			Word word = words[row + plane * 4];
+			pixels |= PLANE_BITS[word & 0xff] << plane;
+			pixels |= PLANE_BITS[word >> 8] << (plane + 1);
+		}
+		rows[row] = pixels;
+	}
+};
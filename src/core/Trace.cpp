@@ -0,0 +1,381 @@
+#include <blaze/Trace.hpp>
+#include <blaze/CPU.hpp>
+#include <blaze/SaveState.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+// how many records are converted at once when saving or loading
+static constexpr size_t RECORDS_PER_CHUNK = 4096;
+
+static constexpr size_t TRACE_HEADER_SIZE = sizeof(Blaze::TRACE_MAGIC) + sizeof(Blaze::Word) + sizeof(uint64_t);
+
+static size_t roundUpToPowerOfTwo(size_t value) {
+	size_t result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+};
+
+static void writeRecord(Blaze::StateWriter& writer, const Blaze::TraceRecord& record) {
+	writer.write(record.cycle);
+	writer.write(record.pc);
+	writer.writeBytes(record.bytes, sizeof(record.bytes));
+	writer.write(record.a);
+	writer.write(record.x);
+	writer.write(record.y);
+	writer.write(record.sp);
+	writer.write(record.dr);
+	writer.write(record.p);
+	writer.write(record.dbr);
+	writer.write(record.e);
+	writer.write(record.size);
+	writer.writeBytes(record.reserved, sizeof(record.reserved));
+};
+
+static Blaze::TraceRecord readRecord(Blaze::StateReader& reader) {
+	Blaze::TraceRecord record {};
+	record.cycle = reader.read<Blaze::MasterCycles>();
+	record.pc = reader.read<Blaze::Address>();
+	reader.readBytes(record.bytes, sizeof(record.bytes));
+	record.a = reader.read<Blaze::Word>();
+	record.x = reader.read<Blaze::Word>();
+	record.y = reader.read<Blaze::Word>();
+	record.sp = reader.read<Blaze::Word>();
+	record.dr = reader.read<Blaze::Word>();
+	record.p = reader.read<Blaze::Byte>();
+	record.dbr = reader.read<Blaze::Byte>();
+	record.e = reader.read<Blaze::Byte>();
+	record.size = std::min<Blaze::Byte>(reader.read<Blaze::Byte>(), sizeof(record.bytes));
+	reader.readBytes(record.reserved, sizeof(record.reserved));
+	return record;
+};
+
+Blaze::TraceBuffer::TraceBuffer(size_t capacity):
+	_records(roundUpToPowerOfTwo(std::max<size_t>(capacity, 1))),
+	_mask(_records.size() - 1) {};
+
+size_t Blaze::TraceBuffer::size() const {
+	return static_cast<size_t>(std::min<uint64_t>(totalRecorded(), _records.size()));
+};
+
+std::vector<Blaze::TraceRecord> Blaze::TraceBuffer::records() const {
+	uint64_t written = totalRecorded();
+	size_t count = size();
+
+	std::vector<TraceRecord> result;
+	result.reserve(count);
+	for (uint64_t i = written - count; i < written; ++i) {
+		result.push_back(_records[i & _mask]);
+	}
+	return result;
+};
+
+void Blaze::TraceBuffer::save(const std::string& path) const {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		throw std::runtime_error("Failed to open trace file for writing");
+	}
+
+	auto records = this->records();
+
+	Byte header[TRACE_HEADER_SIZE];
+	StateWriter headerWriter(header, sizeof(header));
+	headerWriter.writeBytes(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+	headerWriter.write(TRACE_VERSION);
+	headerWriter.write(static_cast<uint64_t>(records.size()));
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+	std::vector<Byte> chunk(RECORDS_PER_CHUNK * TRACE_RECORD_SIZE);
+	for (size_t start = 0; start < records.size(); start += RECORDS_PER_CHUNK) {
+		size_t end = std::min(start + RECORDS_PER_CHUNK, records.size());
+
+		StateWriter writer(chunk.data(), chunk.size());
+		for (size_t i = start; i < end; ++i) {
+			writeRecord(writer, records[i]);
+		}
+		file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(writer.offset()));
+	}
+
+	if (!file) {
+		throw std::runtime_error("Failed to write trace file");
+	}
+};
+
+std::vector<Blaze::TraceRecord> Blaze::loadTrace(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open trace file");
+	}
+
+	Byte header[TRACE_HEADER_SIZE];
+	if (!file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+		throw std::runtime_error("Trace file is truncated");
+	}
+
+	StateReader headerReader(header, sizeof(header));
+	Byte magic[sizeof(TRACE_MAGIC)];
+	headerReader.readBytes(magic, sizeof(magic));
+	if (!std::equal(std::begin(magic), std::end(magic), std::begin(TRACE_MAGIC))) {
+		throw std::runtime_error("Not a trace file");
+	}
+	if (headerReader.read<Word>() != TRACE_VERSION) {
+		throw std::runtime_error("Unsupported trace file version");
+	}
+	auto count = headerReader.read<uint64_t>();
+
+	std::vector<TraceRecord> records;
+	std::vector<Byte> chunk(RECORDS_PER_CHUNK * TRACE_RECORD_SIZE);
+	while (records.size() < count) {
+		size_t chunkRecords = static_cast<size_t>(std::min<uint64_t>(RECORDS_PER_CHUNK, count - records.size()));
+		size_t chunkSize = chunkRecords * TRACE_RECORD_SIZE;
+		if (!file.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(chunkSize))) {
+			throw std::runtime_error("Trace file is truncated");
+		}
+
+		StateReader reader(chunk.data(), chunkSize);
+		for (size_t i = 0; i < chunkRecords; ++i) {
+			records.push_back(readRecord(reader));
+		}
+	}
+
+	return records;
+};
+
+static const char* mnemonic(const Blaze::CPU::Instruction& info) {
+	using Opcode = Blaze::CPU::Opcode;
+	using ConditionCode = Blaze::CPU::ConditionCode;
+
+	if (info.opcode == Opcode::BRA) {
+		switch (info.condition) {
+			case ConditionCode::Negative: return info.passConditionIfBitSet ? "BMI" : "BPL";
+			case ConditionCode::Overflow: return info.passConditionIfBitSet ? "BVS" : "BVC";
+			case ConditionCode::Carry:    return info.passConditionIfBitSet ? "BCS" : "BCC";
+			case ConditionCode::Zero:     return info.passConditionIfBitSet ? "BEQ" : "BNE";
+			default:                      return "BRA";
+		}
+	}
+
+	if (info.opcode == Opcode::JMP && info.addressingMode == Blaze::CPU::AddressingMode::AbsoluteLong) {
+		return "JML";
+	}
+
+	return Blaze::opcodeName(info.opcode);
+};
+
+const char* Blaze::opcodeName(CPU::Opcode opcode) {
+	using Opcode = CPU::Opcode;
+
+	switch (opcode) {
+		case Opcode::BRK: return "BRK";
+		case Opcode::BRL: return "BRL";
+		case Opcode::CLC: return "CLC";
+		case Opcode::CLD: return "CLD";
+		case Opcode::CLI: return "CLI";
+		case Opcode::CLV: return "CLV";
+		case Opcode::COP: return "COP";
+		case Opcode::DEX: return "DEX";
+		case Opcode::DEY: return "DEY";
+		case Opcode::INX: return "INX";
+		case Opcode::INY: return "INY";
+		case Opcode::JML: return "JML";
+		case Opcode::JSL: return "JSL";
+		case Opcode::MVN: return "MVN";
+		case Opcode::MVP: return "MVP";
+		case Opcode::NOP: return "NOP";
+		case Opcode::PEA: return "PEA";
+		case Opcode::PEI: return "PEI";
+		case Opcode::PER: return "PER";
+		case Opcode::PHA: return "PHA";
+		case Opcode::PHB: return "PHB";
+		case Opcode::PHD: return "PHD";
+		case Opcode::PHK: return "PHK";
+		case Opcode::PHP: return "PHP";
+		case Opcode::PHX: return "PHX";
+		case Opcode::PHY: return "PHY";
+		case Opcode::PLA: return "PLA";
+		case Opcode::PLB: return "PLB";
+		case Opcode::PLD: return "PLD";
+		case Opcode::PLP: return "PLP";
+		case Opcode::PLX: return "PLX";
+		case Opcode::PLY: return "PLY";
+		case Opcode::REP: return "REP";
+		case Opcode::RTI: return "RTI";
+		case Opcode::RTL: return "RTL";
+		case Opcode::RTS: return "RTS";
+		case Opcode::SEC: return "SEC";
+		case Opcode::SED: return "SED";
+		case Opcode::SEI: return "SEI";
+		case Opcode::SEP: return "SEP";
+		case Opcode::STP: return "STP";
+		case Opcode::TAX: return "TAX";
+		case Opcode::TAY: return "TAY";
+		case Opcode::TCD: return "TCD";
+		case Opcode::TCS: return "TCS";
+		case Opcode::TDC: return "TDC";
+		case Opcode::TSC: return "TSC";
+		case Opcode::TSX: return "TSX";
+		case Opcode::TXA: return "TXA";
+		case Opcode::TXS: return "TXS";
+		case Opcode::TXY: return "TXY";
+		case Opcode::TYA: return "TYA";
+		case Opcode::TYX: return "TYX";
+		case Opcode::WAI: return "WAI";
+		case Opcode::WDM: return "WDM";
+		case Opcode::XBA: return "XBA";
+		case Opcode::XCE: return "XCE";
+		case Opcode::ADC: return "ADC";
+		case Opcode::AND: return "AND";
+		case Opcode::ASL: return "ASL";
+		case Opcode::BIT: return "BIT";
+		case Opcode::CMP: return "CMP";
+		case Opcode::CPX: return "CPX";
+		case Opcode::CPY: return "CPY";
+		case Opcode::DEC: return "DEC";
+		case Opcode::EOR: return "EOR";
+		case Opcode::INC: return "INC";
+		case Opcode::JMP: return "JMP";
+		case Opcode::JSR: return "JSR";
+		case Opcode::LDA: return "LDA";
+		case Opcode::LDX: return "LDX";
+		case Opcode::LDY: return "LDY";
+		case Opcode::LSR: return "LSR";
+		case Opcode::ORA: return "ORA";
+		case Opcode::ROL: return "ROL";
+		case Opcode::ROR: return "ROR";
+		case Opcode::SBC: return "SBC";
+		case Opcode::STA: return "STA";
+		case Opcode::STX: return "STX";
+		case Opcode::STY: return "STY";
+		case Opcode::STZ: return "STZ";
+		case Opcode::TRB: return "TRB";
+		case Opcode::TSB: return "TSB";
+		case Opcode::BRA: return "BRA";
+		default:          return "???";
+	}
+};
+
+const char* Blaze::addressingModeName(CPU::AddressingMode mode) {
+	using AddressingMode = CPU::AddressingMode;
+
+	switch (mode) {
+		case AddressingMode::Absolute:                     return "Absolute";
+		case AddressingMode::AbsoluteIndexedIndirect:      return "AbsoluteIndexedIndirect";
+		case AddressingMode::AbsoluteIndexedX:             return "AbsoluteIndexedX";
+		case AddressingMode::AbsoluteIndexedY:             return "AbsoluteIndexedY";
+		case AddressingMode::AbsoluteIndirect:             return "AbsoluteIndirect";
+		case AddressingMode::AbsoluteLongIndexedX:         return "AbsoluteLongIndexedX";
+		case AddressingMode::AbsoluteLong:                 return "AbsoluteLong";
+		case AddressingMode::Accumulator:                  return "Accumulator";
+		case AddressingMode::BlockMove:                    return "BlockMove";
+		case AddressingMode::DirectIndexedIndirect:        return "DirectIndexedIndirect";
+		case AddressingMode::DirectIndexedX:               return "DirectIndexedX";
+		case AddressingMode::DirectIndexedY:               return "DirectIndexedY";
+		case AddressingMode::DirectIndirectIndexed:        return "DirectIndirectIndexed";
+		case AddressingMode::DirectIndirectLongIndexed:    return "DirectIndirectLongIndexed";
+		case AddressingMode::DirectIndirectLong:           return "DirectIndirectLong";
+		case AddressingMode::DirectIndirect:               return "DirectIndirect";
+		case AddressingMode::Direct:                       return "Direct";
+		case AddressingMode::Immediate:                    return "Immediate";
+		case AddressingMode::Implied:                      return "Implied";
+		case AddressingMode::ProgramCounterRelativeLong:   return "ProgramCounterRelativeLong";
+		case AddressingMode::ProgramCounterRelative:       return "ProgramCounterRelative";
+		case AddressingMode::Stack:                        return "Stack";
+		case AddressingMode::StackRelative:                return "StackRelative";
+		case AddressingMode::StackRelativeIndirectIndexed: return "StackRelativeIndirectIndexed";
+		default:                                           return "(other)";
+	}
+};
+
+std::string Blaze::disassemble(const Byte* bytes, Byte size, Address pc) {
+	using AddressingMode = CPU::AddressingMode;
+	using Opcode = CPU::Opcode;
+
+	const auto& info = CPU::OPCODE_TABLE[bytes[0]];
+
+	// the operand, little-endian, in however many bytes the instruction actually had
+	uint32_t operand = 0;
+	for (Byte i = 1; i < size && i < 4; ++i) {
+		operand |= static_cast<uint32_t>(bytes[i]) << ((i - 1) * 8);
+	}
+
+	// relative operands are shown as the address they jump to. branches are relative to the next instruction.
+	auto relativeTarget = [&](bool isLong) {
+		auto offset = isLong ? static_cast<int32_t>(static_cast<int16_t>(operand)) : static_cast<int32_t>(static_cast<int8_t>(operand));
+		return static_cast<Word>((pc & 0xffff) + size + offset);
+	};
+
+	char text[32];
+	const char* name = mnemonic(info);
+
+	switch (info.addressingMode) {
+		case AddressingMode::Absolute:                     std::snprintf(text, sizeof(text), "%s $%04x", name, operand); break;
+		case AddressingMode::AbsoluteIndexedIndirect:      std::snprintf(text, sizeof(text), "%s ($%04x,x)", name, operand); break;
+		case AddressingMode::AbsoluteIndexedX:             std::snprintf(text, sizeof(text), "%s $%04x,x", name, operand); break;
+		case AddressingMode::AbsoluteIndexedY:             std::snprintf(text, sizeof(text), "%s $%04x,y", name, operand); break;
+		case AddressingMode::AbsoluteIndirect:
+			if (info.opcode == Opcode::JML) {
+				std::snprintf(text, sizeof(text), "%s [$%04x]", name, operand);
+			} else {
+				std::snprintf(text, sizeof(text), "%s ($%04x)", name, operand);
+			}
+			break;
+		case AddressingMode::AbsoluteLongIndexedX:         std::snprintf(text, sizeof(text), "%s $%06x,x", name, operand); break;
+		case AddressingMode::AbsoluteLong:                 std::snprintf(text, sizeof(text), "%s $%06x", name, operand); break;
+		case AddressingMode::Accumulator:                  std::snprintf(text, sizeof(text), "%s a", name); break;
+		// the destination bank comes first in the instruction bytes, but the source bank is written first
+		case AddressingMode::BlockMove:                    std::snprintf(text, sizeof(text), "%s $%02x,$%02x", name, operand >> 8, operand & 0xff); break;
+		case AddressingMode::DirectIndexedIndirect:        std::snprintf(text, sizeof(text), "%s ($%02x,x)", name, operand); break;
+		case AddressingMode::DirectIndexedX:               std::snprintf(text, sizeof(text), "%s $%02x,x", name, operand); break;
+		case AddressingMode::DirectIndexedY:               std::snprintf(text, sizeof(text), "%s $%02x,y", name, operand); break;
+		case AddressingMode::DirectIndirectIndexed:        std::snprintf(text, sizeof(text), "%s ($%02x),y", name, operand); break;
+		case AddressingMode::DirectIndirectLongIndexed:    std::snprintf(text, sizeof(text), "%s [$%02x],y", name, operand); break;
+		case AddressingMode::DirectIndirectLong:           std::snprintf(text, sizeof(text), "%s [$%02x]", name, operand); break;
+		case AddressingMode::DirectIndirect:               std::snprintf(text, sizeof(text), "%s ($%02x)", name, operand); break;
+		case AddressingMode::Direct:                       std::snprintf(text, sizeof(text), "%s $%02x", name, operand); break;
+		case AddressingMode::Immediate:                    std::snprintf(text, sizeof(text), (size > 2) ? "%s #$%04x" : "%s #$%02x", name, operand); break;
+		case AddressingMode::Implied:                      std::snprintf(text, sizeof(text), "%s", name); break;
+		case AddressingMode::ProgramCounterRelativeLong:   std::snprintf(text, sizeof(text), "%s $%04x", name, relativeTarget(true)); break;
+		case AddressingMode::ProgramCounterRelative:       std::snprintf(text, sizeof(text), "%s $%04x", name, relativeTarget(false)); break;
+		case AddressingMode::StackRelative:                std::snprintf(text, sizeof(text), "%s $%02x,s", name, operand); break;
+		case AddressingMode::StackRelativeIndirectIndexed: std::snprintf(text, sizeof(text), "%s ($%02x,s),y", name, operand); break;
+
+		default:
+			// a few opcodes don't have their addressing mode in the table
+			switch (info.opcode) {
+				case Opcode::BRA: std::snprintf(text, sizeof(text), "%s $%04x", name, relativeTarget(false)); break;
+				case Opcode::BRL:
+				case Opcode::PER: std::snprintf(text, sizeof(text), "%s $%04x", name, relativeTarget(true)); break;
+				case Opcode::PEI: std::snprintf(text, sizeof(text), "%s ($%02x)", name, operand); break;
+				case Opcode::PEA: std::snprintf(text, sizeof(text), "%s $%04x", name, operand); break;
+				case Opcode::BRK:
+				case Opcode::COP:
+				case Opcode::WDM: std::snprintf(text, sizeof(text), "%s #$%02x", name, operand); break;
+				default:          std::snprintf(text, sizeof(text), "%s", name); break;
+			}
+			break;
+	}
+
+	return text;
+};
+
+std::string Blaze::formatTraceRecord(const TraceRecord& record) {
+	char bytes[16] = "";
+	int length = 0;
+	for (Byte i = 0; i < record.size; ++i) {
+		length += std::snprintf(bytes + length, sizeof(bytes) - length, (i == 0) ? "%02x" : " %02x", record.bytes[i]);
+	}
+
+	auto disassembly = disassemble(record.bytes, std::max<Byte>(record.size, 1), record.pc);
+
+	char line[160];
+	std::snprintf(line, sizeof(line), "%02x:%04x  %-11s  %-16s  A:%04x X:%04x Y:%04x S:%04x D:%04x DB:%02x P:%02x E:%d  @%llu",
+		(record.pc >> 16) & 0xff, record.pc & 0xffff, bytes, disassembly.c_str(),
+		record.a, record.x, record.y, record.sp, record.dr, record.dbr, record.p, record.e,
+		static_cast<unsigned long long>(record.cycle)
+	);
+	return line;
+};
@@ -0,0 +1,28 @@
+#include <blaze/color.hpp>
+#include <blaze/simd.hpp>
+
+void Blaze::convertBGR555(const std::uint16_t* source, Color* destination, size_t count) {
+	using Vector = simd::U16Vector;
+	const Vector componentMask = Vector::broadcast(0x1f);
+	const Vector alpha = Vector::broadcast(0xff00);
+
+	size_t i = 0;
+	for (; i + Vector::LANES <= count; i += Vector::LANES) {
+		Vector color = Vector::load(source + i);
+		Vector red = color & componentMask;
+		Vector green = color.shiftRight<5>() & componentMask;
+		Vector blue = color.shiftRight<10>() & componentMask;
+
+		// the same as `Color::expand5`
+		red = red.shiftLeft<3>() | red.shiftRight<2>();
+		green = green.shiftLeft<3>() | green.shiftRight<2>();
+		blue = blue.shiftLeft<3>() | blue.shiftRight<2>();
+
+		// as little-endian 16-bit pairs, that's R and G, then B and A
+		(red | green.shiftLeft<8>()).storeInterleaved(blue | alpha, destination + i);
+	}
+
+	for (; i < count; ++i) {
+		destination[i] = Color::fromBGR555(source[i]);
+	}
+};
@@ -1,4 +1,5 @@
 #include <SDL.h>
+#include <SDL_audio.h>
 #include <SDL_error.h>
 #include <SDL_events.h>
 #include <SDL_log.h>
@@ -7,9 +8,14 @@
 #include <SDL_syswm.h>
 #include <blaze/color.hpp>
 #include <map>
+#include <memory>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <algorithm>
+#include <blaze/AudioOutput.hpp>
 #include <blaze/Bus.hpp>
+#include <blaze/EmulationThread.hpp>
 #include <SDL_ttf.h>
 
 // Define SNES key constants
@@ -37,6 +43,27 @@ namespace Blaze {
 	static constexpr const char* defaultWindowTitle = "Blaze";
 	static constexpr Color defaultWindowColor { 0, 0, 0 };
 
+	// the debug text is shown in the first of these that loads
+	static constexpr const char* fontPaths[] = {
+#ifdef _WIN32
+		"C:\\Windows\\Fonts\\FiraCode-Regular.ttf",
+		"C:\\Windows\\Fonts\\consola.ttf",
+#elif defined(__APPLE__)
+		"/System/Library/Fonts/Menlo.ttc",
+		"/System/Library/Fonts/Monaco.ttf",
+#else
+		"/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf",
+		"/usr/share/fonts/TTF/DejaVuSansMono.ttf",
+		"/usr/share/fonts/dejavu/DejaVuSansMono.ttf",
+		"/usr/share/fonts/truetype/liberation/LiberationMono-Regular.ttf",
+#endif
+	};
+	static constexpr int fontSize = 16;
+
+	// (if the device runs at some other rate, SDL converts it)
+	static constexpr int audioOutputRate = 48000;
+	static constexpr Uint16 audioBufferFrames = 512;
+
 #ifdef _WIN32
 	enum MenuID: UINT_PTR {
 		FileExit = 1,
@@ -180,6 +207,12 @@ static int createText(const std::string& text, const SDL_Color& color, TTF_Font*
 	return 0;
 };
 
+// runs on SDL's audio thread
+static void audioCallback(void* userdata, Uint8* stream, int length) {
+	auto* output = static_cast<Blaze::AudioOutput*>(userdata);
+	output->pull(reinterpret_cast<int16_t*>(stream), length / (sizeof(int16_t) * Blaze::AudioOutput::CHANNELS));
+};
+
 int main(int argc, char** argv) {
 	SDL_Window* mainWindow;
 	SDL_Renderer* renderer;
@@ -188,9 +221,24 @@ int main(int argc, char** argv) {
 	std::map<int, bool> keyboard;
 	bool running = true;
 	SDL_SysWMinfo mainWindowInfo;
-	Blaze::Bus bus;
 	TTF_Font* font = nullptr;
-	bool executing = false;
+
+	// the bus and the emulation thread are pretty big (all of RAM, and three whole frames), so keep them off the stack
+	auto bus = std::make_unique<Blaze::Bus>();
+	auto emulation = std::make_unique<Blaze::EmulationThread>(*bus);
+
+	// the debug text currently shown on screen, and a texture with it already rendered
+	std::string displayedDebugText;
+	SDL_Texture* debugTexture = nullptr;
+	SDL_Rect debugTextureRect = { 0, 0 };
+
+	// the PPU's picture, converted into a texture every time there's a new frame
+	std::vector<Blaze::Color> screenPixels(Blaze::PPU::SCREEN_WIDTH * Blaze::PPU::SCREEN_HEIGHT);
+	SDL_Texture* screenTexture = nullptr;
+
+	// the APU's output, on its way to the audio device
+	Blaze::AudioOutput audioOutput(Blaze::APU::SAMPLE_RATE, Blaze::audioOutputRate);
+	SDL_AudioDeviceID audioDevice = 0;
 
 #ifdef _WIN32
 	HWND win32MainWindow = nullptr;
@@ -201,7 +249,7 @@ int main(int argc, char** argv) {
 	HMENU helpMenu = nullptr;
 #endif // _WIN32
 
-	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
 		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to initialize SDL: %s", SDL_GetError());
 		return 1;
 	}
@@ -211,27 +259,15 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 
-#ifdef _WIN32
-	// TODO: fall back to other fonts
-	font = TTF_OpenFont("C:\\Windows\\Fonts\\FiraCode-Regular.ttf", 16);
-#else
-	#warning TODO
-#endif
-	if (!font) {
-#ifdef _WIN32
-		// try another font
-		font = TTF_OpenFont("C:\\Windows\\Fonts\\consola.ttf", 16);
-		if (!font) {
-#else
-		#warning TODO
-#endif
-			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load font: %s", TTF_GetError());
-			return 1;
-#ifdef _WIN32
+	for (const char* path: Blaze::fontPaths) {
+		font = TTF_OpenFont(path, Blaze::fontSize);
+		if (font) {
+			break;
 		}
-#else
-		#warning TODO
-#endif
+	}
+	if (!font) {
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load font: %s", TTF_GetError());
+		return 1;
 	}
 
 	if (SDL_CreateWindowAndRenderer(Blaze::defaultWindowWidth, Blaze::defaultWindowHeight, SDL_WINDOW_RESIZABLE, &mainWindow, &renderer) < 0) {
@@ -242,6 +278,37 @@ int main(int argc, char** argv) {
 
 	SDL_SetWindowTitle(mainWindow, Blaze::defaultWindowTitle);
 
+	screenTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, Blaze::PPU::SCREEN_WIDTH, Blaze::PPU::SCREEN_HEIGHT);
+	if (!screenTexture) {
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create screen texture: %s", SDL_GetError());
+		SDL_DestroyRenderer(renderer);
+		SDL_DestroyWindow(mainWindow);
+		SDL_Quit();
+		return 1;
+	}
+
+	// without an audio device, everything still works (just without sound)
+	{
+		SDL_AudioSpec desired {};
+		desired.freq = Blaze::audioOutputRate;
+		desired.format = AUDIO_S16SYS;
+		desired.channels = Blaze::AudioOutput::CHANNELS;
+		desired.samples = Blaze::audioBufferFrames;
+		desired.callback = audioCallback;
+		desired.userdata = &audioOutput;
+
+		audioDevice = SDL_OpenAudioDevice(nullptr, 0, &desired, nullptr, 0);
+		if (audioDevice == 0) {
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open audio device: %s", SDL_GetError());
+		} else {
+			// the samples are pushed from whichever thread runs the APU, and never wait for the device
+			bus->apu.sampleHook = [&audioOutput](const int16_t* samples, size_t frames) {
+				audioOutput.push(samples, frames);
+			};
+			SDL_PauseAudioDevice(audioDevice, 0);
+		}
+	}
+
 	SDL_VERSION(&mainWindowInfo.version);
 	if (!SDL_GetWindowWMInfo(mainWindow, &mainWindowInfo)) {
 		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to get window handle: %s", SDL_GetError());
@@ -287,11 +354,6 @@ int main(int argc, char** argv) {
 	SDL_EventState(SDL_SYSWMEVENT, SDL_ENABLE);
 #endif // _WIN32
 
-	std::string debugBuffer;
-	bus.cpu.putCharacterHook = [&](char character) {
-		debugBuffer.push_back(character);
-	};
-
 	if (argc > 1) {
 		std::string path = argv[1];
 		std::stringstream output;
@@ -300,17 +362,15 @@ int main(int argc, char** argv) {
 		output << '\n';
 
 		try {
-			bus.rom.load(path);
+			bus->rom.load(path);
 
-			if (bus.rom.type() == Blaze::ROM::Type::INVALID) {
+			if (bus->rom.type() == Blaze::ROM::Type::INVALID) {
 				output << "Failed to load ROM";
 			} else {
-				output << "Loaded ROM with name: " << bus.rom.name();
+				output << "Loaded ROM with name: " << bus->rom.name();
 
 				// when a ROM is loaded, we need to reset all components
-				bus.reset();
-
-				executing = true;
+				bus->reset();
 			}
 		} catch (const std::runtime_error& e) {
 			output << "Failed to load ROM:\n" << e.what();
@@ -318,7 +378,11 @@ int main(int argc, char** argv) {
 
 		output << '\n';
 
-		debugBuffer = output.str();
+		emulation->setDebugText(output.str());
+
+		if (bus->rom.type() != Blaze::ROM::Type::INVALID) {
+			emulation->start();
+		}
 	}
 
 	// main event loop
@@ -334,11 +398,18 @@ int main(int argc, char** argv) {
 					break;
 
 				case SDL_KEYDOWN:
+					if (event.key.keysym.sym == SDLK_BACKSPACE) {
+						// hold backspace to rewind
+						emulation->setRewinding(true);
+					}
 					snesKey = mapSDLToSNES(event.key.keysym.sym);
 					// update emulator state
 					break;
 
 				case SDL_KEYUP:
+					if (event.key.keysym.sym == SDLK_BACKSPACE) {
+						emulation->setRewinding(false);
+					}
 					snesKey = mapSDLToSNES(event.key.keysym.sym);
 					// update emulator state
 					break;
@@ -352,21 +423,22 @@ int main(int argc, char** argv) {
 							std::stringstream output;
 
 							if (openROMDialog(path)) {
+								// the bus can only be touched while emulation is stopped
+								emulation->stop();
+
 								output << "Got ROM: " << path;
 								output << '\n';
 
 								try {
-									bus.rom.load(path);
+									bus->rom.load(path);
 
-									if (bus.rom.type() == Blaze::ROM::Type::INVALID) {
+									if (bus->rom.type() == Blaze::ROM::Type::INVALID) {
 										output << "Failed to load ROM";
 									} else {
-										output << "Loaded ROM with name: " << bus.rom.name();
+										output << "Loaded ROM with name: " << bus->rom.name();
 
 										// when a ROM is loaded, we need to reset all components
-										bus.reset();
-
-										executing = true;
+										bus->reset();
 									}
 								} catch (const std::runtime_error& e) {
 									output << "Failed to load ROM:\n" << e.what();
@@ -377,15 +449,27 @@ int main(int argc, char** argv) {
 
 							output << '\n';
 
-							debugBuffer = output.str();
+							if (emulation->running()) {
+								// the dialog failed, so keep running whatever was running before (but show the error)
+								emulation->stop();
+								emulation->setDebugText(output.str());
+								emulation->start();
+							} else {
+								emulation->setDebugText(output.str());
+
+								if (bus->rom.type() != Blaze::ROM::Type::INVALID) {
+									emulation->start();
+								}
+							}
 						} break;
 
 						case Blaze::MenuID::FileClose: {
+							emulation->stop();
+
 							// when a ROM is unloaded, we need to reset all components
-							bus.reset();
-							bus.rom.reset(&bus); // we also reset the ROM
-							executing = false;
-							debugBuffer = "";
+							bus->reset();
+							bus->rom.reset(bus.get()); // we also reset the ROM
+							emulation->setDebugText("");
 						} break;
 
 						case Blaze::MenuID::FileExit: {
@@ -425,33 +509,67 @@ int main(int argc, char** argv) {
 		SDL_SetRenderDrawColor(renderer, Blaze::defaultWindowColor.r, Blaze::defaultWindowColor.g, Blaze::defaultWindowColor.b, Blaze::defaultWindowColor.a);
 		SDL_RenderClear(renderer);
 
-		if (executing) {
-			// execute a single instruction
-			bus.cpu.execute();
+		// pick up the latest frame from the emulation thread (if there's a new one).
+		// the text only needs to be re-rendered when it actually changed.
+		bool newFrame = emulation->acquireFrame();
+		if (newFrame) {
+			Blaze::convertBGR555(emulation->frame().frameBuffer.data(), screenPixels.data(), screenPixels.size());
+			SDL_UpdateTexture(screenTexture, nullptr, screenPixels.data(), Blaze::PPU::SCREEN_WIDTH * sizeof(Blaze::Color));
 		}
 
-		// render the debug buffer
-		if (!debugBuffer.empty()) {
-			SDL_Rect rect = {
-				0, 0,
-			};
-			SDL_Color color = {
-				// white
-				255, 255, 255,
-			};
-			SDL_Texture* texture = nullptr;
+		// the picture is scaled to fit the window, keeping its aspect ratio
+		int outputWidth = 0;
+		int outputHeight = 0;
+		SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight);
+		double scale = std::min(double(outputWidth) / Blaze::PPU::SCREEN_WIDTH, double(outputHeight) / Blaze::PPU::SCREEN_HEIGHT);
+		SDL_Rect screenRect;
+		screenRect.w = int(Blaze::PPU::SCREEN_WIDTH * scale);
+		screenRect.h = int(Blaze::PPU::SCREEN_HEIGHT * scale);
+		screenRect.x = (outputWidth - screenRect.w) / 2;
+		screenRect.y = (outputHeight - screenRect.h) / 2;
+		SDL_RenderCopy(renderer, screenTexture, nullptr, &screenRect);
+
+		if (newFrame && emulation->frame().debugText != displayedDebugText) {
+			displayedDebugText = emulation->frame().debugText;
+
+			if (debugTexture) {
+				SDL_DestroyTexture(debugTexture);
+				debugTexture = nullptr;
+			}
 
-			if (createText(debugBuffer, color, font, renderer, texture, rect.w, rect.h) < 0) {
-				SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create text texture: %s", SDL_GetError());
-				abort();
+			if (!displayedDebugText.empty()) {
+				SDL_Color color = {
+					// white
+					255, 255, 255,
+				};
+
+				if (createText(displayedDebugText, color, font, renderer, debugTexture, debugTextureRect.w, debugTextureRect.h) < 0) {
+					SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create text texture: %s", SDL_GetError());
+					abort();
+				}
 			}
-			SDL_RenderCopy(renderer, texture, nullptr, &rect);
-			SDL_DestroyTexture(texture);
+		}
+
+		// render the debug buffer
+		if (debugTexture) {
+			SDL_RenderCopy(renderer, debugTexture, nullptr, &debugTextureRect);
 		}
 
 		SDL_RenderPresent(renderer);
 	}
 
+	emulation->stop();
+
+	if (audioDevice != 0) {
+		SDL_CloseAudioDevice(audioDevice);
+	}
+	bus->apu.sampleHook = nullptr;
+
+	if (debugTexture) {
+		SDL_DestroyTexture(debugTexture);
+	}
+	SDL_DestroyTexture(screenTexture);
+
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(mainWindow);
 
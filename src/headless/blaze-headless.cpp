@@ -0,0 +1,312 @@
+#include <blaze/Bus.hpp>
+#include <blaze/CallProfiler.hpp>
+#include <blaze/JIT.hpp>
+#include <blaze/Profiler.hpp>
+#include <blaze/Symbols.hpp>
+#include <blaze/Trace.hpp>
+#include <blaze/util.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace Blaze {
+	static constexpr uint64_t defaultInstructionBudget = 100'000'000;
+
+	struct HeadlessOptions {
+		std::string romPath;
+		uint64_t instructionBudget = 0; // 0 = no limit
+		uint64_t cycleBudget = 0;       // 0 = no limit (in master cycles)
+		std::string tracePath;          // empty = no tracing
+		uint64_t traceRecords = TraceBuffer::DEFAULT_CAPACITY;
+		bool useJIT = false;
+		bool profile = false;
+		uint64_t profileHandlers = 20;  // how many of the slowest handlers the profile lists
+		std::string callGraphPath;      // empty = no call profile
+		std::string symbolsPath;        // empty = routines are named by address
+		bool quiet = false;
+	};
+
+	enum class StopReason {
+		Stopped,
+		InstructionBudget,
+		CycleBudget,
+		Error,
+	};
+} // namespace Blaze
+
+static void printUsage(const char* programName) {
+	std::cerr
+		<< "Usage: " << programName << " [options] <rom>\n"
+		<< "\n"
+		<< "Runs a ROM without a GUI until the processor stops (via STP or WDM #$81) or a budget is exhausted.\n"
+		<< "Characters printed by the ROM (via WDM #$80) are written to stdout; the run summary is written to stderr.\n"
+		<< "\n"
+		<< "Options:\n"
+		<< "  -i, --instructions <count>  stop after executing this many instructions\n"
+		<< "  -c, --cycles <count>        stop after this many master clock cycles have passed\n"
+		<< "  -t, --trace <file>          record an instruction trace and save it to this file (view it with blaze-trace)\n"
+		<< "      --trace-records <count> how many of the most recent instructions the trace keeps (default: " << Blaze::TraceBuffer::DEFAULT_CAPACITY << ")\n"
+		<< "  -p, --profile               print where the CPU's time went, per instruction handler (needs a BLAZE_PROFILER build)\n"
+		<< "      --profile-handlers <n>  how many handlers the profile lists (default: 20)\n"
+		<< "  -g, --call-graph <file>     profile which routines the emulated code spends its cycles in, and save it to this\n"
+		<< "                              file as folded stacks (for flame graph tools)\n"
+		<< "      --symbols <file>        name the routines in the call graph with the labels in this asar symbol file\n"
+		<< "  -j, --jit                   compile hot code to native code (x86-64 only; budgets are then checked between blocks)\n"
+		<< "  -q, --quiet                 don't print the run summary\n"
+		<< "  -h, --help                  show this message\n"
+		<< "\n"
+		<< "If neither budget is given, the run is limited to " << Blaze::defaultInstructionBudget << " instructions.\n";
+};
+
+static bool parseCount(const char* text, uint64_t& outCount) {
+	try {
+		size_t consumed = 0;
+		outCount = std::stoull(text, &consumed, 0);
+		return consumed == std::strlen(text);
+	} catch (const std::exception&) {
+		return false;
+	}
+};
+
+static bool parseArguments(int argc, char** argv, Blaze::HeadlessOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		if (arg == "-h" || arg == "--help") {
+			return false;
+		} else if (arg == "-q" || arg == "--quiet") {
+			options.quiet = true;
+		} else if (arg == "-j" || arg == "--jit") {
+			options.useJIT = true;
+		} else if (arg == "-p" || arg == "--profile") {
+			options.profile = true;
+		} else if (arg == "-i" || arg == "--instructions" || arg == "-c" || arg == "--cycles" || arg == "--trace-records" || arg == "--profile-handlers") {
+			uint64_t& count = (arg == "-i" || arg == "--instructions") ? options.instructionBudget
+				: (arg == "--trace-records") ? options.traceRecords
+				: (arg == "--profile-handlers") ? options.profileHandlers
+				: options.cycleBudget;
+			if (i + 1 >= argc || !parseCount(argv[i + 1], count)) {
+				std::cerr << "Invalid or missing count for " << arg << '\n';
+				return false;
+			}
+			++i;
+		} else if (arg == "-t" || arg == "--trace" || arg == "-g" || arg == "--call-graph" || arg == "--symbols") {
+			if (i + 1 >= argc) {
+				std::cerr << "Missing file for " << arg << '\n';
+				return false;
+			}
+			std::string& path = (arg == "-t" || arg == "--trace") ? options.tracePath
+				: (arg == "--symbols") ? options.symbolsPath
+				: options.callGraphPath;
+			path = argv[++i];
+		} else if (!arg.empty() && arg[0] == '-') {
+			std::cerr << "Unknown option: " << arg << '\n';
+			return false;
+		} else if (options.romPath.empty()) {
+			options.romPath = arg;
+		} else {
+			std::cerr << "Only one ROM can be run at a time\n";
+			return false;
+		}
+	}
+
+	if (options.romPath.empty()) {
+		std::cerr << "No ROM given\n";
+		return false;
+	}
+
+	if (options.instructionBudget == 0 && options.cycleBudget == 0) {
+		options.instructionBudget = Blaze::defaultInstructionBudget;
+	}
+
+	return true;
+};
+
+static const char* stopReasonName(Blaze::StopReason reason) {
+	switch (reason) {
+		case Blaze::StopReason::Stopped:           return "processor stopped";
+		case Blaze::StopReason::InstructionBudget: return "instruction budget exhausted";
+		case Blaze::StopReason::CycleBudget:       return "cycle budget exhausted";
+		case Blaze::StopReason::Error:             return "error";
+		default:                                   return "unknown";
+	}
+};
+
+int main(int argc, char** argv) {
+	Blaze::HeadlessOptions options;
+
+	if (!parseArguments(argc, argv, options)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	// the bus is pretty big (it contains all of RAM), so keep it off the stack
+	auto bus = std::make_unique<Blaze::Bus>();
+
+	try {
+		bus->rom.load(options.romPath);
+	} catch (const std::runtime_error& e) {
+		std::cerr << "Failed to load ROM: " << e.what() << '\n';
+		return 1;
+	}
+
+	if (bus->rom.type() == Blaze::ROM::Type::INVALID) {
+		std::cerr << "Failed to load ROM: unrecognized ROM type\n";
+		return 1;
+	}
+
+	// when a ROM is loaded, we need to reset all components
+	bus->reset();
+
+	bus->cpu.putCharacterHook = [](char character) {
+		std::fputc(character, stdout);
+	};
+
+	std::unique_ptr<Blaze::JIT> jit;
+	if (options.useJIT) {
+		if (Blaze::JIT::supported()) {
+			jit = std::make_unique<Blaze::JIT>(bus->cpu);
+			bus->cpu.jit = jit.get();
+		} else {
+			std::cerr << "The JIT isn't supported on this platform; using the interpreter\n";
+		}
+	}
+
+	if (options.profile) {
+		if (!Blaze::Profiler::ENABLED) {
+			std::cerr << "The profiler isn't part of this build (configure with -DBLAZE_PROFILER=ON); not profiling\n";
+		} else if (jit) {
+			std::cerr << "Code run by the JIT isn't profiled\n";
+		}
+		Blaze::Profiler::reset();
+	}
+
+	std::unique_ptr<Blaze::CallProfiler> callProfiler;
+	Blaze::SymbolTable symbols;
+	if (!options.callGraphPath.empty()) {
+		callProfiler = std::make_unique<Blaze::CallProfiler>();
+		bus->cpu.callProfiler = callProfiler.get();
+
+		if (!options.symbolsPath.empty()) {
+			try {
+				symbols.load(options.symbolsPath);
+			} catch (const std::runtime_error& e) {
+				std::cerr << "Failed to load symbols: " << e.what() << '\n';
+			}
+		}
+	}
+
+	std::unique_ptr<Blaze::TraceBuffer> trace;
+	if (!options.tracePath.empty()) {
+		trace = std::make_unique<Blaze::TraceBuffer>(options.traceRecords);
+		bus->cpu.trace = trace.get();
+	}
+
+	uint64_t instructionLimit = (options.instructionBudget == 0) ? std::numeric_limits<uint64_t>::max() : options.instructionBudget;
+	uint64_t cycleLimit = (options.cycleBudget == 0) ? std::numeric_limits<uint64_t>::max() : options.cycleBudget;
+	uint64_t instructions = 0;
+	auto reason = Blaze::StopReason::InstructionBudget;
+	std::string errorMessage;
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	try {
+		while (true) {
+			if (instructions >= instructionLimit) {
+				reason = Blaze::StopReason::InstructionBudget;
+				break;
+			}
+
+			if (bus->scheduler.now() >= cycleLimit) {
+				reason = Blaze::StopReason::CycleBudget;
+				break;
+			}
+
+			// every instruction takes at least 2 CPU cycles (of at least 6 master cycles each), so running for this long can't
+			// go past the instruction budget (except with the JIT, which only stops at the end of a block)
+			uint64_t instructionsLeft = std::min<uint64_t>(instructionLimit - instructions, Blaze::MASTER_CYCLES_PER_FRAME);
+			uint64_t cycles = std::min(cycleLimit - bus->scheduler.now(), instructionsLeft * 2 * Blaze::Bus::FAST_ACCESS_CYCLES);
+
+			uint64_t executedBefore = bus->instructionsExecuted;
+			auto result = bus->runFor(cycles);
+
+			// waiting for an interrupt still counts as a step, so that instruction budgets always run out
+			instructions += std::max<uint64_t>(bus->instructionsExecuted - executedBefore, 1);
+
+			if (result == Blaze::Bus::RunResult::Stopped) {
+				reason = Blaze::StopReason::Stopped;
+				break;
+			}
+		}
+	} catch (const std::runtime_error& e) {
+		reason = Blaze::StopReason::Error;
+		errorMessage = std::string(e.what()) + " (while executing instruction at 0x" + Blaze::valueToHexString(bus->cpu.executingPC) + ")";
+	}
+
+	auto endTime = std::chrono::steady_clock::now();
+	std::fflush(stdout);
+
+	if (trace) {
+		try {
+			trace->save(options.tracePath);
+		} catch (const std::runtime_error& e) {
+			std::cerr << "Failed to save trace: " << e.what() << '\n';
+		}
+	}
+
+	if (callProfiler) {
+		std::ofstream file(options.callGraphPath);
+		callProfiler->writeFolded(file, options.symbolsPath.empty() ? nullptr : &symbols);
+		if (!file) {
+			std::cerr << "Failed to save call graph to " << options.callGraphPath << '\n';
+		}
+	}
+
+	if (!options.quiet) {
+		double seconds = std::chrono::duration<double>(endTime - startTime).count();
+		double instructionsPerSecond = (seconds > 0) ? (static_cast<double>(instructions) / seconds) : 0;
+
+		std::cerr << "Stopped: " << stopReasonName(reason) << '\n';
+		if (!errorMessage.empty()) {
+			std::cerr << "Error: " << errorMessage << '\n';
+		}
+		std::cerr << "Instructions: " << instructions << '\n';
+		std::cerr << "Master cycles: " << bus->scheduler.now() << '\n';
+		std::cerr << "Emulated time: " << (static_cast<double>(bus->scheduler.now()) / Blaze::MASTER_CLOCK_HZ) << " s\n";
+		std::cerr << "Time: " << seconds << " s\n";
+		std::cerr << "Instructions per second: " << static_cast<uint64_t>(instructionsPerSecond) << '\n';
+		if (bus->unmappedAccesses > 0) {
+			std::cerr << "Unmapped (open bus) accesses: " << bus->unmappedAccesses << '\n';
+		}
+		if (jit) {
+			std::cerr << "JIT: " << jit->compiledBlockCount() << " blocks compiled (" << jit->codeBytesUsed() << " bytes of code)\n";
+		}
+		if (trace) {
+			std::cerr << "Traced instructions: " << trace->size() << " (of " << trace->totalRecorded() << ")\n";
+		}
+		if (callProfiler) {
+			std::cerr << "Call graph: " << callProfiler->totalCycles() << " master cycles profiled";
+			if (callProfiler->mismatches() > 0) {
+				std::cerr << " (" << callProfiler->mismatches() << " unmatched calls)";
+			}
+			std::cerr << '\n';
+		}
+	}
+
+	// (this is what was asked for, so it's printed even when the summary isn't)
+	if (options.profile && Blaze::Profiler::ENABLED) {
+		std::cerr << '\n';
+		Blaze::Profiler::snapshot().writeReport(std::cerr, options.profileHandlers);
+	}
+
+	return (reason == Blaze::StopReason::Error) ? 2 : 0;
+};
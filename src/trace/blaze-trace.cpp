@@ -0,0 +1,98 @@
+#include <blaze/Trace.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace Blaze {
+	struct TraceOptions {
+		std::string tracePath;
+		uint64_t last = 0; // 0 = print everything
+	};
+} // namespace Blaze
+
+static void printUsage(const char* programName) {
+	std::cerr
+		<< "Usage: " << programName << " [options] <trace>\n"
+		<< "\n"
+		<< "Disassembles an instruction trace recorded by blaze-headless (with --trace), one instruction per line:\n"
+		<< "the address, the instruction bytes and disassembly, the registers before the instruction executed,\n"
+		<< "and the master clock cycle it started on.\n"
+		<< "\n"
+		<< "Options:\n"
+		<< "  -n, --last <count>  only print the last this many instructions\n"
+		<< "  -h, --help          show this message\n";
+};
+
+static bool parseArguments(int argc, char** argv, Blaze::TraceOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		if (arg == "-h" || arg == "--help") {
+			return false;
+		} else if (arg == "-n" || arg == "--last") {
+			try {
+				size_t consumed = 0;
+				if (i + 1 >= argc) {
+					throw std::invalid_argument("missing count");
+				}
+				options.last = std::stoull(argv[i + 1], &consumed, 0);
+				if (consumed != std::strlen(argv[i + 1])) {
+					throw std::invalid_argument("trailing characters");
+				}
+			} catch (const std::exception&) {
+				std::cerr << "Invalid or missing count for " << arg << '\n';
+				return false;
+			}
+			++i;
+		} else if (!arg.empty() && arg[0] == '-') {
+			std::cerr << "Unknown option: " << arg << '\n';
+			return false;
+		} else if (options.tracePath.empty()) {
+			options.tracePath = arg;
+		} else {
+			std::cerr << "Only one trace can be decoded at a time\n";
+			return false;
+		}
+	}
+
+	if (options.tracePath.empty()) {
+		std::cerr << "No trace given\n";
+		return false;
+	}
+
+	return true;
+};
+
+int main(int argc, char** argv) {
+	Blaze::TraceOptions options;
+
+	if (!parseArguments(argc, argv, options)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	std::vector<Blaze::TraceRecord> records;
+	try {
+		records = Blaze::loadTrace(options.tracePath);
+	} catch (const std::runtime_error& e) {
+		std::cerr << "Failed to load trace: " << e.what() << '\n';
+		return 1;
+	}
+
+	size_t start = 0;
+	if (options.last != 0 && options.last < records.size()) {
+		start = records.size() - static_cast<size_t>(options.last);
+	}
+
+	for (size_t i = start; i < records.size(); ++i) {
+		auto line = Blaze::formatTraceRecord(records[i]);
+		std::fwrite(line.data(), 1, line.size(), stdout);
+		std::fputc('\n', stdout);
+	}
+
+	return 0;
+};
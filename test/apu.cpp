@@ -0,0 +1,399 @@
+#include <blaze/Bus.hpp>
+#include <blaze/util.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace Blaze;
+
+// runs the clock (but not the CPU) until the given APU port reads back the given value
+static bool waitForPort(Bus& bus, Address port, Byte value) {
+	for (unsigned attempt = 0; attempt < 100000; ++attempt) {
+		if (bus.read8(port) == value) {
+			return true;
+		}
+		bus.scheduler.advance(64);
+	}
+	return false;
+}
+
+// sends a program to the APU through the IPL ROM's protocol (the way games do it) and starts it
+static void upload(Bus& bus, Word address, const std::vector<Byte>& data) {
+	REQUIRE(waitForPort(bus, 0x2140, 0xaa));
+	REQUIRE(waitForPort(bus, 0x2141, 0xbb));
+
+	bus.write(0x2142, address);
+	bus.write(0x2141, Byte(0x01));
+	bus.write(0x2140, Byte(0xcc));
+	REQUIRE(waitForPort(bus, 0x2140, 0xcc));
+
+	for (size_t i = 0; i < data.size(); ++i) {
+		bus.write(0x2141, data[i]);
+		bus.write(0x2140, static_cast<Byte>(i));
+		REQUIRE(waitForPort(bus, 0x2140, static_cast<Byte>(i)));
+	}
+
+	// skipping ahead in the count ends the transfer; a 0 in port 1 then jumps to the address in ports 2 and 3
+	Byte end = static_cast<Byte>(data.size() + 1);
+	bus.write(0x2142, address);
+	bus.write(0x2141, Byte(0x00));
+	bus.write(0x2140, end);
+	REQUIRE(waitForPort(bus, 0x2140, end));
+}
+
+// sets up voice 0 to play a looping square wave, then echoes port 0 (plus one) back on port 1
+static std::vector<Byte> soundProgram() {
+	const Byte dspWrites[][2] = {
+		{ DSP::FLG, 0x20 }, // unmuted, with echo writes off
+		{ DSP::MVOLL, 0x7f },
+		{ DSP::MVOLR, 0x7f },
+		{ DSP::DIR, 0x03 }, // the sample directory is at $0300
+		{ DSP::VOLL, 0x7f },
+		{ DSP::VOLR, 0x7f },
+		{ DSP::PITCHL, 0x00 },
+		{ DSP::PITCHH, 0x10 }, // (the sample's own rate)
+		{ DSP::SRCN, 0x00 },
+		{ DSP::ADSR1, 0x8f }, // the fastest attack
+		{ DSP::ADSR2, 0xe0 }, // sustained at full volume
+		{ DSP::KON, 0x01 },
+	};
+
+	std::vector<Byte> program;
+	for (const auto& write: dspWrites) {
+		program.insert(program.end(), {
+			0x8f, write[0], 0xf2, // mov $f2, #register
+			0x8f, write[1], 0xf3, // mov $f3, #value
+		});
+	}
+	program.insert(program.end(), {
+		0xe4, 0xf4, // mov a, $f4
+		0xbc,       // inc a
+		0xc4, 0xf5, // mov $f5, a
+		0x2f, 0xf9, // bra (back to the mov)
+	});
+
+	// the directory entry for sample 0 (at $0300): it starts and loops at $0310
+	program.resize(0x100);
+	program.insert(program.end(), { 0x10, 0x03, 0x10, 0x03 });
+	program.resize(0x110);
+	// one block (shift 12, looping): 8 samples at +7, then 8 at -7
+	program.insert(program.end(), { 0xc3, 0x77, 0x77, 0x77, 0x77, 0x99, 0x99, 0x99, 0x99 });
+	return program;
+}
+
+// a CPU program (at $7E0000) that writes a new value to port 0 every so often
+static void loadPortWritingProgram(Bus& bus) {
+	const Byte program[] = {
+		0x1a,             // inc a
+		0x8d, 0x40, 0x21, // sta $2140
+		0xea, 0xea, 0xea, // nop (x3)
+		0xea, 0xea, 0xea, // nop (x3)
+		0x4c, 0x00, 0x00, // jmp $0000
+	};
+
+	Address address = 0x7e0000;
+	for (auto byte: program) {
+		bus.write(address++, byte);
+	}
+	bus.cpu.PBR = 0x7e;
+	bus.cpu.PC = 0;
+}
+
+TEST_CASE("SPC700 instructions", "[apu]") {
+	auto bus = std::make_unique<Bus>();
+	SPC700& spc = bus->apu.spc;
+
+	// runs the given instructions (at $0200) until the PC gets to the end of them
+	auto run = [&](const std::vector<Byte>& program) {
+		for (size_t i = 0; i < program.size(); ++i) {
+			bus->apu.aram[0x0200 + i] = program[i];
+		}
+		spc.PC = 0x0200;
+		unsigned cycles = 0;
+		for (unsigned steps = 0; steps < 1000 && spc.PC != 0x0200 + program.size(); ++steps) {
+			cycles += spc.step();
+		}
+		REQUIRE(spc.PC == 0x0200 + program.size());
+		return cycles;
+	};
+
+	SECTION("Arithmetic") {
+		// mov a, #$7f; clrc; adc a, #$01
+		REQUIRE(run({ 0xe8, 0x7f, 0x60, 0x88, 0x01 }) == 6);
+		REQUIRE(spc.A == 0x80);
+		REQUIRE((spc.PSW & SPC700::flags::v) != 0);
+		REQUIRE((spc.PSW & SPC700::flags::h) != 0);
+		REQUIRE((spc.PSW & SPC700::flags::n) != 0);
+		REQUIRE((spc.PSW & SPC700::flags::c) == 0);
+
+		// mov a, #$10; setc; sbc a, #$11 (borrows)
+		run({ 0xe8, 0x10, 0x80, 0xa8, 0x11 });
+		REQUIRE(spc.A == 0xff);
+		REQUIRE((spc.PSW & SPC700::flags::c) == 0);
+
+		// mov y, #$12; mov a, #$34; mov x, #$56; mul ya; div ya, x
+		run({ 0x8d, 0x12, 0xe8, 0x34, 0xcd, 0x56, 0xcf });
+		REQUIRE(concat16(spc.Y, spc.A) == 0x12 * 0x34);
+		run({ 0x9e });
+		REQUIRE(spc.A == (0x12 * 0x34) / 0x56);
+		REQUIRE(spc.Y == (0x12 * 0x34) % 0x56);
+
+		// mov a, #$19; clrc; adc a, #$28; daa a
+		run({ 0xe8, 0x19, 0x60, 0x88, 0x28, 0xdf });
+		REQUIRE(spc.A == 0x47);
+	}
+
+	SECTION("16-bit instructions") {
+		bus->apu.aram[0x0010] = 0xff;
+		bus->apu.aram[0x0011] = 0x07;
+		// incw $10; movw ya, $10; addw ya, $10 (which carries out of bit 11)
+		run({ 0x3a, 0x10, 0xba, 0x10, 0x7a, 0x10 });
+		REQUIRE(concat16(spc.Y, spc.A) == 0x1000);
+		REQUIRE((spc.PSW & SPC700::flags::h) != 0);
+
+		// subw ya, $10; movw $12, ya
+		run({ 0x9a, 0x10, 0xda, 0x12 });
+		REQUIRE(bus->apu.aram[0x0012] == 0x00);
+		REQUIRE(bus->apu.aram[0x0013] == 0x08);
+		REQUIRE((spc.PSW & SPC700::flags::c) != 0);
+	}
+
+	SECTION("Branches and calls") {
+		// mov y, #$03; (loop:) inc $20; dbnz y, loop
+		bus->apu.aram[0x0020] = 0;
+		REQUIRE(run({ 0x8d, 0x03, 0xab, 0x20, 0xfe, 0xfc }) == 2 + 3 * (4 + 4) + 2 * 2);
+		REQUIRE(bus->apu.aram[0x0020] == 3);
+
+		// tcall 0 (through $FFDE) to a subroutine at $0300 that sets bit 5 of $20 and returns
+		bus->apu.write(0x00f1, 0x00); // (the IPL ROM would hide the vector)
+		bus->apu.aram[0xffde] = 0x00;
+		bus->apu.aram[0xffdf] = 0x03;
+		bus->apu.aram[0x0300] = 0xa2; // set1 $20.5
+		bus->apu.aram[0x0301] = 0x20;
+		bus->apu.aram[0x0302] = 0x6f; // ret
+		spc.SP = 0xef;
+		run({ 0x01 });
+		REQUIRE(spc.PC == 0x0201);
+		REQUIRE(spc.SP == 0xef);
+		REQUIRE(bus->apu.aram[0x0020] == 0x23);
+
+		// cbne $20, (skip the next instruction); mov a, #$00 (skipped)
+		run({ 0xe8, 0x55, 0x2e, 0x20, 0x02, 0xe8, 0x00 });
+		REQUIRE(spc.A == 0x55);
+
+		// bbs $20.1; (the bit's set, so this branches over the clr1)
+		run({ 0x23, 0x20, 0x02, 0x32, 0x20 });
+		REQUIRE(bus->apu.aram[0x0020] == 0x23);
+	}
+
+	SECTION("Bit instructions") {
+		bus->apu.aram[0x0123] = 0x04;
+		// clrc; or1 c, $0123.2; not1 $0123.2; mov1 $0123.7, c
+		run({ 0x60, 0x0a, 0x23, 0x41, 0xea, 0x23, 0x41, 0xca, 0x23, 0xe1 });
+		REQUIRE((spc.PSW & SPC700::flags::c) != 0);
+		REQUIRE(bus->apu.aram[0x0123] == 0x80);
+
+		// tset1 !$0123 (with A = $0f)
+		run({ 0xe8, 0x0f, 0x0e, 0x23, 0x01 });
+		REQUIRE(bus->apu.aram[0x0123] == 0x8f);
+	}
+}
+
+TEST_CASE("S-DSP", "[apu]") {
+	auto bus = std::make_unique<Bus>();
+	APU& apu = bus->apu;
+	DSP& dsp = apu.dsp;
+
+	// voice 0 plays a looping block of 16 samples at +7 (shift 12), from $0310, at full volume
+	const Byte sample[] = { 0xc3, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77 };
+	for (size_t i = 0; i < sizeof(sample); ++i) {
+		apu.write(static_cast<Word>(0x0310 + i), sample[i]);
+	}
+	apu.write(0x0300, 0x10);
+	apu.write(0x0301, 0x03);
+	apu.write(0x0302, 0x10);
+	apu.write(0x0303, 0x03);
+
+	dsp.write(DSP::FLG, 0x20);
+	dsp.write(DSP::MVOLL, 0x7f);
+	dsp.write(DSP::MVOLR, 0x7f);
+	dsp.write(DSP::DIR, 0x03);
+	dsp.write(DSP::VOLL, 0x7f);
+	dsp.write(DSP::VOLR, 0x7f);
+	dsp.write(DSP::PITCHH, 0x10);
+	dsp.write(DSP::GAIN, 0x7f); // (a fixed envelope)
+	dsp.write(DSP::KON, 0x01);
+
+	int16_t left = 0;
+	int16_t right = 0;
+	auto run = [&](unsigned samples) {
+		for (unsigned i = 0; i < samples; ++i) {
+			dsp.runSample(left, right);
+		}
+	};
+
+	run(64);
+	REQUIRE(left > 0x1000);
+	REQUIRE(left == right);
+	// every sample is 7 << 12 (kept doubled, like the chip does), and at the sample's own rate the interpolation always
+	// uses the weights for a fraction of 0 (370, 1305, 374 and 0): that's 28686, then 28460 after the envelope, and
+	// 28016 after the voice and main volumes
+	REQUIRE(left == 28016);
+	REQUIRE(dsp.read(DSP::ENVX) == 0x7f);
+	REQUIRE(static_cast<int8_t>(dsp.read(DSP::OUTX)) > 0);
+	int16_t playing = left;
+
+	SECTION("Changing a sample while it's playing") {
+		// the loop has been decoded (and cached) already, but it has to be decoded again now that it's -7
+		for (Word address = 0x0311; address < 0x0319; ++address) {
+			apu.write(address, 0x99);
+		}
+		run(64);
+		REQUIRE(left < -0x1000);
+		REQUIRE(static_cast<int8_t>(dsp.read(DSP::OUTX)) < 0);
+
+		// and back again
+		for (Word address = 0x0311; address < 0x0319; ++address) {
+			apu.write(address, 0x77);
+		}
+		run(64);
+		REQUIRE(left == playing);
+	}
+
+	SECTION("Voices playing the same sample") {
+		// (voice 0 keeps playing, but silently)
+		dsp.write(DSP::VOLL, 0x00);
+		dsp.write(DSP::VOLR, 0x00);
+		dsp.write(0x10 | DSP::VOLL, 0x7f);
+		dsp.write(0x10 | DSP::VOLR, 0x7f);
+		dsp.write(0x10 | DSP::PITCHH, 0x10);
+		dsp.write(0x10 | DSP::GAIN, 0x7f);
+		dsp.write(DSP::KON, 0x02);
+		run(64);
+		REQUIRE(left == playing);
+		REQUIRE(dsp.read(0x10 | DSP::OUTX) == dsp.read(DSP::OUTX));
+	}
+
+	SECTION("Decaying to the sustain level in GAIN mode") {
+		// a rising envelope that goes past the top moves on to decay, which (while GAIN drives the envelope) ends at the
+		// sustain level in GAIN's top 3 bits rather than ADSR2's
+		dsp.write(DSP::GAIN, 0xdf); // linear increase, every sample
+		run(8);
+		dsp.write(DSP::GAIN, 0xbf); // exponential decrease (sustain level 5), every sample
+		run(128);
+
+		// sustaining with ADSR2 at 0 holds the envelope where it is; still decaying would keep lowering it
+		dsp.write(DSP::ADSR1, 0xf0);
+		run(1); // (ENVX is a sample behind the envelope)
+		Byte sustained = dsp.read(DSP::ENVX);
+		REQUIRE(sustained > 0x10);
+		run(256);
+		REQUIRE(dsp.read(DSP::ENVX) == sustained);
+	}
+
+	SECTION("Keying off") {
+		dsp.write(DSP::KOFF, 0x01);
+		run(256);
+		REQUIRE(left == 0);
+		REQUIRE(dsp.read(DSP::ENVX) == 0);
+	}
+}
+
+TEST_CASE("APU", "[apu]") {
+	auto bus = std::make_unique<Bus>();
+
+	SECTION("Timers") {
+		// timer 2 steps at 64 kHz; with a target of 4, its counter goes up every 64 cycles
+		bus->apu.write(0x00fc, 4);
+		bus->apu.write(0x00f1, 0x84);
+
+		// (512 SPC700 cycles, rounded up to the next master cycle)
+		bus->apu.sync(512 * MASTER_CLOCK_HZ / APU::CLOCK_HZ + 1);
+		REQUIRE(bus->apu.read(0x00ff) == 8);
+		REQUIRE(bus->apu.read(0x00ff) == 0);
+	}
+
+	SECTION("Uploading a program through the IPL ROM") {
+		std::vector<int16_t> samples;
+		bus->apu.sampleHook = [&](const int16_t* data, size_t frames) {
+			samples.insert(samples.end(), data, data + frames * 2);
+		};
+
+		upload(*bus, 0x0200, soundProgram());
+
+		bus->write(0x2140, Byte(0x41));
+		REQUIRE(waitForPort(*bus, 0x2141, 0x42));
+
+		// let the voice play for a while
+		bus->scheduler.advance(MASTER_CYCLES_PER_FRAME * 2);
+		bus->apu.sync(bus->scheduler.now());
+		REQUIRE(bus->apu.dsp.registers[DSP::ENVX] == 0x7f);
+		REQUIRE(samples.size() > 1000);
+
+		int16_t loudest = 0;
+		int16_t quietest = 0;
+		for (int16_t sample: samples) {
+			loudest = std::max(loudest, sample);
+			quietest = std::min(quietest, sample);
+		}
+		REQUIRE(loudest > 0x1000);
+		REQUIRE(quietest < -0x1000);
+	}
+
+	SECTION("Running on its own thread gives the same results") {
+		auto threadedBus = std::make_unique<Bus>();
+		threadedBus->apu.startThread();
+
+		std::vector<int16_t> samples;
+		std::vector<int16_t> threadedSamples;
+		bus->apu.sampleHook = [&](const int16_t* data, size_t frames) {
+			samples.insert(samples.end(), data, data + frames * 2);
+		};
+		threadedBus->apu.sampleHook = [&](const int16_t* data, size_t frames) {
+			threadedSamples.insert(threadedSamples.end(), data, data + frames * 2);
+		};
+
+		for (Bus* each: { bus.get(), threadedBus.get() }) {
+			upload(*each, 0x0200, soundProgram());
+			loadPortWritingProgram(*each);
+			for (unsigned frame = 0; frame < 8; ++frame) {
+				REQUIRE(each->runFrame() == Bus::RunResult::Finished);
+			}
+			REQUIRE(each->apu.time() == each->scheduler.now());
+
+			// the APU saw the CPU's writes
+			REQUIRE(waitForPort(*each, 0x2141, static_cast<Byte>(each->cpu.A.forceLoadFull() + 1)));
+		}
+
+		threadedBus->apu.stopThread();
+
+		std::vector<Byte> state(bus->saveStateSize());
+		std::vector<Byte> threadedState(threadedBus->saveStateSize());
+		bus->saveState(state.data(), state.size());
+		threadedBus->saveState(threadedState.data(), threadedState.size());
+		REQUIRE(state == threadedState);
+		REQUIRE(samples == threadedSamples);
+	}
+
+	SECTION("Save states") {
+		upload(*bus, 0x0200, soundProgram());
+		bus->write(0x2140, Byte(0x10));
+
+		std::vector<Byte> state(bus->saveStateSize());
+		bus->saveState(state.data(), state.size());
+
+		// the port write is still queued; it has to survive the round trip
+		auto restored = std::make_unique<Bus>();
+		restored->loadState(state.data(), state.size());
+		REQUIRE(waitForPort(*restored, 0x2141, 0x11));
+		REQUIRE(waitForPort(*bus, 0x2141, 0x11));
+
+		state.resize(bus->saveStateSize());
+		bus->saveState(state.data(), state.size());
+		std::vector<Byte> restoredState(restored->saveStateSize());
+		restored->saveState(restoredState.data(), restoredState.size());
+		REQUIRE(state == restoredState);
+	}
+}
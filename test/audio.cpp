@@ -0,0 +1,140 @@
+#include <blaze/AudioOutput.hpp>
+#include <blaze/SampleRing.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace Blaze;
+
+TEST_CASE("Sample ring", "[audio]") {
+	SampleRing ring(6);
+	REQUIRE(ring.capacity() == 8);
+	REQUIRE(ring.available() == 0);
+
+	std::vector<int16_t> samples;
+	for (int16_t i = 0; i < 20; ++i) {
+		samples.push_back(i);
+	}
+
+	SECTION("Wrapping around") {
+		std::vector<int16_t> out(20);
+		for (int round = 0; round < 5; ++round) {
+			REQUIRE(ring.write(samples.data(), 5) == 5);
+			REQUIRE(ring.available() == 5);
+			REQUIRE(ring.read(out.data(), 10) == 5);
+			REQUIRE(std::vector<int16_t>(out.begin(), out.begin() + 10) == std::vector<int16_t>(samples.begin(), samples.begin() + 10));
+		}
+		REQUIRE(ring.available() == 0);
+	}
+
+	SECTION("Full and empty") {
+		// whatever doesn't fit is dropped
+		REQUIRE(ring.write(samples.data(), 10) == 8);
+		REQUIRE(ring.write(samples.data(), 1) == 0);
+
+		std::vector<int16_t> out(16);
+		REQUIRE(ring.read(out.data(), 3) == 3);
+		REQUIRE(ring.write(samples.data() + 16, 2) == 2);
+		REQUIRE(ring.read(out.data(), 8) == 7);
+		REQUIRE(out[0] == 6);
+		REQUIRE(out[10] == 16);
+		REQUIRE(out[13] == 19);
+		REQUIRE(ring.read(out.data(), 1) == 0);
+	}
+
+	SECTION("Across threads") {
+		// the consumer has to see every frame, in order
+		static constexpr int16_t COUNT = 30000;
+		SampleRing bigRing(256);
+
+		std::thread producer([&] {
+			for (int16_t next = 0; next < COUNT;) {
+				const int16_t frame[2] = { next, static_cast<int16_t>(-next) };
+				next += static_cast<int16_t>(bigRing.write(frame, 1));
+			}
+		});
+
+		bool inOrder = true;
+		int16_t expected = 0;
+		int16_t frames[64 * 2];
+		while (expected < COUNT) {
+			size_t count = bigRing.read(frames, 64);
+			for (size_t i = 0; i < count; ++i, ++expected) {
+				inOrder = inOrder && frames[i * 2] == expected && frames[i * 2 + 1] == -expected;
+			}
+		}
+		producer.join();
+
+		REQUIRE(inOrder);
+		REQUIRE(bigRing.available() == 0);
+	}
+}
+
+TEST_CASE("Audio output", "[audio]") {
+	static constexpr unsigned INPUT_RATE = 32000;
+	static constexpr unsigned OUTPUT_RATE = 48000;
+	static constexpr size_t LATENCY = 1600;
+
+	AudioOutput output(INPUT_RATE, OUTPUT_RATE, LATENCY);
+	std::vector<int16_t> in(2 * 1000, 1000);
+	std::vector<int16_t> out(2 * 512);
+
+	SECTION("Waiting for the buffer to fill up") {
+		output.push(in.data(), 1000);
+		output.pull(out.data(), 512);
+		REQUIRE(out == std::vector<int16_t>(out.size(), 0));
+		REQUIRE(output.buffered() == 1000);
+
+		output.push(in.data(), 1000);
+		output.pull(out.data(), 512);
+		REQUIRE(output.buffered() < 2000);
+
+		// (the interpolation takes a few samples to get going)
+		output.pull(out.data(), 512);
+		REQUIRE(out == std::vector<int16_t>(out.size(), 1000));
+	}
+
+	SECTION("Running dry") {
+		output.push(in.data(), 1000);
+		output.push(in.data(), 1000);
+		for (int i = 0; i < 8; ++i) {
+			output.pull(out.data(), 512);
+		}
+		REQUIRE(output.underruns() == 1);
+		REQUIRE(out == std::vector<int16_t>(out.size(), 0));
+	}
+
+	SECTION("Following a device clock that runs fast") {
+		// the device plays 0.2% faster than it says it does, so the buffer would slowly run out without the rate control
+		double deviceRate = OUTPUT_RATE * 1.002;
+		double produced = 0;
+		double consumed = 0;
+		size_t minimum = SIZE_MAX;
+		size_t maximum = 0;
+
+		// 2 minutes, with the emulation producing a frame's worth at a time and the device asking for 512 frames at a time
+		for (unsigned millisecond = 0; millisecond < 120'000; ++millisecond) {
+			double time = (millisecond + 1) / 1000.0;
+			while (produced + 534 <= time * INPUT_RATE) {
+				output.push(in.data(), 534);
+				produced += 534;
+			}
+			while (consumed + 512 <= time * deviceRate) {
+				output.pull(out.data(), 512);
+				consumed += 512;
+				if (millisecond > 20'000) {
+					minimum = std::min(minimum, output.buffered());
+					maximum = std::max(maximum, output.buffered());
+				}
+			}
+		}
+
+		REQUIRE(output.underruns() == 0);
+		REQUIRE(output.droppedFrames() == 0);
+		REQUIRE(std::abs(output.ratio() * deviceRate / INPUT_RATE - 1.0) < 0.0005);
+		REQUIRE(minimum > 0);
+		REQUIRE(maximum < LATENCY * 2);
+	}
+}
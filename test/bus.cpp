@@ -0,0 +1,203 @@
+#include <blaze/Bus.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace Blaze;
+
+TEST_CASE("RAM mapping", "[bus]") {
+	Bus bus;
+
+	SECTION("Low RAM is mirrored into banks $00-$3F and $80-$BF") {
+		bus.write(0x7e0123, static_cast<Byte>(0xab));
+		REQUIRE(bus.read8(0x000123) == 0xab);
+		REQUIRE(bus.read8(0x3f0123) == 0xab);
+		REQUIRE(bus.read8(0x800123) == 0xab);
+
+		bus.write(0x001ffe, static_cast<Word>(0x1234));
+		REQUIRE(bus.read16(0x7e1ffe) == 0x1234);
+	}
+
+	SECTION("Bank $7F maps the second 64 KiB of RAM") {
+		bus.write(0x7f0000, static_cast<Address>(0x563412));
+		REQUIRE(bus.read24(0x7f0000) == 0x563412);
+		REQUIRE(bus.read8(0x7e0000) == 0x00);
+	}
+
+	SECTION("Accesses crossing a page boundary") {
+		Address pageEnd = 0x7e0000 + Bus::PAGE_SIZE - 1;
+		bus.write(pageEnd, static_cast<Word>(0xbeef));
+		REQUIRE(bus.read8(pageEnd) == 0xef);
+		REQUIRE(bus.read8(pageEnd + 1) == 0xbe);
+		REQUIRE(bus.read16(pageEnd) == 0xbeef);
+
+		bus.write(pageEnd - 1, static_cast<Address>(0x112233));
+		REQUIRE(bus.read24(pageEnd - 1) == 0x112233);
+	}
+
+	SECTION("Unmapped accesses read open bus and are reported") {
+		std::vector<std::pair<Address, bool>> faults;
+		bus.faultHook = [&](Address address, bool isWrite) {
+			faults.emplace_back(address, isWrite);
+		};
+		uint64_t unmappedBefore = bus.unmappedAccesses;
+
+		// with no ROM loaded, nothing is mapped into bank $40; reads return whatever was last on the data bus
+		bus.write(0x7e0000, static_cast<Byte>(0x5a));
+		REQUIRE(bus.read8(0x400000) == 0x5a);
+
+		REQUIRE(bus.read8(0x7e0001) == 0x00);
+		REQUIRE(bus.read16(0x400000) == 0x0000);
+
+		// writes are just dropped
+		bus.write(0x400010, static_cast<Word>(0x1234));
+		REQUIRE(bus.read8(0x400010) == 0x12);
+
+		REQUIRE(bus.unmappedAccesses == unmappedBefore + 4);
+		REQUIRE(faults == std::vector<std::pair<Address, bool>> {
+			{ 0x400000, false },
+			{ 0x400000, false },
+			{ 0x400010, true },
+			{ 0x400010, false },
+		});
+	}
+}
+
+TEST_CASE("Memory access speeds", "[bus]") {
+	Bus bus;
+
+	REQUIRE(bus.accessCycles(0x000000) == Bus::SLOW_ACCESS_CYCLES);
+	REQUIRE(bus.accessCycles(0x002100) == Bus::FAST_ACCESS_CYCLES);
+	REQUIRE(bus.accessCycles(0x004200) == Bus::FAST_ACCESS_CYCLES);
+	REQUIRE(bus.accessCycles(0x008000) == Bus::SLOW_ACCESS_CYCLES);
+	REQUIRE(bus.accessCycles(0x7e0000) == Bus::SLOW_ACCESS_CYCLES);
+
+	SECTION("FastROM speeds up the ROM area of banks $80-$FF") {
+		REQUIRE(bus.accessCycles(0x808000) == Bus::SLOW_ACCESS_CYCLES);
+		REQUIRE(bus.accessCycles(0xc00000) == Bus::SLOW_ACCESS_CYCLES);
+
+		// MEMSEL
+		bus.write(0x00420d, static_cast<Byte>(0x01));
+		REQUIRE(bus.fastROM());
+		REQUIRE(bus.accessCycles(0x808000) == Bus::FAST_ACCESS_CYCLES);
+		REQUIRE(bus.accessCycles(0xbfffff) == Bus::FAST_ACCESS_CYCLES);
+		REQUIRE(bus.accessCycles(0xc00000) == Bus::FAST_ACCESS_CYCLES);
+		REQUIRE(bus.accessCycles(0xffffff) == Bus::FAST_ACCESS_CYCLES);
+
+		// (but not the mirrors of the system area, or banks $00-$7F)
+		REQUIRE(bus.accessCycles(0x800000) == Bus::SLOW_ACCESS_CYCLES);
+		REQUIRE(bus.accessCycles(0x806000) == Bus::SLOW_ACCESS_CYCLES);
+		REQUIRE(bus.accessCycles(0x008000) == Bus::SLOW_ACCESS_CYCLES);
+		REQUIRE(bus.accessCycles(0x400000) == Bus::SLOW_ACCESS_CYCLES);
+
+		bus.write(0x80420d, static_cast<Byte>(0x00));
+		REQUIRE_FALSE(bus.fastROM());
+		REQUIRE(bus.accessCycles(0x808000) == Bus::SLOW_ACCESS_CYCLES);
+
+		bus.write(0x00420d, static_cast<Byte>(0x01));
+		bus.reset();
+		REQUIRE_FALSE(bus.fastROM());
+		REQUIRE(bus.accessCycles(0xc00000) == Bus::SLOW_ACCESS_CYCLES);
+	}
+}
+
+TEST_CASE("Running the bus", "[bus]") {
+	auto bus = std::make_unique<Bus>();
+
+	// an endless loop in RAM (`jmp` uses the DBR, so both banks point at RAM)
+	const Byte program[] = {
+		0xea,             // loop: nop
+		0xe8,             // inx
+		0x42, 0x80,       // wdm #$80 (print a character)
+		0x4c, 0x00, 0x00, // jmp loop
+	};
+	for (Address i = 0; i < sizeof(program); ++i) {
+		bus->write(0x7e0000 + i, program[i]);
+	}
+	bus->cpu.PBR = 0x7e;
+	bus->cpu.DBR = 0x7e;
+	bus->cpu.PC = 0;
+
+	// the longest instruction in the loop (`jmp`) takes 3 CPU cycles
+	constexpr MasterCycles LONGEST_INSTRUCTION = 3 * Bus::SLOW_ACCESS_CYCLES;
+
+	SECTION("Runs for the requested time") {
+		REQUIRE(bus->runFor(10000) == Bus::RunResult::Finished);
+		REQUIRE(bus->scheduler.now() >= 10000);
+		REQUIRE(bus->scheduler.now() < 10000 + LONGEST_INSTRUCTION);
+		REQUIRE(bus->instructionsExecuted > 0);
+	}
+
+	SECTION("Stops at frame boundaries") {
+		REQUIRE(bus->runFrame() == Bus::RunResult::Finished);
+		REQUIRE(bus->scheduler.now() >= MASTER_CYCLES_PER_FRAME);
+		REQUIRE(bus->scheduler.now() < MASTER_CYCLES_PER_FRAME + LONGEST_INSTRUCTION);
+
+		bus->runFrame();
+		REQUIRE(bus->scheduler.now() >= 2 * MASTER_CYCLES_PER_FRAME);
+		REQUIRE(bus->scheduler.now() < 2 * MASTER_CYCLES_PER_FRAME + LONGEST_INSTRUCTION);
+	}
+
+	SECTION("Batches end at events") {
+		std::vector<uint64_t> executedAtEvent;
+		auto event = bus->scheduler.registerEvent([&](MasterCycles) {
+			executedAtEvent.push_back(bus->instructionsExecuted);
+		});
+		bus->scheduler.schedule(event, 1000);
+		bus->scheduler.schedule(event, 5000);
+
+		bus->runFor(10000);
+		REQUIRE(executedAtEvent.size() == 2);
+
+		// every instruction takes at least 2 CPU cycles, so the CPU can't have run more instructions than this before each event
+		constexpr MasterCycles SHORTEST_INSTRUCTION = 2 * Bus::SLOW_ACCESS_CYCLES;
+		REQUIRE(executedAtEvent[0] <= 1000 / SHORTEST_INSTRUCTION + 1);
+		REQUIRE(executedAtEvent[1] <= 5000 / SHORTEST_INSTRUCTION + 1);
+		REQUIRE(executedAtEvent[1] > executedAtEvent[0]);
+	}
+
+	SECTION("Events scheduled while the CPU is running cut the batch short") {
+		MasterCycles firedAt = 0;
+		auto event = bus->scheduler.registerEvent([&](MasterCycles) {
+			firedAt = bus->scheduler.now();
+		});
+
+		// `wdm #$80` schedules an event right after itself, in the middle of the batch
+		bool scheduled = false;
+		bus->cpu.putCharacterHook = [&](char) {
+			if (!scheduled) {
+				bus->scheduler.scheduleIn(event, 0);
+				scheduled = true;
+			}
+		};
+
+		bus->runFor(100000);
+		REQUIRE(scheduled);
+
+		// the batch started at 0, so without cutting it short, the event would have run at the end of it (at 100000)
+		REQUIRE(firedAt < 10 * LONGEST_INSTRUCTION);
+	}
+
+	SECTION("Stops at breakpoints") {
+		bus->breakpoints.push_back(0x7e0002);
+
+		REQUIRE(bus->runFor(100000) == Bus::RunResult::Breakpoint);
+		REQUIRE(bus->cpu.PC == 0x0002);
+		uint64_t executed = bus->instructionsExecuted;
+		REQUIRE(executed == 2);
+
+		// continuing runs the instruction at the breakpoint, and then goes around the loop once
+		REQUIRE(bus->runFor(100000) == Bus::RunResult::Breakpoint);
+		REQUIRE(bus->cpu.PC == 0x0002);
+		REQUIRE(bus->instructionsExecuted == executed + 4);
+	}
+
+	SECTION("Stops when the CPU stops") {
+		bus->write(0x7e0000, Byte(0xdb)); // stp
+		REQUIRE(bus->runFor(100000) == Bus::RunResult::Stopped);
+		REQUIRE(bus->cpu.stopped);
+		REQUIRE(bus->instructionsExecuted == 1);
+	}
+}
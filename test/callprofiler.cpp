@@ -0,0 +1,206 @@
+#include <blaze/Bus.hpp>
+#include <blaze/CallProfiler.hpp>
+#include <blaze/Symbols.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace Blaze;
+
+static void loadProgram(Bus& bus) {
+	const std::map<Word, std::vector<Byte>> program = {
+		{ 0x0000, {
+			0x18,                   // clc
+			0xfb,                   // xce (switch to native mode)
+			0x20, 0x10, 0x00,       // jsr outer
+			0x22, 0x20, 0x00, 0x7e, // jsl far
+			0xdb,                   // stp
+		} },
+		{ 0x0010, {                 // outer:
+			0x20, 0x18, 0x00,       // jsr inner
+			0x60,                   // rts
+		} },
+		{ 0x0018, {                 // inner:
+			0xea,                   // nop
+			0x60,                   // rts
+		} },
+		{ 0x0020, {                 // far:
+			0x6b,                   // rtl
+		} },
+		{ 0x0030, {                 // handler:
+			0x40,                   // rti
+		} },
+	};
+
+	for (const auto& [start, bytes] : program) {
+		Address address = 0x7e0000 | start;
+		for (auto byte : bytes) {
+			bus.write(address++, byte);
+		}
+	}
+	bus.cpu.PBR = 0x7e;
+	bus.cpu.PC = 0;
+}
+
+// the folded output as stack -> cycles
+static std::map<std::string, uint64_t> readFolded(const CallProfiler& profiler, const SymbolTable* symbols = nullptr) {
+	std::ostringstream stream;
+	profiler.writeFolded(stream, symbols);
+
+	std::map<std::string, uint64_t> stacks;
+	std::istringstream lines(stream.str());
+	std::string line;
+	while (std::getline(lines, line)) {
+		auto space = line.rfind(' ');
+		stacks[line.substr(0, space)] = std::stoull(line.substr(space + 1));
+	}
+	return stacks;
+}
+
+TEST_CASE("Call profiling", "[callprofiler]") {
+	auto bus = std::make_unique<Bus>();
+	loadProgram(*bus);
+
+	CallProfiler profiler;
+	bus->cpu.callProfiler = &profiler;
+
+	SECTION("Cycles are charged to the stack they ran in") {
+		// clc, xce, jsr outer
+		for (int i = 0; i < 3; ++i) {
+			bus->cpu.clock();
+		}
+		REQUIRE(profiler.depth() == 1);
+
+		// jsr inner, nop
+		bus->cpu.clock();
+		bus->cpu.clock();
+		REQUIRE(profiler.depth() == 2);
+
+		// rts, rts, jsl far, rtl, stp
+		for (int i = 0; i < 5; ++i) {
+			bus->cpu.clock();
+		}
+		REQUIRE(bus->cpu.stopped);
+		REQUIRE(profiler.depth() == 0);
+		REQUIRE(profiler.mismatches() == 0);
+		REQUIRE(profiler.totalCycles() == bus->scheduler.now());
+
+		auto stacks = readFolded(profiler);
+		REQUIRE(stacks.size() == 4);
+
+		// calls count towards the caller, and returns towards the callee
+		REQUIRE(stacks["(root)"] > 0);
+		REQUIRE(stacks["(root);7e:0010"] > 0);
+		REQUIRE(stacks["(root);7e:0010;7e:0018"] > 0);
+		REQUIRE(stacks["(root);7e:0020"] > 0);
+		REQUIRE(stacks["(root);7e:0010;7e:0018"] > stacks["(root);7e:0020"]);
+
+		SymbolTable symbols;
+		symbols.add(0x7e0010, "outer");
+		symbols.add(0x7e0018, "inner");
+		auto named = readFolded(profiler, &symbols);
+		REQUIRE(named.count("(root);outer;inner") == 1);
+		REQUIRE(named.count("(root);inner+$8") == 1);
+	}
+
+	SECTION("Interrupts get their own frames") {
+		// clc, xce, jsr outer
+		for (int i = 0; i < 3; ++i) {
+			bus->cpu.clock();
+		}
+		Word sp = bus->cpu.SP;
+
+		bus->cpu.nmi();
+		REQUIRE(profiler.depth() == 2);
+
+		// (there's no ROM, so point the handler at something)
+		bus->cpu.PBR = 0x7e;
+		bus->cpu.PC = 0x0030;
+		bus->cpu.clock();
+
+		REQUIRE(profiler.depth() == 1);
+		REQUIRE(bus->cpu.SP == sp);
+		REQUIRE(bus->cpu.PBR == 0x7e);
+		REQUIRE(bus->cpu.PC == 0x0010);
+
+		auto stacks = readFolded(profiler);
+		bool foundHandler = false;
+		for (const auto& [stack, cycles] : stacks) {
+			foundHandler = foundHandler || stack.rfind("(root);7e:0010;[nmi] ", 0) == 0;
+		}
+		REQUIRE(foundHandler);
+	}
+
+	SECTION("Returns are matched by the stack pointer") {
+		CallProfiler shadow;
+
+		shadow.call(0x008000, 0x1ff);
+		shadow.charge(1);
+		shadow.call(0x008100, 0x1fd);
+		shadow.charge(1);
+		REQUIRE(shadow.depth() == 2);
+
+		// returning to somewhere that was never called (like a jump through `RTS`) doesn't pop anything
+		shadow.returned(0x1fb);
+		shadow.charge(1);
+		REQUIRE(shadow.depth() == 2);
+
+		// an interrupt that returns to where it came from only pops its own frame
+		shadow.interrupt(CallProfiler::FrameKind::IRQ, 0x008200, 0x1fb);
+		shadow.returned(0x1fb);
+		shadow.charge(1);
+		REQUIRE(shadow.depth() == 2);
+
+		// a return past both frames pops both of them (and one of them was never returned from)
+		shadow.returned(0x1ff);
+		shadow.charge(1);
+		REQUIRE(shadow.depth() == 0);
+		REQUIRE(shadow.mismatches() == 1);
+
+		// so does resetting the stack pointer, as soon as anything is called
+		shadow.call(0x008000, 0x1e0);
+		shadow.charge(1);
+		shadow.call(0x008300, 0x1ff);
+		shadow.charge(1);
+		REQUIRE(shadow.depth() == 1);
+		REQUIRE(shadow.mismatches() == 2);
+		REQUIRE(shadow.totalCycles() == 7);
+	}
+}
+
+TEST_CASE("Symbol files", "[callprofiler]") {
+	SymbolTable symbols;
+
+	std::istringstream wla(
+		"; wla symbolic information file\n"
+		"; generated by asar\n"
+		"\n"
+		"[labels]\n"
+		"00:8000 main\n"
+		"00:8020 print_string\n"
+		"00:8024 :pos_1 ; (anonymous labels are left out)\n"
+		"7e:0100 buffer\n"
+		"\n"
+		"[source files]\n"
+		"0000 0123abcd hello-world.asm\n"
+		"\n"
+		"[addr-to-line mapping]\n"
+		"00:8000 0000:00000009\n"
+	);
+	symbols.load(wla);
+
+	REQUIRE(symbols.size() == 3);
+	REQUIRE(symbols.name(0x008000) == "main");
+	REQUIRE(symbols.name(0x008024) == "print_string+$4");
+	REQUIRE(symbols.name(0x7e0100) == "buffer");
+	REQUIRE(symbols.name(0x7f0100) == "7f:0100");
+	REQUIRE(symbols.name(0x007fff) == "00:7fff");
+
+	std::istringstream nocash("00008000 reset\n0000ffea nmi_vector\n");
+	symbols.load(nocash);
+	REQUIRE(symbols.name(0x008000) == "reset");
+	REQUIRE(symbols.name(0x00ffeb) == "nmi_vector+$1");
+}
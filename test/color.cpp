@@ -4,6 +4,8 @@
 #include <catch2/generators/catch_generators_adapters.hpp>
 #include <catch2/generators/catch_generators_random.hpp>
 
+#include <vector>
+
 TEST_CASE("Color", "[color]") {
 	auto gen = GENERATE(take(10, chunk(4, random(0, 255))));
 
@@ -22,3 +24,39 @@ TEST_CASE("Color", "[color]") {
 		REQUIRE(color.a == gen[3]);
 	}
 }
+
+TEST_CASE("BGR555 conversion", "[color]") {
+	SECTION("Single colors") {
+		auto color = Blaze::Color::fromBGR555(0x7fff);
+		REQUIRE(color.r == 255);
+		REQUIRE(color.g == 255);
+		REQUIRE(color.b == 255);
+		REQUIRE(color.a == 255);
+
+		// 5 bits of blue, green, and red, from the top
+		color = Blaze::Color::fromBGR555((0x01 << 10) | (0x10 << 5) | 0x1e);
+		REQUIRE(color.r == 0xf7);
+		REQUIRE(color.g == 0x84);
+		REQUIRE(color.b == 0x08);
+	}
+
+	SECTION("Whole buffers match single colors") {
+		// every color, starting at an odd offset and with an odd length, so the vectorized part doesn't line up
+		std::vector<std::uint16_t> source(0x8000 + 3);
+		for (size_t i = 0; i < source.size(); ++i) {
+			source[i] = static_cast<std::uint16_t>((i - 1) & 0x7fff);
+		}
+		std::vector<Blaze::Color> destination(source.size() + 1, Blaze::Color(1, 2, 3, 4));
+		Blaze::convertBGR555(source.data() + 1, destination.data(), source.size() - 1);
+
+		for (size_t i = 0; i + 1 < source.size(); ++i) {
+			auto expected = Blaze::Color::fromBGR555(source[i + 1]);
+			REQUIRE(destination[i].r == expected.r);
+			REQUIRE(destination[i].g == expected.g);
+			REQUIRE(destination[i].b == expected.b);
+			REQUIRE(destination[i].a == expected.a);
+		}
+		// (nothing past the end was touched)
+		REQUIRE(destination.back().a == 4);
+	}
+}
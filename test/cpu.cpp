@@ -301,3 +301,625 @@ TEST_CASE("Instruction decoding", "[cpu]") {
 		REQUIRE(decodedInfo.passConditionIfBitSet == expectedInfo.passConditionIfBitSet);
 	}
 }
+
+// the size of an instruction with the given flags, going by `OPCODE_INFO` (which has every immediate as 8-bit)
+static Byte expectedInstructionSize(Byte opcodeByte, bool memoryIs8Bit, bool indexIs8Bit) {
+	const auto& info = OPCODE_INFO[opcodeByte];
+	if (info.addressingMode != AddressingMode::Immediate) {
+		return info.size;
+	}
+
+	switch (opcodeByte) {
+		// REP and SEP always take a single byte
+		case 0xc2:
+		case 0xe2:
+			return info.size;
+
+		// LDY, LDX, CPY and CPX take as many as the index registers have
+		case 0xa0:
+		case 0xa2:
+		case 0xc0:
+		case 0xe0:
+			return indexIs8Bit ? 2 : 3;
+
+		// and everything else (including BIT) as many as the accumulator has
+		default:
+			return memoryIs8Bit ? 2 : 3;
+	}
+}
+
+TEST_CASE("Instruction decoding follows the register widths", "[cpu]") {
+	Bus bus;
+
+	auto memoryAndAccumulatorAre8Bit = GENERATE(true, false);
+	auto indexRegistersAre8Bit = GENERATE(true, false);
+	bus.cpu.setFlag(CPU::flags::m, memoryAndAccumulatorAre8Bit);
+	bus.cpu.setFlag(CPU::flags::x, indexRegistersAre8Bit);
+
+	for (size_t index = 0; index < 256; ++index) {
+		auto opcodeByte = static_cast<Byte>(index);
+		const auto& expectedInfo = OPCODE_INFO[index];
+		auto expectedSize = expectedInstructionSize(opcodeByte, memoryAndAccumulatorAre8Bit, indexRegistersAre8Bit);
+
+		// both the opcode table and the pattern decoding it's built from have to get it right
+		auto fromTable = bus.cpu.decodeInstruction(opcodeByte);
+		auto fromPattern = CPU::decodeInstructionByPattern(opcodeByte, memoryAndAccumulatorAre8Bit, indexRegistersAre8Bit);
+
+		INFO("opcode 0x" << std::hex << index << ", m = " << memoryAndAccumulatorAre8Bit << ", x = " << indexRegistersAre8Bit);
+
+		for (const auto& decodedInfo : { fromTable, fromPattern }) {
+			REQUIRE(static_cast<uint32_t>(decodedInfo.opcode) == static_cast<uint32_t>(expectedInfo.opcode));
+			REQUIRE(static_cast<uint32_t>(decodedInfo.size) == static_cast<uint32_t>(expectedSize));
+
+			if (expectedInfo.addressingMode == AddressingMode::Implied || expectedInfo.addressingMode == AddressingMode::Stack) {
+				REQUIRE(static_cast<uint32_t>(decodedInfo.addressingMode) == static_cast<uint32_t>(AddressingMode::INVALID));
+			} else {
+				REQUIRE(static_cast<uint32_t>(decodedInfo.addressingMode) == static_cast<uint32_t>(expectedInfo.addressingMode));
+			}
+
+			REQUIRE(static_cast<uint32_t>(decodedInfo.condition) == static_cast<uint32_t>(expectedInfo.condition));
+			REQUIRE(decodedInfo.passConditionIfBitSet == expectedInfo.passConditionIfBitSet);
+		}
+	}
+}
+
+// writes the given program into RAM (at $7E0000) and points the CPU at it
+static void loadProgramIntoRAM(Bus& bus, std::initializer_list<Byte> program) {
+	Address address = 0x7e0000;
+	for (auto byte: program) {
+		bus.write(address++, byte);
+	}
+	bus.cpu.PBR = 0x7e;
+	bus.cpu.PC = 0;
+}
+
+TEST_CASE("Width-specialized execution", "[cpu]") {
+	Bus bus;
+
+	loadProgramIntoRAM(bus, {
+		0x18,             // clc
+		0xfb,             // xce (switch to native mode)
+		0xc2, 0x30,       // rep #$30 (16-bit accumulator and index registers)
+		0xa9, 0x34, 0x12, // lda #$1234
+		0x18,             // clc
+		0x69, 0x00, 0x0f, // adc #$0f00
+		0xe2, 0x20,       // sep #$20 (8-bit accumulator)
+		0xa9, 0xff,       // lda #$ff
+		0x18,             // clc
+		0x69, 0x01,       // adc #$01
+		0x38,             // sec
+		0xe9, 0x01,       // sbc #$01
+	});
+
+	// clc, xce, rep
+	for (int i = 0; i < 3; ++i) {
+		bus.cpu.execute();
+	}
+	REQUIRE_FALSE(bus.cpu.usingEmulationMode());
+	REQUIRE_FALSE(bus.cpu.memoryAndAccumulatorAre8Bit());
+	REQUIRE_FALSE(bus.cpu.indexRegistersAre8Bit());
+
+	// lda, clc, adc (16-bit)
+	for (int i = 0; i < 3; ++i) {
+		bus.cpu.execute();
+	}
+	REQUIRE(bus.cpu.A.forceLoadFull() == 0x2134);
+	REQUIRE_FALSE(bus.cpu.getFlag(CPU::flags::c));
+
+	// sep, lda, clc, adc (8-bit)
+	for (int i = 0; i < 4; ++i) {
+		bus.cpu.execute();
+	}
+	REQUIRE(bus.cpu.memoryAndAccumulatorAre8Bit());
+	// the high byte of the accumulator is preserved in 8-bit mode
+	REQUIRE(bus.cpu.A.forceLoadFull() == 0x2100);
+	REQUIRE(bus.cpu.getFlag(CPU::flags::c));
+	REQUIRE(bus.cpu.getFlag(CPU::flags::z));
+
+	// sec, sbc (8-bit, borrows)
+	for (int i = 0; i < 2; ++i) {
+		bus.cpu.execute();
+	}
+	REQUIRE(bus.cpu.A.forceLoadFull() == 0x21ff);
+	REQUIRE_FALSE(bus.cpu.getFlag(CPU::flags::c));
+	REQUIRE(bus.cpu.getFlag(CPU::flags::n));
+	REQUIRE(bus.cpu.PC == 21);
+}
+
+TEST_CASE("Immediate operands follow the width of their register", "[cpu]") {
+	const std::initializer_list<Byte> program = {
+		0x18,             // clc
+		0xfb,             // xce (switch to native mode)
+		0xc2, 0x10,       // rep #$10 (8-bit accumulator, 16-bit index registers)
+		0xa2, 0x34, 0x12, // ldx #$1234
+		0xa0, 0x78, 0x56, // ldy #$5678
+		0xe0, 0x34, 0x12, // cpx #$1234
+		0xc0, 0x79, 0x56, // cpy #$5679
+		0xa9, 0x80,       // lda #$80
+		0xc2, 0x20,       // rep #$20 (16-bit accumulator)
+		0xe2, 0x10,       // sep #$10 (8-bit index registers)
+		0x89, 0x00, 0x80, // bit #$8000
+		0xa2, 0x42,       // ldx #$42
+		0xdb,             // stp
+	};
+
+	SECTION("One instruction at a time") {
+		Bus bus;
+		loadProgramIntoRAM(bus, program);
+
+		// clc, xce, rep
+		for (int i = 0; i < 3; ++i) {
+			bus.cpu.execute();
+		}
+		REQUIRE(bus.cpu.memoryAndAccumulatorAre8Bit());
+		REQUIRE_FALSE(bus.cpu.indexRegistersAre8Bit());
+
+		bus.cpu.execute(); // ldx
+		REQUIRE(bus.cpu.X.forceLoadFull() == 0x1234);
+		REQUIRE(bus.cpu.PC == 7);
+
+		bus.cpu.execute(); // ldy
+		REQUIRE(bus.cpu.Y.forceLoadFull() == 0x5678);
+		REQUIRE(bus.cpu.PC == 10);
+
+		bus.cpu.execute(); // cpx (equal)
+		REQUIRE(bus.cpu.getFlag(CPU::flags::z));
+		REQUIRE(bus.cpu.getFlag(CPU::flags::c));
+		REQUIRE(bus.cpu.PC == 13);
+
+		bus.cpu.execute(); // cpy (less)
+		REQUIRE_FALSE(bus.cpu.getFlag(CPU::flags::z));
+		REQUIRE_FALSE(bus.cpu.getFlag(CPU::flags::c));
+		REQUIRE(bus.cpu.PC == 16);
+
+		// lda, rep, sep
+		for (int i = 0; i < 3; ++i) {
+			bus.cpu.execute();
+		}
+		REQUIRE_FALSE(bus.cpu.memoryAndAccumulatorAre8Bit());
+		REQUIRE(bus.cpu.indexRegistersAre8Bit());
+		REQUIRE(bus.cpu.PC == 22);
+
+		bus.cpu.execute(); // bit (A & $8000 == 0)
+		REQUIRE(bus.cpu.getFlag(CPU::flags::z));
+		REQUIRE(bus.cpu.PC == 25);
+
+		bus.cpu.execute(); // ldx (8-bit again)
+		REQUIRE(bus.cpu.X.forceLoadFull() == 0x0042);
+		REQUIRE(bus.cpu.PC == 27);
+
+		bus.cpu.execute(); // stp
+		REQUIRE(bus.cpu.stopped);
+	}
+
+	SECTION("In batches (from the decode cache)") {
+		Bus bus;
+		loadProgramIntoRAM(bus, program);
+
+		Cycles cycles = 0;
+		bus.cpu.run(1'000'000, cycles);
+		REQUIRE(bus.cpu.stopped);
+		REQUIRE(bus.cpu.X.forceLoadFull() == 0x0042);
+		REQUIRE(bus.cpu.Y.forceLoadFull() == 0x5678);
+		REQUIRE(bus.cpu.A.forceLoadFull() == 0x0080);
+		REQUIRE(bus.cpu.PC == 28);
+	}
+}
+
+TEST_CASE("Instruction timing", "[cpu]") {
+	Bus bus;
+
+	loadProgramIntoRAM(bus, {
+		0x18,             // clc
+		0xfb,             // xce (switch to native mode)
+		0xc2, 0x30,       // rep #$30 (16-bit accumulator and index registers)
+		0xa9, 0x34, 0x12, // lda #$1234
+		0xa5, 0x10,       // lda $10
+		0xa5, 0x10,       // lda $10 (with a direct page that isn't page-aligned)
+		0xe2, 0x30,       // sep #$30 (8-bit accumulator and index registers)
+		0xa2, 0xff,       // ldx #$ff
+		0xbd, 0x01, 0x00, // lda $0001,x (crosses a page)
+		0xbd, 0x00, 0x00, // lda $0000,x (doesn't cross a page)
+		0xa0, 0x10,       // ldy #$10
+		0xb1, 0x40,       // lda ($40),y (crosses a page)
+		0xb1, 0x42,       // lda ($42),y (doesn't cross a page)
+		0x80, 0x00,       // bra
+	});
+	bus.write(0x7e0040, static_cast<Word>(0x00f8));
+	bus.write(0x7e0042, static_cast<Word>(0x0100));
+
+	// the program runs from WRAM, so every CPU cycle takes 8 master cycles
+	REQUIRE(bus.accessCycles(0x7e0000) == Bus::SLOW_ACCESS_CYCLES);
+
+	auto cpuCyclesOfNextInstruction = [&]() {
+		return bus.cpu.execute() / Bus::SLOW_ACCESS_CYCLES;
+	};
+
+	REQUIRE(cpuCyclesOfNextInstruction() == 2); // clc
+	REQUIRE(cpuCyclesOfNextInstruction() == 2); // xce
+	REQUIRE(cpuCyclesOfNextInstruction() == 3); // rep
+	REQUIRE(cpuCyclesOfNextInstruction() == 3); // lda #imm (16-bit)
+	REQUIRE(cpuCyclesOfNextInstruction() == 4); // lda d (16-bit)
+
+	bus.cpu.DR = 0x0001;
+	REQUIRE(cpuCyclesOfNextInstruction() == 5); // lda d (16-bit, unaligned direct page)
+
+	REQUIRE(cpuCyclesOfNextInstruction() == 3); // sep
+	REQUIRE(cpuCyclesOfNextInstruction() == 2); // ldx #imm (8-bit)
+	REQUIRE(cpuCyclesOfNextInstruction() == 5); // lda a,x (page crossed)
+	REQUIRE(cpuCyclesOfNextInstruction() == 4); // lda a,x (same page)
+
+	// (the pointers are at $40 and $42)
+	bus.cpu.DR = 0x0000;
+	REQUIRE(cpuCyclesOfNextInstruction() == 2); // ldy #imm (8-bit)
+	REQUIRE(cpuCyclesOfNextInstruction() == 6); // lda (d),y (page crossed)
+	REQUIRE(cpuCyclesOfNextInstruction() == 5); // lda (d),y (same page)
+
+	REQUIRE(cpuCyclesOfNextInstruction() == 3); // bra (always taken)
+}
+
+TEST_CASE("Branches are relative to the next instruction", "[cpu]") {
+	Bus bus;
+
+	loadProgramIntoRAM(bus, {
+		0x80, 0x01,       // bra +1 (skips the nop)
+		0xea,             // nop
+		0x82, 0x01, 0x00, // brl +1 (skips the nop)
+		0xea,             // nop
+		0x80, 0xfe,       // bra -2 (itself)
+	});
+
+	bus.cpu.execute();
+	REQUIRE(bus.cpu.PC == 3);
+	bus.cpu.execute();
+	REQUIRE(bus.cpu.PC == 7);
+	bus.cpu.execute();
+	REQUIRE(bus.cpu.PC == 7);
+}
+
+TEST_CASE("Clocking the CPU advances the scheduler", "[cpu]") {
+	Bus bus;
+
+	loadProgramIntoRAM(bus, {
+		0xea, // nop
+		0xcb, // wai
+		0xea, // nop
+	});
+
+	bool fired = false;
+	auto event = bus.scheduler.registerEvent([&](MasterCycles) {
+		fired = true;
+		bus.cpu.irq();
+	});
+	bus.scheduler.schedule(event, 1000);
+
+	bus.cpu.clock();
+	REQUIRE(bus.scheduler.now() == 2 * Bus::SLOW_ACCESS_CYCLES);
+
+	bus.cpu.clock();
+	REQUIRE(bus.cpu.waitingForInterrupt);
+	REQUIRE_FALSE(fired);
+
+	// while waiting, the CPU skips straight to the next event (whose IRQ wakes it up; interrupts are masked, so it just continues)
+	bus.cpu.clock();
+	REQUIRE(fired);
+	REQUIRE(bus.scheduler.now() == 1000);
+	REQUIRE_FALSE(bus.cpu.waitingForInterrupt);
+
+	bus.cpu.clock();
+	REQUIRE(bus.cpu.PC == 3);
+}
+
+TEST_CASE("Interrupts return to where they came from", "[cpu]") {
+	const bool native = GENERATE(true, false);
+	INFO((native ? "native mode" : "emulation mode"));
+
+	Bus bus;
+	if (native) {
+		loadProgramIntoRAM(bus, {
+			0x18,       // clc
+			0xfb,       // xce (switch to native mode)
+			0xc2, 0x24, // rep #$24 (16-bit accumulator, IRQs enabled; the index registers stay 8-bit)
+			0xf8,       // sed
+		});
+	} else {
+		loadProgramIntoRAM(bus, {
+			0x58,       // cli
+			0xf8,       // sed
+		});
+	}
+	// the handler (there's no ROM, so the vector doesn't point anywhere useful)
+	bus.write(0x7e0030, Byte(0x40)); // rti
+
+	while (bus.cpu.PC < (native ? 5 : 2)) {
+		bus.cpu.clock();
+	}
+	Byte p = bus.cpu.P;
+	Word sp = bus.cpu.SP;
+	REQUIRE((p & CPU::flags::i) == 0);
+	REQUIRE((p & CPU::flags::x) != 0);
+
+	bus.cpu.irq();
+
+	// the handler runs with IRQs masked and in binary mode, but the status register is pushed the way it was
+	// (except for the B flag in emulation mode, which is clear for anything but `BRK`)
+	REQUIRE(bus.cpu.getFlag(CPU::flags::i));
+	REQUIRE_FALSE(bus.cpu.getFlag(CPU::flags::d));
+	REQUIRE(bus.cpu.getFlag(CPU::flags::x));
+	REQUIRE(bus.read8(static_cast<Word>(bus.cpu.SP + 1)) == (native ? p : (p & ~CPU::flags::b)));
+
+	bus.cpu.PBR = 0x7e;
+	bus.cpu.PC = 0x0030;
+	bus.cpu.clock();
+
+	REQUIRE(bus.cpu.P == p);
+	REQUIRE(bus.cpu.SP == sp);
+	REQUIRE(bus.cpu.PBR == 0x7e);
+	REQUIRE(bus.cpu.PC == (native ? 5 : 2));
+}
+
+TEST_CASE("BRK and COP jump through their vectors and return past their signature byte", "[cpu]") {
+	const bool native = GENERATE(true, false);
+	const Byte opcode = GENERATE(Byte(0x00), Byte(0x02));
+	INFO((native ? "native mode" : "emulation mode"));
+	INFO((opcode == 0x00 ? "BRK" : "COP"));
+
+	Bus bus;
+	if (native) {
+		loadProgramIntoRAM(bus, {
+			0x18,         // clc
+			0xfb,         // xce (switch to native mode)
+			0xc2, 0x24,   // rep #$24 (16-bit accumulator, IRQs enabled)
+			0xf8,         // sed
+			opcode, 0x42, // brk/cop #$42
+		});
+	} else {
+		loadProgramIntoRAM(bus, {
+			0x58,         // cli
+			0xf8,         // sed
+			opcode, 0x42, // brk/cop #$42
+		});
+	}
+	// the handler (there's no ROM, so the vector doesn't point anywhere useful)
+	bus.write(0x7e0030, Byte(0x40)); // rti
+
+	const Word start = native ? 5 : 2;
+	while (bus.cpu.PC < start) {
+		bus.cpu.clock();
+	}
+	Byte p = bus.cpu.P;
+	Word sp = bus.cpu.SP;
+
+	bus.cpu.execute();
+
+	Address vector = native
+		? ((opcode == 0x00) ? CPU::ExceptionVectorAddress::NativeBRK : CPU::ExceptionVectorAddress::NativeCOP)
+		: ((opcode == 0x00) ? CPU::ExceptionVectorAddress::EmulatedBRK : CPU::ExceptionVectorAddress::EmulatedCOP);
+	REQUIRE(bus.cpu.PBR == 0);
+	REQUIRE(bus.cpu.PC == bus.read16(vector));
+	REQUIRE(bus.cpu.getFlag(CPU::flags::i));
+	REQUIRE_FALSE(bus.cpu.getFlag(CPU::flags::d));
+	REQUIRE(bus.cpu.SP == static_cast<Word>(sp - (native ? 4 : 3)));
+
+	// P goes on the stack as it was (in emulation mode, that includes the B flag), after the PC of the next instruction
+	REQUIRE(bus.read8(static_cast<Word>(bus.cpu.SP + 1)) == p);
+	REQUIRE(bus.read16(static_cast<Word>(bus.cpu.SP + 2)) == start + 2);
+	if (native) {
+		REQUIRE(bus.read8(static_cast<Word>(bus.cpu.SP + 4)) == 0x7e);
+	} else {
+		REQUIRE((p & CPU::flags::b) != 0);
+	}
+
+	bus.cpu.PBR = 0x7e;
+	bus.cpu.PC = 0x0030;
+	bus.cpu.clock();
+
+	REQUIRE(bus.cpu.P == p);
+	REQUIRE(bus.cpu.SP == sp);
+	REQUIRE(bus.cpu.PBR == 0x7e);
+	REQUIRE(bus.cpu.PC == start + 2);
+}
+
+TEST_CASE("Running the CPU in batches", "[cpu]") {
+	std::initializer_list<Byte> program = {
+		0x18,             // clc
+		0xfb,             // xce (switch to native mode)
+		0xc2, 0x30,       // rep #$30 (16-bit accumulator and index registers)
+		0xa9, 0x34, 0x12, // lda #$1234
+		0xa2, 0x10, 0x00, // ldx #$0010
+		0x69, 0x01, 0x00, // adc #$0001
+		0x8d, 0x00, 0x10, // sta $1000
+		0xca,             // dex
+		0xe2, 0x30,       // sep #$30 (8-bit accumulator and index registers)
+		0x69, 0x01,       // adc #$01
+		0xe8,             // inx
+		0xdb,             // stp
+	};
+
+	Bus stepped;
+	Bus batched;
+	loadProgramIntoRAM(stepped, program);
+	loadProgramIntoRAM(batched, program);
+
+	Cycles steppedCycles = 0;
+	uint32_t steppedInstructions = 0;
+	while (!stepped.cpu.stopped) {
+		steppedCycles += stepped.cpu.execute();
+		++steppedInstructions;
+	}
+
+	SECTION("A big enough budget runs until the processor stops") {
+		Cycles cycles = 0;
+		REQUIRE(batched.cpu.run(1'000'000, cycles) == steppedInstructions);
+		REQUIRE(cycles == steppedCycles);
+
+		REQUIRE(batched.cpu.stopped);
+		REQUIRE(batched.cpu.PC == stepped.cpu.PC);
+		REQUIRE(batched.cpu.P == stepped.cpu.P);
+		REQUIRE(batched.cpu.A.forceLoadFull() == stepped.cpu.A.forceLoadFull());
+		REQUIRE(batched.cpu.X.forceLoadFull() == stepped.cpu.X.forceLoadFull());
+		REQUIRE(batched.read8(0x1000) == stepped.read8(0x1000));
+
+		// and it doesn't do anything once it's stopped
+		REQUIRE(batched.cpu.run(1'000'000, cycles) == 0);
+		REQUIRE(cycles == 0);
+	}
+
+	SECTION("The budget is only checked between instructions") {
+		Cycles cycles = 0;
+		REQUIRE(batched.cpu.run(1, cycles) == 1);
+		REQUIRE(cycles == 2 * Bus::SLOW_ACCESS_CYCLES);
+
+		// `xce` only takes 2 CPU cycles, so this needs `rep` (3 more), too
+		REQUIRE(batched.cpu.run(2 * Bus::SLOW_ACCESS_CYCLES + 1, cycles) == 2);
+		REQUIRE(cycles == 5 * Bus::SLOW_ACCESS_CYCLES);
+	}
+}
+
+TEST_CASE("Block moves", "[cpu]") {
+	// moves 16 bytes from $7E:1000 to $7E:2000 (or from $7E:100F down to $7E:200F, for `mvp`)
+	auto loadBlockMove = [](Bus& bus, Byte opcode, Word source, Word destination) {
+		loadProgramIntoRAM(bus, {
+			0x18,                                                   // clc
+			0xfb,                                                   // xce (switch to native mode)
+			0xc2, 0x30,                                             // rep #$30 (16-bit accumulator and index registers)
+			0xa9, 0x0f, 0x00,                                       // lda #$000f
+			0xa2, Byte(source & 0xff), Byte(source >> 8),           // ldx #source
+			0xa0, Byte(destination & 0xff), Byte(destination >> 8), // ldy #destination
+			opcode, 0x7e, 0x7e,                                     // mvn/mvp $7e, $7e
+			0xdb,                                                   // stp
+		});
+		for (Word i = 0; i < 0x20; ++i) {
+			bus.write(0x7e1000 + i, static_cast<Byte>(0x80 + i));
+		}
+	};
+
+	const Byte opcode = GENERATE(Byte(0x54), Byte(0x44));
+	const bool descending = opcode == 0x44;
+	const Word source = descending ? 0x100f : 0x1000;
+	const Word destination = descending ? 0x200f : 0x2000;
+
+	INFO((descending ? "mvp" : "mvn"));
+
+	Bus stepped;
+	Bus batched;
+	loadBlockMove(stepped, opcode, source, destination);
+	loadBlockMove(batched, opcode, source, destination);
+
+	// stepping moves one byte per instruction
+	Cycles steppedCycles = 0;
+	uint32_t steppedInstructions = 0;
+	while (!stepped.cpu.stopped) {
+		steppedCycles += stepped.cpu.execute();
+		++steppedInstructions;
+	}
+
+	SECTION("Moves one byte at a time when stepping") {
+		// clc, xce, rep, lda, ldx, ldy, 16 moves, stp
+		REQUIRE(steppedInstructions == 6 + 16 + 1);
+
+		for (Word i = 0; i < 0x10; ++i) {
+			REQUIRE(stepped.read8(0x7e2000 + i) == 0x80 + i);
+		}
+		REQUIRE(stepped.read8(0x7e2010) == 0x00);
+
+		REQUIRE(stepped.cpu.A.forceLoadFull() == 0xffff);
+		REQUIRE(stepped.cpu.X.forceLoadFull() == (descending ? 0x0fff : 0x1010));
+		REQUIRE(stepped.cpu.Y.forceLoadFull() == (descending ? 0x1fff : 0x2010));
+		REQUIRE(stepped.cpu.DBR == 0x7e);
+	}
+
+	SECTION("Running with enough time moves everything at once, and takes just as long") {
+		Cycles cycles = 0;
+		REQUIRE(batched.cpu.run(1'000'000, cycles) == 6 + 1 + 1);
+		REQUIRE(cycles == steppedCycles);
+
+		for (Word i = 0; i < 0x20; ++i) {
+			REQUIRE(batched.read8(0x7e2000 + i) == stepped.read8(0x7e2000 + i));
+		}
+		REQUIRE(batched.cpu.A.forceLoadFull() == stepped.cpu.A.forceLoadFull());
+		REQUIRE(batched.cpu.X.forceLoadFull() == stepped.cpu.X.forceLoadFull());
+		REQUIRE(batched.cpu.Y.forceLoadFull() == stepped.cpu.Y.forceLoadFull());
+		REQUIRE(batched.cpu.PC == stepped.cpu.PC);
+	}
+
+	SECTION("A short budget interrupts the move between bytes") {
+		Cycles cycles = 0;
+		batched.cpu.run(1, cycles); // clc
+		batched.cpu.run(1, cycles); // xce
+		batched.cpu.run(1, cycles); // rep
+		batched.cpu.run(1, cycles); // lda
+		batched.cpu.run(1, cycles); // ldx
+		batched.cpu.run(1, cycles); // ldy
+
+		// enough for 4 bytes
+		REQUIRE(batched.cpu.run(4 * 7 * Bus::SLOW_ACCESS_CYCLES, cycles) == 1);
+		REQUIRE(cycles == 4 * 7 * Bus::SLOW_ACCESS_CYCLES);
+		REQUIRE(batched.cpu.A.forceLoadFull() == 0x000b);
+		REQUIRE(batched.cpu.PC == 0x000d); // still at the move
+
+		Cycles rest = 0;
+		batched.cpu.run(1'000'000, rest);
+		REQUIRE(batched.cpu.stopped);
+		for (Word i = 0; i < 0x10; ++i) {
+			REQUIRE(batched.read8(0x7e2000 + i) == 0x80 + i);
+		}
+	}
+}
+
+TEST_CASE("Block moves drop the code they overwrite", "[cpu]") {
+	// the move covers $7E:0100 through $7E:03FF, and only the line in the middle of that has any code in it
+	Bus bus;
+	loadProgramIntoRAM(bus, {
+		0x18,             // clc
+		0xfb,             // xce (switch to native mode)
+		0xc2, 0x30,       // rep #$30 (16-bit accumulator and index registers)
+		0x20, 0x80, 0x02, // jsr $0280
+		0x8d, 0x00, 0x05, // sta $0500
+		0xa9, 0xff, 0x02, // lda #$02ff
+		0xa2, 0x00, 0x11, // ldx #$1100
+		0xa0, 0x00, 0x01, // ldy #$0100
+		0x54, 0x7e, 0x7e, // mvn $7e, $7e
+		0x20, 0x80, 0x02, // jsr $0280
+		0xdb,             // stp
+	});
+
+	const std::vector<Byte> oldRoutine = { 0xa9, 0x11, 0x00, 0x60 }; // lda #$0011, rts
+	const std::vector<Byte> newRoutine = { 0xa9, 0x22, 0x00, 0x60 }; // lda #$0022, rts
+	for (Word i = 0; i < 4; ++i) {
+		bus.write(0x7e0280 + i, oldRoutine[i]);
+		bus.write(0x7e1280 + i, newRoutine[i]);
+	}
+
+	Cycles cycles = 0;
+	bus.cpu.run(1'000'000, cycles);
+	REQUIRE(bus.cpu.stopped);
+	REQUIRE(bus.read8(0x7e0500) == 0x11);
+	REQUIRE(bus.read8(0x7e0281) == 0x22);
+	REQUIRE(bus.cpu.A.forceLoadFull() == 0x0022);
+}
+
+TEST_CASE("Overlapping block moves repeat the pattern", "[cpu]") {
+	// `mvn` with the destination one byte past the source copies the first byte over and over
+	Bus bus;
+	loadProgramIntoRAM(bus, {
+		0x18,             // clc
+		0xfb,             // xce (switch to native mode)
+		0xc2, 0x30,       // rep #$30 (16-bit accumulator and index registers)
+		0xa9, 0x0e, 0x00, // lda #$000e
+		0xa2, 0x00, 0x10, // ldx #$1000
+		0xa0, 0x01, 0x10, // ldy #$1001
+		0x54, 0x7e, 0x7e, // mvn $7e, $7e
+		0xdb,             // stp
+	});
+	for (Word i = 0; i < 0x10; ++i) {
+		bus.write(0x7e1000 + i, static_cast<Byte>(0x80 + i));
+	}
+
+	Cycles cycles = 0;
+	bus.cpu.run(1'000'000, cycles);
+	REQUIRE(bus.cpu.stopped);
+	for (Word i = 0; i < 0x10; ++i) {
+		REQUIRE(bus.read8(0x7e1000 + i) == 0x80);
+	}
+}
@@ -0,0 +1,80 @@
+#include <blaze/Bus.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "helpers.hpp"
+
+using namespace Blaze;
+using namespace Blaze::Test;
+
+static void loadProgram(Bus& bus, Address address, const std::vector<Byte>& program) {
+	for (auto byte: program) {
+		bus.write(address++, byte);
+	}
+}
+
+// a loop that switches between 8-bit and 16-bit immediates, so the same bytes decode differently depending on the flags
+static const std::vector<Byte> MIXED_WIDTH_PROGRAM = {
+	0x18,             // clc
+	0xfb,             // xce (switch to native mode)
+	0xc2, 0x20,       // loop: rep #$20 (16-bit accumulator)
+	0x69, 0x01, 0x00, // adc #$0001
+	0x8d, 0x00, 0x10, // sta $1000
+	0xe2, 0x20,       // sep #$20 (8-bit accumulator)
+	0x69, 0x01,       // adc #$01
+	0xe8,             // inx
+	0x80, 0xf1,       // bra loop
+};
+
+TEST_CASE("Decode cache", "[decodecache]") {
+	auto bus = std::make_unique<Bus>();
+	loadProgram(*bus, 0x7e0000, MIXED_WIDTH_PROGRAM);
+	bus->cpu.PBR = 0x7e;
+	bus->cpu.PC = 0;
+
+	SECTION("Cached execution matches uncached execution") {
+		auto uncached = std::make_unique<Bus>();
+		loadProgram(*uncached, 0x7e0000, MIXED_WIDTH_PROGRAM);
+		uncached->cpu.PBR = 0x7e;
+		uncached->cpu.PC = 0;
+		uncached->cpu.decodeCache.enabled = false;
+
+		for (int i = 0; i < 1000; ++i) {
+			bus->cpu.clock();
+			uncached->cpu.clock();
+		}
+
+		REQUIRE(bus->cpu.decodeCache.blockCount() > 0);
+		REQUIRE(uncached->cpu.decodeCache.blockCount() == 0);
+		REQUIRE(saveState(*bus) == saveState(*uncached));
+	}
+
+	SECTION("Writing to RAM drops the blocks decoded from it") {
+		// run up to and including the 8-bit `adc #$01`, so that it's cached
+		for (int i = 0; i < 7; ++i) {
+			bus->cpu.clock();
+		}
+		REQUIRE(bus->cpu.decodeCache.blockCount() > 0);
+
+		// replace `adc #$01` with `lda #$42` and run it (through the low RAM mirror, for good measure)
+		bus->write(0x00000c, Byte(0xa9));
+		bus->write(0x00000d, Byte(0x42));
+		bus->cpu.PC = 0x000c;
+		bus->cpu.clock();
+
+		REQUIRE(bus->cpu.A.load() == 0x42);
+	}
+
+	SECTION("Loading a save state drops everything") {
+		auto state = saveState(*bus);
+		for (int i = 0; i < 10; ++i) {
+			bus->cpu.clock();
+		}
+		REQUIRE(bus->cpu.decodeCache.blockCount() > 0);
+
+		bus->loadState(state.data(), state.size());
+		REQUIRE(bus->cpu.decodeCache.blockCount() == 0);
+	}
+}
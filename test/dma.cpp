@@ -0,0 +1,284 @@
+#include <blaze/Bus.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "helpers.hpp"
+
+using namespace Blaze;
+using namespace Blaze::Test;
+
+static void setUpChannel(Bus& bus, Byte channel, Byte control, Byte bAddress, Address aAddress, Word count) {
+	Address base = 0x4300 | (static_cast<Address>(channel) << 4);
+	bus.write(base + 0x0, control);
+	bus.write(base + 0x1, bAddress);
+	bus.write(base + 0x2, static_cast<Word>(aAddress & 0xffff));
+	bus.write(base + 0x4, static_cast<Byte>(aAddress >> 16));
+	bus.write(base + 0x5, count);
+}
+
+// sets WMADD, which is where WMDATA ($2180) reads and writes
+static void setWRAMAddress(Bus& bus, Address ramOffset) {
+	bus.write(0x2181, static_cast<Word>(ramOffset & 0xffff));
+	bus.write(0x2183, static_cast<Byte>(ramOffset >> 16));
+}
+
+static constexpr Cycles dmaCycles(Address bytes) {
+	return DMA::DMA_OVERHEAD + DMA::DMA_CHANNEL_OVERHEAD + bytes * DMA::CYCLES_PER_BYTE;
+}
+
+TEST_CASE("DMA transfers", "[dma]") {
+	auto bus = std::make_unique<Bus>();
+
+	// crosses a couple of pages, so it takes several block copies
+	constexpr Address SIZE = 0x1800;
+	for (Address i = 0; i < SIZE; ++i) {
+		bus->write(0x7e1000 + i, static_cast<Byte>(i * 7));
+	}
+	setWRAMAddress(*bus, 0x10000);
+
+	SECTION("Memory is copied into WRAM through WMDATA") {
+		setUpChannel(*bus, 2, 0x00, 0x80, 0x7e1000, SIZE);
+		bus->write(0x420b, Byte(0x04));
+
+		for (Address i = 0; i < SIZE; ++i) {
+			REQUIRE(bus->read8(0x7f0000 + i) == static_cast<Byte>(i * 7));
+		}
+		REQUIRE(bus->read8(0x7f0000 + SIZE) == 0x00);
+
+		const auto& channel = bus->dma.channels[2];
+		REQUIRE(channel.count == 0);
+		REQUIRE(channel.aAddress == 0x1000 + SIZE);
+		REQUIRE(bus->ram.portAddress == 0x10000 + SIZE);
+		REQUIRE(bus->cpu.stalledCycles == dmaCycles(SIZE));
+	}
+
+	SECTION("Code overwritten through WMDATA is decoded again") {
+		// a routine at $7F:0280, in the middle of the lines the transfer covers
+		const std::vector<Byte> oldRoutine = { 0xa9, 0x11, 0xdb }; // lda #$11, stp
+		const std::vector<Byte> newRoutine = { 0xa9, 0x22, 0xdb }; // lda #$22, stp
+		for (Address i = 0; i < oldRoutine.size(); ++i) {
+			bus->write(0x7f0280 + i, oldRoutine[i]);
+			bus->write(0x7e1180 + i, newRoutine[i]);
+		}
+
+		auto runRoutine = [&]() {
+			bus->cpu.stopped = false;
+			bus->cpu.PBR = 0x7f;
+			bus->cpu.PC = 0x0280;
+			while (!bus->cpu.stopped) {
+				bus->cpu.clock();
+			}
+			return bus->cpu.A.load();
+		};
+		REQUIRE(runRoutine() == 0x11);
+		REQUIRE(bus->cpu.decodeCache.blockCount() > 0);
+
+		setWRAMAddress(*bus, 0x10100);
+		setUpChannel(*bus, 2, 0x00, 0x80, 0x7e1000, 0x300);
+		bus->write(0x420b, Byte(0x04));
+		REQUIRE(bus->read8(0x7f0281) == 0x22);
+		REQUIRE(runRoutine() == 0x22);
+	}
+
+	SECTION("Decrementing transfers go one byte at a time") {
+		setUpChannel(*bus, 0, 0x10, 0x80, 0x7e1000 + SIZE - 1, SIZE);
+		bus->write(0x420b, Byte(0x01));
+
+		for (Address i = 0; i < SIZE; ++i) {
+			REQUIRE(bus->read8(0x7f0000 + i) == static_cast<Byte>((SIZE - 1 - i) * 7));
+		}
+		REQUIRE(bus->dma.channels[0].aAddress == 0x0fff);
+		REQUIRE(bus->cpu.stalledCycles == dmaCycles(SIZE));
+	}
+
+	SECTION("Fixed-address transfers fill") {
+		bus->write(0x7e0500, Byte(0x5a));
+		setUpChannel(*bus, 7, 0x08, 0x80, 0x7e0500, 300);
+		bus->write(0x420b, Byte(0x80));
+
+		for (Address i = 0; i < 300; ++i) {
+			REQUIRE(bus->read8(0x7f0000 + i) == 0x5a);
+		}
+		REQUIRE(bus->read8(0x7f0000 + 300) == 0x00);
+		REQUIRE(bus->dma.channels[7].aAddress == 0x0500);
+	}
+
+	SECTION("Transfers from the B-bus") {
+		for (Address i = 0; i < 16; ++i) {
+			bus->write(0x7f0000 + i, static_cast<Byte>(0xf0 | i));
+		}
+		setUpChannel(*bus, 1, 0x80, 0x80, 0x7e3000, 16);
+		bus->write(0x420b, Byte(0x02));
+
+		for (Address i = 0; i < 16; ++i) {
+			REQUIRE(bus->read8(0x7e3000 + i) == (0xf0 | i));
+		}
+	}
+
+	SECTION("Several channels run in order") {
+		setUpChannel(*bus, 0, 0x00, 0x80, 0x7e1000, 4);
+		setUpChannel(*bus, 3, 0x08, 0x80, 0x7e1001, 2);
+		bus->write(0x420b, Byte(0x09));
+
+		const std::vector<Byte> expected = { 0, 7, 14, 21, 7, 7 };
+		for (Address i = 0; i < expected.size(); ++i) {
+			REQUIRE(bus->read8(0x7f0000 + i) == expected[i]);
+		}
+		REQUIRE(bus->cpu.stalledCycles == dmaCycles(6) + DMA::DMA_CHANNEL_OVERHEAD);
+	}
+
+	SECTION("Registers") {
+		setUpChannel(*bus, 5, 0x43, 0x18, 0x123456, 0x789a);
+		REQUIRE(bus->read8(0x4350) == 0x43);
+		REQUIRE(bus->read8(0x4351) == 0x18);
+		REQUIRE(bus->read24(0x4352) == 0x123456);
+		REQUIRE(bus->read16(0x4355) == 0x789a);
+
+		// they're mirrored into banks $80 through $BF, too
+		bus->write(0x80435b, Byte(0x99));
+		REQUIRE(bus->read8(0x00435f) == 0x99);
+
+		// MDMAEN and HDMAEN are write-only
+		uint64_t unmappedBefore = bus->unmappedAccesses;
+		bus->read8(0x420b);
+		REQUIRE(bus->unmappedAccesses == unmappedBefore + 1);
+	}
+}
+
+TEST_CASE("DMA time is charged to the CPU", "[dma]") {
+	auto setUp = [](Bus& bus) {
+		const std::vector<Byte> program = {
+			0xa9, 0x01,       // lda #$01
+			0x8d, 0x0b, 0x42, // sta $420b
+			0xea,             // nop (DMA overwrites this with `stp`)
+			0xea,             // nop
+		};
+		Address address = 0x7e0000;
+		for (auto byte: program) {
+			bus.write(address++, byte);
+		}
+		bus.write(0x7e1000, Byte(0xdb));
+		bus.cpu.PBR = 0x7e;
+		bus.cpu.DBR = 0x00;
+		bus.cpu.PC = 0;
+
+		setWRAMAddress(bus, 0x00005);
+		setUpChannel(bus, 0, 0x00, 0x80, 0x7e1000, 1);
+	};
+
+	SECTION("One instruction at a time") {
+		auto bus = std::make_unique<Bus>();
+		setUp(*bus);
+
+		bus->cpu.execute();
+		REQUIRE(bus->cpu.execute() == 4 * Bus::SLOW_ACCESS_CYCLES + dmaCycles(1));
+		REQUIRE(bus->cpu.stalledCycles == 0);
+
+		// the `nop` was already decoded, but the DMA wrote over it
+		bus->cpu.execute();
+		REQUIRE(bus->cpu.stopped);
+	}
+
+	SECTION("In batches") {
+		auto bus = std::make_unique<Bus>();
+		setUp(*bus);
+
+		Cycles used = 0;
+		REQUIRE(bus->cpu.run(1000000, used) == 2);
+		REQUIRE(used == (2 + 4) * Bus::SLOW_ACCESS_CYCLES + dmaCycles(1));
+
+		// the DMA ended the batch, so the rest runs in the next one
+		REQUIRE(bus->cpu.run(1000000, used) == 1);
+		REQUIRE(bus->cpu.stopped);
+	}
+}
+
+TEST_CASE("HDMA", "[dma]") {
+	auto bus = std::make_unique<Bus>();
+	setWRAMAddress(*bus, 0x10000);
+
+	SECTION("Direct tables") {
+		const std::vector<Byte> table = {
+			0x83, 0x11, 0x22, 0x33, // 3 lines, transferring on every one of them
+			0x02, 0x44,             // 2 lines, only transferring on the first one
+			0x01, 0x55,             // 1 line
+			0x00,                   // the end
+		};
+		for (Address i = 0; i < table.size(); ++i) {
+			bus->write(0x7e2000 + i, table[i]);
+		}
+
+		setUpChannel(*bus, 4, 0x00, 0x80, 0x7e2000, 0);
+		bus->write(0x420c, Byte(0x10));
+
+		bus->scheduler.advance(MASTER_CYCLES_PER_FRAME);
+
+		const std::vector<Byte> expected = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x00 };
+		for (Address i = 0; i < expected.size(); ++i) {
+			REQUIRE(bus->read8(0x7f0000 + i) == expected[i]);
+		}
+		REQUIRE_FALSE(bus->dma.channels[4].hdmaActive);
+		REQUIRE(bus->dma.channels[4].tableAddress == 0x2000 + table.size());
+		REQUIRE(bus->cpu.stalledCycles > 0);
+
+		// the table starts over every frame
+		bus->scheduler.advance(MASTER_CYCLES_PER_FRAME);
+		REQUIRE(bus->read8(0x7f0005) == 0x11);
+		REQUIRE(bus->read8(0x7f0009) == 0x55);
+
+		// once HDMA is disabled, it doesn't schedule anything else (the only thing left is the PPU's next line)
+		bus->write(0x420c, Byte(0x00));
+		bus->scheduler.advance(MASTER_CYCLES_PER_FRAME);
+		REQUIRE(bus->scheduler.nextEventTime() % MASTER_CYCLES_PER_SCANLINE == PPU::RENDER_TIME);
+		REQUIRE(bus->ram.portAddress == 0x1000a);
+	}
+
+	SECTION("Indirect tables") {
+		const std::vector<Byte> table = {
+			0x02, 0x00, 0x21, // 2 lines from $2100
+			0x81, 0x00, 0x22, // 1 line from $2200
+			0x00,
+		};
+		for (Address i = 0; i < table.size(); ++i) {
+			bus->write(0x7e2000 + i, table[i]);
+		}
+		bus->write(0x7e2100, Word(0xbbaa));
+		bus->write(0x7e2200, Word(0xddcc));
+
+		// mode 1 writes 2 bytes per line, to WMDATA and WMADDL. WMADDL is written last, so every line's data ends up at
+		// the same place (where the second byte says).
+		setUpChannel(*bus, 0, 0x41, 0x80, 0x7e2000, 0);
+		bus->write(0x4307, Byte(0x7e));
+		bus->write(0x420c, Byte(0x01));
+
+		bus->scheduler.advance(MASTER_CYCLES_PER_FRAME);
+
+		REQUIRE(bus->read8(0x7f0000) == 0xaa);
+		REQUIRE(bus->read8(0x7f00bb) == 0xcc);
+		REQUIRE(bus->ram.portAddress == 0x100dd);
+		REQUIRE(bus->dma.channels[0].count == 0x2202);
+	}
+
+	SECTION("Save states") {
+		for (Address i = 0; i < 200; ++i) {
+			bus->write(0x7e2000 + 2 * i, Byte(0x01));
+			bus->write(0x7e2000 + 2 * i + 1, static_cast<Byte>(i));
+		}
+		bus->write(0x7e2000 + 400, Byte(0x00));
+		setUpChannel(*bus, 0, 0x00, 0x80, 0x7e2000, 0);
+		bus->write(0x420c, Byte(0x01));
+
+		bus->scheduler.advance(MASTER_CYCLES_PER_FRAME / 2);
+		auto state = saveState(*bus);
+
+		auto restored = std::make_unique<Bus>();
+		restored->loadState(state.data(), state.size());
+
+		bus->scheduler.advance(MASTER_CYCLES_PER_FRAME);
+		restored->scheduler.advance(MASTER_CYCLES_PER_FRAME);
+		REQUIRE(saveState(*restored) == saveState(*bus));
+		REQUIRE(bus->read8(0x7f00c7) == 199);
+	}
+}
@@ -0,0 +1,86 @@
+#include <blaze/Bus.hpp>
+#include <blaze/EmulationThread.hpp>
+#include <blaze/TripleBuffer.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace Blaze;
+
+TEST_CASE("Triple buffer handoff", "[emulation]") {
+	TripleBuffer<int> buffer;
+
+	REQUIRE_FALSE(buffer.acquire());
+
+	buffer.back() = 1;
+	buffer.publish();
+	buffer.back() = 2;
+	buffer.publish();
+
+	// only the newest value is seen
+	REQUIRE(buffer.acquire());
+	REQUIRE(buffer.front() == 2);
+	REQUIRE_FALSE(buffer.acquire());
+	REQUIRE(buffer.front() == 2);
+
+	buffer.back() = 3;
+	buffer.publish();
+	REQUIRE(buffer.acquire());
+	REQUIRE(buffer.front() == 3);
+}
+
+static void loadPrintAndHaltProgram(Bus& bus) {
+	const Byte program[] = {
+		0xa9, 'H',  // lda #'H'
+		0x42, 0x80, // wdm #$80 (print character)
+		0xa9, 'i',  // lda #'i'
+		0x42, 0x80, // wdm #$80 (print character)
+		0x42, 0x81, // wdm #$81 (halt)
+	};
+
+	Address address = 0x7e0000;
+	for (auto byte: program) {
+		bus.write(address++, byte);
+	}
+	bus.cpu.PBR = 0x7e;
+	bus.cpu.PC = 0;
+}
+
+TEST_CASE("Emulation thread", "[emulation]") {
+	auto bus = std::make_unique<Bus>();
+	EmulationThread emulation(*bus);
+
+	emulation.setDebugText("Loaded\n");
+	REQUIRE(emulation.acquireFrame());
+	REQUIRE(emulation.frame().debugText == "Loaded\n");
+
+	loadPrintAndHaltProgram(*bus);
+
+	SECTION("Running on the emulation thread") {
+		emulation.start();
+		REQUIRE(emulation.running());
+
+		bool sawOutput = false;
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (!sawOutput && std::chrono::steady_clock::now() < deadline) {
+			if (emulation.acquireFrame()) {
+				sawOutput = emulation.frame().debugText == "Loaded\nHi";
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		emulation.stop();
+		REQUIRE_FALSE(emulation.running());
+		REQUIRE(sawOutput);
+		REQUIRE(bus->cpu.stopped);
+	}
+
+	SECTION("Running a single frame") {
+		emulation.runFrame();
+		REQUIRE(emulation.acquireFrame());
+		REQUIRE(emulation.frame().debugText == "Loaded\nHi");
+		REQUIRE(bus->cpu.stopped);
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <blaze/Bus.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+namespace Blaze::Test {
+	// a loop that keeps changing registers and RAM
+	inline void loadCounterProgram(Bus& bus) {
+		const Byte program[] = {
+			0x18,             // clc
+			0xfb,             // xce (switch to native mode)
+			0xc2, 0x20,       // rep #$20 (16-bit accumulator)
+			0x1a,             // loop: inc a
+			0x8d, 0x00, 0x10, // sta $1000
+			0xe8,             // inx
+			0x80, 0xf9,       // bra loop
+		};
+
+		Address address = 0x7e0000;
+		for (auto byte: program) {
+			bus.write(address++, byte);
+		}
+		bus.cpu.PBR = 0x7e;
+		bus.cpu.PC = 0;
+	}
+
+	inline std::vector<Byte> saveState(const Bus& bus) {
+		std::vector<Byte> state(bus.saveStateSize());
+		REQUIRE(bus.saveState(state.data(), state.size()) == state.size());
+		return state;
+	}
+}
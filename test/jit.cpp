@@ -0,0 +1,266 @@
+#include <blaze/Bus.hpp>
+#include <blaze/JIT.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "helpers.hpp"
+
+using namespace Blaze;
+using namespace Blaze::Test;
+
+static void loadProgram(Bus& bus, const std::vector<Byte>& program) {
+	// the programs run from the low RAM mirror in bank 0, so that `jmp` (which uses DBR) stays in the same bank
+	Address address = 0;
+	for (auto byte: program) {
+		bus.write(address++, byte);
+	}
+	bus.cpu.PBR = 0;
+	bus.cpu.PC = 0;
+}
+
+// runs the program with and without the JIT for (about) the given number of instructions, and makes sure both end up in the same state
+static void runDifferential(const std::vector<Byte>& program, uint64_t instructions, bool expectCompiled = true) {
+	auto interpreted = std::make_unique<Bus>();
+	auto compiled = std::make_unique<Bus>();
+	loadProgram(*interpreted, program);
+	loadProgram(*compiled, program);
+
+	JIT jit(compiled->cpu);
+	compiled->cpu.jit = &jit;
+
+	// the JIT runs whole blocks at a time, so it might run a few more instructions than asked for
+	uint64_t compiledCount = 0;
+	while (compiledCount < instructions) {
+		compiledCount += compiled->cpu.clock();
+	}
+
+	for (uint64_t i = 0; i < compiledCount; ++i) {
+		interpreted->cpu.clock();
+	}
+
+	if (JIT::supported() && expectCompiled) {
+		REQUIRE(jit.compiledBlockCount() > 0);
+	}
+	REQUIRE(saveState(*compiled) == saveState(*interpreted));
+	REQUIRE(compiled->scheduler.now() == interpreted->scheduler.now());
+
+	compiled->cpu.jit = nullptr;
+}
+
+TEST_CASE("JIT", "[jit]") {
+	SECTION("Flag and index instructions with 8-bit registers") {
+		runDifferential({
+			0x18,             // clc
+			0xe8,             // loop: inx
+			0xc8,             // iny
+			0xc8,             // iny
+			0x88,             // dey
+			0x38,             // sec
+			0x69, 0x01,       // adc #$01
+			0x8d, 0x00, 0x10, // sta $1000
+			0xb8,             // clv
+			0xea,             // nop
+			0xd8,             // cld
+			0x58,             // cli
+			0x78,             // sei
+			0xca,             // dex
+			0xe8,             // inx
+			0x4c, 0x01, 0x00, // jmp loop
+		}, 20000);
+	}
+
+	SECTION("Index instructions with 16-bit registers, switching modes") {
+		runDifferential({
+			0x18,             // clc
+			0xfb,             // xce (switch to native mode)
+			0xc2, 0x30,       // loop: rep #$30 (16-bit accumulator and index registers)
+			0xe8,             // inx
+			0xe8,             // inx
+			0x88,             // dey
+			0x18,             // clc
+			0x69, 0x03, 0x00, // adc #$0003
+			0x8d, 0x00, 0x10, // sta $1000
+			0xe2, 0x10,       // sep #$10 (8-bit index registers)
+			0xca,             // dex
+			0xc8,             // iny
+			0x4c, 0x02, 0x00, // jmp loop
+		}, 20000);
+	}
+
+	SECTION("Loads, stores, logic ops, compares and transfers with every register width") {
+		// (the direct page is moved away from the code, and isn't page-aligned so that it costs an extra cycle)
+		auto modes = GENERATE(as<Byte>{}, 0x00, 0x10, 0x20, 0x30);
+		runDifferential({
+			0x18,             // clc
+			0xfb,             // xce (switch to native mode)
+			0xc2, 0x30,       // rep #$30 (16-bit accumulator and index registers)
+			0xa9, 0x01, 0x10, // lda #$1001
+			0x5b,             // tcd
+			0xe2, modes,      // sep #modes
+			0xe8,             // loop: inx
+			0x8a,             // txa
+			0x85, 0x10,       // sta $10
+			0xa5, 0x10,       // lda $10
+			0x49, 0xff,       // eor #$ff (or #$eaff with a 16-bit accumulator, like the rest of these)
+			0xea,             // nop
+			0x09, 0x01,       // ora #$01
+			0xea,             // nop
+			0x29, 0x7f,       // and #$7f
+			0xea,             // nop
+			0x8d, 0x00, 0x12, // sta $1200
+			0xac, 0x00, 0x12, // ldy $1200
+			0xa0, 0x10,       // ldy #$10 (or #$ea10 with 16-bit index registers)
+			0xea,             // nop
+			0xc9, 0x40,       // cmp #$40
+			0xea,             // nop
+			0xe0, 0x34,       // cpx #$34 (ditto)
+			0xea,             // nop
+			0xc4, 0x10,       // cpy $10
+			0xcc, 0x10, 0x00, // cpy $0010
+			0xec, 0x00, 0x12, // cpx $1200
+			0xa8,             // tay
+			0x9b,             // txy
+			0xbb,             // tyx
+			0x98,             // tya
+			0x64, 0x11,       // stz $11
+			0x86, 0x12,       // stx $12
+			0x84, 0x14,       // sty $14
+			0x9c, 0x02, 0x12, // stz $1202
+			0x8e, 0x04, 0x12, // stx $1204
+			0x8c, 0x06, 0x12, // sty $1206
+			0xc5, 0x12,       // cmp $12
+			0xcd, 0x00, 0x12, // cmp $1200
+			0x25, 0x14,       // and $14
+			0x05, 0x10,       // ora $10
+			0x45, 0x11,       // eor $11
+			0xad, 0x04, 0x12, // lda $1204
+			0xa6, 0x12,       // ldx $12
+			0xaa,             // tax
+			0xe8,             // inx
+			0x4c, 0x0a, 0x00, // jmp loop
+		}, 20000);
+	}
+
+	SECTION("Stores that drop other blocks") {
+		std::vector<Byte> program(0x105, 0xea);
+		const std::vector<Byte> loop = {
+			0x18,             // clc
+			0xe8,             // loop: inx
+			0x8a,             // txa
+			0x8d, 0x01, 0x01, // sta $0101 (the operand of the `adc` below, in another block)
+			0xc8,             // iny
+			0x4c, 0x00, 0x01, // jmp $0100
+		};
+		const std::vector<Byte> other = {
+			0x69, 0x00,       // adc #$00
+			0x4c, 0x01, 0x00, // jmp loop
+		};
+		std::copy(loop.begin(), loop.end(), program.begin());
+		std::copy(other.begin(), other.end(), program.begin() + 0x100);
+
+		// the block with the store still gets compiled; it just can't go on after the store
+		runDifferential(program, 20000);
+	}
+
+	SECTION("Stores that start DMA") {
+		runDifferential({
+			0x9c, 0x00, 0x43, // stz $4300
+			0xa9, 0x22,       // lda #$22
+			0x8d, 0x01, 0x43, // sta $4301 (channel 0 writes to CGRAM...)
+			0x9c, 0x03, 0x43, // stz $4303
+			0x9c, 0x04, 0x43, // stz $4304
+			0x9c, 0x06, 0x43, // stz $4306
+			0x9c, 0x02, 0x43, // loop: stz $4302 (...from $000000...)
+			0xa9, 0x10,       // lda #$10
+			0x8d, 0x05, 0x43, // sta $4305 (...16 bytes at a time)
+			0xa9, 0x01,       // lda #$01
+			0x8d, 0x0b, 0x42, // sta $420b (the CPU is halted while the transfer runs)
+			0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, // inx (30 times)
+			0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8,
+			0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8,
+			0x4c, 0x11, 0x00, // jmp loop
+		}, 20000);
+	}
+
+	SECTION("Read-modify-write instructions that start DMA") {
+		const std::vector<Byte> program = {
+			0xa2, 0x70,       // loop: ldx #$70
+			0x9e, 0x00, 0x43, // channel: stz $4300,x
+			0xa9, 0x22,       // lda #$22
+			0x9d, 0x01, 0x43, // sta $4301,x (every channel writes to CGRAM...)
+			0x9e, 0x02, 0x43, // stz $4302,x
+			0x9e, 0x03, 0x43, // stz $4303,x
+			0x9e, 0x04, 0x43, // stz $4304,x (...from $000000...)
+			0xa9, 0x02,       // lda #$02
+			0x9d, 0x05, 0x43, // sta $4305,x
+			0x9e, 0x06, 0x43, // stz $4306,x (...2 bytes at a time)
+			0x8a,             // txa
+			0x38,             // sec
+			0xe9, 0x10,       // sbc #$10
+			0xaa,             // tax
+			0x10, 0xe0,       // bpl channel
+			0xa9, 0xff,       // lda #$ff
+			0x0c, 0x0b, 0x42, // tsb $420b (interpreted, rather than stored natively; starts all 8 channels)
+			0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, // inx (30 times)
+			0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8,
+			0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8, 0xe8,
+			0x4c, 0x00, 0x00, // jmp loop
+		};
+		runDifferential(program, 20000);
+
+		// starting DMA ends the run, and the block it's in, right after the `tsb`
+		auto bus = std::make_unique<Bus>();
+		loadProgram(*bus, program);
+		JIT jit(bus->cpu);
+		bus->cpu.jit = &jit;
+		for (int i = 0; i < 100; ++i) {
+			Cycles cycles = 0;
+			bus->cpu.run(1000000, cycles);
+			bus->scheduler.advance(cycles);
+			REQUIRE(bus->cpu.PC == 0x0027);
+		}
+		if (JIT::supported()) {
+			REQUIRE(jit.compiledBlockCount() > 0);
+		}
+		bus->cpu.jit = nullptr;
+	}
+
+	SECTION("Code that modifies itself") {
+		runDifferential({
+			0x18,             // clc
+			0xe8,             // loop: inx
+			0x69, 0x01,       // adc #$01 (the operand is incremented by the code below)
+			0xee, 0x03, 0x00, // inc $0003
+			0xc8,             // iny
+			0x4c, 0x01, 0x00, // jmp loop
+		}, 20000, false); // the block is dropped on every iteration, so it never gets hot enough to compile
+	}
+
+	SECTION("Dropping the JIT leaves no compiled code behind") {
+		auto bus = std::make_unique<Bus>();
+		loadProgram(*bus, {
+			0xe8,             // loop: inx
+			0x4c, 0x00, 0x00, // jmp loop
+		});
+
+		{
+			JIT jit(bus->cpu);
+			bus->cpu.jit = &jit;
+			for (int i = 0; i < 1000; ++i) {
+				bus->cpu.clock();
+			}
+			bus->cpu.jit = nullptr;
+		}
+
+		REQUIRE(bus->cpu.decodeCache.blockCount() == 0);
+
+		// and the interpreter carries on just fine
+		Byte x = bus->cpu.X.load();
+		bus->cpu.clock();
+		REQUIRE(bus->cpu.X.load() == Byte(x + 1));
+	}
+}
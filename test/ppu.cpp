@@ -0,0 +1,466 @@
+#include <blaze/Bus.hpp>
+#include <blaze/util.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <vector>
+
+using namespace Blaze;
+
+static void writePPU(Bus& bus, Byte reg, Byte value) {
+	bus.write(0x2100 | static_cast<Address>(reg), value);
+}
+
+static Byte readPPU(Bus& bus, Byte reg) {
+	return bus.read8(0x2100 | static_cast<Address>(reg));
+}
+
+static void setColor(Bus& bus, Byte index, Word color) {
+	writePPU(bus, PPU::CGADD, index);
+	writePPU(bus, PPU::CGDATA, static_cast<Byte>(color));
+	writePPU(bus, PPU::CGDATA, static_cast<Byte>(color >> 8));
+}
+
+// a tile where every pixel is the given color, at the given bit depth
+static void fillTile(Bus& bus, Word address, Byte depth, Byte color) {
+	for (Word row = 0; row < 8; ++row) {
+		for (Byte plane = 0; plane < depth; plane += 2) {
+			Byte low = ((color >> plane) & 1) ? 0xff : 0x00;
+			Byte high = ((color >> (plane + 1)) & 1) ? 0xff : 0x00;
+			bus.ppu.vram[address + plane * 4 + row] = concat16(high, low);
+		}
+	}
+	bus.ppu.invalidateTiles(address, depth * 4);
+}
+
+static Word pixel(const Bus& bus, unsigned x, unsigned line) {
+	return bus.ppu.frameBuffer[(line - PPU::FIRST_VISIBLE_LINE) * PPU::SCREEN_WIDTH + x];
+}
+
+static constexpr Word RED = 0x001f;
+static constexpr Word GREEN = 0x03e0;
+static constexpr Word BLUE = 0x7c00;
+
+TEST_CASE("PPU memory ports", "[ppu]") {
+	auto bus = std::make_unique<Bus>();
+
+	SECTION("VRAM") {
+		// increment after the high byte
+		writePPU(*bus, PPU::VMAIN, 0x80);
+		bus->write(0x2116, Word(0x1234));
+		bus->write(0x2118, Word(0xbeef));
+		bus->write(0x2118, Word(0xcafe));
+		REQUIRE(bus->ppu.vram[0x1234] == 0xbeef);
+		REQUIRE(bus->ppu.vram[0x1235] == 0xcafe);
+		REQUIRE(bus->ppu.vramAddress == 0x1236);
+
+		// reads go through the prefetch buffer, which is loaded when the address is set
+		bus->write(0x2116, Word(0x1234));
+		REQUIRE(readPPU(*bus, PPU::RDVRAML) == 0xef);
+		REQUIRE(bus->ppu.vramAddress == 0x1234);
+		REQUIRE(readPPU(*bus, PPU::RDVRAMH) == 0xbe);
+		REQUIRE(bus->ppu.vramAddress == 0x1235);
+
+		// increment by 32 after the low byte
+		writePPU(*bus, PPU::VMAIN, 0x01);
+		bus->write(0x2116, Word(0x0100));
+		writePPU(*bus, PPU::VMDATAL, 0x11);
+		writePPU(*bus, PPU::VMDATAL, 0x22);
+		REQUIRE(bus->ppu.vram[0x0100] == 0x0011);
+		REQUIRE(bus->ppu.vram[0x0120] == 0x0022);
+
+		// the 2bpp remapping rotates the low 8 bits of the address left by 3
+		writePPU(*bus, PPU::VMAIN, 0x84);
+		bus->write(0x2116, Word(0x2000));
+		for (Word i = 0; i < 33; ++i) {
+			bus->write(0x2118, static_cast<Word>(i + 1));
+		}
+		for (Word i = 0; i < 32; ++i) {
+			REQUIRE(bus->ppu.vram[0x2000 + i * 8] == i + 1);
+		}
+		REQUIRE(bus->ppu.vram[0x2001] == 33);
+	}
+
+	SECTION("CGRAM") {
+		setColor(*bus, 0x10, 0x7fff);
+		setColor(*bus, 0x11, 0x1234);
+		REQUIRE(bus->ppu.cgram[0x10] == 0x7fff);
+		REQUIRE(bus->ppu.cgram[0x11] == 0x1234);
+
+		writePPU(*bus, PPU::CGADD, 0x11);
+		REQUIRE(readPPU(*bus, PPU::RDCGRAM) == 0x34);
+		REQUIRE(readPPU(*bus, PPU::RDCGRAM) == 0x12);
+		REQUIRE(bus->ppu.cgramAddress == 0x12);
+
+		// the top bit isn't stored
+		setColor(*bus, 0x12, 0xffff);
+		REQUIRE(bus->ppu.cgram[0x12] == 0x7fff);
+	}
+
+	SECTION("OAM") {
+		bus->write(0x2102, Word(0x0001));
+		writePPU(*bus, PPU::OAMDATA, 0x12);
+		// nothing is written until the second byte of the pair
+		REQUIRE(bus->ppu.oam[2] == 0x00);
+		writePPU(*bus, PPU::OAMDATA, 0x34);
+		REQUIRE(bus->ppu.oam[2] == 0x12);
+		REQUIRE(bus->ppu.oam[3] == 0x34);
+
+		// the high table is written a byte at a time
+		bus->write(0x2102, Word(0x0100));
+		writePPU(*bus, PPU::OAMDATA, 0x56);
+		REQUIRE(bus->ppu.oam[0x200] == 0x56);
+
+		bus->write(0x2102, Word(0x0001));
+		REQUIRE(readPPU(*bus, PPU::RDOAM) == 0x12);
+		REQUIRE(readPPU(*bus, PPU::RDOAM) == 0x34);
+	}
+
+	SECTION("Registers") {
+		// the multiplier: M7A times the last byte written to M7B
+		writePPU(*bus, PPU::M7A, 0x00);
+		writePPU(*bus, PPU::M7A, 0x10);
+		writePPU(*bus, PPU::M7B, 0xfe);
+		REQUIRE(bus->read24(0x2134) == 0xffe000);
+
+		// the scroll registers are written twice
+		writePPU(*bus, PPU::BG2HOFS, 0x34);
+		writePPU(*bus, PPU::BG2HOFS, 0x01);
+		writePPU(*bus, PPU::BG2VOFS, 0x78);
+		writePPU(*bus, PPU::BG2VOFS, 0x02);
+		REQUIRE(bus->ppu.bgHOffset[1] == 0x134);
+		REQUIRE(bus->ppu.bgVOffset[1] == 0x278);
+
+		writePPU(*bus, PPU::COLDATA, 0x20 | 0x80 | 0x11);
+		REQUIRE(bus->ppu.fixedColor == ((0x11 << 10) | 0x11));
+
+		// most of them are write-only
+		uint64_t unmappedBefore = bus->unmappedAccesses;
+		readPPU(*bus, PPU::BGMODE);
+		REQUIRE(bus->unmappedAccesses == unmappedBefore + 1);
+	}
+
+	SECTION("DMA into VRAM") {
+		for (Address i = 0; i < 0x800; ++i) {
+			bus->write(0x7e4000 + i, static_cast<Byte>(i ^ 0x5a));
+		}
+		writePPU(*bus, PPU::VMAIN, 0x80);
+		bus->write(0x2116, Word(0x7e00));
+
+		// mode 1 alternates between VMDATAL and VMDATAH (and wraps around the end of VRAM)
+		bus->write(0x4300, Byte(0x01));
+		bus->write(0x4301, Byte(0x18));
+		bus->write(0x4302, Word(0x4000));
+		bus->write(0x4304, Byte(0x7e));
+		bus->write(0x4305, Word(0x800));
+		bus->write(0x420b, Byte(0x01));
+
+		for (Word i = 0; i < 0x400; ++i) {
+			Word expected = concat16(static_cast<Byte>((2 * i + 1) ^ 0x5a), static_cast<Byte>((2 * i) ^ 0x5a));
+			REQUIRE(bus->ppu.vram[(0x7e00 + i) & 0x7fff] == expected);
+		}
+		REQUIRE(bus->ppu.vramAddress == 0x8200);
+	}
+}
+
+TEST_CASE("PPU rendering", "[ppu]") {
+	auto bus = std::make_unique<Bus>();
+	constexpr unsigned LINE = 10;
+
+	// mode 1, with BG1's tilemap at $0400 and its tiles at $1000, and BG2's tilemap at $0800 and its tiles at $2000
+	writePPU(*bus, PPU::INIDISP, 0x0f);
+	writePPU(*bus, PPU::BGMODE, 0x01);
+	writePPU(*bus, PPU::BG1SC, 0x04);
+	writePPU(*bus, PPU::BG2SC, 0x08);
+	writePPU(*bus, PPU::BG12NBA, 0x21);
+	writePPU(*bus, PPU::TM, 0x01);
+
+	setColor(*bus, 0, BLUE);
+	setColor(*bus, 1, RED);
+	setColor(*bus, 0x12, GREEN);
+
+	// tile 1 is color 1 everywhere; BG1's tilemap has it in every other column
+	fillTile(*bus, 0x1000 + 16, 4, 1);
+	for (Word i = 0; i < 32 * 32; i += 2) {
+		bus->ppu.vram[0x0400 + i] = 0x0001;
+	}
+	bus->ppu.invalidateTiles(0x0400, 32 * 32);
+
+	SECTION("Backgrounds") {
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 0, LINE) == RED);
+		REQUIRE(pixel(*bus, 7, LINE) == RED);
+		REQUIRE(pixel(*bus, 8, LINE) == BLUE);
+		REQUIRE(pixel(*bus, 255, LINE) == BLUE);
+
+		// scrolling by 3 pixels
+		writePPU(*bus, PPU::BG1HOFS, 0x03);
+		writePPU(*bus, PPU::BG1HOFS, 0x00);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 4, LINE) == RED);
+		REQUIRE(pixel(*bus, 5, LINE) == BLUE);
+		REQUIRE(pixel(*bus, 13, LINE) == RED);
+
+		// BG2 behind BG1, with palette 1
+		fillTile(*bus, 0x2000 + 16, 4, 2);
+		for (Word i = 0; i < 32 * 32; ++i) {
+			bus->ppu.vram[0x0800 + i] = 0x0401;
+		}
+		bus->ppu.invalidateTiles(0x0800, 32 * 32);
+		writePPU(*bus, PPU::TM, 0x03);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 4, LINE) == RED);
+		REQUIRE(pixel(*bus, 5, LINE) == GREEN);
+
+		// unless its tiles have priority
+		for (Word i = 0; i < 32 * 32; ++i) {
+			bus->ppu.vram[0x0800 + i] = 0x2401;
+		}
+		bus->ppu.invalidateTiles(0x0800, 32 * 32);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 4, LINE) == GREEN);
+
+		// horizontal flip of a tile with one column set (tile 2 is blank, and cached as such, until that column is set)
+		bus->ppu.vram[0x0400 + (LINE / 8) * 32] = 0x4002;
+		bus->ppu.invalidateTiles(0x0400 + (LINE / 8) * 32);
+		writePPU(*bus, PPU::TM, 0x01);
+		writePPU(*bus, PPU::BG1HOFS, 0x00);
+		writePPU(*bus, PPU::BG1HOFS, 0x00);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 7, LINE) == BLUE);
+
+		for (Word row = 0; row < 8; ++row) {
+			bus->ppu.vram[0x1000 + 32 + row] = 0x0080;
+		}
+		bus->ppu.invalidateTiles(0x1000 + 32, 8);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 0, LINE) == BLUE);
+		REQUIRE(pixel(*bus, 7, LINE) == RED);
+	}
+
+	SECTION("Sprites") {
+		// a 16x16 sprite (tiles 0, 1, 16, and 17) at (8, 5), priority 0, palette 0
+		writePPU(*bus, PPU::OBSEL, 0x03 << 5); // 16x16 and 32x32, with the tiles at $0000
+		for (Word tile: { 0, 1, 16, 17 }) {
+			fillTile(*bus, tile * 16, 4, 3);
+		}
+		setColor(*bus, 128 + 3, GREEN);
+		bus->ppu.oam[0] = 8;
+		bus->ppu.oam[1] = 5;
+		bus->ppu.oam[2] = 0;
+		bus->ppu.oam[3] = 0x00;
+		// every other sprite is off screen, at y = 240
+		for (size_t sprite = 1; sprite < 128; ++sprite) {
+			bus->ppu.oam[sprite * 4 + 1] = 240;
+		}
+		writePPU(*bus, PPU::TM, 0x11);
+
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 7, LINE) == RED);
+		REQUIRE(pixel(*bus, 8, LINE) == GREEN);
+		REQUIRE(pixel(*bus, 15, LINE) == GREEN);
+		// behind BG1
+		REQUIRE(pixel(*bus, 16, LINE) == RED);
+		REQUIRE(pixel(*bus, 24, LINE) == BLUE);
+
+		// in front of it with priority 2
+		bus->ppu.oam[3] = 0x20;
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 16, LINE) == GREEN);
+
+		// (it's 16 lines tall, starting on the line after its Y coordinate)
+		bus->ppu.renderLine(5 + 16);
+		REQUIRE(pixel(*bus, 8, 5 + 16) == GREEN);
+		bus->ppu.renderLine(5 + 17);
+		REQUIRE(pixel(*bus, 8, 5 + 17) == BLUE);
+
+		// moving it moves it on the next line that's rendered (even when OAM is written directly)
+		bus->ppu.oam[1] = 40;
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 8, LINE) == BLUE);
+		bus->ppu.renderLine(41);
+		REQUIRE(pixel(*bus, 8, 41) == GREEN);
+
+		// only 32 sprites fit on a line; the 33rd isn't drawn...
+		bus->ppu.oam[1] = 5;
+		for (size_t sprite = 1; sprite <= 32; ++sprite) {
+			bus->ppu.oam[sprite * 4] = (sprite == 32) ? 200 : 100;
+			bus->ppu.oam[sprite * 4 + 1] = 5;
+		}
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 8, LINE) == GREEN);
+		REQUIRE(pixel(*bus, 200, LINE) == BLUE);
+
+		// ...counting from the one OAMADD points at, with priority rotation
+		writePPU(*bus, PPU::OAMADDL, 2);
+		writePPU(*bus, PPU::OAMADDH, 0x80);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 8, LINE) == BLUE);
+		REQUIRE(pixel(*bus, 200, LINE) == GREEN);
+	}
+
+	SECTION("Windows") {
+		// window 1 from 2 to 5, masking BG1
+		writePPU(*bus, PPU::WH0, 2);
+		writePPU(*bus, PPU::WH1, 5);
+		writePPU(*bus, PPU::W12SEL, 0x02);
+		writePPU(*bus, PPU::TMW, 0x01);
+
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 1, LINE) == RED);
+		REQUIRE(pixel(*bus, 2, LINE) == BLUE);
+		REQUIRE(pixel(*bus, 5, LINE) == BLUE);
+		REQUIRE(pixel(*bus, 6, LINE) == RED);
+
+		// inverted
+		writePPU(*bus, PPU::W12SEL, 0x03);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 1, LINE) == BLUE);
+		REQUIRE(pixel(*bus, 2, LINE) == RED);
+
+		// covering a whole column (BG1 scrolled so that it would be red there)
+		writePPU(*bus, PPU::WH0, 8);
+		writePPU(*bus, PPU::WH1, 15);
+		writePPU(*bus, PPU::W12SEL, 0x02);
+		writePPU(*bus, PPU::BG1HOFS, 0x08);
+		writePPU(*bus, PPU::BG1HOFS, 0x00);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 7, LINE) == BLUE);
+		REQUIRE(pixel(*bus, 8, LINE) == BLUE);
+		REQUIRE(pixel(*bus, 16, LINE) == BLUE);
+		REQUIRE(pixel(*bus, 24, LINE) == RED);
+
+		// BG1 is still there on the sub screen, which it isn't windowed on (added to the main screen's backdrop)
+		writePPU(*bus, PPU::TS, 0x01);
+		writePPU(*bus, PPU::CGWSEL, 0x02);
+		writePPU(*bus, PPU::CGADSUB, 0x20);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 8, LINE) == (BLUE | RED));
+		REQUIRE(pixel(*bus, 16, LINE) == BLUE);
+
+		writePPU(*bus, PPU::TS, 0x00);
+		writePPU(*bus, PPU::CGADSUB, 0x00);
+		writePPU(*bus, PPU::BG1HOFS, 0x00);
+		writePPU(*bus, PPU::BG1HOFS, 0x00);
+		writePPU(*bus, PPU::WH0, 2);
+		writePPU(*bus, PPU::WH1, 5);
+
+		// the color window clipping to black inside
+		writePPU(*bus, PPU::TMW, 0x00);
+		writePPU(*bus, PPU::WOBJSEL, 0x20);
+		writePPU(*bus, PPU::CGWSEL, 0x80);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 1, LINE) == RED);
+		REQUIRE(pixel(*bus, 3, LINE) == 0);
+		REQUIRE(pixel(*bus, 9, LINE) == BLUE);
+	}
+
+	SECTION("Color math") {
+		// BG1 and the backdrop plus the fixed color, halved
+		writePPU(*bus, PPU::COLDATA, 0x40 | 0x1f);
+		writePPU(*bus, PPU::CGADSUB, 0x40 | 0x21);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 0, LINE) == ((0x0f << 5) | 0x0f));
+		REQUIRE(pixel(*bus, 8, LINE) == ((0x0f << 10) | (0x0f << 5)));
+
+		// not halved, and only for the backdrop
+		writePPU(*bus, PPU::CGADSUB, 0x20);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 0, LINE) == RED);
+		REQUIRE(pixel(*bus, 8, LINE) == (BLUE | GREEN));
+
+		// subtracting the sub screen (BG2, which is green where it's there)
+		fillTile(*bus, 0x2000 + 16, 4, 2);
+		for (Word i = 0; i < 32 * 32; i += 4) {
+			bus->ppu.vram[0x0800 + i] = 0x0401;
+		}
+		bus->ppu.invalidateTiles(0x0800, 32 * 32);
+		setColor(*bus, 0x12, 0x0421);
+		writePPU(*bus, PPU::TS, 0x02);
+		writePPU(*bus, PPU::CGWSEL, 0x02);
+		writePPU(*bus, PPU::CGADSUB, 0x80 | 0x01);
+		writePPU(*bus, PPU::COLDATA, 0xe0);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 0, LINE) == 0x001e);
+		// (where the sub screen is transparent, it's the fixed color, which is black here)
+		REQUIRE(pixel(*bus, 16, LINE) == RED);
+		REQUIRE(pixel(*bus, 8, LINE) == BLUE);
+	}
+
+	SECTION("Brightness and forced blank") {
+		setColor(*bus, 1, 0x7fff);
+		writePPU(*bus, PPU::INIDISP, 0x07);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 0, LINE) == ((0x0f << 10) | (0x0f << 5) | 0x0f));
+
+		writePPU(*bus, PPU::INIDISP, 0x8f);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 0, LINE) == 0);
+	}
+
+	SECTION("Mode 7") {
+		// tile 1's pixels are color 1, and the whole map is tile 1 except for the top left corner
+		for (Word i = 0; i < 64; ++i) {
+			bus->ppu.vram[64 + i] = 0x0100;
+		}
+		for (Word i = 0; i < 128 * 128; ++i) {
+			bus->ppu.vram[i] = (bus->ppu.vram[i] & 0xff00) | 0x01;
+		}
+		bus->ppu.vram[0] &= 0xff00;
+		bus->ppu.invalidateTiles();
+
+		// the identity matrix
+		writePPU(*bus, PPU::BGMODE, 0x07);
+		writePPU(*bus, PPU::M7A, 0x00);
+		writePPU(*bus, PPU::M7A, 0x01);
+		writePPU(*bus, PPU::M7D, 0x00);
+		writePPU(*bus, PPU::M7D, 0x01);
+
+		bus->ppu.renderLine(1);
+		REQUIRE(pixel(*bus, 7, 1) == BLUE);
+		REQUIRE(pixel(*bus, 8, 1) == RED);
+		bus->ppu.renderLine(LINE);
+		REQUIRE(pixel(*bus, 0, LINE) == RED);
+
+		// scaled up twice
+		writePPU(*bus, PPU::M7A, 0x80);
+		writePPU(*bus, PPU::M7A, 0x00);
+		bus->ppu.renderLine(1);
+		REQUIRE(pixel(*bus, 15, 1) == BLUE);
+		REQUIRE(pixel(*bus, 16, 1) == RED);
+	}
+}
+
+TEST_CASE("PPU timing", "[ppu]") {
+	auto bus = std::make_unique<Bus>();
+	writePPU(*bus, PPU::INIDISP, 0x0f);
+	writePPU(*bus, PPU::TM, 0x01);
+	setColor(*bus, 0, RED);
+
+	bus->scheduler.advance(MASTER_CYCLES_PER_FRAME);
+	REQUIRE(bus->ppu.frameCount == 1);
+	REQUIRE(pixel(*bus, 0, 1) == RED);
+	REQUIRE(pixel(*bus, 255, PPU::VBLANK_LINE - 1) == RED);
+
+	SECTION("Lines are rendered as they're reached") {
+		setColor(*bus, 0, GREEN);
+		bus->scheduler.advance(100 * MASTER_CYCLES_PER_SCANLINE);
+		REQUIRE(pixel(*bus, 0, 99) == GREEN);
+		REQUIRE(pixel(*bus, 0, 100) == RED);
+	}
+
+	SECTION("Save states") {
+		std::vector<Byte> state(bus->saveStateSize());
+		bus->saveState(state.data(), state.size());
+
+		auto restored = std::make_unique<Bus>();
+		restored->loadState(state.data(), state.size());
+		REQUIRE(restored->ppu.cgram == bus->ppu.cgram);
+		REQUIRE(restored->ppu.registers == bus->ppu.registers);
+
+		bus->scheduler.advance(MASTER_CYCLES_PER_FRAME);
+		restored->scheduler.advance(MASTER_CYCLES_PER_FRAME);
+		REQUIRE(restored->ppu.frameBuffer == bus->ppu.frameBuffer);
+		REQUIRE(restored->ppu.frameCount == 2);
+	}
+}
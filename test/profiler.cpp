@@ -0,0 +1,80 @@
+#include <blaze/Bus.hpp>
+#include <blaze/Profiler.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "helpers.hpp"
+
+using namespace Blaze;
+using namespace Blaze::Test;
+
+TEST_CASE("Profile snapshots", "[profiler]") {
+	ProfileSnapshot snapshot;
+	snapshot.handlers[0x3a9] = { 10, 60, 100 };  // LDA #$xx, m8 x8
+	snapshot.handlers[0x1a9] = { 5, 40, 300 };   // LDA #$xxxx, m16 x8
+	snapshot.handlers[0x1bd] = { 2, 20, 50 };    // LDA $xxxx,x, m16 x8
+	snapshot.handlers[0x0e8] = { 1, 12, 10 };    // INX, m16 x16
+
+	REQUIRE(snapshot.total().executions == 18);
+	REQUIRE(snapshot.total().cycles == 132);
+	REQUIRE(snapshot.opcode(CPU::Opcode::LDA).executions == 17);
+	REQUIRE(snapshot.opcode(CPU::Opcode::INX).ticks == 10);
+	REQUIRE(snapshot.opcode(CPU::Opcode::STA).executions == 0);
+	REQUIRE(snapshot.addressingMode(CPU::AddressingMode::Immediate).executions == 15);
+	REQUIRE(snapshot.addressingMode(CPU::AddressingMode::AbsoluteIndexedX).cycles == 20);
+	REQUIRE(snapshot.width(true, true).executions == 10);
+	REQUIRE(snapshot.width(false, true).executions == 7);
+	REQUIRE(snapshot.width(false, false).executions == 1);
+	REQUIRE(snapshot.width(true, false).executions == 0);
+
+	std::ostringstream report;
+	snapshot.writeReport(report, 2);
+	auto text = report.str();
+
+	// the top handlers are sorted by host time, and only as many as were asked for are listed
+	auto first = text.find("$a9 LDA Immediate m16 x8");
+	auto second = text.find("$a9 LDA Immediate m8 x8");
+	REQUIRE(first != std::string::npos);
+	REQUIRE(second != std::string::npos);
+	REQUIRE(first < second);
+	REQUIRE(text.find("$bd LDA") == std::string::npos);
+	REQUIRE(text.find("AbsoluteIndexedX") != std::string::npos);
+	REQUIRE(text.find("STA") == std::string::npos);
+}
+
+TEST_CASE("Profiling the CPU", "[profiler]") {
+	auto bus = std::make_unique<Bus>();
+	loadCounterProgram(*bus);
+	Profiler::reset();
+
+	// (on another thread, so its counters have to outlive it)
+	std::thread([&] {
+		for (int i = 0; i < 7; ++i) {
+			bus->cpu.clock();
+		}
+	}).join();
+
+	auto snapshot = Profiler::snapshot();
+
+	if (!Profiler::ENABLED) {
+		REQUIRE(snapshot.total().executions == 0);
+		return;
+	}
+
+	REQUIRE(snapshot.total().executions == 7);
+	REQUIRE(snapshot.total().cycles > 0);
+
+	// emulation mode starts out with 8-bit everything, and `rep #$20` only widens the accumulator
+	REQUIRE(snapshot.handlers[0x318].executions == 1);
+	REQUIRE(snapshot.handlers[0x3c2].executions == 1);
+	REQUIRE(snapshot.handlers[0x11a].executions == 1);
+	REQUIRE(snapshot.handlers[0x18d].executions == 1);
+	REQUIRE(snapshot.opcode(CPU::Opcode::BRA).executions == 1);
+	REQUIRE(snapshot.width(false, true).executions == 4);
+
+	Profiler::reset();
+	REQUIRE(Profiler::snapshot().total().executions == 0);
+}
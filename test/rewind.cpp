@@ -0,0 +1,105 @@
+#include <blaze/Bus.hpp>
+#include <blaze/Rewind.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "helpers.hpp"
+
+using namespace Blaze;
+using namespace Blaze::Test;
+
+static void runInstructions(Bus& bus, int count) {
+	for (int i = 0; i < count; ++i) {
+		bus.cpu.clock();
+	}
+}
+
+TEST_CASE("Rewinding", "[rewind]") {
+	auto bus = std::make_unique<Bus>();
+	loadCounterProgram(*bus);
+
+	SECTION("Stepping back restores snapshots newest first") {
+		Rewind rewind(*bus);
+		std::vector<std::vector<Byte>> states;
+		std::vector<Word> counters;
+		std::vector<Word> accumulators;
+
+		for (int i = 0; i < 10; ++i) {
+			runInstructions(*bus, 37);
+			rewind.takeSnapshot();
+			states.push_back(saveState(*bus));
+			counters.push_back(bus->read16(0x001000));
+			accumulators.push_back(bus->cpu.A.load());
+
+			// the program keeps counting, so every snapshot has a different A and RAM to restore
+			if (i > 0) {
+				REQUIRE(counters[i] != counters[i - 1]);
+				REQUIRE(accumulators[i] != accumulators[i - 1]);
+			}
+		}
+		REQUIRE(rewind.snapshotCount() == 10);
+
+		// only the RAM at $1000 and the registers change, so the deltas should be tiny compared to the state
+		REQUIRE(rewind.deltaBytesUsed() < states.front().size());
+
+		runInstructions(*bus, 5);
+
+		for (int i = 9; i >= 0; --i) {
+			REQUIRE(rewind.stepBack());
+			REQUIRE(saveState(*bus) == states[i]);
+			REQUIRE(bus->read16(0x001000) == counters[i]);
+		}
+
+		REQUIRE(rewind.snapshotCount() == 0);
+		REQUIRE(rewind.deltaBytesUsed() == 0);
+		REQUIRE_FALSE(rewind.stepBack());
+	}
+
+	SECTION("Snapshots are taken every few frames") {
+		Rewind rewind(*bus, Rewind::DEFAULT_CAPACITY, 3);
+
+		for (int i = 0; i < 7; ++i) {
+			rewind.onFrame();
+		}
+
+		// frames 0, 3 and 6
+		REQUIRE(rewind.snapshotCount() == 3);
+	}
+
+	SECTION("The oldest snapshots are dropped when the buffer fills up") {
+		// just enough for a few small deltas
+		Rewind rewind(*bus, 64);
+		std::vector<std::vector<Byte>> states;
+
+		for (int i = 0; i < 50; ++i) {
+			runInstructions(*bus, 1);
+			rewind.takeSnapshot();
+			states.push_back(saveState(*bus));
+		}
+
+		size_t count = rewind.snapshotCount();
+		REQUIRE(count > 1);
+		REQUIRE(count < states.size());
+		REQUIRE(rewind.deltaBytesUsed() <= 64);
+
+		// whatever is left is still restored correctly
+		for (size_t i = 0; i < count; ++i) {
+			REQUIRE(rewind.stepBack());
+			REQUIRE(saveState(*bus) == states[states.size() - 1 - i]);
+		}
+		REQUIRE_FALSE(rewind.stepBack());
+	}
+
+	SECTION("Clearing drops the history") {
+		Rewind rewind(*bus);
+		rewind.takeSnapshot();
+		runInstructions(*bus, 10);
+		rewind.takeSnapshot();
+
+		rewind.clear();
+		REQUIRE(rewind.snapshotCount() == 0);
+		REQUIRE_FALSE(rewind.stepBack());
+	}
+}
@@ -0,0 +1,69 @@
+#include <blaze/Bus.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+using namespace Blaze;
+
+// writes out a minimal 64 KiB LoROM image and returns its path
+static std::string writeTestROM() {
+	std::vector<Byte> image(0x10000, 0);
+
+	// the title is padded with spaces
+	const char* title = "BLAZE TEST ROM       ";
+	std::memcpy(&image[0x7fb0 + ROM::HeaderFieldOffset::GameTitle], title, std::strlen(title));
+	image[0x7fb0 + ROM::HeaderFieldOffset::FixedValue] = 0x33;
+	image[0x7fb0 + ROM::HeaderFieldOffset::Size] = 16; // 2^16 = 64 KiB
+
+	// reset vector (pointing at $8000) and some recognizable data
+	image[0x7ffc] = 0x00;
+	image[0x7ffd] = 0x80;
+	image[0x0000] = 0xea;
+	image[0x8000] = 0x12;
+	image[0x8001] = 0x34;
+
+	auto path = (std::filesystem::temp_directory_path() / "blaze-test-rom.sfc").string();
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+	return path;
+}
+
+TEST_CASE("ROM loading", "[rom]") {
+	auto path = writeTestROM();
+	auto bus = std::make_unique<Bus>();
+
+	auto mode = GENERATE(ROM::StorageMode::MemoryMapped, ROM::StorageMode::Copied);
+	bus->rom.load(path, mode);
+	bus->reset();
+
+	REQUIRE(bus->rom.storageMode() == mode);
+	REQUIRE(bus->rom.type() == ROM::Type::LoROM);
+	REQUIRE(bus->rom.byteSize() == 0x10000);
+	REQUIRE(bus->rom.name() == "BLAZE TEST ROM       ");
+
+	// LoROM maps the first 32 KiB of the ROM into the upper half of bank $00
+	REQUIRE(bus->read8(0x008000) == 0xea);
+	REQUIRE(bus->read16(0x018000) == 0x3412);
+	REQUIRE(bus->cpu.PC == 0x8000);
+
+	// writes to ROM are ignored
+	bus->write(0x008000, static_cast<Byte>(0x00));
+	REQUIRE(bus->read8(0x008000) == 0xea);
+
+	bus->rom.reset(bus.get());
+	REQUIRE(bus->rom.type() == ROM::Type::INVALID);
+	REQUIRE(bus->rom.byteSize() == 0);
+
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("Loading a missing ROM fails", "[rom]") {
+	ROM rom;
+	REQUIRE_THROWS(rom.load((std::filesystem::temp_directory_path() / "blaze-missing-rom.sfc").string()));
+	REQUIRE(rom.type() == ROM::Type::INVALID);
+}
@@ -0,0 +1,111 @@
+#include <blaze/Bus.hpp>
+#include <blaze/SaveState.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "helpers.hpp"
+
+using namespace Blaze;
+using namespace Blaze::Test;
+
+TEST_CASE("Save states", "[savestate]") {
+	auto bus = std::make_unique<Bus>();
+	loadCounterProgram(*bus);
+
+	for (int i = 0; i < 100; ++i) {
+		bus->cpu.clock();
+	}
+
+	auto state = saveState(*bus);
+
+	SECTION("Restoring a state resumes from the same point") {
+		for (int i = 0; i < 100; ++i) {
+			bus->cpu.clock();
+		}
+		auto expected = saveState(*bus);
+
+		// load the state into a fresh machine (with nothing else set up) and run the same number of instructions
+		auto restored = std::make_unique<Bus>();
+		restored->loadState(state.data(), state.size());
+		REQUIRE(saveState(*restored) == state);
+
+		for (int i = 0; i < 100; ++i) {
+			restored->cpu.clock();
+		}
+		REQUIRE(saveState(*restored) == expected);
+		REQUIRE(restored->read16(0x001000) == bus->read16(0x001000));
+		REQUIRE(restored->scheduler.now() == bus->scheduler.now());
+	}
+
+	SECTION("Pending events are restored") {
+		int fired = 0;
+		auto event = bus->scheduler.registerEvent([&](MasterCycles) { ++fired; });
+		bus->scheduler.schedule(event, bus->scheduler.now() + 100);
+		auto stateWithEvent = saveState(*bus);
+
+		bus->scheduler.reset();
+		bus->loadState(stateWithEvent.data(), stateWithEvent.size());
+		bus->scheduler.advance(100);
+		REQUIRE(fired == 1);
+	}
+
+	SECTION("The memory speed is restored") {
+		bus->write(0x00420d, static_cast<Byte>(0x01));
+		auto fastState = saveState(*bus);
+
+		auto restored = std::make_unique<Bus>();
+		restored->loadState(fastState.data(), fastState.size());
+		REQUIRE(restored->fastROM());
+		REQUIRE(restored->accessCycles(0x808000) == Bus::FAST_ACCESS_CYCLES);
+
+		restored->loadState(state.data(), state.size());
+		REQUIRE_FALSE(restored->fastROM());
+		REQUIRE(restored->accessCycles(0x808000) == Bus::SLOW_ACCESS_CYCLES);
+	}
+
+	SECTION("An out-of-range CGRAM address is wrapped") {
+		bus->ppu.cgramAddress = 0xbeef;
+		auto badState = saveState(*bus);
+
+		auto restored = std::make_unique<Bus>();
+		restored->loadState(badState.data(), badState.size());
+		REQUIRE(restored->ppu.cgramAddress == 0xef);
+
+		restored->write(0x002122, static_cast<Byte>(0x34));
+		restored->write(0x002122, static_cast<Byte>(0x12));
+		REQUIRE(restored->ppu.cgram[0xef] == 0x1234);
+	}
+
+	SECTION("An out-of-range WRAM port address is wrapped") {
+		bus->ram.portAddress = 0xdeadbeef;
+		auto badState = saveState(*bus);
+
+		auto restored = std::make_unique<Bus>();
+		restored->loadState(badState.data(), badState.size());
+		REQUIRE(restored->ram.portAddress == 0x01beef);
+
+		restored->write(0x002180, static_cast<Byte>(0x56));
+		REQUIRE(restored->read8(0x7fbeef) == 0x56);
+	}
+
+	SECTION("The buffer has to be big enough") {
+		std::vector<Byte> tooSmall(state.size() - 1);
+		REQUIRE_THROWS(bus->saveState(tooSmall.data(), tooSmall.size()));
+	}
+
+	SECTION("Invalid states are rejected") {
+		auto truncated = state;
+		truncated.resize(truncated.size() / 2);
+		REQUIRE_THROWS(bus->loadState(truncated.data(), truncated.size()));
+
+		auto wrongMagic = state;
+		wrongMagic[0] = 'X';
+		REQUIRE_THROWS(bus->loadState(wrongMagic.data(), wrongMagic.size()));
+
+		auto wrongVersion = state;
+		wrongVersion[sizeof(SAVE_STATE_MAGIC)] = static_cast<Byte>(SAVE_STATE_VERSION + 1);
+		REQUIRE_THROWS(bus->loadState(wrongVersion.data(), wrongVersion.size()));
+	}
+}
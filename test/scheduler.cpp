@@ -0,0 +1,75 @@
+#include <blaze/Scheduler.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+using namespace Blaze;
+
+TEST_CASE("Scheduler", "[scheduler]") {
+	Scheduler scheduler;
+	std::vector<int> fired;
+
+	auto first = scheduler.registerEvent([&](MasterCycles) { fired.push_back(1); });
+	auto second = scheduler.registerEvent([&](MasterCycles) { fired.push_back(2); });
+
+	REQUIRE(scheduler.nextEventTime() == Scheduler::NEVER);
+
+	SECTION("Events run in time order") {
+		scheduler.schedule(second, 200);
+		scheduler.schedule(first, 100);
+		REQUIRE(scheduler.nextEventTime() == 100);
+
+		scheduler.advance(150);
+		REQUIRE(fired == std::vector<int> { 1 });
+		REQUIRE(scheduler.now() == 150);
+
+		scheduler.advanceTo(200);
+		REQUIRE(fired == std::vector<int> { 1, 2 });
+		REQUIRE(scheduler.nextEventTime() == Scheduler::NEVER);
+	}
+
+	SECTION("Events due at the same time run in the order they were scheduled") {
+		scheduler.schedule(second, 100);
+		scheduler.schedule(first, 100);
+		scheduler.advance(100);
+		REQUIRE(fired == std::vector<int> { 2, 1 });
+	}
+
+	SECTION("Cancelled events don't run") {
+		scheduler.schedule(first, 100);
+		scheduler.schedule(second, 100);
+		scheduler.cancel(first);
+		REQUIRE_FALSE(scheduler.isPending(first));
+		REQUIRE(scheduler.isPending(second));
+
+		scheduler.advance(1000);
+		REQUIRE(fired == std::vector<int> { 2 });
+	}
+
+	SECTION("Periodic events") {
+		std::vector<MasterCycles> times;
+		Scheduler::EventType periodic = 0;
+		periodic = scheduler.registerEvent([&](MasterCycles time) {
+			times.push_back(time);
+			scheduler.schedule(periodic, time + 100);
+		});
+
+		scheduler.schedule(periodic, 100);
+		scheduler.advance(350);
+		REQUIRE(times == std::vector<MasterCycles> { 100, 200, 300 });
+		REQUIRE(scheduler.nextEventTime() == 400);
+	}
+
+	SECTION("Resetting drops pending events") {
+		scheduler.schedule(first, 100);
+		scheduler.advance(50);
+		scheduler.reset();
+		REQUIRE(scheduler.now() == 0);
+		REQUIRE(scheduler.nextEventTime() == Scheduler::NEVER);
+
+		// registrations survive a reset
+		scheduler.schedule(first, 10);
+		scheduler.advance(10);
+		REQUIRE(fired == std::vector<int> { 1 });
+	}
+}
@@ -0,0 +1,139 @@
+#include <blaze/Bus.hpp>
+#include <blaze/TileCache.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <vector>
+
+using namespace Blaze;
+
+// the color index of one pixel from a row returned by `TileCache::row`
+static Byte pixelAt(uint64_t row, unsigned x) {
+	return static_cast<Byte>(row >> (x * 8));
+}
+
+TEST_CASE("Tile cache", "[tilecache]") {
+	std::vector<Word> vram(TileCache::VRAM_WORDS);
+	TileCache tiles(vram.data());
+
+	SECTION("Tiles are decoded from their bitplanes") {
+		// 2bpp tile 3, row 2: plane 0 is %10000001, plane 1 is %11000000
+		vram[3 * 8 + 2] = 0xc081;
+		uint64_t row = tiles.row(2, 3 * 8, 2);
+		REQUIRE(pixelAt(row, 0) == 3);
+		REQUIRE(pixelAt(row, 1) == 2);
+		REQUIRE(pixelAt(row, 2) == 0);
+		REQUIRE(pixelAt(row, 7) == 1);
+
+		// 4bpp tile 1, row 0: planes 2 and 3 are 8 words after planes 0 and 1
+		vram[16 + 0] = 0x0080;
+		vram[16 + 8] = 0x8000;
+		REQUIRE(pixelAt(tiles.row(4, 16, 0), 0) == 0x09);
+
+		// 8bpp tile 2, row 7: only plane 7 is set
+		vram[64 + 24 + 7] = 0x0100;
+		REQUIRE(pixelAt(tiles.row(8, 64, 7), 7) == 0x80);
+	}
+
+	SECTION("Tiles are only decoded again after they're invalidated") {
+		vram[5 * 16 + 3] = 0x00ff;
+		REQUIRE(pixelAt(tiles.row(4, 5 * 16, 3), 0) == 1);
+
+		// (this doesn't tell the cache)
+		vram[5 * 16 + 3] = 0xff00;
+		REQUIRE(pixelAt(tiles.row(4, 5 * 16, 3), 0) == 1);
+
+		// the same word is part of a 2bpp tile and an 8bpp one, too
+		tiles.invalidate(5 * 16 + 3);
+		REQUIRE(pixelAt(tiles.row(4, 5 * 16, 3), 0) == 2);
+		REQUIRE(pixelAt(tiles.row(2, 5 * 16, 3), 0) == 2);
+		// (in the 8bpp tile, that word holds planes 4 and 5)
+		REQUIRE(pixelAt(tiles.row(8, 2 * 32, 3), 0) == 0x20);
+
+		// ranges cover every tile they touch, wrapping around the end of VRAM
+		vram[0x7ff8] = 0x0001;
+		vram[0x0007] = 0x0001;
+		tiles.row(2, 0x7ff8, 0);
+		tiles.row(2, 0x0000, 7);
+		vram[0x7ff8] = 0x0002;
+		vram[0x0007] = 0x0002;
+		tiles.invalidate(0x7ffc, 12);
+		REQUIRE(pixelAt(tiles.row(2, 0x7ff8, 0), 6) == 1);
+		REQUIRE(pixelAt(tiles.row(2, 0x0000, 7), 6) == 1);
+	}
+
+	SECTION("Dirty tiles can all be decoded at once") {
+		vram[7 * 16 + 2] = 0x0080;
+		TileCache::DecodedTiles decoded = tiles.decodeDirty(4);
+		REQUIRE(pixelAt(decoded.row(7, 2), 0) == 1);
+		// (tile numbers wrap around the end of VRAM)
+		REQUIRE(decoded.row(7 + 0x800, 2) == decoded.row(7, 2));
+
+		vram[7 * 16 + 2] = 0x8000;
+		tiles.invalidate(7 * 16 + 2);
+		REQUIRE(pixelAt(tiles.decodeDirty(4).row(7, 2), 0) == 2);
+		// (and `row` doesn't decode it a second time)
+		vram[7 * 16 + 2] = 0x0000;
+		REQUIRE(pixelAt(tiles.row(4, 7 * 16, 2), 0) == 2);
+	}
+}
+
+TEST_CASE("The PPU keeps the tile cache up to date", "[tilecache]") {
+	auto bus = std::make_unique<Bus>();
+	constexpr unsigned LINE = 1;
+
+	// mode 0, BG1's tilemap at $0400 (all tile 0), with its tiles at $0000
+	bus->write(0x2100, Byte(0x0f));
+	bus->write(0x2107, Byte(0x04));
+	bus->write(0x212c, Byte(0x01));
+	bus->ppu.cgram[1] = 0x001f;
+	bus->ppu.cgram[2] = 0x03e0;
+	bus->ppu.cgram[3] = 0x7c00;
+
+	auto firstPixel = [&] {
+		bus->ppu.renderLine(LINE);
+		return bus->ppu.frameBuffer[0];
+	};
+	REQUIRE(firstPixel() == 0x0000);
+
+	SECTION("Writes through the VRAM ports") {
+		// tile 0's row 1 (the one line 1 shows)
+		bus->write(0x2115, Byte(0x80));
+		bus->write(0x2116, Word(0x0001));
+		bus->write(0x2118, Word(0x0080));
+		REQUIRE(firstPixel() == 0x001f);
+
+		bus->write(0x2116, Word(0x0001));
+		bus->write(0x2119, Byte(0x80));
+		REQUIRE(firstPixel() == 0x7c00);
+	}
+
+	SECTION("DMA") {
+		const std::vector<Byte> tile = { 0x00, 0x00, 0x00, 0x80 };
+		for (Address i = 0; i < tile.size(); ++i) {
+			bus->write(0x7e0000 + i, tile[i]);
+		}
+		bus->write(0x2115, Byte(0x80));
+		bus->write(0x2116, Word(0x0000));
+		bus->write(0x4300, Byte(0x01));
+		bus->write(0x4301, Byte(0x18));
+		bus->write(0x4302, Word(0x0000));
+		bus->write(0x4304, Byte(0x7e));
+		bus->write(0x4305, Word(tile.size()));
+		bus->write(0x420b, Byte(0x01));
+		REQUIRE(firstPixel() == 0x03e0);
+	}
+
+	SECTION("Loading a state") {
+		std::vector<Byte> state(bus->saveStateSize());
+		bus->saveState(state.data(), state.size());
+
+		bus->write(0x2115, Byte(0x80));
+		bus->write(0x2116, Word(0x0001));
+		bus->write(0x2118, Word(0x0080));
+		REQUIRE(firstPixel() == 0x001f);
+
+		bus->loadState(state.data(), state.size());
+		REQUIRE(firstPixel() == 0x0000);
+	}
+}
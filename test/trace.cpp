@@ -0,0 +1,149 @@
+#include <blaze/Bus.hpp>
+#include <blaze/Trace.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "helpers.hpp"
+
+using namespace Blaze;
+using namespace Blaze::Test;
+
+TEST_CASE("Instruction traces", "[trace]") {
+	auto bus = std::make_unique<Bus>();
+	loadCounterProgram(*bus);
+
+	SECTION("Every instruction is recorded with the registers before it executed") {
+		TraceBuffer trace(16);
+		bus->cpu.trace = &trace;
+
+		for (int i = 0; i < 5; ++i) {
+			bus->cpu.clock();
+		}
+
+		REQUIRE(trace.size() == 5);
+		auto records = trace.records();
+
+		REQUIRE(records[0].pc == 0x7e0000);
+		REQUIRE(records[0].size == 1);
+		REQUIRE(records[0].bytes[0] == 0x18);
+		REQUIRE(records[0].e == 1);
+		REQUIRE(records[0].cycle == 0);
+
+		REQUIRE(records[2].pc == 0x7e0002);
+		REQUIRE(records[2].size == 2);
+		REQUIRE(records[2].bytes[1] == 0x20);
+		REQUIRE(records[2].e == 0);
+		REQUIRE(records[2].cycle > records[1].cycle);
+
+		REQUIRE(records[4].pc == 0x7e0005);
+		REQUIRE(records[4].size == 3);
+		REQUIRE(records[4].a == 1);
+
+		REQUIRE(formatTraceRecord(records[4]).rfind("7e:0005  8d 00 10     STA $1000", 0) == 0);
+	}
+
+	SECTION("Only the newest records are kept") {
+		TraceBuffer trace(4);
+		bus->cpu.trace = &trace;
+
+		// the same program on another machine, with room for everything
+		auto reference = std::make_unique<Bus>();
+		loadCounterProgram(*reference);
+		TraceBuffer fullTrace(16);
+		reference->cpu.trace = &fullTrace;
+
+		for (int i = 0; i < 10; ++i) {
+			bus->cpu.clock();
+			reference->cpu.clock();
+		}
+
+		REQUIRE(trace.capacity() == 4);
+		REQUIRE(trace.totalRecorded() == 10);
+		REQUIRE(trace.size() == 4);
+
+		auto records = trace.records();
+		auto allRecords = fullTrace.records();
+		REQUIRE(allRecords.size() == 10);
+		for (size_t i = 0; i < records.size(); ++i) {
+			REQUIRE(formatTraceRecord(records[i]) == formatTraceRecord(allRecords[6 + i]));
+		}
+	}
+
+	SECTION("Saving and loading traces") {
+		TraceBuffer trace(64);
+		bus->cpu.trace = &trace;
+
+		for (int i = 0; i < 20; ++i) {
+			bus->cpu.clock();
+		}
+
+		auto path = (std::filesystem::temp_directory_path() / "blaze-test.trace").string();
+		trace.save(path);
+		auto loaded = loadTrace(path);
+		std::filesystem::remove(path);
+
+		auto records = trace.records();
+		REQUIRE(loaded.size() == records.size());
+		for (size_t i = 0; i < records.size(); ++i) {
+			REQUIRE(formatTraceRecord(loaded[i]) == formatTraceRecord(records[i]));
+		}
+	}
+}
+
+TEST_CASE("Traces size immediates by the register they're for", "[trace]") {
+	auto bus = std::make_unique<Bus>();
+	const Byte program[] = {
+		0x18,             // clc
+		0xfb,             // xce (switch to native mode)
+		0xc2, 0x10,       // rep #$10 (16-bit index registers, but still an 8-bit accumulator)
+		0xa2, 0x34, 0x12, // ldx #$1234
+		0xa9, 0x56,       // lda #$56
+	};
+	Address address = 0x7e0000;
+	for (auto byte: program) {
+		bus->write(address++, byte);
+	}
+	bus->cpu.PBR = 0x7e;
+	bus->cpu.PC = 0;
+
+	TraceBuffer trace(8);
+	bus->cpu.trace = &trace;
+	for (int i = 0; i < 5; ++i) {
+		bus->cpu.clock();
+	}
+
+	auto records = trace.records();
+	REQUIRE(records.size() == 5);
+	REQUIRE(records[3].size == 3);
+	REQUIRE(formatTraceRecord(records[3]).rfind("7e:0004  a2 34 12     LDX #$1234", 0) == 0);
+	REQUIRE(records[4].pc == 0x7e0007);
+	REQUIRE(records[4].size == 2);
+	REQUIRE(formatTraceRecord(records[4]).rfind("7e:0007  a9 56        LDA #$56", 0) == 0);
+}
+
+TEST_CASE("Disassembly", "[trace]") {
+	auto check = [](std::initializer_list<Byte> bytes, Address pc = 0) {
+		std::vector<Byte> buffer(bytes);
+		return disassemble(buffer.data(), static_cast<Byte>(buffer.size()), pc);
+	};
+
+	REQUIRE(check({ 0xa9, 0x48 }) == "LDA #$48");
+	REQUIRE(check({ 0xa9, 0x34, 0x12 }) == "LDA #$1234");
+	REQUIRE(check({ 0xbd, 0x34, 0x12 }) == "LDA $1234,x");
+	REQUIRE(check({ 0xb7, 0x10 }) == "LDA [$10],y");
+	REQUIRE(check({ 0xa3, 0x03 }) == "LDA $03,s");
+	REQUIRE(check({ 0x22, 0x56, 0x34, 0x12 }) == "JSL $123456");
+	REQUIRE(check({ 0x6c, 0x34, 0x12 }) == "JMP ($1234)");
+	REQUIRE(check({ 0xdc, 0x34, 0x12 }) == "JML [$1234]");
+	REQUIRE(check({ 0x54, 0x7f, 0x7e }) == "MVN $7e,$7f");
+	REQUIRE(check({ 0x0a }) == "ASL a");
+	REQUIRE(check({ 0xea }) == "NOP");
+
+	// branch targets are relative to the next instruction
+	REQUIRE(check({ 0xf0, 0x02 }, 0x7e8000) == "BEQ $8004");
+	REQUIRE(check({ 0x80, 0xfe }, 0x7e8000) == "BRA $8000");
+	REQUIRE(check({ 0x82, 0x00, 0x10 }, 0x7e8000) == "BRL $9003");
+}